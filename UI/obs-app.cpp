@@ -384,6 +384,7 @@ bool OBSApp::InitGlobalConfigDefaults()
 				  DEFAULT_LANG);
 	config_set_default_uint(globalConfig, "General", "MaxLogs", 10);
 	config_set_default_int(globalConfig, "General", "InfoIncrement", -1);
+	config_set_default_int(globalConfig, "General", "MaxRemuxJobs", 2);
 	config_set_default_string(globalConfig, "General", "ProcessPriority",
 				  "Normal");
 	config_set_default_bool(globalConfig, "General", "EnableAutoUpdates",
@@ -1287,7 +1288,16 @@ static bool StartupOBS(const char *locale, profiler_name_store_t *store)
 	if (GetConfigPath(path, sizeof(path), "obs-studio/plugin_config") <= 0)
 		return false;
 
-	return obs_startup(locale, path, store);
+	if (!obs_startup(locale, path, store))
+		return false;
+
+	if (GetConfigPath(path, sizeof(path), "obs-studio/plugin_cache.json") >
+	    0)
+		obs_set_module_cache_path(path);
+	if (GetConfigPath(path, sizeof(path), "obs-studio/shader_cache") > 0)
+		obs_set_program_cache_path(path);
+
+	return true;
 }
 
 inline void OBSApp::ResetHotkeyState(bool inFocus)
@@ -1633,6 +1643,14 @@ string GenerateSpecifiedFilename(const char *extension, bool noSpace,
 {
 	OBSBasic *main = reinterpret_cast<OBSBasic *>(App()->GetMainWindow());
 	bool autoRemux = config_get_bool(main->Config(), "Video", "AutoRemux");
+	bool fragmented = config_get_bool(main->Config(), "Output",
+					  "FragmentedRecording");
+
+	/* fragmented mp4/mov files survive a crash, so there's nothing to
+	 * gain from recording to mkv and remuxing afterwards */
+	if (fragmented && (strcmp(extension, "mp4") == 0 ||
+			   strcmp(extension, "mov") == 0))
+		autoRemux = false;
 
 	if ((strcmp(extension, "mp4") == 0) && autoRemux)
 		extension = "mkv";
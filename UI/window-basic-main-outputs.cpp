@@ -1038,6 +1038,9 @@ bool SimpleOutput::ConfigureRecording(bool updateReplayBuffer)
 	}
 
 	obs_data_set_string(settings, "muxer_settings", mux);
+	obs_data_set_bool(settings, "fragmented",
+			  config_get_bool(main->Config(), "Output",
+					  "FragmentedRecording"));
 
 	if (updateReplayBuffer)
 		obs_output_update(replayBuffer, settings);
@@ -1441,6 +1444,9 @@ inline void AdvancedOutput::SetupRecording()
 
 	obs_data_set_string(settings, "path", path);
 	obs_data_set_string(settings, "muxer_settings", mux);
+	obs_data_set_bool(settings, "fragmented",
+			  config_get_bool(main->Config(), "Output",
+					  "FragmentedRecording"));
 	obs_output_update(fileOutput, settings);
 	if (replayBuffer)
 		obs_output_update(replayBuffer, settings);
@@ -1342,6 +1342,9 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_uint(basicConfig, "Output", "DelaySec", 20);
 	config_set_default_bool(basicConfig, "Output", "DelayPreserve", true);
 
+	config_set_default_bool(basicConfig, "Output", "FragmentedRecording",
+				false);
+
 	config_set_default_bool(basicConfig, "Output", "Reconnect", true);
 	config_set_default_uint(basicConfig, "Output", "RetryDelay", 10);
 	config_set_default_uint(basicConfig, "Output", "MaxRetries", 20);
@@ -4508,6 +4511,14 @@ void OBSBasic::SetDeinterlacingOrder()
 	obs_source_set_deinterlace_field_order(source, order);
 }
 
+void OBSBasic::SetDeinterlacingCPU(bool cpu)
+{
+	OBSSceneItem sceneItem = GetCurrentSceneItem();
+	obs_source_t *source = obs_sceneitem_get_source(sceneItem);
+
+	obs_source_set_deinterlace_cpu(source, cpu);
+}
+
 QMenu *OBSBasic::AddDeinterlacingMenu(QMenu *menu, obs_source_t *source)
 {
 	obs_deinterlace_mode deinterlaceMode =
@@ -4547,6 +4558,14 @@ QMenu *OBSBasic::AddDeinterlacingMenu(QMenu *menu, obs_source_t *source)
 	ADD_ORDER("BottomFieldFirst", OBS_DEINTERLACE_FIELD_ORDER_BOTTOM);
 #undef ADD_ORDER
 
+	menu->addSeparator();
+
+	action = menu->addAction(QTStr("Deinterlacing.CPU"));
+	action->setCheckable(true);
+	action->setChecked(obs_source_get_deinterlace_cpu(source));
+	connect(action, &QAction::toggled, this,
+		&OBSBasic::SetDeinterlacingCPU);
+
 	return menu;
 }
 
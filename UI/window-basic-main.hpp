@@ -613,6 +613,7 @@ private slots:
 
 	void SetDeinterlacingMode();
 	void SetDeinterlacingOrder();
+	void SetDeinterlacingCPU(bool cpu);
 
 	void SetScaleFilter();
 
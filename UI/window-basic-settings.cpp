@@ -557,6 +557,7 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	HookWidget(ui->enableLowLatencyMode, CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->hotkeyFocusType,      COMBO_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->autoRemux,            CHECK_CHANGED,  ADV_CHANGED);
+	HookWidget(ui->fragmentedRec,        CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->dynBitrate,           CHECK_CHANGED,  ADV_CHANGED);
 	/* clang-format on */
 
@@ -757,6 +758,8 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 		SLOT(SimpleRecordingEncoderChanged()));
 	connect(ui->simpleOutEnforce, SIGNAL(toggled(bool)), this,
 		SLOT(SimpleRecordingEncoderChanged()));
+	connect(ui->fragmentedRec, SIGNAL(toggled(bool)), this,
+		SLOT(SimpleRecordingEncoderChanged()));
 	connect(ui->simpleReplayBuf, SIGNAL(toggled(bool)), this,
 		SLOT(SimpleReplayBufferChanged()));
 	connect(ui->simpleOutputVBitrate, SIGNAL(valueChanged(int)), this,
@@ -818,6 +821,8 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	LoadSettings(false);
 
 	// Add warning checks to advanced output recording section controls
+	connect(ui->fragmentedRec, SIGNAL(toggled(bool)), this,
+		SLOT(AdvOutRecCheckWarnings()));
 	connect(ui->advOutRecTrack1, SIGNAL(clicked()), this,
 		SLOT(AdvOutRecCheckWarnings()));
 	connect(ui->advOutRecTrack2, SIGNAL(clicked()), this,
@@ -2416,6 +2421,8 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	int rbTime = config_get_int(main->Config(), "AdvOut", "RecRBTime");
 	int rbSize = config_get_int(main->Config(), "AdvOut", "RecRBSize");
 	bool autoRemux = config_get_bool(main->Config(), "Video", "AutoRemux");
+	bool fragmentedRec =
+		config_get_bool(main->Config(), "Output", "FragmentedRecording");
 	const char *hotkeyFocusType = config_get_string(
 		App()->GlobalConfig(), "General", "HotkeyFocusType");
 	bool dynBitrate =
@@ -2447,6 +2454,7 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	ui->streamDelayPreserve->setChecked(preserveDelay);
 	ui->streamDelayEnable->setChecked(enableDelay);
 	ui->autoRemux->setChecked(autoRemux);
+	ui->fragmentedRec->setChecked(fragmentedRec);
 	ui->dynBitrate->setChecked(dynBitrate);
 
 	SetComboByName(ui->colorFormat, videoColorFormat);
@@ -3160,6 +3168,7 @@ void OBSBasicSettings::SaveAdvancedSettings()
 	SaveSpinBox(ui->reconnectMaxRetries, "Output", "MaxRetries");
 	SaveComboData(ui->bindToIP, "Output", "BindIP");
 	SaveCheckBox(ui->autoRemux, "Video", "AutoRemux");
+	SaveCheckBox(ui->fragmentedRec, "Output", "FragmentedRecording");
 	SaveCheckBox(ui->dynBitrate, "Output", "DynamicBitrate");
 
 #if defined(_WIN32) || defined(__APPLE__) || HAVE_PULSEAUDIO
@@ -4190,8 +4199,9 @@ void OBSBasicSettings::AdvOutRecCheckWarnings()
 			errorMsg = QTStr("OutputWarnings.NoTracksSelected");
 	}
 
-	if (ui->advOutRecFormat->currentText().compare("mp4") == 0 ||
-	    ui->advOutRecFormat->currentText().compare("mov") == 0) {
+	if (!ui->fragmentedRec->isChecked() &&
+	    (ui->advOutRecFormat->currentText().compare("mp4") == 0 ||
+	     ui->advOutRecFormat->currentText().compare("mov") == 0)) {
 		if (!warningMsg.isEmpty())
 			warningMsg += "\n\n";
 		warningMsg += QTStr("OutputWarnings.MP4Recording");
@@ -4654,7 +4664,7 @@ void OBSBasicSettings::SimpleRecordingEncoderChanged()
 		warning += SIMPLE_OUTPUT_WARNING("CannotPause");
 	}
 
-	if (qual != "Lossless" &&
+	if (qual != "Lossless" && !ui->fragmentedRec->isChecked() &&
 	    (ui->simpleOutRecFormat->currentText().compare("mp4") == 0 ||
 	     ui->simpleOutRecFormat->currentText().compare("mov") == 0)) {
 		if (!warning.isEmpty())
@@ -72,12 +72,14 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closeable)
 
 	fps = new QLabel(this);
 	renderTime = new QLabel(this);
+	drawCalls = new QLabel(this);
 	skippedFrames = new QLabel(this);
 	missedFrames = new QLabel(this);
 	row = 0;
 
 	newStatBare("FPS", fps, 2);
 	newStat("AverageTimeToRender", renderTime, 2);
+	newStat("DrawCalls", drawCalls, 2);
 	newStat("MissedFrames", missedFrames, 2);
 	newStat("SkippedFrames", skippedFrames, 2);
 
@@ -339,6 +341,10 @@ void OBSBasicStats::Update()
 
 	/* ------------------ */
 
+	drawCalls->setText(QString::number(obs_get_average_draw_calls()));
+
+	/* ------------------ */
+
 	video_t *video = obs_get_video();
 	uint32_t total_encoded = video_output_get_total_frames(video);
 	uint32_t total_skipped = video_output_get_skipped_frames(video);
@@ -463,6 +469,32 @@ void OBSBasicStats::Reset()
 	Update();
 }
 
+void OBSBasicStats::OutputLabels::UpdateWriteStats(obs_output_t *output,
+						  bool active)
+{
+	proc_handler_t *ph = output ? obs_output_get_proc_handler(output)
+				    : nullptr;
+	calldata_t cd = {0};
+	QString tip;
+
+	if (active && ph && proc_handler_call(ph, "get_write_stats", &cd) &&
+	    calldata_int(&cd, "max_latency_us") > 0) {
+		long long avg = calldata_int(&cd, "avg_latency_us");
+		long long max = calldata_int(&cd, "max_latency_us");
+		long long slow = calldata_int(&cd, "slow_writes");
+		long long pending = calldata_int(&cd, "pending_bytes");
+
+		tip = QTStr("Basic.Stats.DiskWriteLatency")
+			      .arg(QString::number(avg / 1000.0, 'f', 1),
+				   QString::number(max / 1000.0, 'f', 1),
+				   QString::number(slow),
+				   QString::number(pending / 1024));
+	}
+
+	calldata_free(&cd);
+	status->setToolTip(tip);
+}
+
 void OBSBasicStats::OutputLabels::Update(obs_output_t *output, bool rec)
 {
 	uint64_t totalBytes = output ? obs_output_get_total_bytes(output) : 0;
@@ -507,6 +539,9 @@ void OBSBasicStats::OutputLabels::Update(obs_output_t *output, bool rec)
 	status->setText(str);
 	setThemeID(status, themeID);
 
+	if (rec)
+		UpdateWriteStats(output, active);
+
 	long double num = (long double)totalBytes / (1024.0l * 1024.0l);
 
 	megabytesSent->setText(
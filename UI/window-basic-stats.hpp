@@ -22,6 +22,7 @@ class OBSBasicStats : public QWidget {
 	QLabel *memUsage = nullptr;
 
 	QLabel *renderTime = nullptr;
+	QLabel *drawCalls = nullptr;
 	QLabel *skippedFrames = nullptr;
 	QLabel *missedFrames = nullptr;
 
@@ -48,6 +49,7 @@ class OBSBasicStats : public QWidget {
 		int first_dropped = 0;
 
 		void Update(obs_output_t *output, bool rec);
+		void UpdateWriteStats(obs_output_t *output, bool active);
 		void Reset(obs_output_t *output);
 
 		long double kbps = 0.0l;
@@ -35,6 +35,7 @@
 
 #include "qt-wrappers.hpp"
 
+#include <algorithm>
 #include <memory>
 #include <cmath>
 
@@ -582,11 +583,12 @@ void RemuxQueueModel::endProcessing()
 			 index(queue.length(), RemuxEntryColumn::State));
 }
 
-bool RemuxQueueModel::beginNextEntry(QString &inputPath, QString &outputPath)
+bool RemuxQueueModel::beginNextEntry(int &row, QString &inputPath,
+				     QString &outputPath)
 {
 	bool anyStarted = false;
 
-	for (int row = 0; row < queue.length(); row++) {
+	for (row = 0; row < queue.length(); row++) {
 		RemuxQueueEntry &entry = queue[row];
 		if (entry.state == RemuxEntryState::Pending) {
 			entry.state = RemuxEntryState::InProgress;
@@ -606,23 +608,22 @@ bool RemuxQueueModel::beginNextEntry(QString &inputPath, QString &outputPath)
 	return anyStarted;
 }
 
-void RemuxQueueModel::finishEntry(bool success)
+void RemuxQueueModel::finishEntry(int row, bool success)
 {
-	for (int row = 0; row < queue.length(); row++) {
-		RemuxQueueEntry &entry = queue[row];
-		if (entry.state == RemuxEntryState::InProgress) {
-			if (success)
-				entry.state = RemuxEntryState::Complete;
-			else
-				entry.state = RemuxEntryState::Error;
+	if (row < 0 || row >= queue.length())
+		return;
 
-			QModelIndex index =
-				this->index(row, RemuxEntryColumn::State);
-			emit dataChanged(index, index);
+	RemuxQueueEntry &entry = queue[row];
+	if (entry.state != RemuxEntryState::InProgress)
+		return;
 
-			break;
-		}
-	}
+	if (success)
+		entry.state = RemuxEntryState::Complete;
+	else
+		entry.state = RemuxEntryState::Error;
+
+	QModelIndex index = this->index(row, RemuxEntryColumn::State);
+	emit dataChanged(index, index);
 }
 
 /**********************************************************
@@ -632,7 +633,7 @@ void RemuxQueueModel::finishEntry(bool success)
 OBSRemux::OBSRemux(const char *path, QWidget *parent, bool autoRemux_)
 	: QDialog(parent),
 	  queueModel(new RemuxQueueModel),
-	  worker(new RemuxWorker()),
+	  updateMutex(QMutex::Recursive),
 	  ui(new Ui::OBSRemux),
 	  recPath(path),
 	  autoRemux(autoRemux_)
@@ -659,6 +660,15 @@ OBSRemux::OBSRemux(const char *path, QWidget *parent, bool autoRemux_)
 	ui->progressBar->setMaximum(1000);
 	ui->progressBar->setValue(0);
 
+	maxJobs = (int)config_get_int(App()->GlobalConfig(), "General",
+				      "MaxRemuxJobs");
+	maxJobs = std::max(1, std::min(maxJobs, ui->maxJobs->maximum()));
+	ui->maxJobs->setValue(maxJobs);
+	ui->maxJobs->setVisible(!autoRemux);
+	ui->maxJobsLabel->setVisible(!autoRemux);
+	connect(ui->maxJobs, SIGNAL(valueChanged(int)), this,
+		SLOT(maxJobsChanged(int)));
+
 	ui->tableView->setModel(queueModel);
 	ui->tableView->setItemDelegateForColumn(
 		RemuxEntryColumn::InputPath,
@@ -692,18 +702,6 @@ OBSRemux::OBSRemux(const char *path, QWidget *parent, bool autoRemux_)
 	connect(ui->buttonBox->button(QDialogButtonBox::Close),
 		SIGNAL(clicked()), this, SLOT(close()));
 
-	worker->moveToThread(&remuxer);
-	remuxer.start();
-
-	//gcc-4.8 can't use QPointer<RemuxWorker> below
-	RemuxWorker *worker_ = worker;
-	connect(worker_, &RemuxWorker::updateProgress, this,
-		&OBSRemux::updateProgress);
-	connect(&remuxer, &QThread::finished, worker_, &QObject::deleteLater);
-	connect(worker_, &RemuxWorker::remuxFinished, this,
-		&OBSRemux::remuxFinished);
-	connect(this, &OBSRemux::remux, worker_, &RemuxWorker::remux);
-
 	// Guessing the GCC bug mentioned above would also affect
 	// QPointer<RemuxQueueModel>? Unsure.
 	RemuxQueueModel *queueModel_ = queueModel;
@@ -719,15 +717,82 @@ OBSRemux::OBSRemux(const char *path, QWidget *parent, bool autoRemux_)
 				  Q_ARG(const QModelIndex &, index));
 }
 
+bool OBSRemux::isRemuxing() const
+{
+	for (RemuxWorker *worker : workers)
+		if (worker->busy)
+			return true;
+	return false;
+}
+
+/* Workers are created on demand, so a queue shorter than the job limit
+ * doesn't spin up threads it never uses. */
+RemuxWorker *OBSRemux::idleWorker()
+{
+	int busy = 0;
+
+	for (RemuxWorker *worker : workers) {
+		if (!worker->busy)
+			return worker;
+		busy++;
+	}
+
+	if (busy >= maxJobs)
+		return nullptr;
+
+	QThread *thread = new QThread(this);
+	RemuxWorker *worker = new RemuxWorker(&updateMutex);
+
+	worker->moveToThread(thread);
+	connect(worker, &RemuxWorker::updateProgress, this,
+		&OBSRemux::updateProgress);
+	connect(worker, &RemuxWorker::remuxFinished, this,
+		&OBSRemux::remuxFinished);
+	connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+	thread->start();
+
+	remuxers.append(thread);
+	workers.append(worker);
+	return worker;
+}
+
+void OBSRemux::startRemux(RemuxWorker *worker, int row, const QString &source,
+			  const QString &target)
+{
+	{
+		QMutexLocker lock(&updateMutex);
+		worker->isWorking = true;
+	}
+
+	worker->busy = true;
+	worker->row = row;
+	worker->lastProgress = 0.f;
+	jobProgress[row] = 0.f;
+
+	QMetaObject::invokeMethod(worker, "remux", Qt::QueuedConnection,
+				  Q_ARG(int, row), Q_ARG(QString, source),
+				  Q_ARG(QString, target));
+}
+
+void OBSRemux::maxJobsChanged(int value)
+{
+	maxJobs = value;
+	config_set_int(App()->GlobalConfig(), "General", "MaxRemuxJobs",
+		       value);
+
+	if (isRemuxing())
+		remuxNextEntry();
+}
+
 bool OBSRemux::stopRemux()
 {
-	if (!worker->isWorking)
+	if (!isRemuxing())
 		return true;
 
-	// By locking the worker thread's mutex, we ensure that its
-	// update poll will be blocked as long as we're in here with
+	// By locking the worker threads' mutex, we ensure that their
+	// update polls will be blocked as long as we're in here with
 	// the popup open.
-	QMutexLocker lock(&worker->updateMutex);
+	QMutexLocker lock(&updateMutex);
 
 	bool exit = false;
 
@@ -739,10 +804,12 @@ bool OBSRemux::stopRemux()
 	}
 
 	if (exit) {
-		// Inform the worker it should no longer be
-		// working. It will interrupt accordingly in
-		// its next update callback.
-		worker->isWorking = false;
+		// Inform the workers they should no longer be
+		// working. They will interrupt accordingly in
+		// their next update callback.
+		for (RemuxWorker *worker : workers)
+			worker->isWorking = false;
+		stopping = true;
 	}
 
 	return exit;
@@ -751,8 +818,11 @@ bool OBSRemux::stopRemux()
 OBSRemux::~OBSRemux()
 {
 	stopRemux();
-	remuxer.quit();
-	remuxer.wait();
+
+	for (QThread *remuxer : remuxers) {
+		remuxer->quit();
+		remuxer->wait();
+	}
 }
 
 void OBSRemux::rowCountChanged(const QModelIndex &, int, int)
@@ -820,13 +890,13 @@ void OBSRemux::dropEvent(QDropEvent *ev)
 
 void OBSRemux::dragEnterEvent(QDragEnterEvent *ev)
 {
-	if (ev->mimeData()->hasUrls() && !worker->isWorking)
+	if (ev->mimeData()->hasUrls() && !isRemuxing())
 		ev->accept();
 }
 
 void OBSRemux::beginRemux()
 {
-	if (worker->isWorking) {
+	if (isRemuxing()) {
 		stopRemux();
 		return;
 	}
@@ -853,6 +923,15 @@ void OBSRemux::beginRemux()
 	// Set all jobs to "pending" first.
 	queueModel->beginProcessing();
 
+	stopping = false;
+	finishedJobs = 0;
+	totalJobs = 0;
+	jobProgress.clear();
+	for (int row = 0; row < queueModel->queue.length(); row++)
+		if (queueModel->queue[row].state == RemuxEntryState::Pending)
+			totalJobs++;
+	ui->progressBar->setValue(0);
+
 	ui->progressBar->setVisible(true);
 	ui->buttonBox->button(QDialogButtonBox::Ok)
 		->setText(QTStr("Remux.Stop"));
@@ -864,19 +943,29 @@ void OBSRemux::beginRemux()
 void OBSRemux::AutoRemux(QString inFile, QString outFile)
 {
 	if (inFile != "" && outFile != "" && autoRemux) {
-		emit remux(inFile, outFile);
+		totalJobs = 1;
+		finishedJobs = 0;
+		startRemux(idleWorker(), -1, inFile, outFile);
 		autoRemuxFile = inFile;
 	}
 }
 
 void OBSRemux::remuxNextEntry()
 {
-	worker->lastProgress = 0.f;
+	while (!stopping) {
+		RemuxWorker *worker = idleWorker();
+		if (!worker)
+			break;
 
-	QString inputPath, outputPath;
-	if (queueModel->beginNextEntry(inputPath, outputPath)) {
-		emit remux(inputPath, outputPath);
-	} else {
+		int row;
+		QString inputPath, outputPath;
+		if (!queueModel->beginNextEntry(row, inputPath, outputPath))
+			break;
+
+		startRemux(worker, row, inputPath, outputPath);
+	}
+
+	if (!isRemuxing()) {
 		queueModel->autoRemux = autoRemux;
 		queueModel->endProcessing();
 
@@ -915,16 +1004,44 @@ void OBSRemux::reject()
 	QDialog::reject();
 }
 
-void OBSRemux::updateProgress(float percent)
+void OBSRemux::updateTotalProgress()
 {
-	ui->progressBar->setValue(percent * 10);
+	if (!totalJobs)
+		return;
+
+	float total = finishedJobs * 100.f;
+	for (float percent : jobProgress)
+		total += percent;
+
+	ui->progressBar->setValue((int)(total * 10.f / totalJobs));
 }
 
-void OBSRemux::remuxFinished(bool success)
+void OBSRemux::updateProgress(int row, float percent)
+{
+	if (!jobProgress.contains(row))
+		return;
+
+	jobProgress[row] = percent;
+	updateTotalProgress();
+}
+
+void OBSRemux::remuxFinished(int row, bool success)
 {
 	ui->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(true);
 
-	queueModel->finishEntry(success);
+	for (RemuxWorker *worker : workers) {
+		if (worker->busy && worker->row == row) {
+			worker->busy = false;
+			worker->row = -1;
+			break;
+		}
+	}
+
+	jobProgress.remove(row);
+	finishedJobs++;
+	updateTotalProgress();
+
+	queueModel->finishEntry(row, success);
 
 	if (autoRemux && autoRemuxFile != "") {
 		QTimer::singleShot(3000, this, SLOT(close()));
@@ -953,18 +1070,16 @@ void RemuxWorker::UpdateProgress(float percent)
 	if (abs(lastProgress - percent) < 0.1f)
 		return;
 
-	emit updateProgress(percent);
+	emit updateProgress(row, percent);
 	lastProgress = percent;
 }
 
-void RemuxWorker::remux(const QString &source, const QString &target)
+void RemuxWorker::remux(int row, const QString &source, const QString &target)
 {
-	isWorking = true;
-
 	auto callback = [](void *data, float percent) {
 		RemuxWorker *rw = static_cast<RemuxWorker *>(data);
 
-		QMutexLocker lock(&rw->updateMutex);
+		QMutexLocker lock(rw->updateMutex);
 
 		rw->UpdateProgress(percent);
 
@@ -982,10 +1097,14 @@ void RemuxWorker::remux(const QString &source, const QString &target)
 
 		media_remux_job_destroy(mr_job);
 
+		QMutexLocker lock(updateMutex);
 		stopped = !isWorking;
 	}
 
-	isWorking = false;
+	{
+		QMutexLocker lock(updateMutex);
+		isWorking = false;
+	}
 
-	emit remuxFinished(!stopped && success);
+	emit remuxFinished(row, !stopped && success);
 }
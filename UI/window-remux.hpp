@@ -18,6 +18,8 @@
 #pragma once
 
 #include <QFileInfo>
+#include <QHash>
+#include <QList>
 #include <QMutex>
 #include <QPointer>
 #include <QThread>
@@ -46,8 +48,17 @@ class OBSRemux : public QDialog {
 	Q_OBJECT
 
 	QPointer<RemuxQueueModel> queueModel;
-	QThread remuxer;
-	QPointer<RemuxWorker> worker;
+
+	/* one thread per worker, up to maxJobs of them run at once */
+	QList<QThread *> remuxers;
+	QList<RemuxWorker *> workers;
+	QMutex updateMutex;
+	int maxJobs;
+
+	bool stopping = false;
+	int totalJobs = 0;
+	int finishedJobs = 0;
+	QHash<int, float> jobProgress;
 
 	std::unique_ptr<Ui::OBSRemux> ui;
 
@@ -72,21 +83,24 @@ protected:
 	virtual void dropEvent(QDropEvent *ev) override;
 	virtual void dragEnterEvent(QDragEnterEvent *ev) override;
 
+	bool isRemuxing() const;
+	RemuxWorker *idleWorker();
+	void startRemux(RemuxWorker *worker, int row, const QString &source,
+			const QString &target);
 	void remuxNextEntry();
+	void updateTotalProgress();
 
 private slots:
 	void rowCountChanged(const QModelIndex &parent, int first, int last);
+	void maxJobsChanged(int value);
 
 public slots:
-	void updateProgress(float percent);
-	void remuxFinished(bool success);
+	void updateProgress(int row, float percent);
+	void remuxFinished(int row, bool success);
 	void beginRemux();
 	bool stopRemux();
 	void clearFinished();
 	void clearAll();
-
-signals:
-	void remux(const QString &source, const QString &target);
 };
 
 class RemuxQueueModel : public QAbstractTableModel {
@@ -112,8 +126,8 @@ public:
 	bool checkForErrors() const;
 	void beginProcessing();
 	void endProcessing();
-	bool beginNextEntry(QString &inputPath, QString &outputPath);
-	void finishEntry(bool success);
+	bool beginNextEntry(int &row, QString &inputPath, QString &outputPath);
+	void finishEntry(int row, bool success);
 	bool canClearFinished() const;
 	void clearFinished();
 	void clearAll();
@@ -139,22 +153,31 @@ private:
 class RemuxWorker : public QObject {
 	Q_OBJECT
 
-	QMutex updateMutex;
+	QMutex *updateMutex;
 
+	/* cleared to cancel the job, protected by updateMutex */
 	bool isWorking;
 
+	/* the queue row being remuxed, -1 when idle; only touched by the
+	 * dialog's thread */
+	int row = -1;
+	bool busy = false;
+
 	float lastProgress;
 	void UpdateProgress(float percent);
 
-	explicit RemuxWorker() : isWorking(false) {}
+	explicit RemuxWorker(QMutex *updateMutex_)
+		: updateMutex(updateMutex_), isWorking(false)
+	{
+	}
 	virtual ~RemuxWorker(){};
 
 private slots:
-	void remux(const QString &source, const QString &target);
+	void remux(int row, const QString &source, const QString &target);
 
 signals:
-	void updateProgress(float percent);
-	void remuxFinished(bool success);
+	void updateProgress(int row, float percent);
+	void remuxFinished(int row, bool success);
 
 	friend class OBSRemux;
 };
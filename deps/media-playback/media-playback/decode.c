@@ -176,6 +176,13 @@ bool mp_decode_init(mp_media_t *m, enum AVMediaType type, bool hw)
 		return false;
 	}
 
+	d->pres_frame = av_frame_alloc();
+	if (!d->pres_frame) {
+		blog(LOG_WARNING, "MP: Failed to allocate %s frame",
+		     av_get_media_type_string(type));
+		return false;
+	}
+
 	if (d->hw) {
 		d->hw_frame = av_frame_alloc();
 		if (!d->hw_frame) {
@@ -208,10 +215,36 @@ void mp_decode_clear_packets(struct mp_decode *d)
 	}
 }
 
+void mp_decode_clear_frames(struct mp_decode *d)
+{
+	while (d->frames.size) {
+		struct mp_queued_frame qf;
+		circlebuf_pop_front(&d->frames, &qf, sizeof(qf));
+		av_frame_free(&qf.frame);
+	}
+
+	d->frames_eof = false;
+}
+
+void mp_decode_clear_cache(struct mp_decode *d)
+{
+	for (size_t i = 0; i < d->cache.num; i++)
+		av_frame_free(&d->cache.array[i].frame);
+
+	da_free(d->cache);
+	d->cache_pos = 0;
+}
+
 void mp_decode_free(struct mp_decode *d)
 {
 	mp_decode_clear_packets(d);
 	circlebuf_free(&d->packets);
+	mp_decode_clear_frames(d);
+	circlebuf_free(&d->frames);
+	mp_decode_clear_cache(d);
+
+	if (d->pres_frame)
+		av_frame_free(&d->pres_frame);
 
 	if (d->hw_frame) {
 		av_frame_unref(d->hw_frame);
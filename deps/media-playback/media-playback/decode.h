@@ -21,6 +21,7 @@ extern "C" {
 #endif
 
 #include <util/circlebuf.h>
+#include <util/darray.h>
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -52,6 +53,12 @@ extern "C" {
 
 struct mp_media;
 
+struct mp_queued_frame {
+	AVFrame *frame;
+	int64_t pts;
+	int64_t next_pts;
+};
+
 struct mp_decode {
 	struct mp_media *m;
 	AVStream *stream;
@@ -78,6 +85,23 @@ struct mp_decode {
 	AVPacket pkt;
 	bool packet_pending;
 	struct circlebuf packets;
+
+	/* frames decoded ahead by the decode thread, waiting to be
+	 * presented (guarded by the media's queue mutex) */
+	struct circlebuf frames;
+	bool frames_eof;
+
+	/* frame currently held by the presentation thread */
+	AVFrame *pres_frame;
+	int64_t pres_pts;
+	int64_t pres_next_pts;
+	bool pres_ready;
+	bool pres_eof;
+
+	/* every decoded frame of one full pass, replayed on loop/restart
+	 * instead of decoding again */
+	DARRAY(struct mp_queued_frame) cache;
+	size_t cache_pos;
 };
 
 extern bool mp_decode_init(struct mp_media *media, enum AVMediaType type,
@@ -85,6 +109,8 @@ extern bool mp_decode_init(struct mp_media *media, enum AVMediaType type,
 extern void mp_decode_free(struct mp_decode *decode);
 
 extern void mp_decode_clear_packets(struct mp_decode *decode);
+extern void mp_decode_clear_frames(struct mp_decode *decode);
+extern void mp_decode_clear_cache(struct mp_decode *decode);
 
 extern void mp_decode_push_packet(struct mp_decode *decode, AVPacket *pkt);
 extern bool mp_decode_next(struct mp_decode *decode);
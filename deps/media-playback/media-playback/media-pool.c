@@ -0,0 +1,293 @@
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/bmem.h>
+
+#include "media-pool.h"
+
+struct mp_media_client {
+	void *opaque;
+
+	mp_video_cb v_cb;
+	mp_video_cb v_preload_cb;
+	mp_audio_cb a_cb;
+	mp_stop_cb stop_cb;
+	mp_video_cb v_shared_cb;
+};
+
+struct mp_pool_entry {
+	/* must be first so that the mp_media_t handed out can be cast back */
+	mp_media_t media;
+
+	/* NULL for private media, which is not in the pool's list */
+	char *key;
+	long refs;
+	struct mp_pool_entry *next;
+
+	pthread_mutex_t clients_mutex;
+	DARRAY(struct mp_media_client) clients;
+};
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct mp_pool_entry *first_entry = NULL;
+
+/* ------------------------------------------------------------------------- */
+
+static void pool_video(void *opaque, struct obs_source_frame *frame)
+{
+	struct mp_pool_entry *entry = opaque;
+	struct obs_source_frame *shared = NULL;
+
+	pthread_mutex_lock(&entry->clients_mutex);
+
+	/* copied once and referenced by every client rather than copied by
+	 * each of them */
+	if (entry->clients.num > 1)
+		shared = obs_source_frame_create_shared(frame);
+
+	for (size_t i = 0; i < entry->clients.num; i++) {
+		struct mp_media_client *client = &entry->clients.array[i];
+		if (shared && client->v_shared_cb)
+			client->v_shared_cb(client->opaque, shared);
+		else if (client->v_cb)
+			client->v_cb(client->opaque, frame);
+	}
+
+	pthread_mutex_unlock(&entry->clients_mutex);
+
+	obs_source_frame_release_shared(shared);
+}
+
+static void pool_preload_video(void *opaque, struct obs_source_frame *frame)
+{
+	struct mp_pool_entry *entry = opaque;
+
+	pthread_mutex_lock(&entry->clients_mutex);
+	for (size_t i = 0; i < entry->clients.num; i++) {
+		struct mp_media_client *client = &entry->clients.array[i];
+		if (client->v_preload_cb)
+			client->v_preload_cb(client->opaque, frame);
+	}
+	pthread_mutex_unlock(&entry->clients_mutex);
+}
+
+static void pool_audio(void *opaque, struct obs_source_audio *audio)
+{
+	struct mp_pool_entry *entry = opaque;
+
+	pthread_mutex_lock(&entry->clients_mutex);
+	for (size_t i = 0; i < entry->clients.num; i++) {
+		struct mp_media_client *client = &entry->clients.array[i];
+		if (client->a_cb)
+			client->a_cb(client->opaque, audio);
+	}
+	pthread_mutex_unlock(&entry->clients_mutex);
+}
+
+static void pool_stopped(void *opaque)
+{
+	struct mp_pool_entry *entry = opaque;
+
+	pthread_mutex_lock(&entry->clients_mutex);
+	for (size_t i = 0; i < entry->clients.num; i++) {
+		struct mp_media_client *client = &entry->clients.array[i];
+		if (client->stop_cb)
+			client->stop_cb(client->opaque);
+	}
+	pthread_mutex_unlock(&entry->clients_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static char *make_key(const struct mp_media_info *info, bool looping)
+{
+	struct dstr key = {0};
+
+	dstr_printf(&key, "%s|%s|%d|%d|%d|%d|%d|%d|%d", info->path,
+		    info->format ? info->format : "", info->speed,
+		    (int)info->force_range, (int)info->hardware_decoding,
+		    (int)info->is_local_file, info->decode_ahead_frames,
+		    info->frame_cache_mb, (int)looping);
+	return key.array;
+}
+
+static struct mp_pool_entry *find_entry(const char *key)
+{
+	struct mp_pool_entry *entry = first_entry;
+
+	while (entry) {
+		if (strcmp(entry->key, key) == 0)
+			return entry;
+		entry = entry->next;
+	}
+
+	return NULL;
+}
+
+static void remove_entry(struct mp_pool_entry *entry)
+{
+	struct mp_pool_entry **prev = &first_entry;
+
+	while (*prev) {
+		if (*prev == entry) {
+			*prev = entry->next;
+			break;
+		}
+		prev = &(*prev)->next;
+	}
+}
+
+static void add_client(struct mp_pool_entry *entry,
+		       const struct mp_media_client *client)
+{
+	pthread_mutex_lock(&entry->clients_mutex);
+	da_push_back(entry->clients, client);
+	pthread_mutex_unlock(&entry->clients_mutex);
+}
+
+static bool media_playing(mp_media_t *m)
+{
+	bool playing;
+
+	pthread_mutex_lock(&m->mutex);
+	playing = m->active;
+	pthread_mutex_unlock(&m->mutex);
+
+	return playing;
+}
+
+static void entry_destroy(struct mp_pool_entry *entry)
+{
+	pthread_mutex_destroy(&entry->clients_mutex);
+	da_free(entry->clients);
+	bfree(entry->key);
+	bfree(entry);
+}
+
+static struct mp_pool_entry *entry_create(const struct mp_media_info *info,
+					  const struct mp_media_client *client,
+					  char *key)
+{
+	struct mp_pool_entry *entry = bzalloc(sizeof(*entry));
+	struct mp_media_info pool_info = *info;
+
+	if (pthread_mutex_init(&entry->clients_mutex, NULL) != 0) {
+		bfree(entry);
+		return NULL;
+	}
+
+	entry->key = key;
+	entry->refs = 1;
+	da_push_back(entry->clients, client);
+
+	pool_info.opaque = entry;
+	pool_info.v_cb = pool_video;
+	pool_info.v_preload_cb = pool_preload_video;
+	pool_info.a_cb = pool_audio;
+	pool_info.stop_cb = pool_stopped;
+
+	if (!mp_media_init(&entry->media, &pool_info)) {
+		entry->key = NULL;
+		entry_destroy(entry);
+		return NULL;
+	}
+
+	return entry;
+}
+
+mp_media_t *mp_media_pool_acquire(const struct mp_media_info *info,
+				  bool looping, bool share, bool *playing)
+{
+	struct mp_media_client client = {
+		.opaque = info->opaque,
+		.v_cb = info->v_cb,
+		.v_preload_cb = info->v_preload_cb,
+		.a_cb = info->a_cb,
+		.stop_cb = info->stop_cb,
+		.v_shared_cb = info->v_shared_cb,
+	};
+	struct mp_pool_entry *entry;
+	bool joined = false;
+	char *key;
+
+	*playing = false;
+
+	if (!share) {
+		entry = entry_create(info, &client, NULL);
+		return entry ? &entry->media : NULL;
+	}
+
+	key = make_key(info, looping);
+
+	/* held while opening so that two sources opening the same file at
+	 * the same time don't both end up with their own decoder */
+	pthread_mutex_lock(&pool_mutex);
+
+	entry = find_entry(key);
+	if (entry) {
+		entry->refs++;
+		add_client(entry, &client);
+		*playing = media_playing(&entry->media);
+		joined = true;
+		bfree(key);
+
+	} else {
+		entry = entry_create(info, &client, key);
+		if (entry) {
+			entry->next = first_entry;
+			first_entry = entry;
+		} else {
+			bfree(key);
+		}
+	}
+
+	pthread_mutex_unlock(&pool_mutex);
+
+	if (joined)
+		blog(LOG_DEBUG, "MP: Sharing decoder for '%s'", info->path);
+
+	return entry ? &entry->media : NULL;
+}
+
+void mp_media_pool_release(mp_media_t *media, void *opaque)
+{
+	struct mp_pool_entry *entry = (struct mp_pool_entry *)media;
+	bool last;
+
+	if (!media)
+		return;
+
+	pthread_mutex_lock(&pool_mutex);
+	last = --entry->refs == 0;
+	if (last && entry->key)
+		remove_entry(entry);
+	pthread_mutex_unlock(&pool_mutex);
+
+	/* the last client still gets its stop callback while the media is
+	 * being freed, just like with a private mp_media_t */
+	if (last) {
+		mp_media_free(&entry->media);
+		entry_destroy(entry);
+		return;
+	}
+
+	pthread_mutex_lock(&entry->clients_mutex);
+	for (size_t i = 0; i < entry->clients.num; i++) {
+		if (entry->clients.array[i].opaque == opaque) {
+			da_erase(entry->clients, i);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&entry->clients_mutex);
+}
+
+size_t mp_media_pool_get_clients(mp_media_t *media)
+{
+	struct mp_pool_entry *entry = (struct mp_pool_entry *)media;
+	size_t num;
+
+	pthread_mutex_lock(&entry->clients_mutex);
+	num = entry->clients.num;
+	pthread_mutex_unlock(&entry->clients_mutex);
+
+	return num;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Pool of media players.
+ *
+ * Media acquired with 'share' set is keyed by its path and playback options,
+ * so every source that plays the same local file with the same options ends
+ * up on a single demuxer/decoder.  Decoded audio is handed to the callbacks
+ * of each client, and while there is more than one client, decoded frames are
+ * copied once and handed to their v_shared_cb callbacks.  The media is freed
+ * when the last client releases it.  Playback controls act on all clients of
+ * a shared media, so a client that needs playback state of its own has to
+ * release it and acquire private media instead.
+ *
+ * Media acquired without 'share' behaves like a private mp_media_t.
+ */
+
+/* Returns NULL if the media could not be opened.  'playing' is set to true
+ * if an existing shared media was joined that is already playing, in which
+ * case the caller should not restart it. */
+extern mp_media_t *mp_media_pool_acquire(const struct mp_media_info *info,
+					 bool looping, bool share,
+					 bool *playing);
+
+/* Removes the client registered with 'opaque', freeing the media once it
+ * has no clients left.  No callbacks are made for 'opaque' once this
+ * returns. */
+extern void mp_media_pool_release(mp_media_t *media, void *opaque);
+
+/* Number of sources currently receiving frames from this media */
+extern size_t mp_media_pool_get_clients(mp_media_t *media);
+
+#ifdef __cplusplus
+}
+#endif
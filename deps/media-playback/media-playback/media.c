@@ -27,6 +27,10 @@
 
 static int64_t base_sys_ts = 0;
 
+#define MP_DEFAULT_DECODE_AHEAD 8
+#define MP_MAX_DECODE_AHEAD 64
+#define MP_MAX_QUEUED_AUDIO_FRAMES 64
+
 static inline enum video_format convert_pixel_format(int f)
 {
 	switch (f) {
@@ -155,18 +159,380 @@ static int mp_media_next_packet(mp_media_t *media)
 	return ret;
 }
 
-static inline bool mp_media_ready_to_start(mp_media_t *m)
+/* ------------------------------------------------------------------------ */
+/* decode thread                                                            */
+
+static inline bool mp_decode_has_room(mp_media_t *m, struct mp_decode *d)
+{
+	size_t max = d->audio ? MP_MAX_QUEUED_AUDIO_FRAMES
+			      : (size_t)m->decode_ahead;
+	size_t num;
+	bool eof;
+
+	pthread_mutex_lock(&m->queue_mutex);
+	num = d->frames.size / sizeof(struct mp_queued_frame);
+	eof = d->frames_eof;
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	return !eof && num < max;
+}
+
+static inline size_t get_frame_size(const AVFrame *f)
+{
+	size_t size = 0;
+
+	for (size_t i = 0; i < AV_NUM_DATA_POINTERS && f->buf[i]; i++)
+		size += f->buf[i]->size;
+
+	return size;
+}
+
+static void mp_media_clear_cache(mp_media_t *m)
+{
+	mp_decode_clear_cache(&m->v);
+	mp_decode_clear_cache(&m->a);
+	m->cache_size = 0;
+	m->caching = false;
+	m->cache_complete = false;
+	m->cache_playback = false;
+}
+
+static void mp_media_cache_frame(mp_media_t *m, struct mp_decode *d,
+				 const struct mp_queued_frame *qf)
+{
+	struct mp_queued_frame cached = *qf;
+	size_t size = get_frame_size(qf->frame);
+
+	if (m->cache_size + size > m->cache_limit) {
+		blog(LOG_INFO,
+		     "MP: '%s' does not fit in the %d MB frame cache, "
+		     "it will be decoded on every pass",
+		     m->path, (int)(m->cache_limit / (1024 * 1024)));
+		mp_media_clear_cache(m);
+		m->cache_limit = 0;
+		return;
+	}
+
+	cached.frame = av_frame_clone(qf->frame);
+	if (!cached.frame) {
+		mp_media_clear_cache(m);
+		return;
+	}
+
+	da_push_back(d->cache, &cached);
+	m->cache_size += size;
+}
+
+static inline bool mp_media_decoders_eof(mp_media_t *m)
+{
+	return (!m->has_video || m->v.eof) && (!m->has_audio || m->a.eof);
+}
+
+static void mp_media_queue_cached_frame(mp_media_t *m, struct mp_decode *d)
+{
+	struct mp_queued_frame qf;
+
+	if (d->cache_pos == d->cache.num) {
+		pthread_mutex_lock(&m->queue_mutex);
+		d->frames_eof = true;
+		pthread_mutex_unlock(&m->queue_mutex);
+		return;
+	}
+
+	qf = d->cache.array[d->cache_pos++];
+	qf.frame = av_frame_clone(qf.frame);
+	if (!qf.frame)
+		return;
+
+	pthread_mutex_lock(&m->queue_mutex);
+	circlebuf_push_back(&d->frames, &qf, sizeof(qf));
+	pthread_mutex_unlock(&m->queue_mutex);
+}
+
+static void mp_media_queue_frame(mp_media_t *m, struct mp_decode *d)
+{
+	struct mp_queued_frame qf;
+
+	mp_decode_next(d);
+
+	if (!d->frame_ready) {
+		if (d->eof) {
+			pthread_mutex_lock(&m->queue_mutex);
+			d->frames_eof = true;
+			pthread_mutex_unlock(&m->queue_mutex);
+
+			if (m->caching && mp_media_decoders_eof(m)) {
+				m->caching = false;
+				m->cache_complete = true;
+				blog(LOG_DEBUG,
+				     "MP: Cached %d MB of frames for '%s'",
+				     (int)(m->cache_size / (1024 * 1024)),
+				     m->path);
+			}
+		}
+		return;
+	}
+
+	d->frame_ready = false;
+
+	qf.frame = av_frame_alloc();
+	if (!qf.frame)
+		return;
+
+	/* the decoder reuses its output frame, so take the reference and
+	 * leave it empty for the next decode */
+	av_frame_ref(qf.frame, d->frame);
+	av_frame_unref(d->frame);
+	qf.pts = d->frame_pts;
+	qf.next_pts = d->next_pts;
+
+	if (m->caching)
+		mp_media_cache_frame(m, d, &qf);
+
+	pthread_mutex_lock(&m->queue_mutex);
+	circlebuf_push_back(&d->frames, &qf, sizeof(qf));
+	pthread_mutex_unlock(&m->queue_mutex);
+}
+
+/* reads/decodes one more frame for each queue that has room, returns false
+ * when every queue is full or finished */
+static bool mp_media_decode_step(mp_media_t *m)
+{
+	bool v_room = m->has_video && mp_decode_has_room(m, &m->v);
+	bool a_room = m->has_audio && mp_decode_has_room(m, &m->a);
+
+	if (!v_room && !a_room)
+		return false;
+
+	if (m->cache_playback) {
+		if (v_room)
+			mp_media_queue_cached_frame(m, &m->v);
+		if (a_room)
+			mp_media_queue_cached_frame(m, &m->a);
+		return true;
+	}
+
+	if (!m->eof && ((v_room && !m->v.packets.size) ||
+			(a_room && !m->a.packets.size))) {
+		int ret = mp_media_next_packet(m);
+		if (ret == AVERROR_EOF || ret == AVERROR_EXIT) {
+			m->eof = true;
+		} else if (ret < 0) {
+			pthread_mutex_lock(&m->queue_mutex);
+			m->decode_error = true;
+			pthread_mutex_unlock(&m->queue_mutex);
+			return false;
+		}
+	}
+
+	if (v_room)
+		mp_media_queue_frame(m, &m->v);
+	if (a_room)
+		mp_media_queue_frame(m, &m->a);
+	return true;
+}
+
+static inline bool mp_media_killed(mp_media_t *m)
+{
+	bool kill;
+
+	pthread_mutex_lock(&m->mutex);
+	kill = m->kill;
+	pthread_mutex_unlock(&m->mutex);
+
+	return kill;
+}
+
+static void mp_media_cache_next(mp_media_t *m, struct mp_decode *d)
+{
+	struct mp_queued_frame qf;
+
+	if (d->eof)
+		return;
+
+	mp_decode_next(d);
+	if (!d->frame_ready)
+		return;
+
+	d->frame_ready = false;
+	qf.frame = d->frame;
+	qf.pts = d->frame_pts;
+	qf.next_pts = d->next_pts;
+
+	mp_media_cache_frame(m, d, &qf);
+	av_frame_unref(d->frame);
+}
+
+/* decodes one full pass straight into the frame cache before the decode
+ * thread starts, so that even the first play replays cached frames.  Runs on
+ * the media thread, which is the only user of the decoders at this point. */
+static void mp_media_prewarm_cache(mp_media_t *m)
+{
+	uint64_t start = os_gettime_ns();
+
+	m->caching = true;
+
+	while (m->caching && !mp_media_decoders_eof(m)) {
+		if (mp_media_killed(m)) {
+			mp_media_clear_cache(m);
+			return;
+		}
+
+		if (!m->eof && ((m->has_video && !m->v.packets.size) ||
+				(m->has_audio && !m->a.packets.size))) {
+			int ret = mp_media_next_packet(m);
+			if (ret == AVERROR_EOF || ret == AVERROR_EXIT) {
+				m->eof = true;
+			} else if (ret < 0) {
+				mp_media_clear_cache(m);
+				return;
+			}
+		}
+
+		if (m->has_video)
+			mp_media_cache_next(m, &m->v);
+		if (m->has_audio)
+			mp_media_cache_next(m, &m->a);
+	}
+
+	/* the cache overflowed, playback decodes as usual */
+	if (!m->caching)
+		return;
+
+	m->caching = false;
+	m->cache_complete = true;
+	blog(LOG_DEBUG, "MP: Pre-warmed %d MB of frames for '%s' in %d ms",
+	     (int)(m->cache_size / (1024 * 1024)), m->path,
+	     (int)((os_gettime_ns() - start) / 1000000));
+}
+
+static void *mp_media_decode_thread(void *opaque)
+{
+	mp_media_t *m = opaque;
+
+	os_set_thread_name("mp_media_decode_thread");
+
+	while (!os_atomic_load_bool(&m->decode_kill)) {
+		bool busy;
+
+		/* the presentation thread wants the decoders (seek/reset) */
+		if (os_atomic_load_bool(&m->decode_hold)) {
+			os_event_timedwait(m->decode_event, 10);
+			continue;
+		}
+
+		pthread_mutex_lock(&m->decode_mutex);
+		busy = !m->decode_error && mp_media_decode_step(m);
+		pthread_mutex_unlock(&m->decode_mutex);
+
+		os_event_signal(m->frame_event);
+
+		if (!busy)
+			os_event_wait(m->decode_event);
+	}
+
+	return NULL;
+}
+
+static bool mp_media_start_decode_thread(mp_media_t *m)
 {
-	if (m->has_audio && !m->a.eof && !m->a.frame_ready)
+	os_atomic_set_bool(&m->decode_kill, false);
+
+	if (pthread_create(&m->decode_thread, NULL, mp_media_decode_thread,
+			   m) != 0) {
+		blog(LOG_WARNING, "MP: Could not create decode thread");
 		return false;
-	if (m->has_video && !m->v.eof && !m->v.frame_ready)
+	}
+
+	m->decode_thread_valid = true;
+	return true;
+}
+
+static void mp_media_stop_decode_thread(mp_media_t *m)
+{
+	if (!m->decode_thread_valid)
+		return;
+
+	os_atomic_set_bool(&m->decode_kill, true);
+	os_event_signal(m->decode_event);
+	pthread_join(m->decode_thread, NULL);
+	m->decode_thread_valid = false;
+}
+
+/* gives the calling thread exclusive use of the format context and the
+ * decoders */
+static void mp_media_hold_decode(mp_media_t *m)
+{
+	os_atomic_set_bool(&m->decode_hold, true);
+	pthread_mutex_lock(&m->decode_mutex);
+}
+
+static void mp_media_release_decode(mp_media_t *m)
+{
+	pthread_mutex_unlock(&m->decode_mutex);
+	os_atomic_set_bool(&m->decode_hold, false);
+	os_event_signal(m->decode_event);
+}
+
+/* must be called while holding the decoders */
+static void mp_media_clear_queue(mp_media_t *m, struct mp_decode *d)
+{
+	pthread_mutex_lock(&m->queue_mutex);
+	mp_decode_clear_frames(d);
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	d->pres_ready = false;
+	d->pres_eof = false;
+}
+
+/* must be called while holding the decoders */
+static void mp_media_flush_stream(mp_media_t *m, struct mp_decode *d)
+{
+	mp_decode_flush(d);
+	mp_media_clear_queue(m, d);
+}
+
+/* ------------------------------------------------------------------------ */
+/* presentation                                                             */
+
+static bool mp_media_pop_frame(mp_media_t *m, struct mp_decode *d)
+{
+	struct mp_queued_frame qf;
+	bool popped = false;
+
+	pthread_mutex_lock(&m->queue_mutex);
+	if (d->frames.size) {
+		circlebuf_pop_front(&d->frames, &qf, sizeof(qf));
+		popped = true;
+	} else {
+		d->pres_eof = d->frames_eof;
+	}
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	if (!popped)
 		return false;
+
+	av_frame_unref(d->pres_frame);
+	av_frame_move_ref(d->pres_frame, qf.frame);
+	av_frame_free(&qf.frame);
+
+	d->pres_pts = qf.pts;
+	d->pres_next_pts = qf.next_pts;
+	d->pres_ready = true;
+	d->pres_eof = false;
+
+	/* there's room in the queue again */
+	os_event_signal(m->decode_event);
 	return true;
 }
 
-static inline bool mp_decode_frame(struct mp_decode *d)
+static inline bool mp_media_ready_to_start(mp_media_t *m)
 {
-	return d->frame_ready || mp_decode_next(d);
+	if (m->has_audio && !m->a.pres_eof && !m->a.pres_ready)
+		return false;
+	if (m->has_video && !m->v.pres_eof && !m->v.pres_ready)
+		return false;
+	return true;
 }
 
 static inline int get_sws_colorspace(enum AVColorSpace cs)
@@ -196,15 +562,15 @@ static inline int get_sws_range(enum AVColorRange r)
 
 static bool mp_media_init_scaling(mp_media_t *m)
 {
-	int space = get_sws_colorspace(m->v.decoder->colorspace);
-	int range = get_sws_range(m->v.decoder->color_range);
+	/* the decoder context belongs to the decode thread, so take the
+	 * parameters from the frame about to be presented */
+	AVFrame *f = m->v.pres_frame;
+	int space = get_sws_colorspace(f->colorspace);
+	int range = get_sws_range(f->color_range);
 	const int *coeff = sws_getCoefficients(space);
 
-	m->swscale = sws_getCachedContext(NULL, m->v.decoder->width,
-					  m->v.decoder->height,
-					  m->v.decoder->pix_fmt,
-					  m->v.decoder->width,
-					  m->v.decoder->height, m->scale_format,
+	m->swscale = sws_getCachedContext(NULL, f->width, f->height, f->format,
+					  f->width, f->height, m->scale_format,
 					  SWS_POINT, NULL, NULL, NULL);
 	if (!m->swscale) {
 		blog(LOG_WARNING, "MP: Failed to initialize scaler");
@@ -214,9 +580,8 @@ static bool mp_media_init_scaling(mp_media_t *m)
 	sws_setColorspaceDetails(m->swscale, coeff, range, coeff, range, 0,
 				 FIXED_1_0, FIXED_1_0);
 
-	int ret = av_image_alloc(m->scale_pic, m->scale_linesizes,
-				 m->v.decoder->width, m->v.decoder->height,
-				 m->scale_format, 32);
+	int ret = av_image_alloc(m->scale_pic, m->scale_linesizes, f->width,
+				 f->height, m->scale_format, 32);
 	if (ret < 0) {
 		blog(LOG_WARNING, "MP: Failed to create scale pic data");
 		return false;
@@ -227,24 +592,37 @@ static bool mp_media_init_scaling(mp_media_t *m)
 
 static bool mp_media_prepare_frames(mp_media_t *m)
 {
-	while (!mp_media_ready_to_start(m)) {
-		if (!m->eof) {
-			int ret = mp_media_next_packet(m);
-			if (ret == AVERROR_EOF || ret == AVERROR_EXIT)
-				m->eof = true;
-			else if (ret < 0)
-				return false;
-		}
+	bool waited = false;
 
-		if (m->has_video && !mp_decode_frame(&m->v))
-			return false;
-		if (m->has_audio && !mp_decode_frame(&m->a))
+	for (;;) {
+		bool error;
+
+		if (m->has_video && !m->v.pres_ready)
+			mp_media_pop_frame(m, &m->v);
+		if (m->has_audio && !m->a.pres_ready)
+			mp_media_pop_frame(m, &m->a);
+
+		if (mp_media_ready_to_start(m))
+			break;
+
+		pthread_mutex_lock(&m->queue_mutex);
+		error = m->decode_error;
+		pthread_mutex_unlock(&m->queue_mutex);
+
+		if (error)
 			return false;
+
+		os_event_timedwait(m->frame_event, 100);
+		waited = true;
 	}
 
-	if (m->has_video && m->v.frame_ready && !m->swscale) {
-		m->scale_format = closest_format(m->v.frame->format);
-		if (m->scale_format != m->v.frame->format) {
+	/* the decoder fell behind during playback */
+	if (waited && m->next_ns)
+		os_atomic_inc_long(&m->late_frames);
+
+	if (m->has_video && m->v.pres_ready && !m->swscale) {
+		m->scale_format = closest_format(m->v.pres_frame->format);
+		if (m->scale_format != m->v.pres_frame->format) {
 			if (!mp_media_init_scaling(m)) {
 				return false;
 			}
@@ -258,13 +636,13 @@ static inline int64_t mp_media_get_next_min_pts(mp_media_t *m)
 {
 	int64_t min_next_ns = 0x7FFFFFFFFFFFFFFFLL;
 
-	if (m->has_video && m->v.frame_ready) {
-		if (m->v.frame_pts < min_next_ns)
-			min_next_ns = m->v.frame_pts;
+	if (m->has_video && m->v.pres_ready) {
+		if (m->v.pres_pts < min_next_ns)
+			min_next_ns = m->v.pres_pts;
 	}
-	if (m->has_audio && m->a.frame_ready) {
-		if (m->a.frame_pts < min_next_ns)
-			min_next_ns = m->a.frame_pts;
+	if (m->has_audio && m->a.pres_ready) {
+		if (m->a.pres_pts < min_next_ns)
+			min_next_ns = m->a.pres_pts;
 	}
 
 	return min_next_ns;
@@ -274,29 +652,29 @@ static inline int64_t mp_media_get_base_pts(mp_media_t *m)
 {
 	int64_t base_ts = 0;
 
-	if (m->has_video && m->v.next_pts > base_ts)
-		base_ts = m->v.next_pts;
-	if (m->has_audio && m->a.next_pts > base_ts)
-		base_ts = m->a.next_pts;
+	if (m->has_video && m->v.pres_next_pts > base_ts)
+		base_ts = m->v.pres_next_pts;
+	if (m->has_audio && m->a.pres_next_pts > base_ts)
+		base_ts = m->a.pres_next_pts;
 
 	return base_ts;
 }
 
 static inline bool mp_media_can_play_frame(mp_media_t *m, struct mp_decode *d)
 {
-	return d->frame_ready && d->frame_pts <= m->next_pts_ns;
+	return d->pres_ready && d->pres_pts <= m->next_pts_ns;
 }
 
 static void mp_media_next_audio(mp_media_t *m)
 {
 	struct mp_decode *d = &m->a;
 	struct obs_source_audio audio = {0};
-	AVFrame *f = d->frame;
+	AVFrame *f = d->pres_frame;
 
 	if (!mp_media_can_play_frame(m, d))
 		return;
 
-	d->frame_ready = false;
+	d->pres_ready = false;
 	if (!m->a_cb)
 		return;
 
@@ -308,7 +686,7 @@ static void mp_media_next_audio(mp_media_t *m)
 	audio.format = convert_sample_format(f->format);
 	audio.frames = f->nb_samples;
 
-	audio.timestamp = m->base_ts + d->frame_pts - m->start_ts +
+	audio.timestamp = m->base_ts + d->pres_pts - m->start_ts +
 			  m->play_sys_ts - base_sys_ts;
 
 	if (audio.format == AUDIO_FORMAT_UNKNOWN)
@@ -324,17 +702,17 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 	enum video_format new_format;
 	enum video_colorspace new_space;
 	enum video_range_type new_range;
-	AVFrame *f = d->frame;
+	AVFrame *f = d->pres_frame;
 
 	if (!preload) {
 		if (!mp_media_can_play_frame(m, d))
 			return;
 
-		d->frame_ready = false;
+		d->pres_ready = false;
 
 		if (!m->v_cb)
 			return;
-	} else if (!d->frame_ready) {
+	} else if (!d->pres_ready) {
 		return;
 	}
 
@@ -395,7 +773,7 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 	if (frame->format == VIDEO_FORMAT_NONE)
 		return;
 
-	frame->timestamp = m->base_ts + d->frame_pts - m->start_ts +
+	frame->timestamp = m->base_ts + d->pres_pts - m->start_ts +
 			   m->play_sys_ts - base_sys_ts;
 
 	frame->width = f->width;
@@ -431,7 +809,8 @@ static void mp_media_calc_next_ns(mp_media_t *m)
 	m->next_pts_ns = min_next_ns;
 }
 
-static void seek_to(mp_media_t *m, int64_t pos)
+/* must be called while holding the decoders */
+static void seek_to_internal(mp_media_t *m, int64_t pos)
 {
 	AVStream *stream = m->fmt->streams[0];
 	int64_t seek_pos = pos;
@@ -453,12 +832,52 @@ static void seek_to(mp_media_t *m, int64_t pos)
 			blog(LOG_WARNING, "MP: Failed to seek: %s",
 			     av_err2str(ret));
 		}
+
+		m->eof = false;
 	}
 
 	if (m->has_video && m->is_local_file)
-		mp_decode_flush(&m->v);
+		mp_media_flush_stream(m, &m->v);
 	if (m->has_audio && m->is_local_file)
-		mp_decode_flush(&m->a);
+		mp_media_flush_stream(m, &m->a);
+}
+
+static void seek_to(mp_media_t *m, int64_t pos)
+{
+	mp_media_hold_decode(m);
+
+	/* a partially recorded pass is no use after jumping around */
+	m->cache_playback = false;
+	if (!m->cache_complete)
+		mp_media_clear_cache(m);
+
+	seek_to_internal(m, pos);
+	mp_media_release_decode(m);
+}
+
+/* goes back to the start, replaying cached frames if a full pass has been
+ * cached, otherwise seeking and recording the next pass if enabled */
+static void mp_media_rewind(mp_media_t *m)
+{
+	mp_media_hold_decode(m);
+
+	if (m->cache_complete) {
+		m->v.cache_pos = 0;
+		m->a.cache_pos = 0;
+		m->cache_playback = true;
+
+		if (m->has_video)
+			mp_media_clear_queue(m, &m->v);
+		if (m->has_audio)
+			mp_media_clear_queue(m, &m->a);
+	} else {
+		mp_media_clear_cache(m);
+		seek_to_internal(m, m->fmt->start_time);
+		m->caching = m->cache_limit && m->is_local_file;
+	}
+
+	m->eof = false;
+	mp_media_release_decode(m);
 }
 
 static bool mp_media_reset(mp_media_t *m)
@@ -466,12 +885,11 @@ static bool mp_media_reset(mp_media_t *m)
 	bool stopping;
 	bool active;
 
-	seek_to(m, m->fmt->start_time);
+	mp_media_rewind(m);
 
 	int64_t next_ts = mp_media_get_base_pts(m);
 	int64_t offset = next_ts - m->next_pts_ns;
 
-	m->eof = false;
 	m->base_ts += next_ts;
 
 	pthread_mutex_lock(&m->mutex);
@@ -527,8 +945,8 @@ static inline bool mp_media_sleepto(mp_media_t *m)
 
 static inline bool mp_media_eof(mp_media_t *m)
 {
-	bool v_ended = !m->has_video || !m->v.frame_ready;
-	bool a_ended = !m->has_audio || !m->a.frame_ready;
+	bool v_ended = !m->has_video || !m->v.pres_ready;
+	bool a_ended = !m->has_audio || !m->a.pres_ready;
 	bool eof = v_ended && a_ended;
 
 	if (eof) {
@@ -559,6 +977,9 @@ static int interrupt_callback(void *data)
 		stop = m->kill || m->stopping;
 		pthread_mutex_unlock(&m->mutex);
 
+		if (os_atomic_load_bool(&m->decode_kill))
+			stop = true;
+
 		m->interrupt_poll_ts = ts;
 	}
 
@@ -639,6 +1060,11 @@ static inline bool mp_media_thread(mp_media_t *m)
 	if (!init_avformat(m)) {
 		return false;
 	}
+	if (m->prewarm_cache && m->cache_limit)
+		mp_media_prewarm_cache(m);
+	if (!mp_media_start_decode_thread(m)) {
+		return false;
+	}
 	if (!mp_media_reset(m)) {
 		return false;
 	}
@@ -718,8 +1144,11 @@ static inline bool mp_media_thread(mp_media_t *m)
 static void *mp_media_thread_start(void *opaque)
 {
 	mp_media_t *m = opaque;
+	bool success = mp_media_thread(m);
+
+	mp_media_stop_decode_thread(m);
 
-	if (!mp_media_thread(m)) {
+	if (!success) {
 		if (m->stop_cb) {
 			m->stop_cb(m->opaque);
 		}
@@ -739,6 +1168,22 @@ static inline bool mp_media_init_internal(mp_media_t *m,
 		blog(LOG_WARNING, "MP: Failed to init semaphore");
 		return false;
 	}
+	if (pthread_mutex_init(&m->decode_mutex, NULL) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init decode mutex");
+		return false;
+	}
+	if (pthread_mutex_init(&m->queue_mutex, NULL) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init queue mutex");
+		return false;
+	}
+	if (os_event_init(&m->decode_event, OS_EVENT_TYPE_AUTO) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init decode event");
+		return false;
+	}
+	if (os_event_init(&m->frame_event, OS_EVENT_TYPE_AUTO) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init frame event");
+		return false;
+	}
 
 	m->path = info->path ? bstrdup(info->path) : NULL;
 	m->format_name = info->format ? bstrdup(info->format) : NULL;
@@ -757,6 +1202,8 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 {
 	memset(media, 0, sizeof(*media));
 	pthread_mutex_init_value(&media->mutex);
+	pthread_mutex_init_value(&media->decode_mutex);
+	pthread_mutex_init_value(&media->queue_mutex);
 	media->opaque = info->opaque;
 	media->v_cb = info->v_cb;
 	media->a_cb = info->a_cb;
@@ -770,6 +1217,16 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	if (!info->is_local_file || media->speed < 1 || media->speed > 200)
 		media->speed = 100;
 
+	if (media->is_local_file && info->frame_cache_mb > 0)
+		media->cache_limit = (size_t)info->frame_cache_mb * 1024 * 1024;
+	media->prewarm_cache = info->prewarm_cache;
+
+	media->decode_ahead = info->decode_ahead_frames;
+	if (media->decode_ahead < 1)
+		media->decode_ahead = MP_DEFAULT_DECODE_AHEAD;
+	else if (media->decode_ahead > MP_MAX_DECODE_AHEAD)
+		media->decode_ahead = MP_MAX_DECODE_AHEAD;
+
 	static bool initialized = false;
 	if (!initialized) {
 #if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 9, 100)
@@ -815,13 +1272,19 @@ void mp_media_free(mp_media_t *media)
 	mp_decode_free(&media->a);
 	avformat_close_input(&media->fmt);
 	pthread_mutex_destroy(&media->mutex);
+	pthread_mutex_destroy(&media->decode_mutex);
+	pthread_mutex_destroy(&media->queue_mutex);
 	os_sem_destroy(media->sem);
+	os_event_destroy(media->decode_event);
+	os_event_destroy(media->frame_event);
 	sws_freeContext(media->swscale);
 	av_freep(&media->scale_pic[0]);
 	bfree(media->path);
 	bfree(media->format_name);
 	memset(media, 0, sizeof(*media));
 	pthread_mutex_init_value(&media->mutex);
+	pthread_mutex_init_value(&media->decode_mutex);
+	pthread_mutex_init_value(&media->queue_mutex);
 }
 
 void mp_media_play(mp_media_t *m, bool loop, bool reconnecting)
@@ -882,3 +1345,20 @@ void mp_media_seek_to(mp_media_t *m, int64_t pos)
 
 	os_sem_post(m->sem);
 }
+
+size_t mp_media_get_queue_depth(mp_media_t *m)
+{
+	struct mp_decode *d = m->has_video ? &m->v : &m->a;
+	size_t depth;
+
+	pthread_mutex_lock(&m->queue_mutex);
+	depth = d->frames.size / sizeof(struct mp_queued_frame);
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	return depth;
+}
+
+long mp_media_get_late_frames(mp_media_t *m)
+{
+	return os_atomic_load_long(&m->late_frames);
+}
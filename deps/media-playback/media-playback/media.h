@@ -99,6 +99,32 @@ struct mp_media {
 	bool reset_ts;
 	bool seek;
 	int64_t seek_pos;
+
+	/* demuxing and decoding run ahead of presentation on their own
+	 * thread.  decode_mutex is held by that thread while it uses the
+	 * format context and decoders, queue_mutex guards the decoded frame
+	 * queues shared with the presentation thread. */
+	pthread_mutex_t decode_mutex;
+	pthread_mutex_t queue_mutex;
+	os_event_t *decode_event;
+	os_event_t *frame_event;
+	bool decode_thread_valid;
+	pthread_t decode_thread;
+	volatile bool decode_hold;
+	volatile bool decode_kill;
+	bool decode_error;
+	int decode_ahead;
+
+	volatile long late_frames;
+
+	/* short local clips can keep their decoded frames in memory after
+	 * the first pass so that loops and restarts don't decode at all */
+	size_t cache_limit;
+	size_t cache_size;
+	bool caching;
+	bool cache_complete;
+	bool cache_playback;
+	bool prewarm_cache;
 };
 
 typedef struct mp_media mp_media_t;
@@ -111,6 +137,11 @@ struct mp_media_info {
 	mp_audio_cb a_cb;
 	mp_stop_cb stop_cb;
 
+	/* used instead of v_cb for media shared by several clients (see
+	 * media-pool.h), with a frame from obs_source_frame_create_shared
+	 * that can be passed on to obs_source_output_shared_video */
+	mp_video_cb v_shared_cb;
+
 	const char *path;
 	const char *format;
 	int buffering;
@@ -119,6 +150,12 @@ struct mp_media_info {
 	bool hardware_decoding;
 	bool is_local_file;
 	bool reconnecting;
+	int decode_ahead_frames;
+	int frame_cache_mb;
+
+	/* fill the frame cache as soon as the media is opened instead of
+	 * during the first pass */
+	bool prewarm_cache;
 };
 
 extern bool mp_media_init(mp_media_t *media, const struct mp_media_info *info);
@@ -130,6 +167,13 @@ extern void mp_media_play_pause(mp_media_t *media, bool pause);
 extern int64_t mp_get_current_time(mp_media_t *m);
 extern void mp_media_seek_to(mp_media_t *m, int64_t pos);
 
+/* number of decoded video frames (or audio frames for audio-only media)
+ * currently waiting to be presented */
+extern size_t mp_media_get_queue_depth(mp_media_t *m);
+
+/* number of times presentation had to wait on the decoder */
+extern long mp_media_get_late_frames(mp_media_t *m);
+
 /* #define DETAILED_DEBUG_INFO */
 
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 48, 101)
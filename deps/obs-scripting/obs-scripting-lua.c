@@ -22,6 +22,7 @@
 #include <util/dstr.h>
 
 #include <obs.h>
+#include <media-io/media-remux.h>
 
 /* ========================================================================= */
 
@@ -644,6 +645,75 @@ static int scene_enum_items(lua_State *script)
 
 /* -------------------------------------------- */
 
+static bool table_to_strings(lua_State *script, int idx, char **strs,
+			     size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		lua_rawgeti(script, idx, (int)i + 1);
+		strs[i] = bstrdup(lua_tostring(script, -1));
+		lua_pop(script, 1);
+
+		if (!strs[i])
+			return false;
+	}
+
+	return true;
+}
+
+static int remux_batch(lua_State *script)
+{
+	size_t count;
+	char **in, **out;
+	bool *results;
+	int max_jobs;
+	bool valid;
+
+	if (!lua_istable(script, 1) || !lua_istable(script, 2))
+		return 0;
+
+	count = lua_rawlen(script, 1);
+	if (count != lua_rawlen(script, 2)) {
+		warn("media_remux_batch: expected two tables of the same "
+		     "length");
+		return 0;
+	}
+
+	max_jobs = (int)lua_tointeger(script, 3);
+
+	in = bzalloc(count * sizeof(*in));
+	out = bzalloc(count * sizeof(*out));
+	results = bzalloc(count * sizeof(*results));
+
+	valid = table_to_strings(script, 1, in, count) &&
+		table_to_strings(script, 2, out, count);
+	if (valid) {
+		media_remux_batch((const char *const *)in,
+				  (const char *const *)out, count,
+				  max_jobs > 0 ? max_jobs : 0, NULL, NULL,
+				  results);
+
+		lua_newtable(script);
+		for (size_t i = 0; i < count; i++) {
+			lua_pushboolean(script, results[i]);
+			lua_rawseti(script, -2, (int)i + 1);
+		}
+	} else {
+		warn("media_remux_batch: file names must be strings");
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		bfree(in[i]);
+		bfree(out[i]);
+	}
+	bfree(in);
+	bfree(out);
+	bfree(results);
+
+	return valid ? 1 : 0;
+}
+
+/* -------------------------------------------- */
+
 static void defer_hotkey_unregister(void *p_cb)
 {
 	obs_hotkey_unregister((obs_hotkey_id)(uintptr_t)p_cb);
@@ -1012,6 +1082,7 @@ static void add_hook_functions(lua_State *script)
 	add_func("obs_enum_sources", enum_sources);
 	add_func("obs_source_enum_filters", source_enum_filters);
 	add_func("obs_scene_enum_items", scene_enum_items);
+	add_func("media_remux_batch", remux_batch);
 	add_func("source_list_release", source_list_release);
 	add_func("sceneitem_list_release", sceneitem_list_release);
 	add_func("calldata_source", calldata_source);
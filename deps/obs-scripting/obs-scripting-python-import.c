@@ -100,6 +100,8 @@ bool import_python(const char *python_path)
 	IMPORT_FUNC(PyEval_InitThreads);
 	IMPORT_FUNC(PyEval_ThreadsInitialized);
 	IMPORT_FUNC(PyEval_ReleaseThread);
+	IMPORT_FUNC(PyEval_SaveThread);
+	IMPORT_FUNC(PyEval_RestoreThread);
 	IMPORT_FUNC(PySys_SetArgv);
 	IMPORT_FUNC(PyImport_ImportModule);
 	IMPORT_FUNC(PyObject_CallFunctionObjArgs);
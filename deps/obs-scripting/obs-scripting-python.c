@@ -24,6 +24,7 @@
 #include <util/dstr.h>
 
 #include <obs.h>
+#include <media-io/media-remux.h>
 
 /* ========================================================================= */
 
@@ -1103,6 +1104,78 @@ static PyObject *scene_enum_items(PyObject *self, PyObject *args)
 
 /* -------------------------------------------- */
 
+static bool py_to_strings(PyObject *list, char **strs, Py_ssize_t count)
+{
+	for (Py_ssize_t i = 0; i < count; i++) {
+		PyObject *py_str = PyUnicode_AsUTF8String(
+			PyList_GetItem(list, i));
+		if (!py_str)
+			return false;
+
+		strs[i] = bstrdup(PyBytes_AS_STRING(py_str));
+		Py_DECREF(py_str);
+	}
+
+	return true;
+}
+
+static PyObject *remux_batch(PyObject *self, PyObject *args)
+{
+	PyObject *py_in, *py_out, *py_results = NULL;
+	Py_ssize_t count;
+	char **in, **out;
+	bool *results;
+	int max_jobs = 0;
+
+	UNUSED_PARAMETER(self);
+
+	if (!parse_args(args, "OO|i", &py_in, &py_out, &max_jobs))
+		return python_none();
+
+	count = PyList_Size(py_in);
+	if (py_error() || count != PyList_Size(py_out)) {
+		warn("media_remux_batch: expected two lists of the same "
+		     "length");
+		return python_none();
+	}
+
+	in = bzalloc(count * sizeof(*in));
+	out = bzalloc(count * sizeof(*out));
+	results = bzalloc(count * sizeof(*results));
+
+	if (py_to_strings(py_in, in, count) &&
+	    py_to_strings(py_out, out, count)) {
+		/* lets other python threads run while the files are remuxed */
+		PyThreadState *ts = PyEval_SaveThread();
+		media_remux_batch((const char *const *)in,
+				  (const char *const *)out, count,
+				  max_jobs > 0 ? max_jobs : 0, NULL, NULL,
+				  results);
+		PyEval_RestoreThread(ts);
+
+		py_results = PyList_New(0);
+		for (Py_ssize_t i = 0; i < count; i++) {
+			PyObject *py_result = PyBool_FromLong(results[i]);
+			PyList_Append(py_results, py_result);
+			Py_DECREF(py_result);
+		}
+	} else {
+		py_error();
+	}
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+		bfree(in[i]);
+		bfree(out[i]);
+	}
+	bfree(in);
+	bfree(out);
+	bfree(results);
+
+	return py_results ? py_results : python_none();
+}
+
+/* -------------------------------------------- */
+
 static PyObject *source_list_release(PyObject *self, PyObject *args)
 {
 	PyObject *list;
@@ -1228,6 +1301,7 @@ static void add_hook_functions(PyObject *module)
 		DEF_FUNC("sceneitem_list_release", sceneitem_list_release),
 		DEF_FUNC("obs_enum_sources", enum_sources),
 		DEF_FUNC("obs_scene_enum_items", scene_enum_items),
+		DEF_FUNC("media_remux_batch", remux_batch),
 		DEF_FUNC("obs_remove_tick_callback",
 			 obs_python_remove_tick_callback),
 		DEF_FUNC("obs_add_tick_callback", obs_python_add_tick_callback),
@@ -2234,6 +2234,38 @@ void gs_texture_unmap(gs_texture_t *tex)
 	tex2d->device->context->Unmap(tex2d->texture, 0);
 }
 
+bool gs_texture_set_region(gs_texture_t *tex, uint32_t x, uint32_t y,
+			   uint32_t cx, uint32_t cy, const uint8_t *data,
+			   uint32_t linesize)
+{
+	if (tex->type != GS_TEXTURE_2D)
+		return false;
+
+	gs_texture_2d *tex2d = static_cast<gs_texture_2d *>(tex);
+	if (tex2d->isDynamic || gs_is_compressed_format(tex2d->format))
+		return false;
+	if (x + cx > tex2d->width || y + cy > tex2d->height)
+		return false;
+
+	D3D11_BOX box = {x, y, 0, x + cx, y + cy, 1};
+	tex2d->device->context->UpdateSubresource(tex2d->texture, 0, &box,
+						  data, linesize, 0);
+
+	/* keep the copy used to rebuild the texture after a device loss in
+	 * sync with what was uploaded */
+	if (!tex2d->data.empty() && !tex2d->data[0].empty()) {
+		uint32_t bpp = gs_get_format_bpp(tex2d->format) / 8;
+		uint32_t pitch = tex2d->width * bpp;
+		uint8_t *dst = tex2d->data[0].data() + y * pitch + x * bpp;
+
+		for (uint32_t row = 0; row < cy; row++)
+			memcpy(dst + row * pitch, data + row * linesize,
+			       cx * bpp);
+	}
+
+	return true;
+}
+
 void *gs_texture_get_obj(gs_texture_t *tex)
 {
 	if (tex->type != GS_TEXTURE_2D)
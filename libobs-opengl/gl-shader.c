@@ -17,6 +17,8 @@
 
 #include <assert.h>
 
+#include <util/dstr.h>
+#include <util/platform.h>
 #include <graphics/vec2.h>
 #include <graphics/vec3.h>
 #include <graphics/vec4.h>
@@ -25,6 +27,19 @@
 #include "gl-subsystem.h"
 #include "gl-shaderparser.h"
 
+/* FNV-1a */
+#define HASH_INIT 0xCBF29CE484222325ULL
+
+static uint64_t hash_string(uint64_t hash, const char *str)
+{
+	while (str && *str) {
+		hash ^= (uint8_t)*(str++);
+		hash *= 0x100000001B3ULL;
+	}
+
+	return hash;
+}
+
 static inline void shader_param_init(struct gs_shader_param *param)
 {
 	memset(param, 0, sizeof(struct gs_shader_param));
@@ -201,6 +216,8 @@ static bool gl_shader_init(struct gs_shader *shader,
 	if (!gl_success("glCreateShader") || !shader->obj)
 		return false;
 
+	shader->hash = hash_string(HASH_INIT, glsp->gl_string.array);
+
 	glShaderSource(shader->obj, 1, (const GLchar **)&glsp->gl_string.array,
 		       0);
 	if (!gl_success("glShaderSource"))
@@ -629,51 +646,250 @@ static inline bool assign_program_params(struct gs_program *program)
 	return true;
 }
 
-struct gs_program *gs_program_create(struct gs_device *device)
+#define PROGRAM_CACHE_MAGIC 0x4D475250 /* "PRGM" */
+#define PROGRAM_CACHE_VERSION 1
+
+struct program_cache_header {
+	uint64_t driver_hash;
+	uint64_t vertex_hash;
+	uint64_t pixel_hash;
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t size;
+};
+
+void device_set_program_cache_path(gs_device_t *device, const char *path)
 {
-	struct gs_program *program = bzalloc(sizeof(*program));
-	int linked = false;
+	GLint num_formats = 0;
 
-	program->device = device;
-	program->vertex_shader = device->cur_vertex_shader;
-	program->pixel_shader = device->cur_pixel_shader;
+	bfree(device->program_cache_path);
+	device->program_cache_path = NULL;
 
-	program->obj = glCreateProgram();
-	if (!gl_success("glCreateProgram"))
-		goto error_detach_neither;
+	if (!path || !*path)
+		return;
 
-	glAttachShader(program->obj, program->vertex_shader->obj);
+	if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary)
+		gl_get_integer_v(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+
+	if (!num_formats) {
+		blog(LOG_INFO, "Program binaries are not supported by the "
+			       "driver, shader programs will not be cached");
+		return;
+	}
+
+	if (os_mkdirs(path) == MKDIR_ERROR) {
+		blog(LOG_WARNING, "Failed to create program cache directory "
+				  "'%s'",
+		     path);
+		return;
+	}
+
+	/* binaries are only valid for the driver that created them */
+	device->driver_hash =
+		hash_string(HASH_INIT, (const char *)glGetString(GL_VENDOR));
+	device->driver_hash = hash_string(
+		device->driver_hash, (const char *)glGetString(GL_RENDERER));
+	device->driver_hash = hash_string(
+		device->driver_hash, (const char *)glGetString(GL_VERSION));
+
+	device->program_cache_path = bstrdup(path);
+}
+
+static void get_program_cache_file(struct dstr *file,
+				   const struct gs_program *program)
+{
+	dstr_printf(file, "%s/%016llx%016llx.bin",
+		    program->device->program_cache_path,
+		    (unsigned long long)program->vertex_shader->hash,
+		    (unsigned long long)program->pixel_shader->hash);
+}
+
+static inline bool
+program_cache_header_valid(const struct gs_program *program,
+			   const struct program_cache_header *header,
+			   int64_t file_size)
+{
+	return header->magic == PROGRAM_CACHE_MAGIC &&
+	       header->version == PROGRAM_CACHE_VERSION &&
+	       header->driver_hash == program->device->driver_hash &&
+	       header->vertex_hash == program->vertex_shader->hash &&
+	       header->pixel_hash == program->pixel_shader->hash &&
+	       header->size &&
+	       (int64_t)header->size + (int64_t)sizeof(*header) == file_size;
+}
+
+/* Returns false if there is no usable cached binary, in which case the
+ * program has to be linked from its shaders */
+static bool program_cache_load(struct gs_program *program)
+{
+	struct program_cache_header header;
+	struct dstr file = {0};
+	void *binary = NULL;
+	GLint linked = GL_FALSE;
+	int64_t file_size;
+	FILE *f;
+
+	if (!program->device->program_cache_path)
+		return false;
+
+	get_program_cache_file(&file, program);
+	f = os_fopen(file.array, "rb");
+	dstr_free(&file);
+	if (!f)
+		return false;
+
+	file_size = os_fgetsize(f);
+	if (fread(&header, sizeof(header), 1, f) == 1 &&
+	    program_cache_header_valid(program, &header, file_size)) {
+		binary = bmalloc(header.size);
+		if (fread(binary, header.size, 1, f) != 1) {
+			bfree(binary);
+			binary = NULL;
+		}
+	}
+
+	fclose(f);
+
+	if (!binary)
+		return false;
+
+	glProgramBinary(program->obj, header.format, binary, header.size);
+	bfree(binary);
+	if (!gl_success("glProgramBinary"))
+		return false;
+
+	/* the driver may still reject the binary, for example after being
+	 * updated without its version string changing */
+	glGetProgramiv(program->obj, GL_LINK_STATUS, &linked);
+	if (!gl_success("glGetProgramiv"))
+		return false;
+
+	return linked == GL_TRUE;
+}
+
+static void program_cache_save(const struct gs_program *program)
+{
+	struct program_cache_header header = {0};
+	struct dstr file = {0};
+	struct dstr temp = {0};
+	void *binary = NULL;
+	GLint size = 0;
+	GLenum format = 0;
+	bool success = false;
+	FILE *f;
+
+	glGetProgramiv(program->obj, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (!gl_success("glGetProgramiv") || size <= 0)
+		return;
+
+	binary = bmalloc(size);
+	glGetProgramBinary(program->obj, size, NULL, &format, binary);
+	if (!gl_success("glGetProgramBinary"))
+		goto exit;
+
+	header.driver_hash = program->device->driver_hash;
+	header.vertex_hash = program->vertex_shader->hash;
+	header.pixel_hash = program->pixel_shader->hash;
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.version = PROGRAM_CACHE_VERSION;
+	header.format = format;
+	header.size = (uint32_t)size;
+
+	get_program_cache_file(&file, program);
+	dstr_copy_dstr(&temp, &file);
+	dstr_cat(&temp, ".tmp");
+
+	f = os_fopen(temp.array, "wb");
+	if (!f)
+		goto exit;
+
+	success = fwrite(&header, sizeof(header), 1, f) == 1 &&
+		  fwrite(binary, size, 1, f) == 1;
+	success = fclose(f) == 0 && success;
+	success = success && os_rename(temp.array, file.array) == 0;
+
+	if (!success)
+		os_unlink(temp.array);
+
+exit:
+	if (!success)
+		blog(LOG_DEBUG, "Failed to cache program binary '%s'",
+		     file.array ? file.array : "");
+
+	dstr_free(&file);
+	dstr_free(&temp);
+	bfree(binary);
+}
+
+static bool link_program(struct gs_program *program)
+{
+	GLuint vertex_obj = program->vertex_shader->obj;
+	GLuint pixel_obj = program->pixel_shader->obj;
+	bool cache = !!program->device->program_cache_path;
+	int linked = false;
+
+	glAttachShader(program->obj, vertex_obj);
 	if (!gl_success("glAttachShader (vertex)"))
-		goto error_detach_neither;
+		return false;
 
-	glAttachShader(program->obj, program->pixel_shader->obj);
+	glAttachShader(program->obj, pixel_obj);
 	if (!gl_success("glAttachShader (pixel)"))
-		goto error_detach_vertex;
+		goto detach_vertex;
+
+	if (cache) {
+		glProgramParameteri(program->obj,
+				    GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+				    GL_TRUE);
+		gl_success("glProgramParameteri");
+	}
 
 	glLinkProgram(program->obj);
 	if (!gl_success("glLinkProgram"))
-		goto error;
+		goto detach_pixel;
 
 	glGetProgramiv(program->obj, GL_LINK_STATUS, &linked);
-	if (!gl_success("glGetProgramiv"))
-		goto error;
+	if (!gl_success("glGetProgramiv")) {
+		linked = false;
+		goto detach_pixel;
+	}
 
-	if (linked == GL_FALSE) {
+	if (linked == GL_FALSE)
 		print_link_errors(program->obj);
+	else if (cache)
+		program_cache_save(program);
+
+detach_pixel:
+	glDetachShader(program->obj, pixel_obj);
+	gl_success("glDetachShader (pixel)");
+
+detach_vertex:
+	glDetachShader(program->obj, vertex_obj);
+	gl_success("glDetachShader (vertex)");
+
+	return linked != GL_FALSE;
+}
+
+struct gs_program *gs_program_create(struct gs_device *device)
+{
+	struct gs_program *program = bzalloc(sizeof(*program));
+
+	program->device = device;
+	program->vertex_shader = device->cur_vertex_shader;
+	program->pixel_shader = device->cur_pixel_shader;
+
+	program->obj = glCreateProgram();
+	if (!gl_success("glCreateProgram"))
+		goto error;
+
+	if (!program_cache_load(program) && !link_program(program))
 		goto error;
-	}
 
 	if (!assign_program_attribs(program))
 		goto error;
 	if (!assign_program_params(program))
 		goto error;
 
-	glDetachShader(program->obj, program->vertex_shader->obj);
-	gl_success("glDetachShader (vertex)");
-
-	glDetachShader(program->obj, program->pixel_shader->obj);
-	gl_success("glDetachShader (pixel)");
-
 	program->next = device->first_program;
 	program->prev_next = &device->first_program;
 	device->first_program = program;
@@ -683,14 +899,6 @@ struct gs_program *gs_program_create(struct gs_device *device)
 	return program;
 
 error:
-	glDetachShader(program->obj, program->pixel_shader->obj);
-	gl_success("glDetachShader (pixel)");
-
-error_detach_vertex:
-	glDetachShader(program->obj, program->vertex_shader->obj);
-	gl_success("glDetachShader (vertex)");
-
-error_detach_neither:
 	gs_program_destroy(program);
 	return NULL;
 }
@@ -17,6 +17,30 @@
 
 #include "gl-subsystem.h"
 
+#define PERSISTENT_MAP_FLAGS \
+	(GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+/* The sync object created after each readback is waited on before the
+ * buffer is read, so the buffer can stay mapped for its whole lifetime and
+ * mapping never has to synchronize with the driver. */
+static bool create_persistent_buffer(struct gs_stage_surface *surf,
+				     GLsizeiptr size)
+{
+	glBufferStorage(GL_PIXEL_PACK_BUFFER, size, 0, PERSISTENT_MAP_FLAGS);
+	if (!gl_success("glBufferStorage"))
+		return false;
+
+	surf->mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size,
+					PERSISTENT_MAP_FLAGS);
+	if (!gl_success("glMapBufferRange") || !surf->mapped) {
+		surf->mapped = NULL;
+		blog(LOG_DEBUG, "Failed to persistently map stage surface, "
+				"mapping it on demand");
+	}
+
+	return true;
+}
+
 static bool create_pixel_pack_buffer(struct gs_stage_surface *surf)
 {
 	GLsizeiptr size;
@@ -32,9 +56,14 @@ static bool create_pixel_pack_buffer(struct gs_stage_surface *surf)
 	size = (size + 3) & 0xFFFFFFFC; /* align width to 4-byte boundary */
 	size *= surf->height;
 
-	glBufferData(GL_PIXEL_PACK_BUFFER, size, 0, GL_DYNAMIC_READ);
-	if (!gl_success("glBufferData"))
-		success = false;
+	if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+		if (!create_persistent_buffer(surf, size))
+			success = false;
+	} else {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, 0, GL_DYNAMIC_READ);
+		if (!gl_success("glBufferData"))
+			success = false;
+	}
 
 	if (!gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0))
 		success = false;
@@ -42,6 +71,48 @@ static bool create_pixel_pack_buffer(struct gs_stage_surface *surf)
 	return success;
 }
 
+static inline void delete_sync(struct gs_stage_surface *surf)
+{
+	if (surf->sync) {
+		glDeleteSync(surf->sync);
+		gl_success("glDeleteSync");
+		surf->sync = NULL;
+	}
+}
+
+static void set_readback_fence(struct gs_stage_surface *surf)
+{
+	delete_sync(surf);
+
+	surf->sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	if (!gl_success("glFenceSync"))
+		surf->sync = NULL;
+}
+
+#define READBACK_TIMEOUT_NS 1000000000ULL
+
+static bool wait_for_readback(struct gs_stage_surface *surf)
+{
+	GLenum result;
+
+	if (!surf->sync)
+		return true;
+
+	result = glClientWaitSync(surf->sync, GL_SYNC_FLUSH_COMMANDS_BIT,
+				  READBACK_TIMEOUT_NS);
+	if (!gl_success("glClientWaitSync"))
+		return false;
+
+	if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+		blog(LOG_WARNING, "Timed out waiting for stage surface "
+				  "readback");
+		return false;
+	}
+
+	delete_sync(surf);
+	return true;
+}
+
 gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
 					   uint32_t height,
 					   enum gs_color_format color_format)
@@ -69,6 +140,16 @@ gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
 void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
 {
 	if (stagesurf) {
+		delete_sync(stagesurf);
+
+		if (stagesurf->mapped &&
+		    gl_bind_buffer(GL_PIXEL_PACK_BUFFER,
+				   stagesurf->pack_buffer)) {
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			gl_success("glUnmapBuffer");
+			gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+
 		if (stagesurf->pack_buffer)
 			gl_delete_buffers(1, &stagesurf->pack_buffer);
 
@@ -142,6 +223,7 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 	if (!gl_success("glReadPixels"))
 		goto failed_unbind_all;
 
+	set_readback_fence(dst);
 	success = true;
 
 failed_unbind_all:
@@ -175,6 +257,8 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 	if (!gl_success("glGetTexImage"))
 		goto failed;
 
+	set_readback_fence(dst);
+
 	gl_bind_texture(GL_TEXTURE_2D, 0);
 	gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
 	return;
@@ -208,14 +292,22 @@ gs_stagesurface_get_color_format(const gs_stagesurf_t *stagesurf)
 bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
 			 uint32_t *linesize)
 {
-	if (!gl_bind_buffer(GL_PIXEL_PACK_BUFFER, stagesurf->pack_buffer))
+	if (!wait_for_readback(stagesurf))
 		goto fail;
 
-	*data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
-	if (!gl_success("glMapBuffer"))
-		goto fail;
+	if (stagesurf->mapped) {
+		*data = stagesurf->mapped;
+	} else {
+		if (!gl_bind_buffer(GL_PIXEL_PACK_BUFFER,
+				    stagesurf->pack_buffer))
+			goto fail;
 
-	gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+		*data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (!gl_success("glMapBuffer"))
+			goto fail;
+
+		gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
 
 	*linesize = stagesurf->bytes_per_pixel * stagesurf->width;
 	return true;
@@ -227,6 +319,9 @@ fail:
 
 void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 {
+	if (stagesurf->mapped)
+		return;
+
 	if (!gl_bind_buffer(GL_PIXEL_PACK_BUFFER, stagesurf->pack_buffer))
 		return;
 
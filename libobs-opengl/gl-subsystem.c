@@ -275,6 +275,7 @@ void device_destroy(gs_device_t *device)
 
 		gl_delete_vertex_arrays(1, &device->empty_vao);
 
+		bfree(device->program_cache_path);
 		da_free(device->proj_stack);
 		gl_platform_destroy(device->plat);
 		bfree(device);
@@ -436,6 +436,7 @@ struct gs_shader {
 	gs_device_t *device;
 	enum gs_shader_type type;
 	GLuint obj;
+	uint64_t hash;
 
 	struct gs_shader_param *viewproj;
 	struct gs_shader_param *world;
@@ -555,6 +556,11 @@ struct gs_stage_surface {
 	GLint gl_internal_format;
 	GLenum gl_type;
 	GLuint pack_buffer;
+
+	/* signaled once the last readback into the pack buffer completed */
+	GLsync sync;
+	/* persistently mapped pack buffer, NULL if mapped on demand */
+	uint8_t *mapped;
 };
 
 struct gs_zstencil_buffer {
@@ -611,6 +617,10 @@ struct gs_device {
 
 	struct gs_program *first_program;
 
+	/* directory linked program binaries are cached in, NULL if disabled */
+	char *program_cache_path;
+	uint64_t driver_hash;
+
 	enum gs_cull_mode cur_cull_mode;
 	struct gs_rect cur_viewport;
 
@@ -258,6 +258,42 @@ failed:
 	blog(LOG_ERROR, "gs_texture_unmap (GL) failed");
 }
 
+bool gs_texture_set_region(gs_texture_t *tex, uint32_t x, uint32_t y,
+			   uint32_t cx, uint32_t cy, const uint8_t *data,
+			   uint32_t linesize)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d *)tex;
+	uint32_t bpp;
+	bool success;
+
+	if (!is_texture_2d(tex, "gs_texture_set_region"))
+		return false;
+	if (tex->is_dynamic || gs_is_compressed_format(tex->format))
+		return false;
+	if (x + cx > tex2d->width || y + cy > tex2d->height)
+		return false;
+
+	bpp = gs_get_format_bpp(tex->format) / 8;
+
+	if (!gl_bind_texture(tex->gl_target, tex->texture))
+		return false;
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, linesize / bpp);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glTexSubImage2D(tex->gl_target, 0, x, y, cx, cy, tex->gl_format,
+			tex->gl_type, data);
+	success = gl_success("glTexSubImage2D");
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	gl_bind_texture(tex->gl_target, 0);
+
+	if (!success)
+		blog(LOG_ERROR, "gs_texture_set_region (GL) failed");
+	return success;
+}
+
 bool gs_texture_is_rect(const gs_texture_t *tex)
 {
 	if (tex->type == GS_TEXTURE_3D)
@@ -0,0 +1,85 @@
+#include "graphics/math-defs.h"
+#include "pulseaudio-mix.h"
+
+static void push_scaled(struct circlebuf *buf, const float *data,
+			size_t frames, float vol)
+{
+	float scaled[AUDIO_OUTPUT_FRAMES];
+
+	while (frames) {
+		size_t count = frames;
+		if (count > AUDIO_OUTPUT_FRAMES)
+			count = AUDIO_OUTPUT_FRAMES;
+
+		for (size_t i = 0; i < count; i++)
+			scaled[i] = data[i] * vol;
+
+		circlebuf_push_back(buf, scaled, count * sizeof(float));
+		data += count;
+		frames -= count;
+	}
+}
+
+void monitor_input_push(struct monitor_input *input,
+			const uint8_t *const *data, size_t frames,
+			size_t channels, float vol, bool muted,
+			size_t buffer_frames)
+{
+	size_t bytes = frames * sizeof(float);
+	size_t max_size;
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		struct circlebuf *buf = &input->buf[ch];
+
+		if (muted)
+			circlebuf_push_back_zero(buf, bytes);
+		else if (close_float(vol, 1.0f, EPSILON))
+			circlebuf_push_back(buf, data[ch], bytes);
+		else
+			push_scaled(buf, (const float *)data[ch], frames, vol);
+	}
+
+	max_size = (buffer_frames * 2 + AUDIO_OUTPUT_FRAMES) * sizeof(float);
+	if (input->buf[0].size > max_size) {
+		size_t excess = input->buf[0].size - max_size;
+		for (size_t ch = 0; ch < channels; ch++)
+			circlebuf_pop_front(&input->buf[ch], NULL, excess);
+	}
+}
+
+void monitor_input_mix(struct monitor_input *input, float *const *mix,
+		       size_t frames, size_t channels, size_t buffer_frames)
+{
+	size_t buffered = input->buf[0].size / sizeof(float);
+	float in[AUDIO_OUTPUT_FRAMES];
+
+	if (frames > AUDIO_OUTPUT_FRAMES)
+		frames = AUDIO_OUTPUT_FRAMES;
+
+	if (input->buffering) {
+		if (buffered < buffer_frames)
+			return;
+		input->buffering = false;
+	}
+
+	if (buffered < frames) {
+		input->buffering = true;
+		frames = buffered;
+	}
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		float *out = mix[ch];
+
+		circlebuf_pop_front(&input->buf[ch], in,
+				    frames * sizeof(float));
+		for (size_t i = 0; i < frames; i++)
+			out[i] += in[i];
+	}
+}
+
+void monitor_input_reset(struct monitor_input *input)
+{
+	for (size_t ch = 0; ch < MAX_AUDIO_CHANNELS; ch++)
+		circlebuf_free(&input->buf[ch]);
+	input->buffering = true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "util/circlebuf.h"
+#include "media-io/audio-io.h"
+
+/*
+ * The audio queued by one monitored source.  Sources push their audio as
+ * it's delivered, and the audio thread adds what's queued to the monitoring
+ * submix once per tick.  A queue is only mixed once it holds
+ * 'buffer_frames', to absorb the jitter of the source's packets, and waits
+ * for that much again whenever it runs dry.
+ */
+struct monitor_input {
+	struct circlebuf buf[MAX_AUDIO_CHANNELS];
+	bool buffering;
+};
+
+/* queues planar float audio, scaled by 'vol' or silent if 'muted', and drops
+ * the oldest audio once the source delivers faster than it's mixed */
+extern void monitor_input_push(struct monitor_input *input,
+			       const uint8_t *const *data, size_t frames,
+			       size_t channels, float vol, bool muted,
+			       size_t buffer_frames);
+
+/* adds up to 'frames' (at most AUDIO_OUTPUT_FRAMES) of queued audio to
+ * 'mix' */
+extern void monitor_input_mix(struct monitor_input *input, float *const *mix,
+			      size_t frames, size_t channels,
+			      size_t buffer_frames);
+
+/* empties the queue, which then buffers again */
+extern void monitor_input_reset(struct monitor_input *input);
@@ -1,15 +1,29 @@
 #include "obs-internal.h"
 #include "pulseaudio-wrapper.h"
+#include "pulseaudio-mix.h"
 
-#define PULSE_DATA(voidptr) struct audio_monitor *data = voidptr;
 #define blog(level, msg, ...) blog(level, "pulse-am: " msg, ##__VA_ARGS__)
 
+/*
+ * All monitored sources are summed into a single submix on the audio thread,
+ * which is resampled once and played through one stream.  Half of the
+ * monitoring latency is used to buffer each source against the jitter of its
+ * packets, the other half is the target length of the stream.
+ */
+
 struct audio_monitor {
 	obs_source_t *source;
+	struct monitor_input input;
+	bool ignore;
+};
+
+struct monitor_bus {
 	pa_stream *stream;
+	char *id;
 	char *device;
+	uint32_t latency_ms;
+	pa_sample_spec spec;
 	pa_buffer_attr attr;
-	enum speaker_layout speakers;
 	pa_sample_format_t format;
 	uint_fast32_t samples_per_sec;
 	uint_fast32_t bytes_per_frame;
@@ -18,16 +32,21 @@ struct audio_monitor {
 	uint_fast32_t packets;
 	uint_fast64_t frames;
 
-	struct circlebuf new_data;
+	size_t mix_channels;
+	size_t buffer_frames;
+	float *mix[MAX_AUDIO_CHANNELS];
 	audio_resampler_t *resampler;
-	size_t buffer_size;
+	struct circlebuf new_data;
+	size_t max_data_size;
 	size_t bytesRemaining;
-	size_t bytes_per_channel;
-
-	bool ignore;
-	pthread_mutex_t playback_mutex;
 };
 
+/* The stream itself is started and stopped with the monitoring mutex held.
+ * The bus mutex protects the buffers of the bus and of the monitors, and is
+ * always locked after the pulseaudio mainloop lock. */
+static pthread_mutex_t bus_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct monitor_bus bus = {0};
+
 static enum speaker_layout
 pulseaudio_channels_to_obs_speakers(uint_fast32_t channels)
 {
@@ -125,132 +144,123 @@ static pa_channel_map pulseaudio_channel_map(enum speaker_layout layout)
 	return ret;
 }
 
-static void process_byte(void *p, size_t frames, size_t channels, float vol)
+static void write_stream(void)
 {
-	register char *cur = (char *)p;
-	register char *end = cur + frames * channels;
+	uint8_t *buffer = NULL;
 
-	while (cur < end)
-		*(cur++) *= vol;
-}
+	pulseaudio_lock();
+	pthread_mutex_lock(&bus_mutex);
 
-static void process_short(void *p, size_t frames, size_t channels, float vol)
-{
-	register short *cur = (short *)p;
-	register short *end = cur + frames * channels;
+	while (bus.stream && bus.new_data.size && bus.bytesRemaining) {
+		size_t bytes = bus.new_data.size;
 
-	while (cur < end)
-		*(cur++) *= vol;
-}
+		if (bytes > bus.bytesRemaining)
+			bytes = bus.bytesRemaining;
 
-static void process_float(void *p, size_t frames, size_t channels, float vol)
-{
-	register float *cur = (float *)p;
-	register float *end = cur + frames * channels;
+		size_t bytesToFill = bytes;
+		if (pa_stream_begin_write(bus.stream, (void **)&buffer,
+					  &bytesToFill) < 0 ||
+		    !buffer)
+			break;
+		if (bytesToFill > bytes)
+			bytesToFill = bytes;
 
-	while (cur < end)
-		*(cur++) *= vol;
-}
+		circlebuf_pop_front(&bus.new_data, buffer, bytesToFill);
+		pa_stream_write(bus.stream, buffer, bytesToFill, NULL, 0LL,
+				PA_SEEK_RELATIVE);
 
-void process_volume(const struct audio_monitor *monitor, float vol,
-		    uint8_t *const *resample_data, uint32_t resample_frames)
-{
-	switch (monitor->bytes_per_channel) {
-	case 1:
-		process_byte(resample_data[0], resample_frames,
-			     monitor->channels, vol);
-		break;
-	case 2:
-		process_short(resample_data[0], resample_frames,
-			      monitor->channels, vol);
-		break;
-	default:
-		process_float(resample_data[0], resample_frames,
-			      monitor->channels, vol);
-		break;
+		bus.bytesRemaining -= bytesToFill;
 	}
+
+	pthread_mutex_unlock(&bus_mutex);
+	pulseaudio_unlock();
 }
 
-static void do_stream_write(void *param)
+void audio_monitoring_mix(size_t frames)
 {
-	PULSE_DATA(param);
-	uint8_t *buffer = NULL;
+	struct obs_core_audio *audio = &obs->audio;
+	uint8_t *resample_data[MAX_AV_PLANES];
+	uint32_t resample_frames;
+	uint64_t ts_offset;
 
-	while (data->new_data.size >= data->buffer_size &&
-	       data->bytesRemaining > 0) {
-		size_t bytesToFill = data->buffer_size;
+	if (frames > AUDIO_OUTPUT_FRAMES)
+		frames = AUDIO_OUTPUT_FRAMES;
 
-		if (bytesToFill > data->bytesRemaining)
-			bytesToFill = data->bytesRemaining;
+	/* don't hold up the audio thread while the device is changed */
+	if (pthread_mutex_trylock(&audio->monitoring_mutex) != 0)
+		return;
 
-		pa_stream_begin_write(data->stream, (void **)&buffer,
-				      &bytesToFill);
+	if (!bus.stream) {
+		pthread_mutex_unlock(&audio->monitoring_mutex);
+		return;
+	}
 
-		circlebuf_pop_front(&data->new_data, buffer, bytesToFill);
+	pthread_mutex_lock(&bus_mutex);
 
-		pulseaudio_lock();
-		pa_stream_write(data->stream, buffer, bytesToFill, NULL, 0LL,
-				PA_SEEK_RELATIVE);
-		pulseaudio_unlock();
+	for (size_t ch = 0; ch < bus.mix_channels; ch++)
+		memset(bus.mix[ch], 0, frames * sizeof(float));
+
+	for (size_t i = 0; i < audio->monitors.num; i++) {
+		struct audio_monitor *monitor = audio->monitors.array[i];
 
-		data->bytesRemaining -= bytesToFill;
+		if (!monitor->ignore)
+			monitor_input_mix(&monitor->input, bus.mix, frames,
+					  bus.mix_channels, bus.buffer_frames);
 	}
+
+	if (audio_resampler_resample(bus.resampler, resample_data,
+				     &resample_frames, &ts_offset,
+				     (const uint8_t *const *)bus.mix,
+				     (uint32_t)frames)) {
+		size_t bytes = bus.bytes_per_frame * resample_frames;
+
+		circlebuf_push_back(&bus.new_data, resample_data[0], bytes);
+
+		if (bus.new_data.size > bus.max_data_size) {
+			size_t excess = bus.new_data.size - bus.max_data_size;
+			excess -= excess % bus.bytes_per_frame;
+			circlebuf_pop_front(&bus.new_data, NULL, excess);
+		}
+
+		bus.packets++;
+		bus.frames += resample_frames;
+	}
+
+	pthread_mutex_unlock(&bus_mutex);
+
+	write_stream();
+
+	pthread_mutex_unlock(&audio->monitoring_mutex);
 }
 
 static void on_audio_playback(void *param, obs_source_t *source,
 			      const struct audio_data *audio_data, bool muted)
 {
 	struct audio_monitor *monitor = param;
-	float vol = source->user_volume;
-	size_t bytes;
-
-	uint8_t *resample_data[MAX_AV_PLANES];
-	uint32_t resample_frames;
-	uint64_t ts_offset;
-	bool success;
-
-	if (pthread_mutex_trylock(&monitor->playback_mutex) != 0)
-		return;
 
 	if (os_atomic_load_long(&source->activate_refs) == 0)
-		goto unlock;
-
-	success = audio_resampler_resample(
-		monitor->resampler, resample_data, &resample_frames, &ts_offset,
-		(const uint8_t *const *)audio_data->data,
-		(uint32_t)audio_data->frames);
-
-	if (!success)
-		goto unlock;
-
-	bytes = monitor->bytes_per_frame * resample_frames;
+		return;
 
-	if (muted) {
-		memset(resample_data[0], 0, bytes);
-	} else {
-		if (!close_float(vol, 1.0f, EPSILON)) {
-			process_volume(monitor, vol, resample_data,
-				       resample_frames);
-		}
-	}
+	pthread_mutex_lock(&bus_mutex);
 
-	circlebuf_push_back(&monitor->new_data, resample_data[0], bytes);
-	monitor->packets++;
-	monitor->frames += resample_frames;
+	if (bus.resampler)
+		monitor_input_push(&monitor->input,
+				   (const uint8_t *const *)audio_data->data,
+				   audio_data->frames, bus.mix_channels,
+				   source->user_volume, muted,
+				   bus.buffer_frames);
 
-unlock:
-	pthread_mutex_unlock(&monitor->playback_mutex);
-	do_stream_write(param);
+	pthread_mutex_unlock(&bus_mutex);
 }
 
 static void pulseaudio_stream_write(pa_stream *p, size_t nbytes, void *userdata)
 {
 	UNUSED_PARAMETER(p);
-	PULSE_DATA(userdata);
+	UNUSED_PARAMETER(userdata);
 
-	pthread_mutex_lock(&data->playback_mutex);
-	data->bytesRemaining += nbytes;
-	pthread_mutex_unlock(&data->playback_mutex);
+	pthread_mutex_lock(&bus_mutex);
+	bus.bytesRemaining += nbytes;
+	pthread_mutex_unlock(&bus_mutex);
 
 	pulseaudio_signal(0);
 }
@@ -258,14 +268,14 @@ static void pulseaudio_stream_write(pa_stream *p, size_t nbytes, void *userdata)
 static void pulseaudio_underflow(pa_stream *p, void *userdata)
 {
 	UNUSED_PARAMETER(p);
-	PULSE_DATA(userdata);
-
-	pthread_mutex_lock(&data->playback_mutex);
-	if (obs_source_active(data->source))
-		data->attr.tlength = (data->attr.tlength * 3) / 2;
+	UNUSED_PARAMETER(userdata);
 
-	pa_stream_set_buffer_attr(data->stream, &data->attr, NULL, NULL);
-	pthread_mutex_unlock(&data->playback_mutex);
+	pthread_mutex_lock(&bus_mutex);
+	if (bus.attr.tlength < pa_usec_to_bytes(1000000, &bus.spec)) {
+		bus.attr.tlength = (bus.attr.tlength * 3) / 2;
+		pa_stream_set_buffer_attr(bus.stream, &bus.attr, NULL, NULL);
+	}
+	pthread_mutex_unlock(&bus_mutex);
 
 	pulseaudio_signal(0);
 }
@@ -286,7 +296,7 @@ static void pulseaudio_source_info(pa_context *c, const pa_source_info *i,
 				   int eol, void *userdata)
 {
 	UNUSED_PARAMETER(c);
-	PULSE_DATA(userdata);
+	struct monitor_bus *data = userdata;
 	// An error occurred
 	if (eol < 0) {
 		data->format = PA_SAMPLE_INVALID;
@@ -328,79 +338,76 @@ skip:
 	pulseaudio_signal(0);
 }
 
-static void pulseaudio_stop_playback(struct audio_monitor *monitor)
+static void stop_bus(void)
 {
-	if (monitor->stream) {
-		pa_stream_disconnect(monitor->stream);
-		pa_stream_unref(monitor->stream);
-		monitor->stream = NULL;
-	}
+	if (!bus.id)
+		return;
 
-	blog(LOG_INFO, "Stopped Monitoring in '%s'", monitor->device);
-	blog(LOG_INFO,
-	     "Got %" PRIuFAST32 " packets with %" PRIuFAST64 " frames",
-	     monitor->packets, monitor->frames);
+	if (bus.stream) {
+		pulseaudio_lock();
+		pa_stream_disconnect(bus.stream);
+		pa_stream_unref(bus.stream);
+		pulseaudio_unlock();
 
-	monitor->packets = 0;
-	monitor->frames = 0;
-}
+		blog(LOG_INFO, "Stopped Monitoring in '%s'", bus.device);
+		blog(LOG_INFO,
+		     "Got %" PRIuFAST32 " packets with %" PRIuFAST64 " frames",
+		     bus.packets, bus.frames);
+	}
 
-static bool audio_monitor_init(struct audio_monitor *monitor,
-			       obs_source_t *source)
-{
-	pthread_mutex_init_value(&monitor->playback_mutex);
+	pthread_mutex_lock(&bus_mutex);
 
-	monitor->source = source;
+	audio_resampler_destroy(bus.resampler);
+	circlebuf_free(&bus.new_data);
+	for (size_t ch = 0; ch < MAX_AUDIO_CHANNELS; ch++)
+		bfree(bus.mix[ch]);
+	bfree(bus.device);
+	bfree(bus.id);
+	memset(&bus, 0, sizeof(bus));
 
-	const char *id = obs->audio.monitoring_device_id;
-	if (!id)
-		return false;
+	pthread_mutex_unlock(&bus_mutex);
 
-	if (source->info.output_flags & OBS_SOURCE_DO_NOT_SELF_MONITOR) {
-		obs_data_t *s = obs_source_get_settings(source);
-		const char *s_dev_id = obs_data_get_string(s, "device_id");
-		bool match = devices_match(s_dev_id, id);
-		obs_data_release(s);
+	pulseaudio_unref();
+}
 
-		if (match) {
-			monitor->ignore = true;
-			blog(LOG_INFO, "Prevented feedback-loop in '%s'",
-			     s_dev_id);
-			return true;
-		}
-	}
+static bool start_bus(void)
+{
+	struct obs_core_audio *audio = &obs->audio;
+	const char *id = audio->monitoring_device_id;
+
+	bus.id = bstrdup(id);
+	bus.latency_ms = audio->monitoring_latency_ms;
 
 	pulseaudio_init();
 
 	if (strcmp(id, "default") == 0)
-		get_default_id(&monitor->device);
+		get_default_id(&bus.device);
 	else
-		monitor->device = bstrdup(id);
+		bus.device = bstrdup(id);
 
-	if (!monitor->device)
+	if (!bus.device)
 		return false;
 
-	if (pulseaudio_get_server_info(pulseaudio_server_info,
-				       (void *)monitor) < 0) {
+	if (pulseaudio_get_server_info(pulseaudio_server_info, NULL) < 0) {
 		blog(LOG_ERROR, "Unable to get server info !");
 		return false;
 	}
 
-	if (pulseaudio_get_source_info(pulseaudio_source_info, monitor->device,
-				       (void *)monitor) < 0) {
+	if (pulseaudio_get_source_info(pulseaudio_source_info, bus.device,
+				       &bus) < 0) {
 		blog(LOG_ERROR, "Unable to get source info !");
 		return false;
 	}
-	if (monitor->format == PA_SAMPLE_INVALID) {
+	if (bus.format == PA_SAMPLE_INVALID) {
 		blog(LOG_ERROR,
 		     "An error occurred while getting the source info!");
 		return false;
 	}
 
 	pa_sample_spec spec;
-	spec.format = monitor->format;
-	spec.rate = (uint32_t)monitor->samples_per_sec;
-	spec.channels = monitor->channels;
+	spec.format = bus.format;
+	spec.rate = (uint32_t)bus.samples_per_sec;
+	spec.channels = bus.channels;
 
 	if (!pa_sample_spec_valid(&spec)) {
 		blog(LOG_ERROR, "Sample spec is not valid");
@@ -408,151 +415,195 @@ static bool audio_monitor_init(struct audio_monitor *monitor,
 	}
 
 	const struct audio_output_info *info =
-		audio_output_get_info(obs->audio.audio);
+		audio_output_get_info(audio->audio);
+	enum speaker_layout speakers =
+		pulseaudio_channels_to_obs_speakers(spec.channels);
 
 	struct resample_info from = {.samples_per_sec = info->samples_per_sec,
 				     .speakers = info->speakers,
 				     .format = AUDIO_FORMAT_FLOAT_PLANAR};
 	struct resample_info to = {
-		.samples_per_sec = (uint32_t)monitor->samples_per_sec,
-		.speakers =
-			pulseaudio_channels_to_obs_speakers(monitor->channels),
-		.format = pulseaudio_to_obs_audio_format(monitor->format)};
+		.samples_per_sec = (uint32_t)bus.samples_per_sec,
+		.speakers = speakers,
+		.format = pulseaudio_to_obs_audio_format(bus.format)};
 
-	monitor->resampler = audio_resampler_create(&to, &from);
-	if (!monitor->resampler) {
+	audio_resampler_t *resampler = audio_resampler_create(&to, &from);
+	if (!resampler) {
 		blog(LOG_WARNING, "%s: %s", __FUNCTION__,
 		     "Failed to create resampler");
 		return false;
 	}
 
-	monitor->bytes_per_channel = get_audio_bytes_per_channel(
-		pulseaudio_to_obs_audio_format(monitor->format));
-	monitor->speakers = pulseaudio_channels_to_obs_speakers(spec.channels);
-	monitor->bytes_per_frame = pa_frame_size(&spec);
+	pa_channel_map channel_map = pulseaudio_channel_map(speakers);
 
-	pa_channel_map channel_map = pulseaudio_channel_map(monitor->speakers);
-
-	monitor->stream = pulseaudio_stream_new(
-		obs_source_get_name(monitor->source), &spec, &channel_map);
-	if (!monitor->stream) {
+	bus.stream = pulseaudio_stream_new("Audio Monitor", &spec,
+					   &channel_map);
+	if (!bus.stream) {
+		audio_resampler_destroy(resampler);
 		blog(LOG_ERROR, "Unable to create stream");
 		return false;
 	}
 
-	monitor->attr.fragsize = (uint32_t)-1;
-	monitor->attr.maxlength = (uint32_t)-1;
-	monitor->attr.minreq = (uint32_t)-1;
-	monitor->attr.prebuf = (uint32_t)-1;
-	monitor->attr.tlength = pa_usec_to_bytes(25000, &spec);
+	uint64_t latency_us = (uint64_t)bus.latency_ms * 1000;
+
+	pthread_mutex_lock(&bus_mutex);
+
+	bus.spec = spec;
+	bus.bytes_per_frame = pa_frame_size(&spec);
+	bus.attr.fragsize = (uint32_t)-1;
+	bus.attr.maxlength = (uint32_t)-1;
+	bus.attr.minreq = (uint32_t)-1;
+	bus.attr.prebuf = (uint32_t)-1;
+	bus.attr.tlength = (uint32_t)pa_usec_to_bytes(latency_us / 2, &spec);
+	bus.max_data_size = pa_usec_to_bytes(latency_us * 2, &spec);
+
+	bus.mix_channels = audio_output_get_channels(audio->audio);
+	bus.buffer_frames = (size_t)util_mul_div64(
+		latency_us / 2, info->samples_per_sec, 1000000);
+	if (bus.buffer_frames < AUDIO_OUTPUT_FRAMES)
+		bus.buffer_frames = AUDIO_OUTPUT_FRAMES;
+	for (size_t ch = 0; ch < bus.mix_channels; ch++)
+		bus.mix[ch] = bzalloc(AUDIO_OUTPUT_FRAMES * sizeof(float));
+	bus.resampler = resampler;
+
+	for (size_t i = 0; i < audio->monitors.num; i++) {
+		struct audio_monitor *monitor = audio->monitors.array[i];
+		monitor_input_reset(&monitor->input);
+	}
+
+	pthread_mutex_unlock(&bus_mutex);
 
-	monitor->buffer_size =
-		monitor->bytes_per_frame * pa_usec_to_bytes(5000, &spec);
+	pulseaudio_write_callback(bus.stream, pulseaudio_stream_write, NULL);
+	pulseaudio_set_underflow_callback(bus.stream, pulseaudio_underflow,
+					  NULL);
 
 	pa_stream_flags_t flags = PA_STREAM_INTERPOLATE_TIMING |
 				  PA_STREAM_AUTO_TIMING_UPDATE;
 
-	if (pthread_mutex_init(&monitor->playback_mutex, NULL) != 0) {
-		blog(LOG_WARNING, "%s: %s", __FUNCTION__,
-		     "Failed to init mutex");
-		return false;
-	}
-
-	int_fast32_t ret = pulseaudio_connect_playback(
-		monitor->stream, monitor->device, &monitor->attr, flags);
+	int_fast32_t ret = pulseaudio_connect_playback(bus.stream, bus.device,
+						       &bus.attr, flags);
 	if (ret < 0) {
-		pulseaudio_stop_playback(monitor);
 		blog(LOG_ERROR, "Unable to connect to stream");
 		return false;
 	}
 
-	blog(LOG_INFO, "Started Monitoring in '%s'", monitor->device);
+	blog(LOG_INFO, "Started Monitoring in '%s' with %" PRIu32 " ms latency",
+	     bus.device, bus.latency_ms);
 	return true;
 }
 
-static void audio_monitor_init_final(struct audio_monitor *monitor)
+static bool bus_needed(void)
 {
-	if (monitor->ignore)
-		return;
-
-	obs_source_add_audio_capture_callback(monitor->source,
-					      on_audio_playback, monitor);
+	struct obs_core_audio *audio = &obs->audio;
 
-	pulseaudio_write_callback(monitor->stream, pulseaudio_stream_write,
-				  (void *)monitor);
+	for (size_t i = 0; i < audio->monitors.num; i++) {
+		if (!audio->monitors.array[i]->ignore)
+			return true;
+	}
 
-	pulseaudio_set_underflow_callback(monitor->stream, pulseaudio_underflow,
-					  (void *)monitor);
+	return false;
 }
 
-static inline void audio_monitor_free(struct audio_monitor *monitor)
+/* Starts, restarts or stops the stream to match the monitors and the
+ * monitoring settings.  Called with the monitoring mutex held. */
+static void update_bus(void)
 {
-	if (monitor->ignore)
+	struct obs_core_audio *audio = &obs->audio;
+
+	if (!bus_needed()) {
+		stop_bus();
 		return;
+	}
 
-	if (monitor->source)
-		obs_source_remove_audio_capture_callback(
-			monitor->source, on_audio_playback, monitor);
+	if (bus.id && strcmp(bus.id, audio->monitoring_device_id) == 0 &&
+	    bus.latency_ms == audio->monitoring_latency_ms)
+		return;
 
-	audio_resampler_destroy(monitor->resampler);
-	circlebuf_free(&monitor->new_data);
+	stop_bus();
+	if (!start_bus())
+		stop_bus();
+}
 
-	if (monitor->stream)
-		pulseaudio_stop_playback(monitor);
-	pulseaudio_unref();
+static void check_feedback(struct audio_monitor *monitor)
+{
+	obs_source_t *source = monitor->source;
+	const char *id = obs->audio.monitoring_device_id;
 
-	bfree(monitor->device);
+	monitor->ignore = false;
+
+	if (source->info.output_flags & OBS_SOURCE_DO_NOT_SELF_MONITOR) {
+		obs_data_t *s = obs_source_get_settings(source);
+		const char *s_dev_id = obs_data_get_string(s, "device_id");
+		bool match = devices_match(s_dev_id, id);
+		obs_data_release(s);
+
+		if (match) {
+			monitor->ignore = true;
+			blog(LOG_INFO, "Prevented feedback-loop in '%s'",
+			     s_dev_id);
+		}
+	}
 }
 
 struct audio_monitor *audio_monitor_create(obs_source_t *source)
 {
-	struct audio_monitor monitor = {0};
-	struct audio_monitor *out;
+	struct audio_monitor *monitor;
 
-	if (!audio_monitor_init(&monitor, source))
-		goto fail;
+	if (!obs->audio.monitoring_device_id)
+		return NULL;
 
-	out = bmemdup(&monitor, sizeof(monitor));
+	monitor = bzalloc(sizeof(*monitor));
+	monitor->source = source;
+	monitor_input_reset(&monitor->input);
+	check_feedback(monitor);
 
 	pthread_mutex_lock(&obs->audio.monitoring_mutex);
-	da_push_back(obs->audio.monitors, &out);
-	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+	da_push_back(obs->audio.monitors, &monitor);
+	update_bus();
 
-	audio_monitor_init_final(out);
-	return out;
+	if (!monitor->ignore)
+		obs_source_add_audio_capture_callback(source, on_audio_playback,
+						      monitor);
 
-fail:
-	audio_monitor_free(&monitor);
-	return NULL;
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+	return monitor;
 }
 
 void audio_monitor_reset(struct audio_monitor *monitor)
 {
-	struct audio_monitor new_monitor = {0};
-	bool success;
-	audio_monitor_free(monitor);
-
-	pthread_mutex_lock(&monitor->playback_mutex);
-	success = audio_monitor_init(&new_monitor, monitor->source);
-	pthread_mutex_unlock(&monitor->playback_mutex);
-
-	if (success) {
-		*monitor = new_monitor;
-		audio_monitor_init_final(monitor);
-	} else {
-		audio_monitor_free(&new_monitor);
-	}
+	bool ignored = monitor->ignore;
+
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+
+	check_feedback(monitor);
+
+	if (monitor->ignore && !ignored)
+		obs_source_remove_audio_capture_callback(
+			monitor->source, on_audio_playback, monitor);
+
+	update_bus();
+
+	if (!monitor->ignore && ignored)
+		obs_source_add_audio_capture_callback(
+			monitor->source, on_audio_playback, monitor);
+
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
 }
 
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
-	if (monitor) {
-		audio_monitor_free(monitor);
+	if (!monitor)
+		return;
+
+	if (!monitor->ignore)
+		obs_source_remove_audio_capture_callback(
+			monitor->source, on_audio_playback, monitor);
 
-		pthread_mutex_lock(&obs->audio.monitoring_mutex);
-		da_erase_item(obs->audio.monitors, &monitor);
-		pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+	da_erase_item(obs->audio.monitors, &monitor);
+	update_bus();
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
 
-		bfree(monitor);
-	}
+	monitor_input_reset(&monitor->input);
+	bfree(monitor);
 }
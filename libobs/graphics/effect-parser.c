@@ -1839,6 +1839,7 @@ static void ep_compile_annotations(struct darray *ep_annotations,
 			((struct ep_param *)ep_annotations->array) + i;
 
 		param->name = bstrdup(param_in->name);
+		param->name_hash = effect_name_hash(param->name);
 		param->section = EFFECT_ANNOTATION;
 		param->effect = ep->effect;
 		da_move(param->default_val, param_in->default_val);
@@ -1870,6 +1871,7 @@ static void ep_compile_param(struct effect_parser *ep, size_t idx)
 	param_in->param = param;
 
 	param->name = bstrdup(param_in->name);
+	param->name_hash = effect_name_hash(param->name);
 	param->section = EFFECT_PARAM;
 	param->effect = ep->effect;
 	da_move(param->default_val, param_in->default_val);
@@ -1880,6 +1882,8 @@ static void ep_compile_param(struct effect_parser *ep, size_t idx)
 		ep->effect->view_proj = param;
 	else if (strcmp(param_in->name, "World") == 0)
 		ep->effect->world = param;
+	else if (strcmp(param_in->name, "image") == 0)
+		ep->effect->image = param;
 
 #if defined(_DEBUG) && defined(_DEBUG_SHADERS)
 	debug_param(param, param_in, idx, "\t");
@@ -2040,9 +2044,13 @@ static inline bool ep_compile_technique(struct effect_parser *ep, size_t idx)
 	tech_in = ep->techniques.array + idx;
 
 	tech->name = bstrdup(tech_in->name);
+	tech->name_hash = effect_name_hash(tech->name);
 	tech->section = EFFECT_TECHNIQUE;
 	tech->effect = ep->effect;
 
+	if (strcmp(tech->name, "Draw") == 0)
+		ep->effect->draw = tech;
+
 	da_resize(tech->passes, tech_in->passes.num);
 
 #if defined(_DEBUG) && defined(_DEBUG_SHADERS)
@@ -41,9 +41,11 @@ gs_technique_t *gs_effect_get_technique(const gs_effect_t *effect,
 	if (!effect)
 		return NULL;
 
+	uint32_t hash = effect_name_hash(name);
+
 	for (size_t i = 0; i < effect->techniques.num; i++) {
 		struct gs_effect_technique *tech = effect->techniques.array + i;
-		if (strcmp(tech->name, name) == 0)
+		if (tech->name_hash == hash && strcmp(tech->name, name) == 0)
 			return tech;
 	}
 
@@ -105,6 +107,9 @@ size_t gs_technique_begin(gs_technique_t *tech)
 	if (!tech)
 		return 0;
 
+	/* batched sprites must be drawn before another effect takes over */
+	gs_sprite_batch_flush();
+
 	tech->effect->cur_technique = tech;
 	tech->effect->graphics->cur_effect = tech->effect;
 
@@ -284,11 +289,12 @@ gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect,
 		return NULL;
 
 	struct gs_effect_param *params = effect->params.array;
+	uint32_t hash = effect_name_hash(name);
 
 	for (size_t i = 0; i < effect->params.num; i++) {
 		struct gs_effect_param *param = params + i;
 
-		if (strcmp(param->name, name) == 0)
+		if (param->name_hash == hash && strcmp(param->name, name) == 0)
 			return param;
 	}
 
@@ -319,10 +325,12 @@ gs_eparam_t *gs_param_get_annotation_by_name(const gs_eparam_t *param,
 	if (!param)
 		return NULL;
 	struct gs_effect_param *params = param->annotations.array;
+	uint32_t hash = effect_name_hash(name);
 
 	for (size_t i = 0; i < param->annotations.num; i++) {
 		struct gs_effect_param *g_param = params + i;
-		if (strcmp(g_param->name, name) == 0)
+		if (g_param->name_hash == hash &&
+		    strcmp(g_param->name, name) == 0)
 			return g_param;
 	}
 	return NULL;
@@ -366,6 +374,16 @@ gs_eparam_t *gs_effect_get_world_matrix(const gs_effect_t *effect)
 	return effect ? effect->world : NULL;
 }
 
+gs_eparam_t *gs_effect_get_image_param(const gs_effect_t *effect)
+{
+	return effect ? effect->image : NULL;
+}
+
+gs_technique_t *gs_effect_get_draw_technique(const gs_effect_t *effect)
+{
+	return effect ? effect->draw : NULL;
+}
+
 void gs_effect_get_param_info(const gs_eparam_t *param,
 			      struct gs_effect_param_info *info)
 {
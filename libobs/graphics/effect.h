@@ -49,6 +49,7 @@ enum effect_section {
 
 struct gs_effect_param {
 	char *name;
+	uint32_t name_hash;
 	enum effect_section section;
 
 	enum gs_shader_param_type type;
@@ -65,6 +66,20 @@ struct gs_effect_param {
 	DARRAY(struct gs_effect_param) annotations;
 };
 
+/* FNV-1a hash of parameter and technique names.  Lookups compare the hash
+ * first so that only an actual match needs a full string comparison. */
+static inline uint32_t effect_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*name) {
+		hash ^= (uint8_t)*(name++);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
 static inline void effect_param_init(struct gs_effect_param *param)
 {
 	memset(param, 0, sizeof(struct gs_effect_param));
@@ -124,6 +139,7 @@ static inline void effect_pass_free(struct gs_effect_pass *pass)
 
 struct gs_effect_technique {
 	char *name;
+	uint32_t name_hash;
 	enum effect_section section;
 	struct gs_effect *effect;
 
@@ -159,6 +175,8 @@ struct gs_effect {
 	struct gs_effect_pass *cur_pass;
 
 	gs_eparam_t *view_proj, *world, *scale;
+	gs_eparam_t *image;
+	gs_technique_t *draw;
 	graphics_t *graphics;
 
 	struct gs_effect *next;
@@ -178,6 +178,9 @@ struct gs_exports {
 	bool (*gs_texture_map)(gs_texture_t *tex, uint8_t **ptr,
 			       uint32_t *linesize);
 	void (*gs_texture_unmap)(gs_texture_t *tex);
+	bool (*gs_texture_set_region)(gs_texture_t *tex, uint32_t x, uint32_t y,
+				      uint32_t cx, uint32_t cy,
+				      const uint8_t *data, uint32_t linesize);
 	bool (*gs_texture_is_rect)(const gs_texture_t *tex);
 	void *(*gs_texture_get_obj)(const gs_texture_t *tex);
 
@@ -261,6 +264,8 @@ struct gs_exports {
 					   gs_samplerstate_t *sampler);
 
 	bool (*device_nv12_available)(gs_device_t *device);
+	void (*device_set_program_cache_path)(gs_device_t *device,
+					      const char *path);
 
 	void (*device_debug_marker_begin)(gs_device_t *device,
 					  const char *markername,
@@ -326,6 +331,16 @@ struct blend_state {
 	enum gs_blend_type dest_a;
 };
 
+struct gs_sprite_batch {
+	long depth;
+	bool flushing;
+	bool disabled;
+	gs_effect_t *effect;
+	gs_vertbuffer_t *vertbuffer;
+	DARRAY(struct vec3) points;
+	DARRAY(uint32_t) colors;
+};
+
 struct graphics_subsystem {
 	void *module;
 	gs_device_t *device;
@@ -357,4 +372,7 @@ struct graphics_subsystem {
 
 	struct blend_state cur_blend_state;
 	DARRAY(struct blend_state) blend_state_stack;
+
+	struct gs_sprite_batch sprite_batch;
+	uint64_t draw_calls;
 };
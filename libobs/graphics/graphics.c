@@ -64,6 +64,19 @@ static inline bool gs_valid(const char *f)
 	 ptr_valid(param2, func) && ptr_valid(param3, func))
 
 #define IMMEDIATE_COUNT 512
+#define SPRITE_BATCH_MAX_VERTS (6 * 256)
+
+static void sprite_batch_draw(graphics_t *graphics);
+
+/* draws any queued batched sprites before the device state they depend on
+ * changes, or before anything else is drawn on top of them */
+static inline void sprite_batch_flush_pending(graphics_t *graphics)
+{
+	struct gs_sprite_batch *batch = &graphics->sprite_batch;
+
+	if (batch->points.num && !batch->flushing)
+		sprite_batch_draw(graphics);
+}
 
 void gs_enum_adapters(bool (*callback)(void *param, const char *name,
 				       uint32_t id),
@@ -230,6 +243,9 @@ void gs_destroy(graphics_t *graphics)
 
 		graphics->exports.gs_vertexbuffer_destroy(
 			graphics->sprite_buffer);
+		if (graphics->sprite_batch.vertbuffer)
+			graphics->exports.gs_vertexbuffer_destroy(
+				graphics->sprite_batch.vertbuffer);
 		graphics->exports.gs_vertexbuffer_destroy(
 			graphics->immediate_vertbuffer);
 		graphics->exports.device_destroy(graphics->device);
@@ -242,6 +258,8 @@ void gs_destroy(graphics_t *graphics)
 	da_free(graphics->matrix_stack);
 	da_free(graphics->viewport_stack);
 	da_free(graphics->blend_state_stack);
+	da_free(graphics->sprite_batch.points);
+	da_free(graphics->sprite_batch.colors);
 	if (graphics->module)
 		os_dlclose(graphics->module);
 	bfree(graphics);
@@ -1070,6 +1088,199 @@ void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t sub_x,
 	gs_draw(GS_TRISTRIP, 0, 0);
 }
 
+/* ------------------------------------------------------------------------- */
+/* sprite batching */
+
+static const char *sprite_batch_effect_string =
+	"uniform float4x4 ViewProj;\n"
+	"\n"
+	"struct VertInOut {\n"
+	"	float4 pos   : POSITION;\n"
+	"	float4 color : COLOR;\n"
+	"};\n"
+	"\n"
+	"VertInOut VSBatch(VertInOut vert_in)\n"
+	"{\n"
+	"	VertInOut vert_out;\n"
+	"	vert_out.pos   = mul(float4(vert_in.pos.xyz, 1.0), ViewProj);\n"
+	"	vert_out.color = vert_in.color;\n"
+	"	return vert_out;\n"
+	"}\n"
+	"\n"
+	"float4 PSBatch(VertInOut vert_in) : TARGET\n"
+	"{\n"
+	"	return vert_in.color;\n"
+	"}\n"
+	"\n"
+	"technique Draw\n"
+	"{\n"
+	"	pass\n"
+	"	{\n"
+	"		vertex_shader = VSBatch(vert_in);\n"
+	"		pixel_shader  = PSBatch(vert_in);\n"
+	"	}\n"
+	"}\n";
+
+static bool sprite_batch_init(graphics_t *graphics)
+{
+	struct gs_sprite_batch *batch = &graphics->sprite_batch;
+	struct gs_vb_data *vbd;
+
+	if (batch->vertbuffer)
+		return true;
+
+	if (!batch->effect) {
+		batch->effect = gs_effect_create(sprite_batch_effect_string,
+						 "sprite_batch.effect", NULL);
+		if (!batch->effect)
+			return false;
+	}
+
+	vbd = gs_vbdata_create();
+	vbd->num = SPRITE_BATCH_MAX_VERTS;
+	vbd->points = bmalloc(sizeof(struct vec3) * SPRITE_BATCH_MAX_VERTS);
+	vbd->colors = bmalloc(sizeof(uint32_t) * SPRITE_BATCH_MAX_VERTS);
+
+	memset(vbd->points, 0, sizeof(struct vec3) * SPRITE_BATCH_MAX_VERTS);
+	memset(vbd->colors, 0, sizeof(uint32_t) * SPRITE_BATCH_MAX_VERTS);
+
+	batch->vertbuffer = graphics->exports.device_vertexbuffer_create(
+		graphics->device, vbd, GS_DYNAMIC);
+	return batch->vertbuffer != NULL;
+}
+
+static void sprite_batch_draw(graphics_t *graphics)
+{
+	struct gs_sprite_batch *batch = &graphics->sprite_batch;
+	uint32_t num = (uint32_t)batch->points.num;
+	struct gs_vb_data *data;
+
+	batch->flushing = true;
+
+	data = gs_vertexbuffer_get_data(batch->vertbuffer);
+	memcpy(data->points, batch->points.array, sizeof(struct vec3) * num);
+	memcpy(data->colors, batch->colors.array, sizeof(uint32_t) * num);
+	gs_vertexbuffer_flush(batch->vertbuffer);
+
+	/* every state change flushes the batch first, so the current device
+	 * state is still the one the sprites were queued with.  the vertices
+	 * have already been transformed to world space */
+	gs_matrix_push();
+	gs_matrix_identity();
+
+	while (gs_effect_loop(batch->effect, "Draw")) {
+		gs_load_vertexbuffer(batch->vertbuffer);
+		gs_load_indexbuffer(NULL);
+		gs_draw(GS_TRIS, 0, num);
+	}
+
+	gs_matrix_pop();
+
+	da_resize(batch->points, 0);
+	da_resize(batch->colors, 0);
+
+	batch->flushing = false;
+}
+
+void gs_sprite_batch_begin(void)
+{
+	graphics_t *graphics = thread_graphics;
+	struct gs_sprite_batch *batch;
+
+	if (!gs_valid("gs_sprite_batch_begin"))
+		return;
+
+	batch = &graphics->sprite_batch;
+	if (batch->depth++ || batch->disabled)
+		return;
+
+	/* only try (and warn) once, sprites are simply drawn normally when
+	 * no batch could be created */
+	if (!sprite_batch_init(graphics)) {
+		blog(LOG_WARNING, "gs_sprite_batch_begin: Failed to create "
+				  "sprite batch, sprites will not be batched");
+		batch->disabled = true;
+	}
+}
+
+void gs_sprite_batch_end(void)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_sprite_batch_end"))
+		return;
+	if (!graphics->sprite_batch.depth) {
+		blog(LOG_WARNING, "gs_sprite_batch_end: Called without a "
+				  "matching gs_sprite_batch_begin");
+		return;
+	}
+
+	sprite_batch_flush_pending(graphics);
+	graphics->sprite_batch.depth--;
+}
+
+void gs_sprite_batch_flush(void)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_sprite_batch_flush"))
+		return;
+
+	sprite_batch_flush_pending(graphics);
+}
+
+bool gs_sprite_batch_add_solid(uint32_t width, uint32_t height,
+			       uint32_t color)
+{
+	graphics_t *graphics = thread_graphics;
+	struct gs_sprite_batch *batch;
+	struct matrix4 world;
+	struct vec3 corners[4];
+	static const size_t order[6] = {0, 1, 2, 1, 3, 2};
+
+	if (!gs_valid("gs_sprite_batch_add_solid"))
+		return false;
+
+	batch = &graphics->sprite_batch;
+
+	/* sprites can only be deferred when no other effect is active, as
+	 * the caller would otherwise expect its own shaders to be used */
+	if (!batch->depth || !batch->vertbuffer || graphics->cur_effect)
+		return false;
+	if (!width || !height)
+		return true;
+
+	if (batch->points.num + 6 > SPRITE_BATCH_MAX_VERTS)
+		sprite_batch_draw(graphics);
+
+	gs_matrix_get(&world);
+
+	vec3_set(&corners[0], 0.0f, 0.0f, 0.0f);
+	vec3_set(&corners[1], (float)width, 0.0f, 0.0f);
+	vec3_set(&corners[2], 0.0f, (float)height, 0.0f);
+	vec3_set(&corners[3], (float)width, (float)height, 0.0f);
+
+	for (size_t i = 0; i < 4; i++)
+		vec3_transform(&corners[i], &corners[i], &world);
+
+	for (size_t i = 0; i < 6; i++) {
+		da_push_back(batch->points, &corners[order[i]]);
+		da_push_back(batch->colors, &color);
+	}
+
+	return true;
+}
+
+uint64_t gs_get_draw_call_count(void)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_get_draw_call_count"))
+		return 0;
+
+	return graphics->draw_calls;
+}
+
 void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot,
 			   float left, float right, float top, float bottom,
 			   float znear)
@@ -1199,6 +1410,8 @@ void gs_perspective(float angle, float aspect, float near, float far)
 	if (!gs_valid("gs_perspective"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	ymax = near * tanf(RAD(angle) * 0.5f);
 	ymin = -ymax;
 
@@ -1576,6 +1789,8 @@ void gs_load_vertexbuffer(gs_vertbuffer_t *vertbuffer)
 	if (!gs_valid("gs_load_vertexbuffer"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_load_vertexbuffer(graphics->device,
 						   vertbuffer);
 }
@@ -1587,6 +1802,8 @@ void gs_load_indexbuffer(gs_indexbuffer_t *indexbuffer)
 	if (!gs_valid("gs_load_indexbuffer"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_load_indexbuffer(graphics->device,
 						  indexbuffer);
 }
@@ -1598,6 +1815,8 @@ void gs_load_texture(gs_texture_t *tex, int unit)
 	if (!gs_valid("gs_load_texture"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_load_texture(graphics->device, tex, unit);
 }
 
@@ -1608,6 +1827,8 @@ void gs_load_samplerstate(gs_samplerstate_t *samplerstate, int unit)
 	if (!gs_valid("gs_load_samplerstate"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_load_samplerstate(graphics->device,
 						   samplerstate, unit);
 }
@@ -1619,6 +1840,8 @@ void gs_load_vertexshader(gs_shader_t *vertshader)
 	if (!gs_valid("gs_load_vertexshader"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_load_vertexshader(graphics->device,
 						   vertshader);
 }
@@ -1630,6 +1853,8 @@ void gs_load_pixelshader(gs_shader_t *pixelshader)
 	if (!gs_valid("gs_load_pixelshader"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_load_pixelshader(graphics->device,
 						  pixelshader);
 }
@@ -1641,6 +1866,8 @@ void gs_load_default_samplerstate(bool b_3d, int unit)
 	if (!gs_valid("gs_load_default_samplerstate"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_load_default_samplerstate(graphics->device,
 							   b_3d, unit);
 }
@@ -1692,6 +1919,8 @@ void gs_set_render_target(gs_texture_t *tex, gs_zstencil_t *zstencil)
 	if (!gs_valid("gs_set_render_target"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_set_render_target(graphics->device, tex,
 						   zstencil);
 }
@@ -1704,6 +1933,8 @@ void gs_set_cube_render_target(gs_texture_t *cubetex, int side,
 	if (!gs_valid("gs_set_cube_render_target"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_set_cube_render_target(
 		graphics->device, cubetex, side, zstencil);
 }
@@ -1715,6 +1946,8 @@ void gs_copy_texture(gs_texture_t *dst, gs_texture_t *src)
 	if (!gs_valid_p2("gs_copy_texture", dst, src))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_copy_texture(graphics->device, dst, src);
 }
 
@@ -1727,6 +1960,8 @@ void gs_copy_texture_region(gs_texture_t *dst, uint32_t dst_x, uint32_t dst_y,
 	if (!gs_valid_p("gs_copy_texture_region", dst))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_copy_texture_region(graphics->device, dst,
 						     dst_x, dst_y, src, src_x,
 						     src_y, src_w, src_h);
@@ -1739,6 +1974,8 @@ void gs_stage_texture(gs_stagesurf_t *dst, gs_texture_t *src)
 	if (!gs_valid("gs_stage_texture"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_stage_texture(graphics->device, dst, src);
 }
 
@@ -1770,8 +2007,11 @@ void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert,
 	if (!gs_valid("gs_draw"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_draw(graphics->device, draw_mode, start_vert,
 				      num_verts);
+	graphics->draw_calls++;
 }
 
 void gs_end_scene(void)
@@ -1781,6 +2021,8 @@ void gs_end_scene(void)
 	if (!gs_valid("gs_end_scene"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_end_scene(graphics->device);
 }
 
@@ -1791,6 +2033,8 @@ void gs_load_swapchain(gs_swapchain_t *swapchain)
 	if (!gs_valid("gs_load_swapchain"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_load_swapchain(graphics->device, swapchain);
 }
 
@@ -1802,6 +2046,8 @@ void gs_clear(uint32_t clear_flags, const struct vec4 *color, float depth,
 	if (!gs_valid("gs_clear"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_clear(graphics->device, clear_flags, color,
 				       depth, stencil);
 }
@@ -1813,6 +2059,8 @@ void gs_present(void)
 	if (!gs_valid("gs_present"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_present(graphics->device);
 }
 
@@ -1823,6 +2071,8 @@ void gs_flush(void)
 	if (!gs_valid("gs_flush"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_flush(graphics->device);
 }
 
@@ -1833,6 +2083,8 @@ void gs_set_cull_mode(enum gs_cull_mode mode)
 	if (!gs_valid("gs_set_cull_mode"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_set_cull_mode(graphics->device, mode);
 }
 
@@ -1853,6 +2105,8 @@ void gs_enable_blending(bool enable)
 	if (!gs_valid("gs_enable_blending"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->cur_blend_state.enabled = enable;
 	graphics->exports.device_enable_blending(graphics->device, enable);
 }
@@ -1864,6 +2118,8 @@ void gs_enable_depth_test(bool enable)
 	if (!gs_valid("gs_enable_depth_test"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_enable_depth_test(graphics->device, enable);
 }
 
@@ -1874,6 +2130,8 @@ void gs_enable_stencil_test(bool enable)
 	if (!gs_valid("gs_enable_stencil_test"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_enable_stencil_test(graphics->device, enable);
 }
 
@@ -1884,6 +2142,8 @@ void gs_enable_stencil_write(bool enable)
 	if (!gs_valid("gs_enable_stencil_write"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_enable_stencil_write(graphics->device, enable);
 }
 
@@ -1894,6 +2154,8 @@ void gs_enable_color(bool red, bool green, bool blue, bool alpha)
 	if (!gs_valid("gs_enable_color"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_enable_color(graphics->device, red, green,
 					      blue, alpha);
 }
@@ -1905,6 +2167,8 @@ void gs_blend_function(enum gs_blend_type src, enum gs_blend_type dest)
 	if (!gs_valid("gs_blend_function"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->cur_blend_state.src_c = src;
 	graphics->cur_blend_state.dest_c = dest;
 	graphics->cur_blend_state.src_a = src;
@@ -1922,6 +2186,8 @@ void gs_blend_function_separate(enum gs_blend_type src_c,
 	if (!gs_valid("gs_blend_function_separate"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->cur_blend_state.src_c = src_c;
 	graphics->cur_blend_state.dest_c = dest_c;
 	graphics->cur_blend_state.src_a = src_a;
@@ -1937,6 +2203,8 @@ void gs_depth_function(enum gs_depth_test test)
 	if (!gs_valid("gs_depth_function"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_depth_function(graphics->device, test);
 }
 
@@ -1947,6 +2215,8 @@ void gs_stencil_function(enum gs_stencil_side side, enum gs_depth_test test)
 	if (!gs_valid("gs_stencil_function"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_stencil_function(graphics->device, side, test);
 }
 
@@ -1958,6 +2228,8 @@ void gs_stencil_op(enum gs_stencil_side side, enum gs_stencil_op_type fail,
 	if (!gs_valid("gs_stencil_op"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_stencil_op(graphics->device, side, fail, zfail,
 					    zpass);
 }
@@ -1969,6 +2241,8 @@ void gs_set_viewport(int x, int y, int width, int height)
 	if (!gs_valid("gs_set_viewport"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_set_viewport(graphics->device, x, y, width,
 					      height);
 }
@@ -1990,6 +2264,8 @@ void gs_set_scissor_rect(const struct gs_rect *rect)
 	if (!gs_valid("gs_set_scissor_rect"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_set_scissor_rect(graphics->device, rect);
 }
 
@@ -2001,6 +2277,8 @@ void gs_ortho(float left, float right, float top, float bottom, float znear,
 	if (!gs_valid("gs_ortho"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_ortho(graphics->device, left, right, top,
 				       bottom, znear, zfar);
 }
@@ -2013,6 +2291,8 @@ void gs_frustum(float left, float right, float top, float bottom, float znear,
 	if (!gs_valid("gs_frustum"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_frustum(graphics->device, left, right, top,
 					 bottom, znear, zfar);
 }
@@ -2034,6 +2314,8 @@ void gs_projection_pop(void)
 	if (!gs_valid("gs_projection_pop"))
 		return;
 
+	sprite_batch_flush_pending(graphics);
+
 	graphics->exports.device_projection_pop(graphics->device);
 }
 
@@ -2304,6 +2586,22 @@ void gs_texture_unmap(gs_texture_t *tex)
 	graphics->exports.gs_texture_unmap(tex);
 }
 
+bool gs_texture_set_region(gs_texture_t *tex, uint32_t x, uint32_t y,
+			   uint32_t cx, uint32_t cy, const uint8_t *data,
+			   uint32_t linesize)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p2("gs_texture_set_region", tex, data))
+		return false;
+
+	if (!graphics->exports.gs_texture_set_region)
+		return false;
+
+	return graphics->exports.gs_texture_set_region(tex, x, y, cx, cy, data,
+						       linesize);
+}
+
 bool gs_texture_is_rect(const gs_texture_t *tex)
 {
 	graphics_t *graphics = thread_graphics;
@@ -2689,6 +2987,18 @@ bool gs_nv12_available(void)
 		thread_graphics->device);
 }
 
+void gs_set_program_cache_path(const char *path)
+{
+	if (!gs_valid("gs_set_program_cache_path"))
+		return;
+
+	if (!thread_graphics->exports.device_set_program_cache_path)
+		return;
+
+	thread_graphics->exports.device_set_program_cache_path(
+		thread_graphics->device, path);
+}
+
 void gs_debug_marker_begin(const float color[4], const char *markername)
 {
 	if (!gs_valid("gs_debug_marker_begin"))
@@ -408,6 +408,8 @@ EXPORT void gs_effect_update_params(gs_effect_t *effect);
 
 EXPORT gs_eparam_t *gs_effect_get_viewproj_matrix(const gs_effect_t *effect);
 EXPORT gs_eparam_t *gs_effect_get_world_matrix(const gs_effect_t *effect);
+EXPORT gs_eparam_t *gs_effect_get_image_param(const gs_effect_t *effect);
+EXPORT gs_technique_t *gs_effect_get_draw_technique(const gs_effect_t *effect);
 
 #ifndef SWIG
 EXPORT void gs_effect_get_param_info(const gs_eparam_t *param,
@@ -572,6 +574,29 @@ EXPORT void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip,
 				     uint32_t x, uint32_t y, uint32_t cx,
 				     uint32_t cy);
 
+/**
+ * Sprite batching
+ *
+ *   Between gs_sprite_batch_begin and gs_sprite_batch_end, solid colored
+ * sprites queued with gs_sprite_batch_add_solid are transformed on the CPU
+ * and drawn together with a single draw call.  Queued sprites are drawn
+ * automatically before anything else is drawn or before the render target,
+ * viewport or projection changes, so drawing order is preserved.
+ *
+ *   gs_sprite_batch_add_solid returns false if the sprite could not be
+ * queued (no batch active, or an effect technique is currently active), in
+ * which case the caller should draw it normally.  The color is in the same
+ * 0xAABBGGRR format as vec4_from_rgba.
+ */
+EXPORT void gs_sprite_batch_begin(void);
+EXPORT void gs_sprite_batch_end(void);
+EXPORT void gs_sprite_batch_flush(void);
+EXPORT bool gs_sprite_batch_add_solid(uint32_t width, uint32_t height,
+				      uint32_t color);
+
+/** Returns the total number of draw calls issued by the current context */
+EXPORT uint64_t gs_get_draw_call_count(void);
+
 EXPORT void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot,
 				  float left, float right, float top,
 				  float bottom, float znear);
@@ -735,6 +760,15 @@ gs_texture_get_color_format(const gs_texture_t *tex);
 EXPORT bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr,
 			   uint32_t *linesize);
 EXPORT void gs_texture_unmap(gs_texture_t *tex);
+/**
+ * Replaces a rectangle of the first level of a non-dynamic texture without
+ * re-uploading the rest of it.  Returns false if the texture is dynamic or
+ * compressed, or if the backend can't update regions, in which case the
+ * caller has to recreate the texture.
+ */
+EXPORT bool gs_texture_set_region(gs_texture_t *tex, uint32_t x, uint32_t y,
+				  uint32_t cx, uint32_t cy, const uint8_t *data,
+				  uint32_t linesize);
 /** special-case function (GL only) - specifies whether the texture is a
  * GL_TEXTURE_RECTANGLE type, which doesn't use normalized texture
  * coordinates, doesn't support mipmapping, and requires address clamping */
@@ -799,6 +833,10 @@ EXPORT bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint,
 
 EXPORT bool gs_nv12_available(void);
 
+/** Sets the directory that linked shader programs are cached in, or NULL to
+ * stop caching them.  Only used by the OpenGL renderer. */
+EXPORT void gs_set_program_cache_path(const char *path);
+
 #define GS_USE_DEBUG_MARKERS 0
 #if GS_USE_DEBUG_MARKERS
 static const float GS_DEBUG_COLOR_DEFAULT[] = {0.5f, 0.5f, 0.5f, 1.0f};
@@ -19,7 +19,9 @@
 
 #include "../util/base.h"
 #include "../util/bmem.h"
+#include "../util/dstr.h"
 #include "../util/platform.h"
+#include "../util/threading.h"
 
 #include <libavformat/avformat.h>
 
@@ -32,11 +34,103 @@
 #define CODEC_FLAG_GLOBAL_H CODEC_FLAG_GLOBAL_HEADER
 #endif
 
+/* libavformat's default 32 KiB AVIO buffer turns remuxing a large file
+ * into hundreds of thousands of small reads and writes */
+#define REMUX_IO_BUFFER_SIZE (1024 * 1024)
+#define REMUX_PROGRESS_INTERVAL_NS 100000000ULL
+
 struct media_remux_job {
 	int64_t in_size;
 	AVFormatContext *ifmt_ctx, *ofmt_ctx;
+
+	FILE *in_file;
+	FILE *out_file;
+	AVIOContext *in_pb;
+	AVIOContext *out_pb;
 };
 
+/* ------------------------------------------------------------------------- */
+/* buffered file I/O                                                         */
+
+static int file_read(void *opaque, uint8_t *buf, int buf_size)
+{
+	size_t size = fread(buf, 1, (size_t)buf_size, opaque);
+	if (!size)
+		return ferror((FILE *)opaque) ? AVERROR(EIO) : AVERROR_EOF;
+	return (int)size;
+}
+
+static int file_write(void *opaque, uint8_t *buf, int buf_size)
+{
+	size_t size = fwrite(buf, 1, (size_t)buf_size, opaque);
+	return size == (size_t)buf_size ? buf_size : AVERROR(EIO);
+}
+
+static int64_t file_seek(void *opaque, int64_t offset, int whence)
+{
+	FILE *file = opaque;
+
+	if (whence & AVSEEK_SIZE) {
+		int64_t cur = os_ftelli64(file);
+		int64_t size;
+
+		os_fseeki64(file, 0, SEEK_END);
+		size = os_ftelli64(file);
+		os_fseeki64(file, cur, SEEK_SET);
+		return size;
+	}
+
+	whence &= ~AVSEEK_FORCE;
+	if (os_fseeki64(file, offset, whence) != 0)
+		return AVERROR(EIO);
+
+	return os_ftelli64(file);
+}
+
+static AVIOContext *file_io_create(FILE *file, bool write)
+{
+	uint8_t *buf = av_malloc(REMUX_IO_BUFFER_SIZE);
+	AVIOContext *pb;
+
+	if (!buf)
+		return NULL;
+
+	/* the AVIO buffer is all the buffering needed */
+	setvbuf(file, NULL, _IONBF, 0);
+
+	pb = avio_alloc_context(buf, REMUX_IO_BUFFER_SIZE, write, file,
+				write ? NULL : file_read,
+				write ? file_write : NULL, file_seek);
+	if (!pb)
+		av_free(buf);
+	return pb;
+}
+
+static void file_io_destroy(AVIOContext **pb, FILE **file)
+{
+	if (*pb) {
+		av_freep(&(*pb)->buffer);
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 80, 100)
+		avio_context_free(pb);
+#else
+		av_freep(pb);
+#endif
+	}
+
+	if (*file) {
+		fclose(*file);
+		*file = NULL;
+	}
+}
+
+static inline bool is_playlist(const char *filename)
+{
+	const char *ext = strrchr(filename, '.');
+	return ext && astrcmpi(ext, ".m3u8") == 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
 static inline void init_size(media_remux_job_t job, const char *in_filename)
 {
 #ifdef _MSC_VER
@@ -51,7 +145,26 @@ static inline void init_size(media_remux_job_t job, const char *in_filename)
 
 static inline bool init_input(media_remux_job_t job, const char *in_filename)
 {
-	int ret = avformat_open_input(&job->ifmt_ctx, in_filename, NULL, NULL);
+	int ret;
+
+	/* playlists reference other files, which only the protocol layer
+	 * knows how to open */
+	if (!is_playlist(in_filename)) {
+		job->in_file = os_fopen(in_filename, "rb");
+		if (job->in_file)
+			job->in_pb = file_io_create(job->in_file, false);
+		if (job->in_pb) {
+			job->ifmt_ctx = avformat_alloc_context();
+			if (!job->ifmt_ctx) {
+				blog(LOG_ERROR, "media_remux: Could not "
+						"allocate input context");
+				return false;
+			}
+			job->ifmt_ctx->pb = job->in_pb;
+		}
+	}
+
+	ret = avformat_open_input(&job->ifmt_ctx, in_filename, NULL, NULL);
 	if (ret < 0) {
 		blog(LOG_ERROR, "media_remux: Could not open input file '%s'",
 		     in_filename);
@@ -121,8 +234,12 @@ static inline bool init_output(media_remux_job_t job, const char *out_filename)
 #endif
 
 	if (!(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-		ret = avio_open(&job->ofmt_ctx->pb, out_filename,
-				AVIO_FLAG_WRITE);
+		job->out_file = os_fopen(out_filename, "wb");
+		if (job->out_file)
+			job->out_pb = file_io_create(job->out_file, true);
+
+		job->ofmt_ctx->pb = job->out_pb;
+		ret = job->out_pb ? 0 : AVERROR(EIO);
 		if (ret < 0) {
 			blog(LOG_ERROR,
 			     "media_remux: Failed to open output"
@@ -189,9 +306,10 @@ static inline int process_packets(media_remux_job_t job,
 				  media_remux_progress_callback callback,
 				  void *data)
 {
+	uint64_t last_progress = os_gettime_ns();
 	AVPacket pkt;
+	int ret;
 
-	int ret, throttle = 0;
 	for (;;) {
 		ret = av_read_frame(job->ifmt_ctx, &pkt);
 		if (ret < 0) {
@@ -203,11 +321,17 @@ static inline int process_packets(media_remux_job_t job,
 			break;
 		}
 
-		if (callback != NULL && throttle++ > 10) {
+		/* a packet is often only a few hundred bytes, so reporting
+		 * on a timer keeps the callback from dominating the loop */
+		if (callback != NULL && pkt.pos >= 0 &&
+		    os_gettime_ns() - last_progress >=
+			    REMUX_PROGRESS_INTERVAL_NS) {
 			float progress = pkt.pos / (float)job->in_size * 100.f;
-			if (!callback(data, progress))
+			if (!callback(data, progress)) {
+				av_packet_unref(&pkt);
 				break;
-			throttle = 0;
+			}
+			last_progress = os_gettime_ns();
 		}
 
 		process_packet(&pkt, job->ifmt_ctx->streams[pkt.stream_index],
@@ -267,11 +391,154 @@ void media_remux_job_destroy(media_remux_job_t job)
 		return;
 
 	avformat_close_input(&job->ifmt_ctx);
+	file_io_destroy(&job->in_pb, &job->in_file);
+
+	if (job->ofmt_ctx) {
+		if (job->out_pb) {
+			avio_flush(job->out_pb);
+			job->ofmt_ctx->pb = NULL;
+		} else if (!(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+			avio_close(job->ofmt_ctx->pb);
+		}
+	}
 
-	if (job->ofmt_ctx && !(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE))
-		avio_close(job->ofmt_ctx->pb);
-
+	file_io_destroy(&job->out_pb, &job->out_file);
 	avformat_free_context(job->ofmt_ctx);
 
 	bfree(job);
 }
+
+/* ------------------------------------------------------------------------- */
+/* batch remuxing                                                            */
+
+struct remux_batch {
+	const char *const *in_filenames;
+	const char *const *out_filenames;
+	size_t count;
+	bool *results;
+
+	media_remux_batch_callback *callback;
+	void *data;
+
+	pthread_mutex_t mutex;
+	size_t next;
+	size_t succeeded;
+	bool canceled;
+};
+
+struct remux_batch_job {
+	struct remux_batch *batch;
+	size_t idx;
+};
+
+static bool batch_progress(void *data, float percent)
+{
+	struct remux_batch_job *bj = data;
+	struct remux_batch *batch = bj->batch;
+	bool keep_going;
+
+	pthread_mutex_lock(&batch->mutex);
+	if (!batch->canceled && batch->callback &&
+	    !batch->callback(batch->data, bj->idx, percent))
+		batch->canceled = true;
+	keep_going = !batch->canceled;
+	pthread_mutex_unlock(&batch->mutex);
+
+	return keep_going;
+}
+
+static void *batch_thread(void *data)
+{
+	struct remux_batch *batch = data;
+
+	os_set_thread_name("media_remux_batch");
+
+	for (;;) {
+		struct remux_batch_job bj = {batch, 0};
+		media_remux_job_t job = NULL;
+		bool success = false;
+
+		pthread_mutex_lock(&batch->mutex);
+		if (batch->canceled || batch->next == batch->count) {
+			pthread_mutex_unlock(&batch->mutex);
+			break;
+		}
+		bj.idx = batch->next++;
+		pthread_mutex_unlock(&batch->mutex);
+
+		if (media_remux_job_create(&job, batch->in_filenames[bj.idx],
+					   batch->out_filenames[bj.idx])) {
+			success = media_remux_job_process(job, batch_progress,
+							  &bj);
+			media_remux_job_destroy(job);
+		}
+
+		pthread_mutex_lock(&batch->mutex);
+		if (batch->canceled)
+			success = false;
+		if (success)
+			batch->succeeded++;
+		if (batch->results)
+			batch->results[bj.idx] = success;
+		pthread_mutex_unlock(&batch->mutex);
+	}
+
+	return NULL;
+}
+
+size_t media_remux_batch(const char *const *in_filenames,
+			 const char *const *out_filenames, size_t count,
+			 size_t max_jobs, media_remux_batch_callback callback,
+			 void *data, bool *results)
+{
+	struct remux_batch batch = {
+		.in_filenames = in_filenames,
+		.out_filenames = out_filenames,
+		.count = count,
+		.results = results,
+		.callback = callback,
+		.data = data,
+	};
+	pthread_t *threads;
+	size_t num_threads = 0;
+
+	if (!count || !in_filenames || !out_filenames)
+		return 0;
+
+	if (results)
+		memset(results, 0, count * sizeof(*results));
+
+	/* remuxing is mostly I/O, two jobs per disk is usually the sweet
+	 * spot, but let callers with faster storage ask for more */
+	if (!max_jobs) {
+		int cores = os_get_physical_cores();
+		max_jobs = cores > 1 ? 2 : 1;
+	}
+	if (max_jobs > count)
+		max_jobs = count;
+
+	if (pthread_mutex_init(&batch.mutex, NULL) != 0)
+		return 0;
+
+	threads = bmalloc(max_jobs * sizeof(*threads));
+
+	for (size_t i = 0; i < max_jobs; i++) {
+		if (pthread_create(&threads[num_threads], NULL, batch_thread,
+				   &batch) == 0)
+			num_threads++;
+	}
+
+	/* should never happen, but don't leave the files untouched */
+	if (!num_threads)
+		batch_thread(&batch);
+
+	for (size_t i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	bfree(threads);
+	pthread_mutex_destroy(&batch.mutex);
+
+	blog(LOG_INFO, "media_remux: Remuxed %zu of %zu files using %zu jobs",
+	     batch.succeeded, count, num_threads ? num_threads : 1);
+	return batch.succeeded;
+}
@@ -23,6 +23,8 @@ struct media_remux_job;
 typedef struct media_remux_job *media_remux_job_t;
 
 typedef bool(media_remux_progress_callback)(void *data, float percent);
+typedef bool(media_remux_batch_callback)(void *data, size_t idx,
+					float percent);
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,6 +38,20 @@ EXPORT bool media_remux_job_process(media_remux_job_t job,
 				    void *data);
 EXPORT void media_remux_job_destroy(media_remux_job_t job);
 
+/**
+ * Remuxes in_filenames[i] to out_filenames[i] for each of the count files,
+ * running up to max_jobs of them at the same time (0 picks a default based
+ * on the number of cores).  The callback is called from the worker threads,
+ * but never concurrently; returning false from it cancels the whole batch.
+ * results may be NULL, otherwise it receives the outcome of each file.
+ * Returns the number of files that were remuxed successfully.
+ */
+EXPORT size_t media_remux_batch(const char *const *in_filenames,
+				const char *const *out_filenames, size_t count,
+				size_t max_jobs,
+				media_remux_batch_callback callback,
+				void *data, bool *results);
+
 #ifdef __cplusplus
 }
 #endif
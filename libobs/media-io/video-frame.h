@@ -37,6 +37,20 @@ static inline void video_frame_free(struct video_frame *frame)
 	}
 }
 
+/* Allocates the frame data as a media buffer (see bmalloc_media).  Frames
+ * initialized with this must be freed with video_frame_free_media. */
+EXPORT void video_frame_init_media(struct video_frame *frame,
+				   enum video_format format, uint32_t width,
+				   uint32_t height);
+
+static inline void video_frame_free_media(struct video_frame *frame)
+{
+	if (frame) {
+		bfree_media(frame->data[0]);
+		memset(frame, 0, sizeof(struct video_frame));
+	}
+}
+
 static inline struct video_frame *
 video_frame_create(enum video_format format, uint32_t width, uint32_t height)
 {
@@ -40,23 +40,31 @@ struct cached_frame_info {
 	int count;
 };
 
-struct video_input {
+/*
+ * A scaled/converted copy of the output, shared by every input that asks for
+ * the same conversion.  Stages of the same format are chained into a cascade:
+ * each one is scaled from the smallest larger stage that already exists, so
+ * an encoder ladder only scales the full-size frame once.
+ */
+struct video_scale_stage {
 	struct video_scale_info conversion;
 	video_scaler_t *scaler;
+	struct video_scale_stage *parent;
+	long refs;
+
 	struct video_frame frame[MAX_CONVERT_BUFFERS];
 	int cur_frame;
+	bool success;
+};
+
+struct video_input {
+	struct video_scale_info conversion;
+	struct video_scale_stage *stage;
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
 };
 
-static inline void video_input_free(struct video_input *input)
-{
-	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
-}
-
 struct video_output {
 	struct video_output_info info;
 
@@ -74,6 +82,9 @@ struct video_output {
 	pthread_mutex_t input_mutex;
 	DARRAY(struct video_input) inputs;
 
+	/* ordered so that a stage always comes after its parent */
+	DARRAY(struct video_scale_stage *) stages;
+
 	size_t available_frames;
 	size_t first_added;
 	size_t last_added;
@@ -85,35 +96,218 @@ struct video_output {
 
 /* ------------------------------------------------------------------------- */
 
-static inline bool scale_video_output(struct video_input *input,
-				      struct video_data *data)
+static inline bool scale_info_equal(const struct video_scale_info *a,
+				    const struct video_scale_info *b)
 {
-	bool success = true;
+	return a->format == b->format && a->width == b->width &&
+	       a->height == b->height && a->range == b->range &&
+	       a->colorspace == b->colorspace;
+}
 
-	if (input->scaler) {
-		struct video_frame *frame;
+static struct video_scale_stage *
+find_scale_stage(struct video_output *video,
+		 const struct video_scale_info *conversion)
+{
+	for (size_t i = 0; i < video->stages.num; i++) {
+		struct video_scale_stage *stage = video->stages.array[i];
+		if (scale_info_equal(&stage->conversion, conversion))
+			return stage;
+	}
 
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+	return NULL;
+}
 
-		frame = &input->frame[input->cur_frame];
+/* smallest existing stage of the same format that is at least as large as
+ * the requested conversion in both dimensions */
+static struct video_scale_stage *
+find_parent_stage(struct video_output *video,
+		  const struct video_scale_info *conversion)
+{
+	struct video_scale_stage *best = NULL;
+	uint64_t best_size = 0;
+
+	for (size_t i = 0; i < video->stages.num; i++) {
+		struct video_scale_stage *stage = video->stages.array[i];
+		const struct video_scale_info *info = &stage->conversion;
+		uint64_t size = (uint64_t)info->width * info->height;
+
+		if (info->format != conversion->format ||
+		    info->range != conversion->range ||
+		    info->colorspace != conversion->colorspace)
+			continue;
+		if (info->width < conversion->width ||
+		    info->height < conversion->height)
+			continue;
+
+		if (!best || size < best_size) {
+			best = stage;
+			best_size = size;
+		}
+	}
 
-		success = video_scaler_scale(input->scaler, frame->data,
-					     frame->linesize,
-					     (const uint8_t *const *)data->data,
-					     data->linesize);
+	return best;
+}
 
-		if (success) {
-			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-				data->data[i] = frame->data[i];
-				data->linesize[i] = frame->linesize[i];
+static void scale_stage_free(struct video_scale_stage *stage)
+{
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
+		video_frame_free_media(&stage->frame[i]);
+	video_scaler_destroy(stage->scaler);
+	bfree(stage);
+}
+
+static struct video_scale_stage *
+scale_stage_create(struct video_output *video,
+		   const struct video_scale_info *conversion)
+{
+	struct video_scale_stage *stage;
+	struct video_scale_stage *parent;
+	struct video_scale_info from = {.format = video->info.format,
+					.width = video->info.width,
+					.height = video->info.height,
+					.range = video->info.range,
+					.colorspace = video->info.colorspace};
+
+	parent = find_parent_stage(video, conversion);
+	if (parent)
+		from = parent->conversion;
+
+	stage = bzalloc(sizeof(*stage));
+	stage->conversion = *conversion;
+
+	int ret = video_scaler_create(&stage->scaler, &stage->conversion, &from,
+				      VIDEO_SCALE_FAST_BILINEAR);
+	if (ret != VIDEO_SCALER_SUCCESS) {
+		if (ret == VIDEO_SCALER_BAD_CONVERSION)
+			blog(LOG_ERROR, "video_input_init: Bad "
+					"scale conversion type");
+		else
+			blog(LOG_ERROR, "video_input_init: Failed to "
+					"create scaler");
+
+		bfree(stage);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
+		video_frame_init_media(&stage->frame[i],
+				       stage->conversion.format,
+				       stage->conversion.width,
+				       stage->conversion.height);
+
+	if (parent) {
+		parent->refs++;
+		stage->parent = parent;
+
+		blog(LOG_DEBUG, "video-io: Scaling %ux%u from the %ux%u stage",
+		     conversion->width, conversion->height,
+		     parent->conversion.width, parent->conversion.height);
+	}
+
+	stage->refs = 1;
+	da_push_back(video->stages, &stage);
+	return stage;
+}
+
+static void scale_stage_release(struct video_output *video,
+				struct video_scale_stage *stage)
+{
+	while (stage && --stage->refs == 0) {
+		struct video_scale_stage *parent = stage->parent;
+
+		da_erase_item(video->stages, &stage);
+		scale_stage_free(stage);
+		stage = parent;
+	}
+}
+
+static inline bool video_input_init(struct video_input *input,
+				    struct video_output *video)
+{
+	if (input->conversion.width != video->info.width ||
+	    input->conversion.height != video->info.height ||
+	    input->conversion.format != video->info.format) {
+		input->stage = find_scale_stage(video, &input->conversion);
+
+		if (input->stage)
+			input->stage->refs++;
+		else
+			input->stage =
+				scale_stage_create(video, &input->conversion);
+
+		return input->stage != NULL;
+	}
+
+	return true;
+}
+
+static inline void video_input_free(struct video_output *video,
+				    struct video_input *input)
+{
+	scale_stage_release(video, input->stage);
+	input->stage = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void scale_video_stages(struct video_output *video,
+			       const struct video_data *data)
+{
+	for (size_t i = 0; i < video->stages.num; i++) {
+		struct video_scale_stage *stage = video->stages.array[i];
+		struct video_scale_stage *parent = stage->parent;
+		const uint8_t *const *input;
+		const uint32_t *in_linesize;
+		struct video_frame *frame;
+
+		if (parent) {
+			struct video_frame *src;
+
+			if (!parent->success) {
+				stage->success = false;
+				continue;
 			}
+
+			src = &parent->frame[parent->cur_frame];
+			input = (const uint8_t *const *)src->data;
+			in_linesize = src->linesize;
 		} else {
-			blog(LOG_WARNING, "video-io: Could not scale frame!");
+			input = (const uint8_t *const *)data->data;
+			in_linesize = data->linesize;
 		}
+
+		if (++stage->cur_frame == MAX_CONVERT_BUFFERS)
+			stage->cur_frame = 0;
+
+		frame = &stage->frame[stage->cur_frame];
+
+		stage->success = video_scaler_scale(stage->scaler, frame->data,
+						    frame->linesize, input,
+						    in_linesize);
+		if (!stage->success)
+			blog(LOG_WARNING, "video-io: Could not scale frame!");
 	}
+}
 
-	return success;
+static inline bool scale_video_output(struct video_input *input,
+				      struct video_data *data)
+{
+	struct video_scale_stage *stage = input->stage;
+	struct video_frame *frame;
+
+	if (!stage)
+		return true;
+	if (!stage->success)
+		return false;
+
+	frame = &stage->frame[stage->cur_frame];
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		data->data[i] = frame->data[i];
+		data->linesize[i] = frame->linesize[i];
+	}
+
+	return true;
 }
 
 static inline bool video_output_cur_frame(struct video_output *video)
@@ -134,6 +328,8 @@ static inline bool video_output_cur_frame(struct video_output *video)
 
 	pthread_mutex_lock(&video->input_mutex);
 
+	scale_video_stages(video, &frame_info->frame);
+
 	for (size_t i = 0; i < video->inputs.num; i++) {
 		struct video_input *input = video->inputs.array + i;
 		struct video_data frame = frame_info->frame;
@@ -215,8 +411,8 @@ static inline void init_cache(struct video_output *video)
 		struct video_frame *frame;
 		frame = (struct video_frame *)&video->cache[i];
 
-		video_frame_init(frame, video->info.format, video->info.width,
-				 video->info.height);
+		video_frame_init_media(frame, video->info.format,
+				       video->info.width, video->info.height);
 	}
 
 	video->available_frames = video->info.cache_size;
@@ -271,11 +467,12 @@ void video_output_close(video_t *video)
 	video_output_stop(video);
 
 	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
+		video_input_free(video, &video->inputs.array[i]);
 	da_free(video->inputs);
+	da_free(video->stages);
 
 	for (size_t i = 0; i < video->info.cache_size; i++)
-		video_frame_free((struct video_frame *)&video->cache[i]);
+		video_frame_free_media((struct video_frame *)&video->cache[i]);
 
 	os_sem_destroy(video->update_semaphore);
 	pthread_mutex_destroy(&video->data_mutex);
@@ -297,43 +494,6 @@ static size_t video_get_input_idx(const video_t *video,
 	return DARRAY_INVALID;
 }
 
-static inline bool video_input_init(struct video_input *input,
-				    struct video_output *video)
-{
-	if (input->conversion.width != video->info.width ||
-	    input->conversion.height != video->info.height ||
-	    input->conversion.format != video->info.format) {
-		struct video_scale_info from = {.format = video->info.format,
-						.width = video->info.width,
-						.height = video->info.height,
-						.range = video->info.range,
-						.colorspace =
-							video->info.colorspace};
-
-		int ret = video_scaler_create(&input->scaler,
-					      &input->conversion, &from,
-					      VIDEO_SCALE_FAST_BILINEAR);
-		if (ret != VIDEO_SCALER_SUCCESS) {
-			if (ret == VIDEO_SCALER_BAD_CONVERSION)
-				blog(LOG_ERROR, "video_input_init: Bad "
-						"scale conversion type");
-			else
-				blog(LOG_ERROR, "video_input_init: Failed to "
-						"create scaler");
-
-			return false;
-		}
-
-		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i],
-					 input->conversion.format,
-					 input->conversion.width,
-					 input->conversion.height);
-	}
-
-	return true;
-}
-
 static inline void reset_frames(video_t *video)
 {
 	os_atomic_set_long(&video->skipped_frames, 0);
@@ -417,7 +577,7 @@ void video_output_disconnect(video_t *video,
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array + idx);
+		video_input_free(video, video->inputs.array + idx);
 		da_erase(video->inputs, idx);
 
 		if (video->inputs.num == 0) {
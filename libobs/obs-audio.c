@@ -488,6 +488,12 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	/* release audio sources */
 	release_audio_sources(audio);
 
+#if HAVE_PULSEAUDIO
+	/* ------------------------------------------------ */
+	/* mix monitored sources */
+	audio_monitoring_mix(AUDIO_OUTPUT_FRAMES);
+#endif
+
 	circlebuf_pop_front(&audio->buffered_timestamps, NULL, sizeof(ts));
 
 	*out_ts = ts.start;
@@ -23,7 +23,7 @@
 #define set_encoder_active(encoder, val) \
 	os_atomic_set_bool(&encoder->active, val)
 
-struct obs_encoder_info *find_encoder(const char *id)
+struct obs_encoder_info *find_registered_encoder(const char *id)
 {
 	for (size_t i = 0; i < obs->encoder_types.num; i++) {
 		struct obs_encoder_info *info = obs->encoder_types.array + i;
@@ -35,6 +35,16 @@ struct obs_encoder_info *find_encoder(const char *id)
 	return NULL;
 }
 
+struct obs_encoder_info *find_encoder(const char *id)
+{
+	struct obs_encoder_info *info = find_registered_encoder(id);
+
+	if (!info && obs_load_deferred_module_for(id))
+		info = find_registered_encoder(id);
+
+	return info;
+}
+
 const char *obs_encoder_get_display_name(const char *id)
 {
 	struct obs_encoder_info *ei = find_encoder(id);
@@ -856,6 +866,7 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 				    struct encoder_packet *packet)
 {
 	struct encoder_packet first_packet;
+	struct encoder_packet first_instance;
 	DARRAY(uint8_t) data;
 	uint8_t *sei;
 	size_t size;
@@ -879,10 +890,13 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 	first_packet.data = data.array;
 	first_packet.size = data.num;
 
-	cb->new_packet(cb->param, &first_packet);
+	obs_encoder_packet_create_instance(&first_instance, &first_packet);
+	da_free(data);
+
+	cb->new_packet(cb->param, &first_instance);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_instance);
 }
 
 static inline void send_packet(struct obs_encoder *encoder,
@@ -945,15 +959,23 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 		pkt->sys_dts_usec += encoder->pause.ts_offset / 1000;
 		pthread_mutex_unlock(&encoder->pause.mutex);
 
+		/* the encoder's buffer is only valid until its next
+		 * encode call, so copy it once here; every output that
+		 * keeps the packet shares this copy by reference */
+		struct encoder_packet instance;
+		obs_encoder_packet_create_instance(&instance, pkt);
+
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
 		for (size_t i = encoder->callbacks.num; i > 0; i--) {
 			struct encoder_callback *cb;
 			cb = encoder->callbacks.array + (i - 1);
-			send_packet(encoder, cb, pkt);
+			send_packet(encoder, cb, &instance);
 		}
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
+
+		obs_encoder_packet_release(&instance);
 	}
 }
 
@@ -1314,7 +1336,7 @@ void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 	long *p_refs;
 
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
+	p_refs = bmalloc_media(src->size + sizeof(long));
 	dst->data = (void *)(p_refs + 1);
 	*p_refs = 1;
 	memcpy(dst->data, src->data, src->size);
@@ -1355,7 +1377,7 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 	if (pkt->data) {
 		long *p_refs = ((long *)pkt->data) - 1;
 		if (os_atomic_dec_long(p_refs) == 0)
-			bfree(p_refs);
+			bfree_media(p_refs);
 	}
 
 	memset(pkt, 0, sizeof(struct encoder_packet));
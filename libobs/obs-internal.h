@@ -37,10 +37,14 @@
 #include "obs.h"
 
 #define NUM_TEXTURES 2
+#define MAX_TEXTURES 4
 #define NUM_CHANNELS 3
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 3
 #define NUM_ENCODE_TEXTURE_FRAMES_TO_WAIT 1
+#define NUM_ASYNC_UPLOAD_THREADS 2
+#define MAX_DEINTERLACE_THREADS 3
+#define DEFAULT_MONITORING_LATENCY_MS 50
 
 static inline int64_t packet_dts_usec(struct encoder_packet *packet)
 {
@@ -87,10 +91,12 @@ struct obs_module {
 	char *data_path;
 	void *module;
 	bool loaded;
+	uint64_t load_time_ns;
 
 	bool (*load)(void);
 	void (*unload)(void);
 	void (*post_load)(void);
+	bool (*deferrable)(void);
 	void (*set_locale)(const char *locale);
 	void (*free_locale)(void);
 	uint32_t (*ver)(void);
@@ -104,6 +110,47 @@ struct obs_module {
 
 extern void free_module(struct obs_module *mod);
 
+enum obs_module_type {
+	OBS_MODULE_TYPE_SOURCE, /* any of the three below, to enumerate */
+	OBS_MODULE_TYPE_INPUT,
+	OBS_MODULE_TYPE_FILTER,
+	OBS_MODULE_TYPE_TRANSITION,
+	OBS_MODULE_TYPE_OUTPUT,
+	OBS_MODULE_TYPE_ENCODER,
+	OBS_MODULE_TYPE_SERVICE,
+};
+
+struct obs_deferred_type {
+	char *id;
+	char *unversioned_id;
+	uint32_t version;
+	enum obs_module_type type;
+};
+
+/* a module that is only opened once one of the types it registered in a
+ * previous run is looked up.  Kept after it is loaded, so the order types
+ * are enumerated in doesn't change. */
+struct obs_deferred_module {
+	char *bin_path;
+	char *data_path;
+	DARRAY(struct obs_deferred_type) types;
+	bool loaded;
+};
+
+/* Loads the deferred module that registers 'id'.  Modules are only loaded on
+ * the thread that loaded the modules, other threads wait for the load to be
+ * done there through a UI task.  Threads in a graphics context only queue the
+ * load, since the UI thread may be waiting for the context, and get false. */
+extern bool obs_load_deferred_module_for(const char *id);
+extern void free_deferred_modules(void);
+
+/* Enumerates registered types, then the cached types of deferred modules,
+ * without loading any module */
+extern bool obs_enum_module_types(enum obs_module_type type, size_t idx,
+				  const char **id, const char **unversioned_id);
+extern const char *obs_get_deferred_input_type_id(const char *unversioned_id,
+						  int *version);
+
 struct obs_module_path {
 	char *bin;
 	char *data;
@@ -239,14 +286,42 @@ struct obs_task_info {
 	void *param;
 };
 
+#define NUM_SCALE_EFFECTS 5
+
+/* parameters and techniques of the base effects used on every frame,
+ * resolved once when the effects are loaded */
+struct obs_scale_effect {
+	gs_effect_t *effect;
+	gs_eparam_t *base_dimension;
+	gs_eparam_t *base_dimension_i;
+	gs_technique_t *draw_upscale;
+	gs_technique_t *draw_alpha_divide;
+};
+
+struct obs_conversion_params {
+	gs_eparam_t *image[MAX_AV_PLANES];
+	gs_eparam_t *width;
+	gs_eparam_t *height;
+	gs_eparam_t *width_d2;
+	gs_eparam_t *height_d2;
+	gs_eparam_t *width_x2_i;
+	gs_eparam_t *width_i;
+	gs_eparam_t *color_vec[3];
+	gs_eparam_t *color_range_min;
+	gs_eparam_t *color_range_max;
+
+	/* techniques for converting async frames, looked up on first use */
+	gs_technique_t *async_techs[VIDEO_FORMAT_AYUV + 1][2];
+};
+
 struct obs_core_video {
 	graphics_t *graphics;
-	gs_stagesurf_t *copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
+	gs_stagesurf_t *copy_surfaces[MAX_TEXTURES][NUM_CHANNELS];
 	gs_texture_t *render_texture;
 	gs_texture_t *output_texture;
 	gs_texture_t *convert_textures[NUM_CHANNELS];
 	bool texture_rendered;
-	bool textures_copied[NUM_TEXTURES];
+	bool textures_copied[MAX_TEXTURES];
 	bool texture_converted;
 	bool using_nv12_tex;
 	struct circlebuf vframe_info_buffer;
@@ -262,9 +337,17 @@ struct obs_core_video {
 	gs_effect_t *area_effect;
 	gs_effect_t *bilinear_lowres_effect;
 	gs_effect_t *premultiplied_alpha_effect;
+	struct obs_scale_effect scale_effects[NUM_SCALE_EFFECTS];
+	struct obs_conversion_params conversion_params;
+	gs_eparam_t *default_color_matrix;
+	gs_eparam_t *default_color_range_min;
+	gs_eparam_t *default_color_range_max;
 	gs_samplerstate_t *point_sampler;
 	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
 	int cur_texture;
+	int num_textures;
+	uint32_t readback_depth;
+	char *program_cache_path;
 	long raw_active;
 	long gpu_encoder_active;
 	pthread_mutex_t gpu_encoder_mutex;
@@ -277,9 +360,16 @@ struct obs_core_video {
 	bool gpu_encode_thread_initialized;
 	volatile bool gpu_encode_stop;
 
+	pthread_t upload_threads[NUM_ASYNC_UPLOAD_THREADS];
+	size_t upload_thread_count;
+	pthread_mutex_t upload_mutex;
+	os_sem_t *upload_semaphore;
+	struct circlebuf upload_queue;
+
 	uint64_t video_time;
 	uint64_t video_frame_interval_ns;
 	uint64_t video_avg_frame_time_ns;
+	uint64_t video_avg_draw_calls;
 	double video_fps;
 	video_t *video;
 	pthread_t video_thread;
@@ -289,6 +379,7 @@ struct obs_core_video {
 
 	bool gpu_conversion;
 	const char *conversion_techs[NUM_CHANNELS];
+	gs_technique_t *conversion_tech_handles[NUM_CHANNELS];
 	bool conversion_needed;
 	float conversion_width_i;
 
@@ -335,6 +426,7 @@ struct obs_core_audio {
 	DARRAY(struct audio_monitor *) monitors;
 	char *monitoring_device_name;
 	char *monitoring_device_id;
+	uint32_t monitoring_latency_ms;
 };
 
 /* user sources, output channels, and displays */
@@ -403,6 +495,9 @@ struct obs_core_hotkeys {
 struct obs_core {
 	struct obs_module *first_module;
 	DARRAY(struct obs_module_path) module_paths;
+	DARRAY(struct obs_deferred_module) deferred_modules;
+	char *module_cache_path;
+	pthread_t module_thread;
 
 	DARRAY(struct obs_source_info) source_types;
 	DARRAY(struct obs_source_info) input_types;
@@ -440,6 +535,8 @@ struct obs_graphics_context {
 	uint64_t frame_time_total_ns;
 	uint64_t fps_total_ns;
 	uint32_t fps_total_frames;
+	uint64_t last_draw_calls;
+	uint64_t draw_calls_total;
 #ifdef _WIN32
 	bool gpu_was_active;
 #endif
@@ -458,6 +555,18 @@ obs_graphics_thread_loop_autorelease(struct obs_graphics_context *context);
 
 extern gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file);
 
+static inline const struct obs_scale_effect *
+get_scale_effect_params(const struct obs_core_video *video,
+			const gs_effect_t *effect)
+{
+	for (size_t i = 0; i < NUM_SCALE_EFFECTS; i++) {
+		if (video->scale_effects[i].effect == effect)
+			return &video->scale_effects[i];
+	}
+
+	return NULL;
+}
+
 extern bool audio_callback(void *param, uint64_t start_ts_in,
 			   uint64_t end_ts_in, uint64_t *out_ts,
 			   uint32_t mixers, struct audio_output_data *mixes);
@@ -557,6 +666,10 @@ struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
 	bool used;
+
+	/* frame from obs_source_frame_create_shared, which is dropped rather
+	 * than reused once the source is done with it */
+	bool shared;
 };
 
 enum audio_action_type {
@@ -687,11 +800,18 @@ struct obs_source {
 	uint32_t async_cache_height;
 	uint32_t async_convert_width[MAX_AV_PLANES];
 	uint32_t async_convert_height[MAX_AV_PLANES];
+	struct async_upload *async_upload;
+	uint64_t async_upload_time_ns;
 
 	/* async video deinterlacing */
 	uint64_t deinterlace_offset;
 	uint64_t deinterlace_frame_ts;
 	gs_effect_t *deinterlace_effect;
+	gs_eparam_t *deinterlace_image_param;
+	gs_eparam_t *deinterlace_prev_param;
+	gs_eparam_t *deinterlace_field_param;
+	gs_eparam_t *deinterlace_frame2_param;
+	gs_eparam_t *deinterlace_dimensions_param;
 	struct obs_source_frame *prev_async_frame;
 	gs_texture_t *async_prev_textures[MAX_AV_PLANES];
 	gs_texrender_t *async_prev_texrender;
@@ -699,6 +819,8 @@ struct obs_source {
 	enum obs_deinterlace_mode deinterlace_mode;
 	bool deinterlace_top_first;
 	bool deinterlace_rendered;
+	bool deinterlace_cpu;
+	struct deinterlace_cpu *deinterlace_cpu_state;
 
 	/* filters */
 	struct obs_source *filter_parent;
@@ -774,6 +896,9 @@ extern void obs_transition_load(obs_source_t *source, obs_data_t *data);
 struct audio_monitor *audio_monitor_create(obs_source_t *source);
 void audio_monitor_reset(struct audio_monitor *monitor);
 extern void audio_monitor_destroy(struct audio_monitor *monitor);
+#if HAVE_PULSEAUDIO
+extern void audio_monitoring_mix(size_t frames);
+#endif
 
 extern obs_source_t *obs_source_create_set_last_ver(const char *id,
 						    const char *name,
@@ -854,15 +979,43 @@ extern bool update_async_textures(struct obs_source *source,
 				  gs_texrender_t *texrender);
 extern bool set_async_texture_size(struct obs_source *source,
 				   const struct obs_source_frame *frame);
+extern void obs_source_stage_async_video(obs_source_t *source);
+
+/* in obs-source-upload.c */
+struct async_upload;
+extern bool init_async_upload(struct obs_core_video *video);
+extern void free_async_upload(struct obs_core_video *video);
+extern bool async_upload_begin(obs_source_t *source,
+			       struct obs_source_frame *frame,
+			       gs_texture_t *tex[MAX_AV_PLANES]);
+extern struct obs_source_frame *async_upload_end(obs_source_t *source);
+extern bool async_upload_pending(const obs_source_t *source);
+extern void async_upload_destroy(struct async_upload *upload);
 extern void remove_async_frame(obs_source_t *source,
 			       struct obs_source_frame *frame);
 
+/* in obs-source-frame-pool.c */
+extern struct obs_source_frame *frame_pool_acquire(enum video_format format,
+						   uint32_t width,
+						   uint32_t height);
+extern void frame_pool_release(struct obs_source_frame *frame);
+extern void frame_pool_tick(void);
+extern void free_frame_pool(void);
+
 extern void set_deinterlace_texture_size(obs_source_t *source);
 extern void deinterlace_process_last_frame(obs_source_t *source,
 					   uint64_t sys_time);
 extern void deinterlace_update_async_video(obs_source_t *source);
 extern void deinterlace_render(obs_source_t *s);
 
+/* in obs-source-deinterlace-cpu.c */
+struct deinterlace_cpu;
+extern void free_deinterlace_threads(void);
+extern void deinterlace_cpu_frame(obs_source_t *source,
+				  struct obs_source_frame *dst,
+				  const struct obs_source_frame *src);
+extern void deinterlace_cpu_destroy(struct deinterlace_cpu *state);
+
 /* ------------------------------------------------------------------------- */
 /* outputs  */
 
@@ -1011,6 +1164,7 @@ extern void obs_output_actual_stop(obs_output_t *output, bool force,
 				   uint64_t ts);
 
 extern const struct obs_output_info *find_output(const char *id);
+extern const struct obs_output_info *find_registered_output(const char *id);
 
 extern void obs_output_remove_encoder(struct obs_output *output,
 				      struct obs_encoder *encoder);
@@ -1100,6 +1254,7 @@ struct obs_encoder {
 };
 
 extern struct obs_encoder_info *find_encoder(const char *id);
+extern struct obs_encoder_info *find_registered_encoder(const char *id);
 
 extern bool obs_encoder_initialize(obs_encoder_t *encoder);
 extern void obs_encoder_shutdown(obs_encoder_t *encoder);
@@ -1149,6 +1304,7 @@ struct obs_service {
 };
 
 extern const struct obs_service_info *find_service(const char *id);
+extern const struct obs_service_info *find_registered_service(const char *id);
 
 extern void obs_service_activate(struct obs_service *service);
 extern void obs_service_deactivate(struct obs_service *service, bool remove);
@@ -15,6 +15,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <sys/stat.h>
+
 #include "util/platform.h"
 #include "util/dstr.h"
 
@@ -50,6 +52,7 @@ static int load_module_exports(struct obs_module *mod, const char *path)
 	/* optional exports */
 	mod->unload = os_dlsym(mod->module, "obs_module_unload");
 	mod->post_load = os_dlsym(mod->module, "obs_module_post_load");
+	mod->deferrable = os_dlsym(mod->module, "obs_module_deferrable");
 	mod->set_locale = os_dlsym(mod->module, "obs_module_set_locale");
 	mod->free_locale = os_dlsym(mod->module, "obs_module_free_locale");
 	mod->name = os_dlsym(mod->module, "obs_module_name");
@@ -81,6 +84,7 @@ int obs_open_module(obs_module_t **module, const char *path,
 		    const char *data_path)
 {
 	struct obs_module mod = {0};
+	uint64_t start;
 	int errorcode;
 
 	if (!module || !path || !obs)
@@ -99,11 +103,13 @@ int obs_open_module(obs_module_t **module, const char *path,
 
 	blog(LOG_DEBUG, "---------------------------------");
 
+	start = os_gettime_ns();
 	mod.module = os_dlopen(path);
 	if (!mod.module) {
 		blog(LOG_WARNING, "Module '%s' not loaded", path);
 		return MODULE_FILE_NOT_FOUND;
 	}
+	mod.load_time_ns = os_gettime_ns() - start;
 
 	errorcode = load_module_exports(&mod, path);
 	if (errorcode != MODULE_SUCCESS)
@@ -142,7 +148,9 @@ bool obs_init_module(obs_module_t *module)
 				   "obs_init_module(%s)", module->file);
 	profile_start(profile_name);
 
+	uint64_t start = os_gettime_ns();
 	module->loaded = module->load();
+	module->load_time_ns += os_gettime_ns() - start;
 	if (!module->loaded)
 		blog(LOG_WARNING, "Failed to initialize module '%s'",
 		     module->file);
@@ -157,6 +165,23 @@ void obs_log_loaded_modules(void)
 
 	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next)
 		blog(LOG_INFO, "    %s", mod->file);
+
+	blog(LOG_INFO, "  Module Load Times:");
+
+	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next)
+		blog(LOG_INFO, "    %s: %.1f ms", mod->file,
+		     (double)mod->load_time_ns / 1000000.0);
+
+	if (obs->deferred_modules.num) {
+		blog(LOG_INFO, "  Deferred Modules:");
+
+		for (size_t i = 0; i < obs->deferred_modules.num; i++) {
+			struct obs_deferred_module *dm =
+				obs->deferred_modules.array + i;
+			if (!dm->loaded)
+				blog(LOG_INFO, "    %s", dm->bin_path);
+		}
+	}
 }
 
 const char *obs_get_module_file_name(obs_module_t *module)
@@ -235,9 +260,561 @@ void obs_add_module_path(const char *bin, const char *data)
 	da_push_back(obs->module_paths, &omp);
 }
 
+void obs_set_module_cache_path(const char *path)
+{
+	if (!obs)
+		return;
+
+	bfree(obs->module_cache_path);
+	obs->module_cache_path = path ? bstrdup(path) : NULL;
+}
+
+static void free_deferred_module(struct obs_deferred_module *dm)
+{
+	for (size_t i = 0; i < dm->types.num; i++) {
+		bfree(dm->types.array[i].id);
+		bfree(dm->types.array[i].unversioned_id);
+	}
+	da_free(dm->types);
+	bfree(dm->bin_path);
+	bfree(dm->data_path);
+}
+
+static inline bool in_module_thread(void)
+{
+	return pthread_equal(pthread_self(), obs->module_thread);
+}
+
+static void load_deferred_module(struct obs_deferred_module *dm)
+{
+	obs_module_t *module;
+
+	/* set first, in case the module looks up its own types while it is
+	 * loading */
+	dm->loaded = true;
+
+	int code = obs_open_module(&module, dm->bin_path, dm->data_path);
+	if (code == MODULE_SUCCESS) {
+		obs_init_module(module);
+		blog(LOG_INFO, "Loaded deferred module '%s' in %.1f ms",
+		     module->file, (double)module->load_time_ns / 1000000.0);
+	} else {
+		blog(LOG_WARNING, "Failed to load deferred module '%s': %d",
+		     dm->bin_path, code);
+	}
+}
+
+static void load_deferred_module_task(void *param)
+{
+	size_t idx = (size_t)(uintptr_t)param;
+
+	if (obs && idx < obs->deferred_modules.num &&
+	    !obs->deferred_modules.array[idx].loaded)
+		load_deferred_module(obs->deferred_modules.array + idx);
+}
+
+static bool has_type(const struct obs_deferred_module *dm, const char *id)
+{
+	for (size_t i = 0; i < dm->types.num; i++) {
+		if (strcmp(dm->types.array[i].id, id) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+bool obs_load_deferred_module_for(const char *id)
+{
+	for (size_t i = 0; i < obs->deferred_modules.num; i++) {
+		struct obs_deferred_module *dm =
+			obs->deferred_modules.array + i;
+
+		if (dm->loaded || !has_type(dm, id))
+			continue;
+
+		/* the type lists aren't synchronized, so modules are only
+		 * ever registered from the thread that loaded them */
+		if (!in_module_thread()) {
+			bool wait = !gs_get_context();
+
+			blog(LOG_INFO,
+			     "Type '%s' was looked up outside of the UI "
+			     "thread before its module was loaded, loading "
+			     "'%s' from the UI thread",
+			     id, dm->bin_path);
+			obs_queue_task(OBS_TASK_UI, load_deferred_module_task,
+				       (void *)(uintptr_t)i, wait);
+
+			if (!wait)
+				blog(LOG_WARNING,
+				     "Type '%s' was looked up in a graphics "
+				     "context, it's only available once "
+				     "'%s' is loaded",
+				     id, dm->bin_path);
+			return wait && dm->loaded;
+		}
+
+		load_deferred_module(dm);
+		return true;
+	}
+
+	return false;
+}
+
+void obs_load_deferred_modules(void)
+{
+	if (!obs || !obs->deferred_modules.num)
+		return;
+
+	if (!in_module_thread()) {
+		blog(LOG_WARNING, "obs_load_deferred_modules: not called "
+				  "from the thread that loaded the modules");
+		return;
+	}
+
+	for (size_t i = 0; i < obs->deferred_modules.num; i++) {
+		struct obs_deferred_module *dm =
+			obs->deferred_modules.array + i;
+		if (!dm->loaded)
+			load_deferred_module(dm);
+	}
+}
+
+void free_deferred_modules(void)
+{
+	for (size_t i = 0; i < obs->deferred_modules.num; i++)
+		free_deferred_module(&obs->deferred_modules.array[i]);
+	da_free(obs->deferred_modules);
+}
+
+static inline bool type_matches(enum obs_module_type list,
+				enum obs_module_type type)
+{
+	if (list == OBS_MODULE_TYPE_SOURCE)
+		return type == OBS_MODULE_TYPE_INPUT ||
+		       type == OBS_MODULE_TYPE_FILTER ||
+		       type == OBS_MODULE_TYPE_TRANSITION;
+	return list == type;
+}
+
+static const char *registered_type_id(enum obs_module_type list, size_t idx,
+				      const char **unversioned_id)
+{
+	const struct obs_source_info *source = NULL;
+	const char *id = NULL;
+
+	switch (list) {
+	case OBS_MODULE_TYPE_SOURCE:
+		if (idx < obs->source_types.num)
+			source = obs->source_types.array + idx;
+		break;
+	case OBS_MODULE_TYPE_INPUT:
+		if (idx < obs->input_types.num)
+			source = obs->input_types.array + idx;
+		break;
+	case OBS_MODULE_TYPE_FILTER:
+		if (idx < obs->filter_types.num)
+			source = obs->filter_types.array + idx;
+		break;
+	case OBS_MODULE_TYPE_TRANSITION:
+		if (idx < obs->transition_types.num)
+			source = obs->transition_types.array + idx;
+		break;
+	case OBS_MODULE_TYPE_OUTPUT:
+		if (idx < obs->output_types.num)
+			id = obs->output_types.array[idx].id;
+		break;
+	case OBS_MODULE_TYPE_ENCODER:
+		if (idx < obs->encoder_types.num)
+			id = obs->encoder_types.array[idx].id;
+		break;
+	case OBS_MODULE_TYPE_SERVICE:
+		if (idx < obs->service_types.num)
+			id = obs->service_types.array[idx].id;
+		break;
+	}
+
+	if (source) {
+		*unversioned_id = source->unversioned_id;
+		return source->id;
+	}
+
+	*unversioned_id = id;
+	return id;
+}
+
+static bool is_registered(enum obs_module_type list, const char *id)
+{
+	const char *cur_id;
+	const char *unversioned_id;
+	size_t i = 0;
+
+	while ((cur_id = registered_type_id(list, i++, &unversioned_id))) {
+		if (strcmp(cur_id, id) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static bool is_deferred_type(enum obs_module_type list, const char *id)
+{
+	for (size_t i = 0; i < obs->deferred_modules.num; i++) {
+		struct obs_deferred_module *dm =
+			obs->deferred_modules.array + i;
+
+		for (size_t j = 0; j < dm->types.num; j++) {
+			struct obs_deferred_type *type = dm->types.array + j;
+
+			if (type_matches(list, type->type) &&
+			    strcmp(type->id, id) == 0)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/* Types of deferred modules come after all other types, whether or not their
+ * module has been loaded since, so that looking up the types while they are
+ * enumerated loads modules without moving the types that are left. */
+bool obs_enum_module_types(enum obs_module_type list, size_t idx,
+			   const char **id, const char **unversioned_id)
+{
+	const char *cur_id;
+	const char *cur_unversioned_id;
+	size_t i = 0;
+
+	if (!obs->deferred_modules.num) {
+		cur_id = registered_type_id(list, idx, &cur_unversioned_id);
+		if (!cur_id)
+			return false;
+		goto found;
+	}
+
+	while ((cur_id = registered_type_id(list, i++, &cur_unversioned_id))) {
+		if (!is_deferred_type(list, cur_id) && idx-- == 0)
+			goto found;
+	}
+
+	for (i = 0; i < obs->deferred_modules.num; i++) {
+		struct obs_deferred_module *dm =
+			obs->deferred_modules.array + i;
+
+		for (size_t j = 0; j < dm->types.num; j++) {
+			struct obs_deferred_type *type = dm->types.array + j;
+
+			if (!type_matches(list, type->type))
+				continue;
+			/* the module no longer registers it */
+			if (dm->loaded && !is_registered(list, type->id))
+				continue;
+
+			if (idx-- == 0) {
+				cur_id = type->id;
+				cur_unversioned_id = type->unversioned_id;
+				goto found;
+			}
+		}
+	}
+
+	return false;
+
+found:
+	if (id)
+		*id = cur_id;
+	if (unversioned_id)
+		*unversioned_id = cur_unversioned_id;
+	return true;
+}
+
+const char *obs_get_deferred_input_type_id(const char *unversioned_id,
+					   int *version)
+{
+	const char *latest = NULL;
+
+	for (size_t i = 0; i < obs->deferred_modules.num; i++) {
+		struct obs_deferred_module *dm =
+			obs->deferred_modules.array + i;
+
+		for (size_t j = 0; j < dm->types.num; j++) {
+			struct obs_deferred_type *type = dm->types.array + j;
+
+			if (type->type == OBS_MODULE_TYPE_INPUT &&
+			    strcmp(type->unversioned_id, unversioned_id) == 0 &&
+			    (int)type->version > *version) {
+				latest = type->id;
+				*version = (int)type->version;
+			}
+		}
+	}
+
+	return latest;
+}
+
+/* ------------------------------------------------------------------------- */
+/* module cache */
+
+struct module_cache {
+	obs_data_t *old_modules;
+	obs_data_t *modules;
+};
+
+struct registered_types {
+	size_t sources;
+	size_t outputs;
+	size_t encoders;
+	size_t services;
+	size_t modal_uis;
+	size_t modeless_uis;
+};
+
+static void get_registered_types(struct registered_types *types)
+{
+	types->sources = obs->source_types.num;
+	types->outputs = obs->output_types.num;
+	types->encoders = obs->encoder_types.num;
+	types->services = obs->service_types.num;
+	types->modal_uis = obs->modal_ui_callbacks.num;
+	types->modeless_uis = obs->modeless_ui_callbacks.num;
+}
+
+static const char *type_names[] = {
+	[OBS_MODULE_TYPE_INPUT] = "input",
+	[OBS_MODULE_TYPE_FILTER] = "filter",
+	[OBS_MODULE_TYPE_TRANSITION] = "transition",
+	[OBS_MODULE_TYPE_OUTPUT] = "output",
+	[OBS_MODULE_TYPE_ENCODER] = "encoder",
+	[OBS_MODULE_TYPE_SERVICE] = "service",
+};
+
+static bool get_type_from_name(const char *name, enum obs_module_type *type)
+{
+	for (size_t i = 0; i < sizeof(type_names) / sizeof(type_names[0]);
+	     i++) {
+		if (type_names[i] && strcmp(type_names[i], name) == 0) {
+			*type = (enum obs_module_type)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void add_id(obs_data_array_t *ids, const char *id,
+		   enum obs_module_type type)
+{
+	obs_data_t *item = obs_data_create();
+	obs_data_set_string(item, "id", id);
+	obs_data_set_string(item, "type", type_names[type]);
+	obs_data_array_push_back(ids, item);
+	obs_data_release(item);
+}
+
+static void add_source_id(obs_data_array_t *ids,
+			  const struct obs_source_info *info)
+{
+	obs_data_t *item = obs_data_create();
+	enum obs_module_type type;
+
+	if (info->type == OBS_SOURCE_TYPE_INPUT)
+		type = OBS_MODULE_TYPE_INPUT;
+	else if (info->type == OBS_SOURCE_TYPE_FILTER)
+		type = OBS_MODULE_TYPE_FILTER;
+	else
+		type = OBS_MODULE_TYPE_TRANSITION;
+
+	obs_data_set_string(item, "id", info->id);
+	obs_data_set_string(item, "type", type_names[type]);
+	obs_data_set_string(item, "unversioned_id", info->unversioned_id);
+	obs_data_set_int(item, "version", info->version);
+	obs_data_array_push_back(ids, item);
+	obs_data_release(item);
+}
+
+/* Records the types the module registered while it was loaded.  Only modules
+ * that declare that they register nothing but types are deferred, and never
+ * if they registered UI or have a post-load step anyway. */
+static obs_data_t *create_manifest(obs_module_t *module, const struct stat *st,
+				   const struct registered_types *before)
+{
+	obs_data_t *manifest = obs_data_create();
+	obs_data_array_t *ids = obs_data_array_create();
+	struct registered_types after;
+	bool scenes = false;
+	bool deferrable;
+
+	get_registered_types(&after);
+
+	for (size_t i = before->sources; i < after.sources; i++) {
+		const struct obs_source_info *info =
+			obs->source_types.array + i;
+		if (info->type == OBS_SOURCE_TYPE_SCENE)
+			scenes = true;
+		else
+			add_source_id(ids, info);
+	}
+	for (size_t i = before->outputs; i < after.outputs; i++)
+		add_id(ids, obs->output_types.array[i].id,
+		       OBS_MODULE_TYPE_OUTPUT);
+	for (size_t i = before->encoders; i < after.encoders; i++)
+		add_id(ids, obs->encoder_types.array[i].id,
+		       OBS_MODULE_TYPE_ENCODER);
+	for (size_t i = before->services; i < after.services; i++)
+		add_id(ids, obs->service_types.array[i].id,
+		       OBS_MODULE_TYPE_SERVICE);
+
+	deferrable = module->loaded && module->deferrable &&
+		     module->deferrable() && !module->post_load && !scenes &&
+		     after.modal_uis == before->modal_uis &&
+		     after.modeless_uis == before->modeless_uis &&
+		     obs_data_array_count(ids) > 0;
+
+	obs_data_set_int(manifest, "mtime", (long long)st->st_mtime);
+	obs_data_set_int(manifest, "size", (long long)st->st_size);
+	obs_data_set_bool(manifest, "defer", deferrable);
+	obs_data_set_array(manifest, "ids", ids);
+
+	obs_data_array_release(ids);
+	return manifest;
+}
+
+static bool defer_module(struct module_cache *cache,
+			 const struct obs_module_info *info,
+			 const struct stat *st)
+{
+	obs_data_t *manifest = obs_data_get_obj(cache->old_modules,
+						info->bin_path);
+	bool defer = manifest && obs_data_get_bool(manifest, "defer") &&
+		     obs_data_get_int(manifest, "mtime") ==
+			     (long long)st->st_mtime &&
+		     obs_data_get_int(manifest, "size") ==
+			     (long long)st->st_size;
+
+	if (defer) {
+		struct obs_deferred_module dm = {0};
+		obs_data_array_t *ids = obs_data_get_array(manifest, "ids");
+		size_t count = obs_data_array_count(ids);
+
+		for (size_t i = 0; i < count; i++) {
+			obs_data_t *item = obs_data_array_item(ids, i);
+			struct obs_deferred_type type = {0};
+			const char *id = obs_data_get_string(item, "id");
+			const char *unversioned_id =
+				obs_data_get_string(item, "unversioned_id");
+
+			if (!get_type_from_name(
+				    obs_data_get_string(item, "type"),
+				    &type.type)) {
+				obs_data_release(item);
+				defer = false;
+				break;
+			}
+
+			type.id = bstrdup(id);
+			type.unversioned_id =
+				bstrdup(*unversioned_id ? unversioned_id : id);
+			type.version =
+				(uint32_t)obs_data_get_int(item, "version");
+			da_push_back(dm.types, &type);
+			obs_data_release(item);
+		}
+
+		dm.bin_path = bstrdup(info->bin_path);
+		dm.data_path = bstrdup(info->data_path);
+
+		if (defer) {
+			da_push_back(obs->deferred_modules, &dm);
+			obs_data_set_obj(cache->modules, info->bin_path,
+					 manifest);
+		} else {
+			free_deferred_module(&dm);
+		}
+
+		obs_data_array_release(ids);
+	}
+
+	obs_data_release(manifest);
+	return defer;
+}
+
+/* Makes room for the types deferred modules will register, so registering
+ * them doesn't move the type lists while other threads look types up */
+static void reserve_deferred_types(void)
+{
+	size_t counts[OBS_MODULE_TYPE_SERVICE + 1] = {0};
+
+	if (!obs->deferred_modules.num)
+		return;
+
+	for (size_t i = 0; i < obs->deferred_modules.num; i++) {
+		struct obs_deferred_module *dm =
+			obs->deferred_modules.array + i;
+
+		for (size_t j = 0; j < dm->types.num; j++)
+			counts[dm->types.array[j].type]++;
+	}
+
+	da_reserve(obs->source_types,
+		   obs->source_types.num + counts[OBS_MODULE_TYPE_INPUT] +
+			   counts[OBS_MODULE_TYPE_FILTER] +
+			   counts[OBS_MODULE_TYPE_TRANSITION]);
+	da_reserve(obs->input_types,
+		   obs->input_types.num + counts[OBS_MODULE_TYPE_INPUT]);
+	da_reserve(obs->filter_types,
+		   obs->filter_types.num + counts[OBS_MODULE_TYPE_FILTER]);
+	da_reserve(obs->transition_types,
+		   obs->transition_types.num +
+			   counts[OBS_MODULE_TYPE_TRANSITION]);
+	da_reserve(obs->output_types,
+		   obs->output_types.num + counts[OBS_MODULE_TYPE_OUTPUT]);
+	da_reserve(obs->encoder_types,
+		   obs->encoder_types.num + counts[OBS_MODULE_TYPE_ENCODER]);
+	da_reserve(obs->service_types,
+		   obs->service_types.num + counts[OBS_MODULE_TYPE_SERVICE]);
+}
+
+static void load_module_cache(struct module_cache *cache)
+{
+	obs_data_t *data =
+		obs_data_create_from_json_file(obs->module_cache_path);
+
+	if (obs_data_get_int(data, "version") == LIBOBS_API_VER)
+		cache->old_modules = obs_data_get_obj(data, "modules");
+	cache->modules = obs_data_create();
+
+	obs_data_release(data);
+}
+
+static void save_module_cache(struct module_cache *cache)
+{
+	obs_data_t *data = obs_data_create();
+
+	obs_data_set_int(data, "version", LIBOBS_API_VER);
+	obs_data_set_obj(data, "modules", cache->modules);
+
+	if (!obs_data_save_json_safe(data, obs->module_cache_path, "tmp",
+				     "bak"))
+		blog(LOG_WARNING, "Failed to save module cache to '%s'",
+		     obs->module_cache_path);
+
+	obs_data_release(data);
+	obs_data_release(cache->modules);
+	obs_data_release(cache->old_modules);
+}
+
 static void load_all_callback(void *param, const struct obs_module_info *info)
 {
+	struct module_cache *cache = param;
+	struct registered_types types;
 	obs_module_t *module;
+	struct stat st;
+	bool use_cache = cache->modules && os_stat(info->bin_path, &st) == 0;
+
+	if (use_cache && defer_module(cache, info, &st))
+		return;
+
+	get_registered_types(&types);
 
 	int code = obs_open_module(&module, info->bin_path, info->data_path);
 	if (code != MODULE_SUCCESS) {
@@ -248,7 +825,11 @@ static void load_all_callback(void *param, const struct obs_module_info *info)
 
 	obs_init_module(module);
 
-	UNUSED_PARAMETER(param);
+	if (use_cache) {
+		obs_data_t *manifest = create_manifest(module, &st, &types);
+		obs_data_set_obj(cache->modules, info->bin_path, manifest);
+		obs_data_release(manifest);
+	}
 }
 
 static const char *obs_load_all_modules_name = "obs_load_all_modules";
@@ -258,8 +839,22 @@ static const char *reset_win32_symbol_paths_name = "reset_win32_symbol_paths";
 
 void obs_load_all_modules(void)
 {
+	struct module_cache cache = {0};
+
 	profile_start(obs_load_all_modules_name);
-	obs_find_modules(load_all_callback, NULL);
+
+	obs->module_thread = pthread_self();
+
+	if (obs->module_cache_path)
+		load_module_cache(&cache);
+
+	obs_find_modules(load_all_callback, &cache);
+
+	if (cache.modules)
+		save_module_cache(&cache);
+
+	reserve_deferred_types();
+
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
@@ -672,7 +1267,7 @@ error:
 
 void obs_register_output_s(const struct obs_output_info *info, size_t size)
 {
-	if (find_output(info->id)) {
+	if (find_registered_output(info->id)) {
 		output_warn("Output id '%s' already exists!  "
 			    "Duplicate library?",
 			    info->id);
@@ -715,7 +1310,7 @@ error:
 
 void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size)
 {
-	if (find_encoder(info->id)) {
+	if (find_registered_encoder(info->id)) {
 		encoder_warn("Encoder id '%s' already exists!  "
 			     "Duplicate library?",
 			     info->id);
@@ -746,7 +1341,7 @@ error:
 
 void obs_register_service_s(const struct obs_service_info *info, size_t size)
 {
-	if (find_service(info->id)) {
+	if (find_registered_service(info->id)) {
 		service_warn("Service id '%s' already exists!  "
 			     "Duplicate library?",
 			     info->id);
@@ -100,6 +100,15 @@ MODULE_EXPORT void obs_module_unload(void);
 /** Optional: Called when all modules have finished loading */
 MODULE_EXPORT void obs_module_post_load(void);
 
+/**
+ * Optional: Declares that obs_module_load does nothing but register types,
+ * so that loading the module can be deferred until one of its types is first
+ * used.  See obs_set_module_cache_path.
+ */
+#define OBS_MODULE_DEFERRABLE()                         \
+	MODULE_EXPORT bool obs_module_deferrable(void); \
+	bool obs_module_deferrable(void) { return true; }
+
 /** Called to set the current locale data for the module.  */
 MODULE_EXPORT void obs_module_set_locale(const char *locale);
 
@@ -31,6 +31,8 @@ static void get_ungrouped_transform(obs_sceneitem_t *group, struct vec2 *pos,
 				    struct vec2 *scale, float *rot);
 static inline bool crop_enabled(const struct obs_sceneitem_crop *crop);
 static inline bool item_texture_enabled(const struct obs_scene_item *item);
+static uint32_t scene_getwidth(void *data);
+static uint32_t scene_getheight(void *data);
 static void init_hotkeys(obs_scene_t *scene, obs_sceneitem_t *item,
 			 const char *name);
 
@@ -476,12 +478,14 @@ static void render_item_texture(struct obs_scene_item *item)
 	enum obs_scale_type type = item->scale_filter;
 	uint32_t cx = gs_texture_get_width(tex);
 	uint32_t cy = gs_texture_get_height(tex);
-	const char *tech = "Draw";
+	const struct obs_scale_effect *scale = NULL;
+	bool upscale = false;
+	gs_technique_t *tech;
+	size_t passes;
 
 	if (type != OBS_SCALE_DISABLE) {
 		if (type == OBS_SCALE_POINT) {
-			gs_eparam_t *image =
-				gs_effect_get_param_by_name(effect, "image");
+			gs_eparam_t *image = gs_effect_get_image_param(effect);
 			gs_effect_set_next_sampler(image,
 						   obs->video.point_sampler);
 
@@ -499,21 +503,19 @@ static void render_item_texture(struct obs_scene_item *item)
 				effect = obs->video.lanczos_effect;
 			} else if (type == OBS_SCALE_AREA) {
 				effect = obs->video.area_effect;
-				if ((item->output_scale.x >= 1.0f) &&
-				    (item->output_scale.y >= 1.0f))
-					tech = "DrawUpscale";
+				upscale = (item->output_scale.x >= 1.0f) &&
+					  (item->output_scale.y >= 1.0f);
 			}
 
-			scale_param = gs_effect_get_param_by_name(
-				effect, "base_dimension");
+			scale = get_scale_effect_params(&obs->video, effect);
+			scale_param = scale ? scale->base_dimension : NULL;
 			if (scale_param) {
 				struct vec2 base_res = {(float)cx, (float)cy};
 
 				gs_effect_set_vec2(scale_param, &base_res);
 			}
 
-			scale_i_param = gs_effect_get_param_by_name(
-				effect, "base_dimension_i");
+			scale_i_param = scale ? scale->base_dimension_i : NULL;
 			if (scale_i_param) {
 				struct vec2 base_res_i = {1.0f / (float)cx,
 							  1.0f / (float)cy};
@@ -523,11 +525,19 @@ static void render_item_texture(struct obs_scene_item *item)
 		}
 	}
 
+	tech = upscale && scale ? scale->draw_upscale
+				: gs_effect_get_draw_technique(effect);
+
 	gs_blend_state_push();
 	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
 
-	while (gs_effect_loop(effect, tech))
+	passes = gs_technique_begin(tech);
+	for (size_t i = 0; i < passes; i++) {
+		gs_technique_begin_pass(tech, i);
 		obs_source_draw(tex, 0, 0, 0, 0, 0);
+		gs_technique_end_pass(tech);
+	}
+	gs_technique_end(tech);
 
 	gs_blend_state_pop();
 
@@ -646,11 +656,166 @@ update_transforms_and_prune_sources(obs_scene_t *scene,
 		resize_group(group_sceneitem);
 }
 
+/* ------------------------------------------------------------------------- */
+/* culling */
+
+static inline bool format_has_alpha(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_I40A:
+	case VIDEO_FORMAT_I42A:
+	case VIDEO_FORMAT_YUVA:
+	case VIDEO_FORMAT_AYUV:
+	case VIDEO_FORMAT_NONE:
+		return true;
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_Y800:
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_BGR3:
+	case VIDEO_FORMAT_I422:
+		return false;
+	}
+
+	return true;
+}
+
+/* only plain async sources drawing an alpha-less frame are known to cover
+ * every pixel of their rectangle */
+static inline bool item_is_opaque(const struct obs_scene_item *item)
+{
+	const struct obs_source *source = item->source;
+	uint32_t flags = source->info.output_flags;
+
+	if ((flags & OBS_SOURCE_ASYNC_VIDEO) != OBS_SOURCE_ASYNC_VIDEO)
+		return false;
+	if (source->info.video_render || source->filters.num ||
+	    !source->enabled)
+		return false;
+	if (!source->async_active || !source->async_textures[0])
+		return false;
+
+	return !format_has_alpha(source->async_format);
+}
+
+static inline void get_item_local_size(const struct obs_scene_item *item,
+				       float *cx, float *cy)
+{
+	uint32_t width = obs_source_get_width(item->source);
+	uint32_t height = obs_source_get_height(item->source);
+
+	*cx = width ? (float)calc_cx(item, width) : 0.0f;
+	*cy = height ? (float)calc_cy(item, height) : 0.0f;
+}
+
+static bool item_outside_canvas(const struct obs_scene_item *item,
+				float canvas_cx, float canvas_cy)
+{
+	struct vec3 corners[4];
+	struct vec2 minv;
+	struct vec2 maxv;
+	float cx, cy;
+
+	get_item_local_size(item, &cx, &cy);
+	if (cx <= 0.0f || cy <= 0.0f)
+		return true;
+
+	vec3_set(&corners[0], 0.0f, 0.0f, 0.0f);
+	vec3_set(&corners[1], cx, 0.0f, 0.0f);
+	vec3_set(&corners[2], 0.0f, cy, 0.0f);
+	vec3_set(&corners[3], cx, cy, 0.0f);
+
+	vec2_set(&minv, M_INFINITE, M_INFINITE);
+	vec2_set(&maxv, -M_INFINITE, -M_INFINITE);
+
+	for (size_t i = 0; i < 4; i++) {
+		struct vec3 *v = &corners[i];
+		vec3_transform(v, v, &item->draw_transform);
+
+		if (v->x < minv.x)
+			minv.x = v->x;
+		if (v->y < minv.y)
+			minv.y = v->y;
+		if (v->x > maxv.x)
+			maxv.x = v->x;
+		if (v->y > maxv.y)
+			maxv.y = v->y;
+	}
+
+	return maxv.x <= 0.0f || maxv.y <= 0.0f || minv.x >= canvas_cx ||
+	       minv.y >= canvas_cy;
+}
+
+static bool item_covers_canvas(const struct obs_scene_item *item,
+			       float canvas_cx, float canvas_cy)
+{
+	struct matrix4 inv;
+	struct vec3 corners[4];
+	float cx, cy;
+
+	if (!item_is_opaque(item))
+		return false;
+
+	get_item_local_size(item, &cx, &cy);
+	if (cx <= 0.0f || cy <= 0.0f)
+		return false;
+	if (!matrix4_inv(&inv, &item->draw_transform))
+		return false;
+
+	vec3_set(&corners[0], 0.0f, 0.0f, 0.0f);
+	vec3_set(&corners[1], canvas_cx, 0.0f, 0.0f);
+	vec3_set(&corners[2], 0.0f, canvas_cy, 0.0f);
+	vec3_set(&corners[3], canvas_cx, canvas_cy, 0.0f);
+
+	/* the item covers the canvas if every canvas corner maps back into
+	 * the item's own rectangle, which also handles rotation */
+	for (size_t i = 0; i < 4; i++) {
+		struct vec3 *v = &corners[i];
+		vec3_transform(v, v, &inv);
+
+		if (v->x < -EPSILON || v->y < -EPSILON ||
+		    v->x > cx + EPSILON || v->y > cy + EPSILON)
+			return false;
+	}
+
+	return true;
+}
+
+/* assumes video lock.  returns the lowest item that still needs to be
+ * rendered; everything below it is hidden by an opaque item */
+static struct obs_scene_item *find_first_unoccluded_item(obs_scene_t *scene,
+							 float canvas_cx,
+							 float canvas_cy)
+{
+	struct obs_scene_item *item = scene->first_item;
+	struct obs_scene_item *first = scene->first_item;
+
+	while (item) {
+		if (item->user_visible &&
+		    item_covers_canvas(item, canvas_cx, canvas_cy))
+			first = item;
+
+		item = item->next;
+	}
+
+	return first;
+}
+
 static void scene_video_render(void *data, gs_effect_t *effect)
 {
 	DARRAY(struct obs_scene_item *) remove_items;
 	struct obs_scene *scene = data;
 	struct obs_scene_item *item;
+	struct obs_scene_item *first_rendered;
+	float canvas_cx = 0.0f;
+	float canvas_cy = 0.0f;
+	long culled = 0;
 
 	da_init(remove_items);
 
@@ -659,19 +824,44 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 	if (!scene->is_group) {
 		update_transforms_and_prune_sources(scene, &remove_items.da,
 						    NULL);
+
+		canvas_cx = (float)scene_getwidth(scene);
+		canvas_cy = (float)scene_getheight(scene);
 	}
 
+	/* groups are always sized to fit their items and are culled as a
+	 * whole by their parent scene */
+	first_rendered = scene->is_group ? scene->first_item
+					 : find_first_unoccluded_item(
+						   scene, canvas_cx, canvas_cy);
+
 	gs_blend_state_push();
 	gs_reset_blend_state();
+	gs_sprite_batch_begin();
 
 	item = scene->first_item;
 	while (item) {
-		if (item->user_visible)
+		if (!item->user_visible) {
+			item = item->next;
+			continue;
+		}
+
+		if (item == first_rendered)
+			first_rendered = NULL;
+
+		if (first_rendered ||
+		    (!scene->is_group &&
+		     item_outside_canvas(item, canvas_cx, canvas_cy)))
+			culled++;
+		else
 			render_item(item);
 
 		item = item->next;
 	}
 
+	os_atomic_set_long(&scene->culled_items, culled);
+
+	gs_sprite_batch_end();
 	gs_blend_state_pop();
 
 	video_unlock(scene);
@@ -1502,6 +1692,14 @@ obs_sceneitem_t *obs_scene_find_sceneitem_by_id(obs_scene_t *scene, int64_t id)
 	return item;
 }
 
+size_t obs_scene_get_culled_item_count(const obs_scene_t *scene)
+{
+	if (!scene)
+		return 0;
+
+	return (size_t)os_atomic_load_long(&scene->culled_items);
+}
+
 void obs_scene_enum_items(obs_scene_t *scene,
 			  bool (*callback)(obs_scene_t *, obs_sceneitem_t *,
 					   void *),
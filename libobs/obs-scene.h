@@ -97,4 +97,8 @@ struct obs_scene {
 	pthread_mutex_t video_mutex;
 	pthread_mutex_t audio_mutex;
 	struct obs_scene_item *first_item;
+
+	/* number of visible items skipped during the last render because
+	 * they could not contribute any pixels */
+	volatile long culled_items;
 };
@@ -0,0 +1,559 @@
+#include "util/sse-intrin.h"
+#include "obs-internal.h"
+
+/*
+ * Async frames can be deinterlaced on the CPU while they're being cached,
+ * instead of by the deinterlacing effects when the source is drawn, so that
+ * frame filters and anything else that reads the cached frames get
+ * progressive frames too.  The kernels follow deinterlace_base.effect, but
+ * work on the bytes of each plane and therefore only interpolate vertically.
+ * The lines of each frame are split between the output thread and a small
+ * pool of worker threads, which is started the first time it's needed.
+ */
+
+#define MIN_SLICE_LINES 64
+
+struct deinterlace_slice {
+	struct deinterlace_cpu *state;
+	size_t index;
+};
+
+struct deinterlace_cpu {
+	/* copies of the previous input frame and of the current one, only
+	 * kept while yadif is used */
+	struct obs_source_frame *prev;
+	struct obs_source_frame *next;
+	bool prev_valid;
+
+	struct obs_source_frame *dst;
+	const struct obs_source_frame *src;
+	const struct obs_source_frame *prev_src;
+	enum obs_deinterlace_mode mode;
+	uint32_t field;
+
+	struct deinterlace_slice slices[MAX_DEINTERLACE_THREADS + 1];
+	size_t num_slices;
+	os_sem_t *done;
+};
+
+static pthread_mutex_t workers_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static struct {
+	pthread_t threads[MAX_DEINTERLACE_THREADS];
+	size_t count;
+	bool started;
+	os_sem_t *semaphore;
+	struct circlebuf queue;
+} workers;
+
+/* ------------------------------------------------------------------------- */
+
+static inline int max_int(int a, int b)
+{
+	return a > b ? a : b;
+}
+
+static inline int min_int(int a, int b)
+{
+	return a < b ? a : b;
+}
+
+static inline int abs_diff(int a, int b)
+{
+	return a > b ? a - b : b - a;
+}
+
+static inline int average(int a, int b)
+{
+	return (a + b + 1) >> 1;
+}
+
+static inline __m128i load_16(const uint8_t *line, size_t x)
+{
+	return _mm_loadu_si128((const __m128i *)(line + x));
+}
+
+static inline __m128i abs_diff_epu8(__m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+static inline __m128i widen(__m128i v, bool high)
+{
+	return high ? _mm_unpackhi_epi8(v, _mm_setzero_si128())
+		    : _mm_unpacklo_epi8(v, _mm_setzero_si128());
+}
+
+static void average_line(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+			 size_t size)
+{
+	size_t x = 0;
+
+	for (; x + 16 <= size; x += 16)
+		_mm_storeu_si128((__m128i *)(dst + x),
+				 _mm_avg_epu8(load_16(a, x), load_16(b, x)));
+
+	for (; x < size; x++)
+		dst[x] = (uint8_t)average(a[x], b[x]);
+}
+
+/* lines[0..4] are the lines y - 2 to y + 2 of a frame */
+struct yadif_lines {
+	const uint8_t *prev[5];
+	const uint8_t *cur[5];
+	const uint8_t *above;
+	const uint8_t *below;
+};
+
+static inline uint8_t yadif_pixel(const struct yadif_lines *l, size_t x)
+{
+	int c = l->below[x];
+	int e = l->above[x];
+	int d = average(l->prev[2][x], l->cur[2][x]);
+	int b = average(l->prev[4][x], l->cur[4][x]);
+	int f = average(l->prev[0][x], l->cur[0][x]);
+
+	int diff0 = abs_diff(l->prev[2][x], l->cur[2][x]) >> 1;
+	int diff1 = average(abs_diff(l->prev[3][x], c),
+			    abs_diff(l->prev[1][x], e));
+	int diff2 = average(abs_diff(l->cur[3][x], c),
+			    abs_diff(l->cur[1][x], e));
+	int diff = max_int(diff0, max_int(diff1, diff2));
+	int pred = average(c, e);
+
+	int max_ = max_int(d - e, max_int(d - c, min_int(b - c, f - e)));
+	int min_ = min_int(d - e, min_int(d - c, max_int(b - c, f - e)));
+	diff = max_int(diff, max_int(min_, -max_));
+
+	if (pred > d + diff)
+		pred = d + diff;
+	else if (pred < d - diff)
+		pred = d - diff;
+
+	return (uint8_t)pred;
+}
+
+/* the spatial check and clamp of yadif_pixel on 8 widened pixels */
+static inline __m128i yadif_clamp(__m128i c, __m128i e, __m128i d, __m128i b,
+				  __m128i f, __m128i diff, __m128i pred)
+{
+	const __m128i de = _mm_sub_epi16(d, e);
+	const __m128i dc = _mm_sub_epi16(d, c);
+	const __m128i bc = _mm_sub_epi16(b, c);
+	const __m128i fe = _mm_sub_epi16(f, e);
+
+	__m128i max_ = _mm_min_epi16(bc, fe);
+	__m128i min_ = _mm_max_epi16(bc, fe);
+
+	max_ = _mm_max_epi16(de, _mm_max_epi16(dc, max_));
+	min_ = _mm_min_epi16(de, _mm_min_epi16(dc, min_));
+
+	max_ = _mm_sub_epi16(_mm_setzero_si128(), max_);
+	diff = _mm_max_epi16(diff, _mm_max_epi16(min_, max_));
+
+	pred = _mm_min_epi16(pred, _mm_add_epi16(d, diff));
+	return _mm_max_epi16(pred, _mm_sub_epi16(d, diff));
+}
+
+static inline __m128i yadif_half(__m128i c, __m128i e, __m128i d, __m128i b,
+				 __m128i f, __m128i diff0, __m128i diff12,
+				 __m128i pred, bool high)
+{
+	__m128i diff = _mm_max_epi16(_mm_srli_epi16(widen(diff0, high), 1),
+				     widen(diff12, high));
+
+	return yadif_clamp(widen(c, high), widen(e, high), widen(d, high),
+			   widen(b, high), widen(f, high), diff,
+			   widen(pred, high));
+}
+
+static void yadif_line(uint8_t *dst, const struct yadif_lines *l, size_t size)
+{
+	size_t x = 0;
+
+	for (; x + 16 <= size; x += 16) {
+		__m128i c = load_16(l->below, x);
+		__m128i e = load_16(l->above, x);
+		__m128i p2 = load_16(l->prev[2], x);
+		__m128i n2 = load_16(l->cur[2], x);
+		__m128i d = _mm_avg_epu8(p2, n2);
+		__m128i b = _mm_avg_epu8(load_16(l->prev[4], x),
+					 load_16(l->cur[4], x));
+		__m128i f = _mm_avg_epu8(load_16(l->prev[0], x),
+					 load_16(l->cur[0], x));
+		__m128i pred = _mm_avg_epu8(c, e);
+
+		__m128i diff0 = abs_diff_epu8(p2, n2);
+		__m128i diff1 =
+			_mm_avg_epu8(abs_diff_epu8(load_16(l->prev[3], x), c),
+				     abs_diff_epu8(load_16(l->prev[1], x), e));
+		__m128i diff2 =
+			_mm_avg_epu8(abs_diff_epu8(load_16(l->cur[3], x), c),
+				     abs_diff_epu8(load_16(l->cur[1], x), e));
+		__m128i diff12 = _mm_max_epu8(diff1, diff2);
+
+		__m128i lo = yadif_half(c, e, d, b, f, diff0, diff12, pred,
+					false);
+		__m128i hi = yadif_half(c, e, d, b, f, diff0, diff12, pred,
+					true);
+
+		_mm_storeu_si128((__m128i *)(dst + x),
+				 _mm_packus_epi16(lo, hi));
+	}
+
+	for (; x < size; x++)
+		dst[x] = yadif_pixel(l, x);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint32_t plane_lines(enum video_format format, size_t plane,
+			    uint32_t height)
+{
+	switch (format) {
+	case VIDEO_FORMAT_NONE:
+		return 0;
+	case VIDEO_FORMAT_I420:
+		return plane < 3 ? (plane ? height / 2 : height) : 0;
+	case VIDEO_FORMAT_NV12:
+		return plane < 2 ? (plane ? height / 2 : height) : 0;
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_I422:
+		return plane < 3 ? height : 0;
+	case VIDEO_FORMAT_I40A:
+		if (plane == 1 || plane == 2)
+			return height / 2;
+		return plane < 4 ? height : 0;
+	case VIDEO_FORMAT_I42A:
+	case VIDEO_FORMAT_YUVA:
+		return plane < 4 ? height : 0;
+	default:
+		return plane == 0 ? height : 0;
+	}
+}
+
+static inline const uint8_t *get_line(const struct obs_source_frame *frame,
+				      size_t plane, uint32_t y)
+{
+	return frame->data[plane] + (size_t)y * frame->linesize[plane];
+}
+
+/* mirrors lines outside of the plane back into it, which keeps them in the
+ * same field */
+static inline uint32_t offset_line(uint32_t y, int offset, uint32_t lines)
+{
+	int64_t line = (int64_t)y + offset;
+
+	if (line < 0 || line >= (int64_t)lines)
+		line = (int64_t)y - offset;
+	if (line < 0 || line >= (int64_t)lines)
+		line = y;
+
+	return (uint32_t)line;
+}
+
+static void deinterlace_line(struct deinterlace_cpu *state, size_t plane,
+			     uint32_t y, uint32_t lines, size_t size)
+{
+	const struct obs_source_frame *src = state->src;
+	const struct obs_source_frame *prev = state->prev_src;
+	uint8_t *out = state->dst->data[plane] +
+		       (size_t)y * state->dst->linesize[plane];
+	bool kept = (y & 1) == state->field;
+	uint32_t line;
+
+	switch (state->mode) {
+	case OBS_DEINTERLACE_MODE_DISCARD:
+	case OBS_DEINTERLACE_MODE_RETRO:
+		line = (y & ~1u) + state->field;
+		memcpy(out, get_line(src, plane, line < lines ? line : y),
+		       size);
+		break;
+
+	case OBS_DEINTERLACE_MODE_BLEND:
+	case OBS_DEINTERLACE_MODE_BLEND_2X:
+		average_line(out, get_line(src, plane, y),
+			     get_line(src, plane, offset_line(y, 1, lines)),
+			     size);
+		break;
+
+	case OBS_DEINTERLACE_MODE_LINEAR:
+	case OBS_DEINTERLACE_MODE_LINEAR_2X:
+		if (kept)
+			memcpy(out, get_line(src, plane, y), size);
+		else
+			average_line(
+				out,
+				get_line(src, plane, offset_line(y, -1, lines)),
+				get_line(src, plane, offset_line(y, 1, lines)),
+				size);
+		break;
+
+	case OBS_DEINTERLACE_MODE_YADIF:
+	case OBS_DEINTERLACE_MODE_YADIF_2X: {
+		/* like the effect, the kept field is read from the previous
+		 * frame for the second field order */
+		const struct obs_source_frame *spatial = state->field ? prev
+								      : src;
+		struct yadif_lines l;
+
+		if (kept) {
+			memcpy(out, get_line(spatial, plane, y), size);
+			break;
+		}
+
+		for (int i = 0; i < 5; i++) {
+			line = offset_line(y, i - 2, lines);
+			l.prev[i] = get_line(prev, plane, line);
+			l.cur[i] = get_line(src, plane, line);
+		}
+		l.above = get_line(spatial, plane, offset_line(y, -1, lines));
+		l.below = get_line(spatial, plane, offset_line(y, 1, lines));
+
+		yadif_line(out, &l, size);
+		break;
+	}
+
+	case OBS_DEINTERLACE_MODE_DISABLE:
+		memcpy(out, get_line(src, plane, y), size);
+		break;
+	}
+}
+
+static void copy_lines(struct obs_source_frame *dst,
+		       const struct obs_source_frame *src, size_t plane,
+		       uint32_t start, uint32_t end, size_t size)
+{
+	for (uint32_t y = start; y < end; y++)
+		memcpy(dst->data[plane] + (size_t)y * dst->linesize[plane],
+		       get_line(src, plane, y), size);
+}
+
+static void deinterlace_slice(struct deinterlace_slice *slice)
+{
+	struct deinterlace_cpu *state = slice->state;
+	const struct obs_source_frame *dst = state->dst;
+	const struct obs_source_frame *src = state->src;
+
+	for (size_t plane = 0; plane < MAX_AV_PLANES; plane++) {
+		uint32_t lines = plane_lines(dst->format, plane, dst->height);
+		uint32_t start, end;
+		size_t size;
+
+		if (!lines)
+			continue;
+
+		start = (uint32_t)((uint64_t)lines * slice->index /
+				   state->num_slices);
+		end = (uint32_t)((uint64_t)lines * (slice->index + 1) /
+				 state->num_slices);
+		size = src->linesize[plane] < dst->linesize[plane]
+			       ? src->linesize[plane]
+			       : dst->linesize[plane];
+
+		for (uint32_t y = start; y < end; y++)
+			deinterlace_line(state, plane, y, lines, size);
+
+		/* keep a copy of the input for the next frame, which can't
+		 * replace the previous one until every slice is done */
+		if (state->next)
+			copy_lines(state->next, src, plane, start, end, size);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void *deinterlace_thread(void *unused)
+{
+	os_set_thread_name("obs deinterlace thread");
+
+	/* the semaphore is posted once per queued slice, and once per thread
+	 * when stopping, so the queue is always drained first */
+	while (os_sem_wait(workers.semaphore) == 0) {
+		struct deinterlace_slice *slice = NULL;
+
+		pthread_mutex_lock(&workers_mutex);
+		if (workers.queue.size)
+			circlebuf_pop_front(&workers.queue, &slice,
+					    sizeof(slice));
+		pthread_mutex_unlock(&workers_mutex);
+
+		if (!slice)
+			break;
+
+		deinterlace_slice(slice);
+		os_sem_post(slice->state->done);
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+/* called with workers_mutex held */
+static void start_workers(void)
+{
+	int cores = os_get_logical_cores();
+	size_t count = cores > 1 ? (size_t)cores - 1 : 0;
+
+	workers.started = true;
+
+	if (count > MAX_DEINTERLACE_THREADS)
+		count = MAX_DEINTERLACE_THREADS;
+	if (!count || os_sem_init(&workers.semaphore, 0) != 0)
+		return;
+
+	for (size_t i = 0; i < count; i++) {
+		if (pthread_create(&workers.threads[i], NULL,
+				   deinterlace_thread, NULL) != 0) {
+			blog(LOG_WARNING, "Failed to create deinterlace "
+					  "thread");
+			break;
+		}
+		workers.count++;
+	}
+
+	if (!workers.count) {
+		os_sem_destroy(workers.semaphore);
+		workers.semaphore = NULL;
+	}
+}
+
+void free_deinterlace_threads(void)
+{
+	size_t count;
+
+	pthread_mutex_lock(&workers_mutex);
+	count = workers.count;
+	workers.count = 0;
+	workers.started = false;
+	pthread_mutex_unlock(&workers_mutex);
+
+	if (!count)
+		return;
+
+	for (size_t i = 0; i < count; i++)
+		os_sem_post(workers.semaphore);
+	for (size_t i = 0; i < count; i++)
+		pthread_join(workers.threads[i], NULL);
+
+	os_sem_destroy(workers.semaphore);
+	workers.semaphore = NULL;
+	circlebuf_free(&workers.queue);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool frame_matches(const struct obs_source_frame *frame,
+				 const struct obs_source_frame *src)
+{
+	return frame->format == src->format && frame->width == src->width &&
+	       frame->height == src->height;
+}
+
+static void release_history(struct deinterlace_cpu *state)
+{
+	frame_pool_release(state->prev);
+	frame_pool_release(state->next);
+	state->prev = NULL;
+	state->next = NULL;
+	state->prev_valid = false;
+}
+
+static void update_history(struct deinterlace_cpu *state,
+			   const struct obs_source_frame *src)
+{
+	if (state->prev && !frame_matches(state->prev, src))
+		release_history(state);
+
+	if (!state->prev) {
+		enum video_format format = src->format;
+
+		state->prev = frame_pool_acquire(format, src->width,
+						 src->height);
+		state->next = frame_pool_acquire(format, src->width,
+						 src->height);
+	}
+
+	state->prev_src = state->prev_valid ? state->prev : src;
+}
+
+static inline bool is_yadif(enum obs_deinterlace_mode mode)
+{
+	return mode == OBS_DEINTERLACE_MODE_YADIF ||
+	       mode == OBS_DEINTERLACE_MODE_YADIF_2X;
+}
+
+void deinterlace_cpu_frame(obs_source_t *source, struct obs_source_frame *dst,
+			   const struct obs_source_frame *src)
+{
+	struct deinterlace_cpu *state = source->deinterlace_cpu_state;
+	size_t num_slices;
+
+	if (!state) {
+		state = bzalloc(sizeof(*state));
+		if (os_sem_init(&state->done, 0) != 0) {
+			bfree(state);
+			obs_source_frame_copy(dst, src);
+			return;
+		}
+		source->deinterlace_cpu_state = state;
+	}
+
+	state->dst = dst;
+	state->src = src;
+	state->mode = source->deinterlace_mode;
+	state->field = source->deinterlace_top_first ? 1 : 0;
+
+	if (is_yadif(state->mode)) {
+		update_history(state, src);
+	} else {
+		release_history(state);
+		state->prev_src = src;
+	}
+
+	num_slices = dst->height / MIN_SLICE_LINES;
+	if (!num_slices)
+		num_slices = 1;
+
+	pthread_mutex_lock(&workers_mutex);
+	if (!workers.started)
+		start_workers();
+	if (num_slices > workers.count + 1)
+		num_slices = workers.count + 1;
+
+	state->num_slices = num_slices;
+	for (size_t i = 0; i < num_slices; i++) {
+		struct deinterlace_slice *slice = &state->slices[i];
+
+		slice->state = state;
+		slice->index = i;
+		if (i)
+			circlebuf_push_back(&workers.queue, &slice,
+					    sizeof(slice));
+	}
+
+	for (size_t i = 1; i < num_slices; i++)
+		os_sem_post(workers.semaphore);
+	pthread_mutex_unlock(&workers_mutex);
+
+	deinterlace_slice(&state->slices[0]);
+
+	for (size_t i = 1; i < num_slices; i++)
+		os_sem_wait(state->done);
+
+	if (state->next) {
+		struct obs_source_frame *prev = state->prev;
+		state->prev = state->next;
+		state->next = prev;
+		state->prev_valid = true;
+	}
+}
+
+void deinterlace_cpu_destroy(struct deinterlace_cpu *state)
+{
+	if (state) {
+		release_history(state);
+		os_sem_destroy(state->done);
+		bfree(state);
+	}
+}
@@ -351,13 +351,11 @@ void deinterlace_render(obs_source_t *s)
 	gs_effect_t *effect = s->deinterlace_effect;
 
 	uint64_t frame2_ts;
-	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
-	gs_eparam_t *prev =
-		gs_effect_get_param_by_name(effect, "previous_image");
-	gs_eparam_t *field = gs_effect_get_param_by_name(effect, "field_order");
-	gs_eparam_t *frame2 = gs_effect_get_param_by_name(effect, "frame2");
-	gs_eparam_t *dimensions =
-		gs_effect_get_param_by_name(effect, "dimensions");
+	gs_eparam_t *image = s->deinterlace_image_param;
+	gs_eparam_t *prev = s->deinterlace_prev_param;
+	gs_eparam_t *field = s->deinterlace_field_param;
+	gs_eparam_t *frame2 = s->deinterlace_frame2_param;
+	gs_eparam_t *dimensions = s->deinterlace_dimensions_param;
 	struct vec2 size = {(float)s->async_width, (float)s->async_height};
 
 	gs_texture_t *cur_tex =
@@ -387,17 +385,35 @@ void deinterlace_render(obs_source_t *s)
 			       s->async_width, s->async_height);
 }
 
+/* parameter handles are resolved once when the mode changes rather than on
+ * every draw */
+static void set_deinterlace_effect(obs_source_t *s, gs_effect_t *effect)
+{
+	s->deinterlace_effect = effect;
+	s->deinterlace_image_param =
+		gs_effect_get_param_by_name(effect, "image");
+	s->deinterlace_prev_param =
+		gs_effect_get_param_by_name(effect, "previous_image");
+	s->deinterlace_field_param =
+		gs_effect_get_param_by_name(effect, "field_order");
+	s->deinterlace_frame2_param =
+		gs_effect_get_param_by_name(effect, "frame2");
+	s->deinterlace_dimensions_param =
+		gs_effect_get_param_by_name(effect, "dimensions");
+}
+
 static void enable_deinterlacing(obs_source_t *source,
 				 enum obs_deinterlace_mode mode)
 {
 	obs_enter_graphics();
 
-	if (source->async_format != VIDEO_FORMAT_NONE &&
+	if (!source->deinterlace_cpu &&
+	    source->async_format != VIDEO_FORMAT_NONE &&
 	    source->async_width != 0 && source->async_height != 0)
 		set_deinterlace_texture_size(source);
 
 	source->deinterlace_mode = mode;
-	source->deinterlace_effect = get_effect(mode);
+	set_deinterlace_effect(source, get_effect(mode));
 
 	pthread_mutex_lock(&source->async_mutex);
 	if (source->prev_async_frame) {
@@ -439,7 +455,7 @@ void obs_source_set_deinterlace_mode(obs_source_t *source,
 	} else {
 		obs_enter_graphics();
 		source->deinterlace_mode = mode;
-		source->deinterlace_effect = get_effect(mode);
+		set_deinterlace_effect(source, get_effect(mode));
 		obs_leave_graphics();
 	}
 }
@@ -472,3 +488,31 @@ obs_source_get_deinterlace_field_order(const obs_source_t *source)
 		       ? OBS_DEINTERLACE_FIELD_ORDER_TOP
 		       : OBS_DEINTERLACE_FIELD_ORDER_BOTTOM;
 }
+
+void obs_source_set_deinterlace_cpu(obs_source_t *source, bool cpu)
+{
+	enum obs_deinterlace_mode mode;
+
+	if (!obs_source_valid(source, "obs_source_set_deinterlace_cpu"))
+		return;
+	if (source->deinterlace_cpu == cpu)
+		return;
+
+	/* the textures for the previous frame are only needed by the
+	 * effects, so they're freed or recreated along with the mode */
+	mode = source->deinterlace_mode;
+	if (mode != OBS_DEINTERLACE_MODE_DISABLE)
+		disable_deinterlacing(source);
+
+	source->deinterlace_cpu = cpu;
+
+	if (mode != OBS_DEINTERLACE_MODE_DISABLE)
+		enable_deinterlacing(source, mode);
+}
+
+bool obs_source_get_deinterlace_cpu(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_deinterlace_cpu")
+		       ? source->deinterlace_cpu
+		       : false;
+}
@@ -0,0 +1,312 @@
+#include <inttypes.h>
+#include "media-io/video-frame.h"
+#include "obs-internal.h"
+
+/*
+ * Frames of the async frame caches of all sources are allocated from, and
+ * returned to, a single pool.  Free frames are bucketed by format and size,
+ * so a source that changes resolution or restarts can pick up frames that it
+ * or another source released earlier instead of allocating new ones.  Free
+ * frames are released once they have been unused for a while, and the least
+ * recently used ones are released early to keep the pool under its limit.
+ * Frame data is allocated as media buffers, so pooled frames must not be
+ * freed with obs_source_frame_destroy.  Frames the pool didn't create, such
+ * as frames filters create with obs_source_frame_create, are destroyed when
+ * they are released instead of being kept.
+ */
+
+#define DEFAULT_FRAME_POOL_LIMIT (512ULL * 1024 * 1024)
+#define MAX_IDLE_NS 5000000000ULL
+#define TRIM_INTERVAL_NS 1000000000ULL
+
+struct frame_bucket {
+	enum video_format format;
+	uint32_t width;
+	uint32_t height;
+	size_t frame_size;
+	uint64_t last_used;
+	DARRAY(struct obs_source_frame *) frames;
+};
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static struct {
+	DARRAY(struct frame_bucket) buckets;
+	uint64_t limit;
+	uint64_t idle_bytes;
+	uint64_t idle_frames;
+	uint64_t peak_idle_bytes;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t last_trim;
+} pool = {.limit = DEFAULT_FRAME_POOL_LIMIT};
+
+static inline uint32_t plane_height(enum video_format format, size_t plane,
+				    uint32_t height)
+{
+	bool half = plane == 1 || plane == 2;
+
+	switch (format) {
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_I40A:
+		return half ? height / 2 : height;
+	default:
+		return height;
+	}
+}
+
+static size_t get_frame_size(const struct obs_source_frame *frame)
+{
+	size_t size = 0;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		if (frame->data[i])
+			size += (size_t)frame->linesize[i] *
+				plane_height(frame->format, i, frame->height);
+	}
+
+	return size;
+}
+
+static struct obs_source_frame *create_frame(enum video_format format,
+					     uint32_t width, uint32_t height)
+{
+	struct obs_source_frame *frame = bzalloc(sizeof(*frame));
+	struct video_frame vid_frame;
+
+	video_frame_init_media(&vid_frame, format, width, height);
+	frame->format = format;
+	frame->width = width;
+	frame->height = height;
+	frame->pooled = true;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		frame->data[i] = vid_frame.data[i];
+		frame->linesize[i] = vid_frame.linesize[i];
+	}
+
+	return frame;
+}
+
+static void destroy_frame(struct obs_source_frame *frame)
+{
+	bfree_media(frame->data[0]);
+	bfree(frame);
+}
+
+static struct frame_bucket *find_bucket(enum video_format format,
+					uint32_t width, uint32_t height)
+{
+	for (size_t i = 0; i < pool.buckets.num; i++) {
+		struct frame_bucket *bucket = &pool.buckets.array[i];
+
+		if (bucket->format == format && bucket->width == width &&
+		    bucket->height == height)
+			return bucket;
+	}
+
+	return NULL;
+}
+
+static void evict_frame(struct frame_bucket *bucket)
+{
+	struct obs_source_frame *frame =
+		bucket->frames.array[bucket->frames.num - 1];
+
+	da_pop_back(bucket->frames);
+	destroy_frame(frame);
+
+	pool.idle_bytes -= bucket->frame_size;
+	pool.idle_frames--;
+	pool.evictions++;
+}
+
+static void remove_empty_buckets(void)
+{
+	for (size_t i = pool.buckets.num; i > 0; i--) {
+		struct frame_bucket *bucket = &pool.buckets.array[i - 1];
+
+		if (!bucket->frames.num) {
+			da_free(bucket->frames);
+			da_erase(pool.buckets, i - 1);
+		}
+	}
+}
+
+static struct frame_bucket *get_lru_bucket(void)
+{
+	struct frame_bucket *lru = NULL;
+
+	for (size_t i = 0; i < pool.buckets.num; i++) {
+		struct frame_bucket *bucket = &pool.buckets.array[i];
+
+		if (bucket->frames.num &&
+		    (!lru || bucket->last_used < lru->last_used))
+			lru = bucket;
+	}
+
+	return lru;
+}
+
+static void trim_pool(void)
+{
+	uint64_t now = os_gettime_ns();
+	struct frame_bucket *lru;
+
+	pool.last_trim = now;
+
+	for (size_t i = 0; i < pool.buckets.num; i++) {
+		struct frame_bucket *bucket = &pool.buckets.array[i];
+
+		if (now - bucket->last_used < MAX_IDLE_NS)
+			continue;
+
+		while (bucket->frames.num)
+			evict_frame(bucket);
+	}
+
+	while (pool.idle_bytes > pool.limit && (lru = get_lru_bucket()))
+		evict_frame(lru);
+
+	remove_empty_buckets();
+}
+
+struct obs_source_frame *frame_pool_acquire(enum video_format format,
+					    uint32_t width, uint32_t height)
+{
+	struct obs_source_frame *frame = NULL;
+	struct frame_bucket *bucket;
+
+	pthread_mutex_lock(&pool_mutex);
+
+	bucket = find_bucket(format, width, height);
+	if (bucket && bucket->frames.num) {
+		frame = bucket->frames.array[bucket->frames.num - 1];
+		da_pop_back(bucket->frames);
+
+		bucket->last_used = os_gettime_ns();
+		pool.idle_bytes -= bucket->frame_size;
+		pool.idle_frames--;
+		pool.hits++;
+	} else {
+		pool.misses++;
+	}
+
+	trim_pool();
+
+	pthread_mutex_unlock(&pool_mutex);
+
+	if (frame) {
+		frame->refs = 0;
+		frame->prev_frame = false;
+	} else {
+		frame = create_frame(format, width, height);
+	}
+
+	return frame;
+}
+
+void frame_pool_release(struct obs_source_frame *frame)
+{
+	struct frame_bucket *bucket;
+
+	if (!frame)
+		return;
+
+	if (!frame->pooled) {
+		obs_source_frame_destroy(frame);
+		return;
+	}
+
+	pthread_mutex_lock(&pool_mutex);
+
+	bucket = find_bucket(frame->format, frame->width, frame->height);
+	if (!bucket) {
+		bucket = da_push_back_new(pool.buckets);
+		bucket->format = frame->format;
+		bucket->width = frame->width;
+		bucket->height = frame->height;
+		bucket->frame_size = get_frame_size(frame);
+	}
+
+	da_push_back(bucket->frames, &frame);
+	bucket->last_used = os_gettime_ns();
+
+	pool.idle_bytes += bucket->frame_size;
+	pool.idle_frames++;
+	if (pool.idle_bytes > pool.peak_idle_bytes)
+		pool.peak_idle_bytes = pool.idle_bytes;
+
+	trim_pool();
+
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+/* Called once per video frame, so that frames are released once they have
+ * been idle for a while even if no source acquires or releases frames */
+void frame_pool_tick(void)
+{
+	uint64_t now = os_gettime_ns();
+
+	pthread_mutex_lock(&pool_mutex);
+	if (pool.idle_frames && now - pool.last_trim >= TRIM_INTERVAL_NS)
+		trim_pool();
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void free_frame_pool(void)
+{
+	pthread_mutex_lock(&pool_mutex);
+
+	if (pool.hits || pool.misses)
+		blog(LOG_INFO,
+		     "Async frame pool: %" PRIu64 " hits, %" PRIu64
+		     " misses, %" PRIu64 " evictions, peak %" PRIu64
+		     " MB idle",
+		     pool.hits, pool.misses, pool.evictions,
+		     pool.peak_idle_bytes / (1024 * 1024));
+
+	for (size_t i = 0; i < pool.buckets.num; i++) {
+		struct frame_bucket *bucket = &pool.buckets.array[i];
+
+		for (size_t j = 0; j < bucket->frames.num; j++)
+			destroy_frame(bucket->frames.array[j]);
+		da_free(bucket->frames);
+	}
+
+	da_free(pool.buckets);
+	pool.idle_bytes = 0;
+	pool.idle_frames = 0;
+	pool.peak_idle_bytes = 0;
+	pool.hits = 0;
+	pool.misses = 0;
+	pool.evictions = 0;
+
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void obs_set_frame_pool_limit(uint64_t max_bytes)
+{
+	pthread_mutex_lock(&pool_mutex);
+	pool.limit = max_bytes;
+	trim_pool();
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void obs_get_frame_pool_stats(struct obs_frame_pool_stats *stats)
+{
+	if (!obs_ptr_valid(stats, "obs_get_frame_pool_stats"))
+		return;
+
+	pthread_mutex_lock(&pool_mutex);
+	stats->limit = pool.limit;
+	stats->idle_bytes = pool.idle_bytes;
+	stats->idle_frames = pool.idle_frames;
+	stats->peak_idle_bytes = pool.peak_idle_bytes;
+	stats->hits = pool.hits;
+	stats->misses = pool.misses;
+	stats->evictions = pool.evictions;
+	pthread_mutex_unlock(&pool_mutex);
+}
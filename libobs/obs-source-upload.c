@@ -0,0 +1,211 @@
+#include "obs-internal.h"
+
+/*
+ * Async frames are copied into their textures by a small pool of worker
+ * threads.  The textures are mapped on the graphics thread while sources are
+ * ticked, the copies then run while the rest of the sources tick and the
+ * scene starts rendering, and the textures are only unmapped when the source
+ * is actually drawn.
+ */
+
+struct async_upload {
+	struct obs_source_frame *frame;
+	gs_texture_t *tex[MAX_AV_PLANES];
+	uint8_t *ptr[MAX_AV_PLANES];
+	uint32_t linesize[MAX_AV_PLANES];
+	uint32_t height[MAX_AV_PLANES];
+	os_event_t *done;
+	uint64_t copy_ns;
+	bool pending;
+};
+
+static void copy_plane(uint8_t *dst, uint32_t dst_linesize, const uint8_t *src,
+		       uint32_t src_linesize, uint32_t height)
+{
+	size_t row_copy = (src_linesize < dst_linesize) ? src_linesize
+							: dst_linesize;
+
+	if (src_linesize == dst_linesize) {
+		memcpy(dst, src, row_copy * height);
+	} else {
+		uint8_t *const end = dst + (size_t)height * dst_linesize;
+		while (dst < end) {
+			memcpy(dst, src, row_copy);
+			dst += dst_linesize;
+			src += src_linesize;
+		}
+	}
+}
+
+static void copy_frame(struct async_upload *upload)
+{
+	const struct obs_source_frame *frame = upload->frame;
+	uint64_t start = os_gettime_ns();
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		if (upload->ptr[c])
+			copy_plane(upload->ptr[c], upload->linesize[c],
+				   frame->data[c], frame->linesize[c],
+				   upload->height[c]);
+	}
+
+	upload->copy_ns = os_gettime_ns() - start;
+}
+
+static void *async_upload_thread(void *unused)
+{
+	struct obs_core_video *video = &obs->video;
+
+	os_set_thread_name("obs async upload thread");
+
+	/* the semaphore is posted once per queued upload, and once per
+	 * thread when stopping, so the queue is always drained first */
+	while (os_sem_wait(video->upload_semaphore) == 0) {
+		struct async_upload *upload = NULL;
+
+		pthread_mutex_lock(&video->upload_mutex);
+		if (video->upload_queue.size)
+			circlebuf_pop_front(&video->upload_queue, &upload,
+					    sizeof(upload));
+		pthread_mutex_unlock(&video->upload_mutex);
+
+		if (!upload)
+			break;
+
+		copy_frame(upload);
+		os_event_signal(upload->done);
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+bool init_async_upload(struct obs_core_video *video)
+{
+	if (pthread_mutex_init(&video->upload_mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&video->upload_semaphore, 0) != 0) {
+		pthread_mutex_destroy(&video->upload_mutex);
+		return false;
+	}
+
+	for (size_t i = 0; i < NUM_ASYNC_UPLOAD_THREADS; i++) {
+		if (pthread_create(&video->upload_threads[i], NULL,
+				   async_upload_thread, NULL) != 0) {
+			blog(LOG_WARNING, "Failed to create async upload "
+					  "thread, uploading frames on the "
+					  "graphics thread");
+			break;
+		}
+		video->upload_thread_count++;
+	}
+
+	if (!video->upload_thread_count) {
+		os_sem_destroy(video->upload_semaphore);
+		video->upload_semaphore = NULL;
+		pthread_mutex_destroy(&video->upload_mutex);
+		return false;
+	}
+
+	return true;
+}
+
+void free_async_upload(struct obs_core_video *video)
+{
+	if (!video->upload_thread_count)
+		return;
+
+	for (size_t i = 0; i < video->upload_thread_count; i++)
+		os_sem_post(video->upload_semaphore);
+	for (size_t i = 0; i < video->upload_thread_count; i++)
+		pthread_join(video->upload_threads[i], NULL);
+
+	video->upload_thread_count = 0;
+
+	os_sem_destroy(video->upload_semaphore);
+	video->upload_semaphore = NULL;
+	pthread_mutex_destroy(&video->upload_mutex);
+	circlebuf_free(&video->upload_queue);
+}
+
+bool async_upload_begin(obs_source_t *source, struct obs_source_frame *frame,
+			gs_texture_t *tex[MAX_AV_PLANES])
+{
+	struct obs_core_video *video = &obs->video;
+	struct async_upload *upload = source->async_upload;
+
+	if (!video->upload_thread_count)
+		return false;
+
+	if (!upload) {
+		upload = bzalloc(sizeof(*upload));
+		if (os_event_init(&upload->done, OS_EVENT_TYPE_MANUAL) != 0) {
+			bfree(upload);
+			return false;
+		}
+		source->async_upload = upload;
+	}
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		upload->tex[c] = NULL;
+		upload->ptr[c] = NULL;
+
+		if (!tex[c] || !frame->data[c])
+			continue;
+
+		if (!gs_texture_map(tex[c], &upload->ptr[c],
+				    &upload->linesize[c])) {
+			for (size_t i = 0; i < c; i++) {
+				if (upload->tex[i])
+					gs_texture_unmap(upload->tex[i]);
+			}
+			return false;
+		}
+
+		upload->tex[c] = tex[c];
+		upload->height[c] = gs_texture_get_height(tex[c]);
+	}
+
+	upload->frame = frame;
+	upload->pending = true;
+	os_event_reset(upload->done);
+
+	pthread_mutex_lock(&video->upload_mutex);
+	circlebuf_push_back(&video->upload_queue, &upload, sizeof(upload));
+	pthread_mutex_unlock(&video->upload_mutex);
+
+	os_sem_post(video->upload_semaphore);
+	return true;
+}
+
+bool async_upload_pending(const obs_source_t *source)
+{
+	return source->async_upload && source->async_upload->pending;
+}
+
+struct obs_source_frame *async_upload_end(obs_source_t *source)
+{
+	struct async_upload *upload = source->async_upload;
+
+	if (!upload || !upload->pending)
+		return NULL;
+
+	os_event_wait(upload->done);
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		if (upload->tex[c])
+			gs_texture_unmap(upload->tex[c]);
+	}
+
+	upload->pending = false;
+	source->async_upload_time_ns = upload->copy_ns;
+	return upload->frame;
+}
+
+void async_upload_destroy(struct async_upload *upload)
+{
+	if (upload) {
+		os_event_destroy(upload->done);
+		bfree(upload);
+	}
+}
@@ -38,10 +38,17 @@ static inline bool data_valid(const struct obs_source *source, const char *f)
 
 static inline bool deinterlacing_enabled(const struct obs_source *source)
 {
-	return source->deinterlace_mode != OBS_DEINTERLACE_MODE_DISABLE;
+	return source->deinterlace_mode != OBS_DEINTERLACE_MODE_DISABLE &&
+	       !source->deinterlace_cpu;
 }
 
-struct obs_source_info *get_source_info(const char *id)
+static inline bool deinterlacing_on_cpu(const struct obs_source *source)
+{
+	return source->deinterlace_mode != OBS_DEINTERLACE_MODE_DISABLE &&
+	       source->deinterlace_cpu;
+}
+
+static struct obs_source_info *find_registered_source(const char *id)
 {
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *info = &obs->source_types.array[i];
@@ -52,6 +59,16 @@ struct obs_source_info *get_source_info(const char *id)
 	return NULL;
 }
 
+struct obs_source_info *get_source_info(const char *id)
+{
+	struct obs_source_info *info = find_registered_source(id);
+
+	if (!info && obs_load_deferred_module_for(id))
+		info = find_registered_source(id);
+
+	return info;
+}
+
 struct obs_source_info *get_source_info2(const char *unversioned_id,
 					 uint32_t ver)
 {
@@ -575,7 +592,7 @@ void obs_source_frame_init(struct obs_source_frame *frame,
 static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 {
 	if (os_atomic_dec_long(&frame->refs) == 0)
-		obs_source_frame_destroy(frame);
+		frame_pool_release(frame);
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source,
@@ -624,6 +641,15 @@ void obs_source_destroy(struct obs_source *source)
 	obs_hotkey_unregister(source->push_to_mute_key);
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
+	/* only sources that uploaded async frames can have one in flight */
+	if (source->async_upload) {
+		gs_enter_context(obs->video.graphics);
+		obs_source_release_frame(source, async_upload_end(source));
+		gs_leave_context();
+		async_upload_destroy(source->async_upload);
+	}
+	deinterlace_cpu_destroy(source->deinterlace_cpu_state);
+
 	for (i = 0; i < source->async_cache.num; i++)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
 
@@ -1062,11 +1088,19 @@ static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 							 uint64_t sys_time);
 bool set_async_texture_size(struct obs_source *source,
 			    const struct obs_source_frame *frame);
+static void finish_async_upload(obs_source_t *source);
 
 static void async_tick(obs_source_t *source)
 {
 	uint64_t sys_time = obs->video.video_time;
 
+	/* the source was staged but not drawn last frame */
+	if (async_upload_pending(source)) {
+		gs_enter_context(obs->video.graphics);
+		finish_async_upload(source);
+		gs_leave_context();
+	}
+
 	pthread_mutex_lock(&source->async_mutex);
 
 	if (deinterlacing_enabled(source)) {
@@ -1837,36 +1871,36 @@ static const char *select_conversion_technique(enum video_format format,
 	return NULL;
 }
 
-static inline void set_eparam(gs_effect_t *effect, const char *name, float val)
+static gs_technique_t *get_conversion_technique(enum video_format format,
+						bool full_range)
 {
-	gs_eparam_t *param = gs_effect_get_param_by_name(effect, name);
-	gs_effect_set_float(param, val);
-}
+	struct obs_conversion_params *conv = &obs->video.conversion_params;
+	gs_technique_t **tech = &conv->async_techs[format][full_range];
 
-static inline void set_eparami(gs_effect_t *effect, const char *name, int val)
-{
-	gs_eparam_t *param = gs_effect_get_param_by_name(effect, name);
-	gs_effect_set_int(param, val);
+	if (!*tech)
+		*tech = gs_effect_get_technique(
+			obs->video.conversion_effect,
+			select_conversion_technique(format, full_range));
+
+	return *tech;
 }
 
-static bool update_async_texrender(struct obs_source *source,
-				   const struct obs_source_frame *frame,
-				   gs_texture_t *tex[MAX_AV_PLANES],
-				   gs_texrender_t *texrender)
+static bool convert_async_frame(struct obs_source *source,
+				const struct obs_source_frame *frame,
+				gs_texture_t *tex[MAX_AV_PLANES],
+				gs_texrender_t *texrender)
 {
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_CONVERT_FORMAT, "Convert Format");
 
 	gs_texrender_reset(texrender);
 
-	upload_raw_frame(tex, frame);
-
 	uint32_t cx = source->async_width;
 	uint32_t cy = source->async_height;
 
-	gs_effect_t *conv = obs->video.conversion_effect;
-	const char *tech_name =
-		select_conversion_technique(frame->format, frame->full_range);
-	gs_technique_t *tech = gs_effect_get_technique(conv, tech_name);
+	const struct obs_conversion_params *conv =
+		&obs->video.conversion_params;
+	gs_technique_t *tech =
+		get_conversion_technique(frame->format, frame->full_range);
 
 	const bool success = gs_texrender_begin(texrender, cx, cy);
 
@@ -1876,27 +1910,15 @@ static bool update_async_texrender(struct obs_source *source,
 		gs_technique_begin(tech);
 		gs_technique_begin_pass(tech, 0);
 
-		if (tex[0])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image"),
-				tex[0]);
-		if (tex[1])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image1"),
-				tex[1]);
-		if (tex[2])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image2"),
-				tex[2]);
-		if (tex[3])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image3"),
-				tex[3]);
-		set_eparam(conv, "width", (float)cx);
-		set_eparam(conv, "height", (float)cy);
-		set_eparam(conv, "width_d2", (float)cx * 0.5f);
-		set_eparam(conv, "height_d2", (float)cy * 0.5f);
-		set_eparam(conv, "width_x2_i", 0.5f / (float)cx);
+		for (size_t i = 0; i < 4; i++) {
+			if (tex[i])
+				gs_effect_set_texture(conv->image[i], tex[i]);
+		}
+		gs_effect_set_float(conv->width, (float)cx);
+		gs_effect_set_float(conv->height, (float)cy);
+		gs_effect_set_float(conv->width_d2, (float)cx * 0.5f);
+		gs_effect_set_float(conv->height_d2, (float)cy * 0.5f);
+		gs_effect_set_float(conv->width_x2_i, 0.5f / (float)cx);
 
 		struct vec4 vec0, vec1, vec2;
 		vec4_set(&vec0, frame->color_matrix[0], frame->color_matrix[1],
@@ -1905,20 +1927,15 @@ static bool update_async_texrender(struct obs_source *source,
 			 frame->color_matrix[6], frame->color_matrix[7]);
 		vec4_set(&vec2, frame->color_matrix[8], frame->color_matrix[9],
 			 frame->color_matrix[10], frame->color_matrix[11]);
-		gs_effect_set_vec4(
-			gs_effect_get_param_by_name(conv, "color_vec0"), &vec0);
-		gs_effect_set_vec4(
-			gs_effect_get_param_by_name(conv, "color_vec1"), &vec1);
-		gs_effect_set_vec4(
-			gs_effect_get_param_by_name(conv, "color_vec2"), &vec2);
+		gs_effect_set_vec4(conv->color_vec[0], &vec0);
+		gs_effect_set_vec4(conv->color_vec[1], &vec1);
+		gs_effect_set_vec4(conv->color_vec[2], &vec2);
 		if (!frame->full_range) {
-			gs_eparam_t *min_param = gs_effect_get_param_by_name(
-				conv, "color_range_min");
-			gs_effect_set_val(min_param, frame->color_range_min,
+			gs_effect_set_val(conv->color_range_min,
+					  frame->color_range_min,
 					  sizeof(float) * 3);
-			gs_eparam_t *max_param = gs_effect_get_param_by_name(
-				conv, "color_range_max");
-			gs_effect_set_val(max_param, frame->color_range_max,
+			gs_effect_set_val(conv->color_range_max,
+					  frame->color_range_max,
 					  sizeof(float) * 3);
 		}
 
@@ -1936,6 +1953,15 @@ static bool update_async_texrender(struct obs_source *source,
 	return success;
 }
 
+static bool update_async_texrender(struct obs_source *source,
+				   const struct obs_source_frame *frame,
+				   gs_texture_t *tex[MAX_AV_PLANES],
+				   gs_texrender_t *texrender)
+{
+	upload_raw_frame(tex, frame);
+	return convert_async_frame(source, frame, tex, texrender);
+}
+
 bool update_async_texture(struct obs_source *source,
 			  const struct obs_source_frame *frame,
 			  gs_texture_t *tex, gs_texrender_t *texrender)
@@ -1976,7 +2002,7 @@ static inline void obs_source_draw_texture(struct obs_source *source,
 	if (source->async_texrender)
 		tex = gs_texrender_get_texture(source->async_texrender);
 
-	param = gs_effect_get_param_by_name(effect, "image");
+	param = gs_effect_get_image_param(effect);
 	gs_effect_set_texture(param, tex);
 
 	gs_draw_sprite(tex, source->async_flip ? GS_FLIP_V : 0, 0, 0);
@@ -1990,7 +2016,7 @@ static void obs_source_draw_async_texture(struct obs_source *source)
 
 	if (def_draw) {
 		effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
-		tech = gs_effect_get_technique(effect, "Draw");
+		tech = gs_effect_get_draw_technique(effect);
 		gs_technique_begin(tech);
 		gs_technique_begin_pass(tech, 0);
 	}
@@ -2025,29 +2051,86 @@ static inline void check_to_swap_bgrx_bgra(obs_source_t *source,
 	}
 }
 
-static void obs_source_update_async_video(obs_source_t *source)
+static struct obs_source_frame *get_async_video(obs_source_t *source)
 {
-	if (!source->async_rendered) {
-		struct obs_source_frame *frame = obs_source_get_frame(source);
+	struct obs_source_frame *frame = obs_source_get_frame(source);
 
-		if (frame)
-			frame = filter_async_video(source, frame);
+	if (frame)
+		frame = filter_async_video(source, frame);
 
-		source->async_rendered = true;
-		if (frame) {
-			check_to_swap_bgrx_bgra(source, frame);
+	source->async_rendered = true;
+	if (frame) {
+		check_to_swap_bgrx_bgra(source, frame);
 
-			if (!source->async_decoupled ||
-			    !source->async_unbuffered) {
-				source->timing_adjust = obs->video.video_time -
-							frame->timestamp;
-				source->timing_set = true;
-			}
+		if (!source->async_decoupled || !source->async_unbuffered) {
+			source->timing_adjust =
+				obs->video.video_time - frame->timestamp;
+			source->timing_set = true;
+		}
+	}
+
+	return frame;
+}
+
+/* Called from the tick with the graphics context entered.  Maps the async
+ * textures of showing sources and queues the new frame to be copied into them
+ * on the upload threads, so that drawing the source only has to wait for a
+ * copy that has most likely finished already. */
+void obs_source_stage_async_video(obs_source_t *source)
+{
+	struct obs_source_frame *frame;
+
+	if (source->info.type != OBS_SOURCE_TYPE_INPUT ||
+	    (source->info.output_flags & OBS_SOURCE_ASYNC) == 0 ||
+	    !source->showing || source->async_rendered ||
+	    !source->async_update_texture || !source->async_textures[0] ||
+	    deinterlacing_enabled(source) || !obs->video.upload_thread_count)
+		return;
 
+	frame = get_async_video(source);
+	if (!frame)
+		return;
+
+	source->async_update_texture = false;
+
+	if (!async_upload_begin(source, frame, source->async_textures)) {
+		uint64_t start = os_gettime_ns();
+		update_async_textures(source, frame, source->async_textures,
+				      source->async_texrender);
+		source->async_upload_time_ns = os_gettime_ns() - start;
+		obs_source_release_frame(source, frame);
+	}
+}
+
+static void finish_async_upload(obs_source_t *source)
+{
+	struct obs_source_frame *frame = async_upload_end(source);
+	if (!frame)
+		return;
+
+	source->async_flip = frame->flip;
+	if (source->async_gpu_conversion && source->async_texrender)
+		convert_async_frame(source, frame, source->async_textures,
+				    source->async_texrender);
+
+	obs_source_release_frame(source, frame);
+}
+
+static void obs_source_update_async_video(obs_source_t *source)
+{
+	finish_async_upload(source);
+
+	if (!source->async_rendered) {
+		struct obs_source_frame *frame = get_async_video(source);
+
+		if (frame) {
 			if (source->async_update_texture) {
+				uint64_t start = os_gettime_ns();
 				update_async_textures(source, frame,
 						      source->async_textures,
 						      source->async_texrender);
+				source->async_upload_time_ns =
+					os_gettime_ns() - start;
 				source->async_update_texture = false;
 			}
 
@@ -2112,7 +2195,7 @@ static inline void obs_source_render_filters(obs_source_t *source)
 void obs_source_default_render(obs_source_t *source)
 {
 	gs_effect_t *effect = obs->video.default_effect;
-	gs_technique_t *tech = gs_effect_get_technique(effect, "Draw");
+	gs_technique_t *tech = gs_effect_get_draw_technique(effect);
 	size_t passes, i;
 
 	passes = gs_technique_begin(tech);
@@ -2615,7 +2698,7 @@ static inline void copy_frame_data_plane(struct obs_source_frame *dst,
 	}
 }
 
-static void copy_frame_data(struct obs_source_frame *dst,
+static void copy_frame_info(struct obs_source_frame *dst,
 			    const struct obs_source_frame *src)
 {
 	dst->flip = src->flip;
@@ -2627,6 +2710,12 @@ static void copy_frame_data(struct obs_source_frame *dst,
 		memcpy(dst->color_range_min, src->color_range_min, size);
 		memcpy(dst->color_range_max, src->color_range_max, size);
 	}
+}
+
+static void copy_frame_data(struct obs_source_frame *dst,
+			    const struct obs_source_frame *src)
+{
+	copy_frame_info(dst, src);
 
 	switch (src->format) {
 	case VIDEO_FORMAT_I420:
@@ -2708,15 +2797,15 @@ static inline void free_async_cache(struct obs_source *source)
 
 #define MAX_UNUSED_FRAME_DURATION 5
 
-/* frees frame allocations if they haven't been used for a specific period
- * of time */
+/* returns frame allocations to the frame pool if they haven't been used for a
+ * specific period of time */
 static void clean_cache(obs_source_t *source)
 {
 	for (size_t i = source->async_cache.num; i > 0; i--) {
 		struct async_frame *af = &source->async_cache.array[i - 1];
-		if (!af->used) {
+		if (!af->used && !af->shared) {
 			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
+				frame_pool_release(af->frame);
 				da_erase(source->async_cache, i - 1);
 			}
 		}
@@ -2724,7 +2813,7 @@ static void clean_cache(obs_source_t *source)
 }
 
 #define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
+//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && frame_pool_release(output)
 static inline struct obs_source_frame *
 cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 {
@@ -2751,7 +2840,7 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
-		if (!af->used) {
+		if (!af->used && !af->shared) {
 			new_frame = af->frame;
 			new_frame->format = format;
 			af->used = true;
@@ -2765,10 +2854,11 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 	if (!new_frame) {
 		struct async_frame new_af;
 
-		new_frame = obs_source_frame_create(format, frame->width,
-						    frame->height);
+		new_frame = frame_pool_acquire(format, frame->width,
+					       frame->height);
 		new_af.frame = new_frame;
 		new_af.used = true;
+		new_af.shared = false;
 		new_af.unused_count = 0;
 		new_frame->refs = 1;
 
@@ -2779,7 +2869,12 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 
 	pthread_mutex_unlock(&source->async_mutex);
 
-	copy_frame_data(new_frame, frame);
+	if (deinterlacing_on_cpu(source)) {
+		copy_frame_info(new_frame, frame);
+		deinterlace_cpu_frame(source, new_frame, frame);
+	} else {
+		copy_frame_data(new_frame, frame);
+	}
 
 	return new_frame;
 }
@@ -2803,7 +2898,7 @@ obs_source_output_video_internal(obs_source_t *source,
 	pthread_mutex_lock(&source->async_mutex);
 	if (output) {
 		if (os_atomic_dec_long(&output->refs) == 0) {
-			obs_source_frame_destroy(output);
+			frame_pool_release(output);
 			output = NULL;
 		} else {
 			da_push_back(source->async_frames, &output);
@@ -2862,6 +2957,90 @@ void obs_source_output_video2(obs_source_t *source,
 	obs_source_output_video_internal(source, &new_frame);
 }
 
+struct obs_source_frame *
+obs_source_frame_create_shared(const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *shared;
+
+	if (!obs_ptr_valid(frame, "obs_source_frame_create_shared"))
+		return NULL;
+
+	shared = frame_pool_acquire(frame->format, frame->width,
+				    frame->height);
+	copy_frame_data(shared, frame);
+	shared->full_range = format_is_yuv(frame->format) ? frame->full_range
+							 : true;
+	shared->refs = 1;
+	return shared;
+}
+
+static bool can_share_frames(obs_source_t *source)
+{
+	bool share = source->deinterlace_mode == OBS_DEINTERLACE_MODE_DISABLE;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; share && i < source->filters.num; i++) {
+		if (source->filters.array[i]->info.filter_video)
+			share = false;
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return share;
+}
+
+void obs_source_output_shared_video(obs_source_t *source,
+				    struct obs_source_frame *frame)
+{
+	struct async_frame af = {0};
+
+	if (!obs_source_valid(source, "obs_source_output_shared_video"))
+		return;
+	if (!obs_ptr_valid(frame, "obs_source_output_shared_video"))
+		return;
+
+	if (!can_share_frames(source)) {
+		obs_source_output_video_internal(source, frame);
+		return;
+	}
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
+		free_async_cache(source);
+		source->last_frame_ts = 0;
+		pthread_mutex_unlock(&source->async_mutex);
+		return;
+	}
+
+	if (async_texture_changed(source, frame)) {
+		free_async_cache(source);
+		source->async_cache_width = frame->width;
+		source->async_cache_height = frame->height;
+	}
+
+	source->async_cache_format = frame->format;
+	source->async_cache_full_range = frame->full_range;
+
+	/* the cache entry holds the source's reference, like it does for
+	 * the frames the source copies itself */
+	af.frame = frame;
+	af.used = true;
+	af.shared = true;
+	os_atomic_inc_long(&frame->refs);
+	da_push_back(source->async_cache, &af);
+
+	da_push_back(source->async_frames, &frame);
+	source->async_active = true;
+
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
+void obs_source_frame_release_shared(struct obs_source_frame *frame)
+{
+	if (frame)
+		obs_source_frame_decref(frame);
+}
+
 void obs_source_set_async_rotation(obs_source_t *source, long rotation)
 {
 	if (source)
@@ -2890,13 +3069,22 @@ obs_source_preload_video_internal(obs_source_t *source,
 
 	obs_enter_graphics();
 
+	finish_async_upload(source);
+
 	if (preload_frame_changed(source, frame)) {
 		obs_source_frame_destroy(source->async_preload_frame);
 		source->async_preload_frame = obs_source_frame_create(
 			frame->format, frame->width, frame->height);
 	}
 
-	copy_frame_data(source->async_preload_frame, frame);
+	if (deinterlacing_on_cpu(source)) {
+		copy_frame_info(source->async_preload_frame, frame);
+		deinterlace_cpu_frame(source, source->async_preload_frame,
+				      frame);
+	} else {
+		copy_frame_data(source->async_preload_frame, frame);
+	}
+
 	set_async_texture_size(source, source->async_preload_frame);
 	update_async_textures(source, source->async_preload_frame,
 			      source->async_textures, source->async_texrender);
@@ -3190,7 +3378,12 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
-			f->used = false;
+			if (f->shared) {
+				da_erase(source->async_cache, i);
+				obs_source_frame_decref(frame);
+			} else {
+				f->used = false;
+			}
 			break;
 		}
 	}
@@ -3341,12 +3534,12 @@ void obs_source_release_frame(obs_source_t *source,
 		return;
 
 	if (!source) {
-		obs_source_frame_destroy(frame);
+		frame_pool_release(frame);
 	} else {
 		pthread_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			frame_pool_release(frame);
 		else
 			remove_async_frame(source, frame);
 
@@ -3405,11 +3598,23 @@ const char *obs_source_get_unversioned_id(const obs_source_t *source)
 		       : NULL;
 }
 
+/* filters almost always draw with "Draw", which the effect resolves when it's
+ * created, so only other techniques are looked up by name */
+static inline gs_technique_t *get_filter_technique(gs_effect_t *effect,
+						   const char *tech_name)
+{
+	gs_technique_t *tech = gs_effect_get_draw_technique(effect);
+
+	if (!tech || strcmp(tech_name, "Draw") != 0)
+		tech = gs_effect_get_technique(effect, tech_name);
+	return tech;
+}
+
 static inline void render_filter_bypass(obs_source_t *target,
 					gs_effect_t *effect,
 					const char *tech_name)
 {
-	gs_technique_t *tech = gs_effect_get_technique(effect, tech_name);
+	gs_technique_t *tech = get_filter_technique(effect, tech_name);
 	size_t passes, i;
 
 	passes = gs_technique_begin(tech);
@@ -3425,8 +3630,8 @@ static inline void render_filter_tex(gs_texture_t *tex, gs_effect_t *effect,
 				     uint32_t width, uint32_t height,
 				     const char *tech_name)
 {
-	gs_technique_t *tech = gs_effect_get_technique(effect, tech_name);
-	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_technique_t *tech = get_filter_technique(effect, tech_name);
+	gs_eparam_t *image = gs_effect_get_image_param(effect);
 	size_t passes, i;
 
 	gs_effect_set_texture(image, tex);
@@ -3993,9 +4198,17 @@ void obs_source_draw_set_color_matrix(const struct matrix4 *color_matrix,
 	if (!color_range_max)
 		color_range_max = &color_range_max_def;
 
-	matrix = gs_effect_get_param_by_name(effect, "color_matrix");
-	range_min = gs_effect_get_param_by_name(effect, "color_range_min");
-	range_max = gs_effect_get_param_by_name(effect, "color_range_max");
+	if (effect == obs->video.default_effect) {
+		matrix = obs->video.default_color_matrix;
+		range_min = obs->video.default_color_range_min;
+		range_max = obs->video.default_color_range_max;
+	} else {
+		matrix = gs_effect_get_param_by_name(effect, "color_matrix");
+		range_min =
+			gs_effect_get_param_by_name(effect, "color_range_min");
+		range_max =
+			gs_effect_get_param_by_name(effect, "color_range_max");
+	}
 
 	gs_effect_set_matrix4(matrix, color_matrix);
 	gs_effect_set_val(range_min, color_range_min, sizeof(float) * 3);
@@ -4017,7 +4230,7 @@ void obs_source_draw(gs_texture_t *texture, int x, int y, uint32_t cx,
 	if (!obs_ptr_valid(texture, "obs_source_draw"))
 		return;
 
-	image = gs_effect_get_param_by_name(effect, "image");
+	image = gs_effect_get_image_param(effect);
 	gs_effect_set_texture(image, texture);
 
 	if (change_pos) {
@@ -4762,6 +4975,13 @@ bool obs_source_async_decoupled(const obs_source_t *source)
 		       : false;
 }
 
+uint64_t obs_source_get_async_upload_time(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_async_upload_time")
+		       ? source->async_upload_time_ns
+		       : 0;
+}
+
 /* hidden/undocumented export to allow source type redefinition for scripts */
 EXPORT void obs_enable_source_type(const char *name, bool enable)
 {
@@ -72,8 +72,29 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 		}
 	}
 
+	/* ------------------------------------- */
+	/* start copying new async frames        */
+
+	gs_enter_context(obs->video.graphics);
+
+	source = data->first_source;
+	while (source) {
+		struct obs_source *cur_source = obs_source_get_ref(source);
+		source = (struct obs_source *)source->context.next;
+
+		if (cur_source) {
+			obs_source_stage_async_video(cur_source);
+			obs_source_release(cur_source);
+		}
+	}
+
+	gs_leave_context();
+
 	pthread_mutex_unlock(&data->sources_mutex);
 
+	frame_pool_tick();
+	base_expire_media_pool();
+
 	return cur_time;
 }
 
@@ -217,26 +238,26 @@ static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
 	uint32_t height = gs_texture_get_height(target);
 
 	gs_effect_t *effect = get_scale_effect(video, width, height);
+	const struct obs_scale_effect *scale =
+		get_scale_effect_params(video, effect);
 	gs_technique_t *tech;
 
 	if (video->ovi.output_format == VIDEO_FORMAT_RGBA) {
-		tech = gs_effect_get_technique(effect, "DrawAlphaDivide");
+		tech = scale->draw_alpha_divide;
 	} else {
 		if ((effect == video->default_effect) &&
 		    (width == video->base_width) &&
 		    (height == video->base_height))
 			return texture;
 
-		tech = gs_effect_get_technique(effect, "Draw");
+		tech = gs_effect_get_draw_technique(effect);
 	}
 
 	profile_start(render_output_texture_name);
 
-	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
-	gs_eparam_t *bres =
-		gs_effect_get_param_by_name(effect, "base_dimension");
-	gs_eparam_t *bres_i =
-		gs_effect_get_param_by_name(effect, "base_dimension_i");
+	gs_eparam_t *image = gs_effect_get_image_param(effect);
+	gs_eparam_t *bres = scale->base_dimension;
+	gs_eparam_t *bres_i = scale->base_dimension_i;
 	size_t passes, i;
 
 	gs_set_render_target(target, NULL);
@@ -273,11 +294,8 @@ static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
 	return target;
 }
 
-static void render_convert_plane(gs_effect_t *effect, gs_texture_t *target,
-				 const char *tech_name)
+static void render_convert_plane(gs_texture_t *target, gs_technique_t *tech)
 {
-	gs_technique_t *tech = gs_effect_get_technique(effect, tech_name);
-
 	const uint32_t width = gs_texture_get_width(target);
 	const uint32_t height = gs_texture_get_height(target);
 
@@ -299,15 +317,12 @@ static void render_convert_texture(struct obs_core_video *video,
 {
 	profile_start(render_convert_texture_name);
 
-	gs_effect_t *effect = video->conversion_effect;
-	gs_eparam_t *color_vec0 =
-		gs_effect_get_param_by_name(effect, "color_vec0");
-	gs_eparam_t *color_vec1 =
-		gs_effect_get_param_by_name(effect, "color_vec1");
-	gs_eparam_t *color_vec2 =
-		gs_effect_get_param_by_name(effect, "color_vec2");
-	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
-	gs_eparam_t *width_i = gs_effect_get_param_by_name(effect, "width_i");
+	const struct obs_conversion_params *conv = &video->conversion_params;
+	gs_eparam_t *color_vec0 = conv->color_vec[0];
+	gs_eparam_t *color_vec1 = conv->color_vec[1];
+	gs_eparam_t *color_vec2 = conv->color_vec[2];
+	gs_eparam_t *image = conv->image[0];
+	gs_eparam_t *width_i = conv->width_i;
 
 	struct vec4 vec0, vec1, vec2;
 	vec4_set(&vec0, video->color_matrix[4], video->color_matrix[5],
@@ -322,8 +337,8 @@ static void render_convert_texture(struct obs_core_video *video,
 	if (video->convert_textures[0]) {
 		gs_effect_set_texture(image, texture);
 		gs_effect_set_vec4(color_vec0, &vec0);
-		render_convert_plane(effect, video->convert_textures[0],
-				     video->conversion_techs[0]);
+		render_convert_plane(video->convert_textures[0],
+				     video->conversion_tech_handles[0]);
 
 		if (video->convert_textures[1]) {
 			gs_effect_set_texture(image, texture);
@@ -331,8 +346,8 @@ static void render_convert_texture(struct obs_core_video *video,
 			if (!video->convert_textures[2])
 				gs_effect_set_vec4(color_vec2, &vec2);
 			gs_effect_set_float(width_i, video->conversion_width_i);
-			render_convert_plane(effect, video->convert_textures[1],
-					     video->conversion_techs[1]);
+			render_convert_plane(video->convert_textures[1],
+					     video->conversion_tech_handles[1]);
 
 			if (video->convert_textures[2]) {
 				gs_effect_set_texture(image, texture);
@@ -340,8 +355,8 @@ static void render_convert_texture(struct obs_core_video *video,
 				gs_effect_set_float(width_i,
 						    video->conversion_width_i);
 				render_convert_plane(
-					effect, video->convert_textures[2],
-					video->conversion_techs[2]);
+					video->convert_textures[2],
+					video->conversion_tech_handles[2]);
 			}
 		}
 	}
@@ -747,8 +762,8 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 {
 	struct obs_core_video *video = &obs->video;
 	int cur_texture = video->cur_texture;
-	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1
-					    : cur_texture - 1;
+	/* the oldest surface, staged num_textures - 1 frames ago */
+	int prev_texture = (cur_texture + 1) % video->num_textures;
 	struct video_data frame;
 	bool frame_ready = 0;
 
@@ -788,7 +803,7 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 		profile_end(output_frame_output_video_data_name);
 	}
 
-	if (++video->cur_texture == NUM_TEXTURES)
+	if (++video->cur_texture == video->num_textures)
 		video->cur_texture = 0;
 }
 
@@ -928,6 +943,7 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
 	uint64_t frame_start = os_gettime_ns();
 	uint64_t frame_time_ns;
+	uint64_t draw_calls;
 	bool raw_active = obs->video.raw_active > 0;
 #ifdef _WIN32
 	const bool gpu_active = obs->video.gpu_encoder_active > 0;
@@ -954,8 +970,12 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
 	gs_enter_context(obs->video.graphics);
 	gs_begin_frame();
+	draw_calls = gs_get_draw_call_count();
 	gs_leave_context();
 
+	context->draw_calls_total += draw_calls - context->last_draw_calls;
+	context->last_draw_calls = draw_calls;
+
 	profile_start(tick_sources_name);
 	context->last_time =
 		tick_sources(obs->video.video_time, context->last_time);
@@ -999,8 +1019,12 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 		obs->video.video_avg_frame_time_ns =
 			context->frame_time_total_ns /
 			(uint64_t)context->fps_total_frames;
+		obs->video.video_avg_draw_calls =
+			context->draw_calls_total /
+			(uint64_t)context->fps_total_frames;
 
 		context->frame_time_total_ns = 0;
+		context->draw_calls_total = 0;
 		context->fps_total_ns = 0;
 		context->fps_total_frames = 0;
 	}
@@ -1036,6 +1060,8 @@ void *obs_graphics_thread(void *param)
 	context.frame_time_total_ns = 0;
 	context.fps_total_ns = 0;
 	context.fps_total_frames = 0;
+	context.last_draw_calls = 0;
+	context.draw_calls_total = 0;
 	context.last_time = 0;
 #ifdef _WIN32
 	context.gpu_was_active = false;
@@ -81,6 +81,15 @@ static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
 
 	calc_gpu_conversion_sizes(ovi);
 
+	for (size_t i = 0; i < NUM_CHANNELS; i++) {
+		const char *tech = video->conversion_techs[i];
+
+		video->conversion_tech_handles[i] =
+			tech ? gs_effect_get_technique(video->conversion_effect,
+						       tech)
+			     : NULL;
+	}
+
 	video->using_nv12_tex = ovi->output_format == VIDEO_FORMAT_NV12
 					? gs_nv12_available()
 					: false;
@@ -203,7 +212,7 @@ static bool obs_init_textures(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (int i = 0; i < video->num_textures; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
 			video->copy_surfaces[i][0] =
@@ -258,6 +267,59 @@ gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file)
 	return *effect;
 }
 
+static void init_scale_effect(struct obs_scale_effect *scale,
+			      gs_effect_t *effect)
+{
+	scale->effect = effect;
+	scale->base_dimension =
+		gs_effect_get_param_by_name(effect, "base_dimension");
+	scale->base_dimension_i =
+		gs_effect_get_param_by_name(effect, "base_dimension_i");
+	scale->draw_upscale = gs_effect_get_technique(effect, "DrawUpscale");
+	scale->draw_alpha_divide =
+		gs_effect_get_technique(effect, "DrawAlphaDivide");
+}
+
+static void init_effect_params(struct obs_core_video *video)
+{
+	struct obs_conversion_params *conv = &video->conversion_params;
+	gs_effect_t *effect = video->conversion_effect;
+
+	init_scale_effect(&video->scale_effects[0], video->default_effect);
+	init_scale_effect(&video->scale_effects[1], video->bicubic_effect);
+	init_scale_effect(&video->scale_effects[2], video->lanczos_effect);
+	init_scale_effect(&video->scale_effects[3], video->area_effect);
+	init_scale_effect(&video->scale_effects[4],
+			  video->bilinear_lowres_effect);
+
+	video->default_color_matrix =
+		gs_effect_get_param_by_name(video->default_effect,
+					    "color_matrix");
+	video->default_color_range_min = gs_effect_get_param_by_name(
+		video->default_effect, "color_range_min");
+	video->default_color_range_max = gs_effect_get_param_by_name(
+		video->default_effect, "color_range_max");
+
+	memset(conv, 0, sizeof(*conv));
+	conv->image[0] = gs_effect_get_param_by_name(effect, "image");
+	conv->image[1] = gs_effect_get_param_by_name(effect, "image1");
+	conv->image[2] = gs_effect_get_param_by_name(effect, "image2");
+	conv->image[3] = gs_effect_get_param_by_name(effect, "image3");
+	conv->width = gs_effect_get_param_by_name(effect, "width");
+	conv->height = gs_effect_get_param_by_name(effect, "height");
+	conv->width_d2 = gs_effect_get_param_by_name(effect, "width_d2");
+	conv->height_d2 = gs_effect_get_param_by_name(effect, "height_d2");
+	conv->width_x2_i = gs_effect_get_param_by_name(effect, "width_x2_i");
+	conv->width_i = gs_effect_get_param_by_name(effect, "width_i");
+	conv->color_vec[0] = gs_effect_get_param_by_name(effect, "color_vec0");
+	conv->color_vec[1] = gs_effect_get_param_by_name(effect, "color_vec1");
+	conv->color_vec[2] = gs_effect_get_param_by_name(effect, "color_vec2");
+	conv->color_range_min =
+		gs_effect_get_param_by_name(effect, "color_range_min");
+	conv->color_range_max =
+		gs_effect_get_param_by_name(effect, "color_range_max");
+}
+
 static int obs_init_graphics(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
@@ -282,6 +344,9 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 
 	gs_enter_context(video->graphics);
 
+	if (video->program_cache_path)
+		gs_set_program_cache_path(video->program_cache_path);
+
 	char *filename = obs_find_data_file("default.effect");
 	video->default_effect = gs_effect_create_from_file(filename, NULL);
 	bfree(filename);
@@ -356,6 +421,9 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 	if (!video->point_sampler)
 		success = false;
 
+	if (success)
+		init_effect_params(video);
+
 	gs_leave_context();
 	return success ? OBS_VIDEO_SUCCESS : OBS_VIDEO_FAIL;
 }
@@ -396,6 +464,7 @@ static int obs_init_video(struct obs_video_info *ovi)
 	video->output_height = ovi->output_height;
 	video->gpu_conversion = ovi->gpu_conversion;
 	video->scale_type = ovi->scale_type;
+	video->num_textures = (int)video->readback_depth;
 
 	set_video_matrix(video, ovi);
 
@@ -429,6 +498,8 @@ static int obs_init_video(struct obs_video_info *ovi)
 	if (pthread_mutex_init(&video->task_mutex, NULL) < 0)
 		return OBS_VIDEO_FAIL;
 
+	init_async_upload(video);
+
 #ifdef __APPLE__
 	errorcode = pthread_create(&video->video_thread, NULL,
 				   obs_graphics_thread_autorelease, obs);
@@ -456,6 +527,8 @@ static void stop_video(void)
 			video->thread_initialized = false;
 		}
 	}
+
+	free_async_upload(video);
 }
 
 static void obs_free_video(void)
@@ -479,7 +552,7 @@ static void obs_free_video(void)
 			}
 		}
 
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < MAX_TEXTURES; i++) {
 			for (size_t c = 0; c < NUM_CHANNELS; c++) {
 				if (video->copy_surfaces[i][c]) {
 					gs_stagesurface_destroy(
@@ -498,7 +571,7 @@ static void obs_free_video(void)
 			}
 		}
 
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < MAX_TEXTURES; i++) {
 			for (size_t c = 0; c < NUM_CHANNELS; c++) {
 				if (video->copy_surfaces[i][c]) {
 					gs_stagesurface_destroy(
@@ -557,6 +630,9 @@ static void obs_free_graphics(void)
 		gs_effect_destroy(video->area_effect);
 		gs_effect_destroy(video->bilinear_lowres_effect);
 		video->default_effect = NULL;
+		memset(video->scale_effects, 0, sizeof(video->scale_effects));
+		memset(&video->conversion_params, 0,
+		       sizeof(video->conversion_params));
 
 		gs_leave_context();
 
@@ -585,6 +661,7 @@ static bool obs_init_audio(struct audio_output_info *ai)
 
 	audio->monitoring_device_name = bstrdup("Default");
 	audio->monitoring_device_id = bstrdup("default");
+	audio->monitoring_latency_ms = DEFAULT_MONITORING_LATENCY_MS;
 
 	errorcode = audio_output_open(&audio->audio, ai);
 	if (errorcode == AUDIO_OUTPUT_SUCCESS)
@@ -845,6 +922,21 @@ const struct obs_source_info audio_line_info = {
 
 extern void log_system_info(void);
 
+static void free_media_pool(void)
+{
+	struct base_media_stats stats;
+	base_get_media_stats(&stats);
+
+	if (stats.pool_hits || stats.pool_misses)
+		blog(LOG_INFO,
+		     "Media buffers: %" PRIu64 " pool hits, %" PRIu64
+		     " misses, %" PRIu64 " MB pooled",
+		     stats.pool_hits, stats.pool_misses,
+		     stats.bytes_cached / (1024 * 1024));
+
+	base_trim_media_pool();
+}
+
 static bool obs_init(const char *locale, const char *module_config_path,
 		     profiler_name_store_t *store)
 {
@@ -853,6 +945,7 @@ static bool obs_init(const char *locale, const char *module_config_path,
 	pthread_mutex_init_value(&obs->audio.monitoring_mutex);
 	pthread_mutex_init_value(&obs->video.gpu_encoder_mutex);
 	pthread_mutex_init_value(&obs->video.task_mutex);
+	obs->video.readback_depth = NUM_TEXTURES;
 
 	obs->name_store_owned = !store;
 	obs->name_store = store ? store : profiler_name_store_create();
@@ -1035,10 +1128,14 @@ void obs_shutdown(void)
 		module = next;
 	}
 	obs->first_module = NULL;
+	free_deferred_modules();
 
 	obs_free_audio();
 	obs_free_data();
 	obs_free_video();
+	free_deinterlace_threads();
+	free_frame_pool();
+	free_media_pool();
 	obs_free_hotkeys();
 	obs_free_graphics();
 	proc_handler_destroy(obs->procs);
@@ -1054,6 +1151,8 @@ void obs_shutdown(void)
 		profiler_name_store_free(obs->name_store);
 
 	bfree(obs->module_config_path);
+	bfree(obs->module_cache_path);
+	bfree(obs->video.program_cache_path);
 	bfree(obs->locale);
 	bfree(obs);
 	obs = NULL;
@@ -1176,11 +1275,13 @@ int obs_reset_video(struct obs_video_info *ovi)
 	     "\tdownscale filter:  %s\n"
 	     "\tfps:               %d/%d\n"
 	     "\tformat:            %s\n"
-	     "\tYUV mode:          %s%s%s",
+	     "\tYUV mode:          %s%s%s\n"
+	     "\treadback depth:    %u",
 	     ovi->base_width, ovi->base_height, ovi->output_width,
 	     ovi->output_height, scale_type_name, ovi->fps_num, ovi->fps_den,
 	     get_video_format_name(ovi->output_format),
-	     yuv ? yuv_format : "None", yuv ? "/" : "", yuv ? yuv_range : "");
+	     yuv ? yuv_format : "None", yuv ? "/" : "", yuv ? yuv_range : "",
+	     obs->video.readback_depth);
 
 	return obs_init_video(ovi);
 }
@@ -1224,6 +1325,33 @@ bool obs_get_video_info(struct obs_video_info *ovi)
 	return true;
 }
 
+void obs_set_video_readback_depth(uint32_t depth)
+{
+	if (!obs)
+		return;
+
+	if (depth < NUM_TEXTURES)
+		depth = NUM_TEXTURES;
+	else if (depth > MAX_TEXTURES)
+		depth = MAX_TEXTURES;
+
+	obs->video.readback_depth = depth;
+}
+
+uint32_t obs_get_video_readback_depth(void)
+{
+	return obs ? obs->video.readback_depth : 0;
+}
+
+void obs_set_program_cache_path(const char *path)
+{
+	if (!obs)
+		return;
+
+	bfree(obs->video.program_cache_path);
+	obs->video.program_cache_path = path ? bstrdup(path) : NULL;
+}
+
 bool obs_get_audio_info(struct obs_audio_info *oai)
 {
 	struct obs_core_audio *audio = &obs->audio;
@@ -1241,35 +1369,25 @@ bool obs_get_audio_info(struct obs_audio_info *oai)
 
 bool obs_enum_source_types(size_t idx, const char **id)
 {
-	if (idx >= obs->source_types.num)
-		return false;
-	*id = obs->source_types.array[idx].id;
-	return true;
+	return obs_enum_module_types(OBS_MODULE_TYPE_SOURCE, idx, id, NULL);
 }
 
 bool obs_enum_input_types(size_t idx, const char **id)
 {
-	if (idx >= obs->input_types.num)
-		return false;
-	*id = obs->input_types.array[idx].id;
-	return true;
+	return obs_enum_module_types(OBS_MODULE_TYPE_INPUT, idx, id, NULL);
 }
 
 bool obs_enum_input_types2(size_t idx, const char **id,
 			   const char **unversioned_id)
 {
-	if (idx >= obs->input_types.num)
-		return false;
-	if (id)
-		*id = obs->input_types.array[idx].id;
-	if (unversioned_id)
-		*unversioned_id = obs->input_types.array[idx].unversioned_id;
-	return true;
+	return obs_enum_module_types(OBS_MODULE_TYPE_INPUT, idx, id,
+				     unversioned_id);
 }
 
 const char *obs_get_latest_input_type_id(const char *unversioned_id)
 {
 	struct obs_source_info *latest = NULL;
+	const char *deferred_id;
 	int version = -1;
 
 	if (!unversioned_id)
@@ -1284,6 +1402,11 @@ const char *obs_get_latest_input_type_id(const char *unversioned_id)
 		}
 	}
 
+	/* a newer version may be in a module that hasn't been loaded yet */
+	deferred_id = obs_get_deferred_input_type_id(unversioned_id, &version);
+	if (deferred_id)
+		return deferred_id;
+
 	assert(!!latest);
 	if (!latest)
 		return NULL;
@@ -1293,42 +1416,28 @@ const char *obs_get_latest_input_type_id(const char *unversioned_id)
 
 bool obs_enum_filter_types(size_t idx, const char **id)
 {
-	if (idx >= obs->filter_types.num)
-		return false;
-	*id = obs->filter_types.array[idx].id;
-	return true;
+	return obs_enum_module_types(OBS_MODULE_TYPE_FILTER, idx, id, NULL);
 }
 
 bool obs_enum_transition_types(size_t idx, const char **id)
 {
-	if (idx >= obs->transition_types.num)
-		return false;
-	*id = obs->transition_types.array[idx].id;
-	return true;
+	return obs_enum_module_types(OBS_MODULE_TYPE_TRANSITION, idx, id,
+				     NULL);
 }
 
 bool obs_enum_output_types(size_t idx, const char **id)
 {
-	if (idx >= obs->output_types.num)
-		return false;
-	*id = obs->output_types.array[idx].id;
-	return true;
+	return obs_enum_module_types(OBS_MODULE_TYPE_OUTPUT, idx, id, NULL);
 }
 
 bool obs_enum_encoder_types(size_t idx, const char **id)
 {
-	if (idx >= obs->encoder_types.num)
-		return false;
-	*id = obs->encoder_types.array[idx].id;
-	return true;
+	return obs_enum_module_types(OBS_MODULE_TYPE_ENCODER, idx, id, NULL);
 }
 
 bool obs_enum_service_types(size_t idx, const char **id)
 {
-	if (idx >= obs->service_types.num)
-		return false;
-	*id = obs->service_types.array[idx].id;
-	return true;
+	return obs_enum_module_types(OBS_MODULE_TYPE_SERVICE, idx, id, NULL);
 }
 
 void obs_enter_graphics(void)
@@ -1824,6 +1933,9 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 	obs_source_set_deinterlace_field_order(
 		source, (enum obs_deinterlace_field_order)di_order);
 
+	obs_source_set_deinterlace_cpu(
+		source, obs_data_get_bool(source_data, "deinterlace_cpu"));
+
 	monitoring_type = (int)obs_data_get_int(source_data, "monitoring_type");
 	if (prev_ver < MAKE_SEMANTIC_VERSION(23, 2, 2)) {
 		if ((caps & OBS_SOURCE_MONITOR_BY_DEFAULT) != 0) {
@@ -1948,6 +2060,7 @@ obs_data_t *obs_save_source(obs_source_t *source)
 	int m_type = (int)obs_source_get_monitoring_type(source);
 	int di_mode = (int)obs_source_get_deinterlace_mode(source);
 	int di_order = (int)obs_source_get_deinterlace_field_order(source);
+	bool di_cpu = obs_source_get_deinterlace_cpu(source);
 
 	obs_source_save(source);
 	hotkeys = obs_hotkeys_save_source(source);
@@ -1978,6 +2091,7 @@ obs_data_t *obs_save_source(obs_source_t *source)
 	obs_data_set_obj(source_data, "hotkeys", hotkey_data);
 	obs_data_set_int(source_data, "deinterlace_mode", di_mode);
 	obs_data_set_int(source_data, "deinterlace_field_order", di_order);
+	obs_data_set_bool(source_data, "deinterlace_cpu", di_cpu);
 	obs_data_set_int(source_data, "monitoring_type", m_type);
 
 	obs_data_set_obj(source_data, "private_settings",
@@ -2194,6 +2308,11 @@ uint64_t obs_get_average_frame_time_ns(void)
 	return obs->video.video_avg_frame_time_ns;
 }
 
+uint64_t obs_get_average_draw_calls(void)
+{
+	return obs->video.video_avg_draw_calls;
+}
+
 uint64_t obs_get_frame_interval_ns(void)
 {
 	return obs->video.video_frame_interval_ns;
@@ -2285,6 +2404,31 @@ void obs_get_audio_monitoring_device(const char **name, const char **id)
 		*id = obs->audio.monitoring_device_id;
 }
 
+void obs_set_audio_monitoring_latency(uint32_t latency_ms)
+{
+	if (!obs || !latency_ms)
+		return;
+
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+
+	if (obs->audio.monitoring_latency_ms != latency_ms) {
+		obs->audio.monitoring_latency_ms = latency_ms;
+
+		for (size_t i = 0; i < obs->audio.monitors.num; i++) {
+			struct audio_monitor *monitor =
+				obs->audio.monitors.array[i];
+			audio_monitor_reset(monitor);
+		}
+	}
+
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+}
+
+uint32_t obs_get_audio_monitoring_latency(void)
+{
+	return obs ? obs->audio.monitoring_latency_ms : 0;
+}
+
 void obs_add_tick_callback(void (*tick)(void *param, float seconds),
 			   void *param)
 {
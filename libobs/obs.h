@@ -242,6 +242,7 @@ struct obs_source_frame {
 	/* used internally by libobs */
 	volatile long refs;
 	bool prev_frame;
+	bool pooled;
 };
 
 struct obs_source_frame2 {
@@ -386,6 +387,19 @@ EXPORT bool obs_reset_audio(const struct obs_audio_info *oai);
 /** Gets the current video settings, returns false if no video */
 EXPORT bool obs_get_video_info(struct obs_video_info *ovi);
 
+/**
+ * Sets how many frames are in flight between rendering and reading them
+ * back for raw outputs.  Takes effect on the next obs_reset_video call.
+ */
+EXPORT void obs_set_video_readback_depth(uint32_t depth);
+EXPORT uint32_t obs_get_video_readback_depth(void);
+
+/**
+ * Sets the directory the graphics subsystem caches linked shader programs
+ * in.  Takes effect on the next obs_reset_video call.
+ */
+EXPORT void obs_set_program_cache_path(const char *path);
+
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
 
@@ -454,6 +468,22 @@ EXPORT void obs_add_module_path(const char *bin, const char *data);
 /** Automatically loads all modules from module paths (convenience function) */
 EXPORT void obs_load_all_modules(void);
 
+/**
+ * Sets the file obs_load_all_modules uses to cache the types each module
+ * registers.  Modules that only register types, and whose file hasn't changed
+ * since they were cached, are then not loaded until one of their types is
+ * looked up.  Enumerating types lists the cached types without loading them.
+ * Modules are only loaded from the thread that called obs_load_all_modules,
+ * a lookup from any other thread queues the load to the UI thread instead.
+ */
+EXPORT void obs_set_module_cache_path(const char *path);
+
+/**
+ * Loads all modules whose loading was deferred by obs_load_all_modules.  Must
+ * be called from the thread that called obs_load_all_modules.
+ */
+EXPORT void obs_load_deferred_modules(void);
+
 /** Notifies modules that all modules have been loaded.  This function should
  * be called after all modules have been loaded. */
 EXPORT void obs_post_load_modules(void);
@@ -713,6 +743,11 @@ EXPORT void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb,
 EXPORT bool obs_set_audio_monitoring_device(const char *name, const char *id);
 EXPORT void obs_get_audio_monitoring_device(const char **name, const char **id);
 
+/** Sets the latency of audio monitoring.  Currently only used by the
+ * PulseAudio backend, which mixes all monitored sources into one stream. */
+EXPORT void obs_set_audio_monitoring_latency(uint32_t latency_ms);
+EXPORT uint32_t obs_get_audio_monitoring_latency(void);
+
 EXPORT void obs_add_tick_callback(void (*tick)(void *param, float seconds),
 				  void *param);
 EXPORT void obs_remove_tick_callback(void (*tick)(void *param, float seconds),
@@ -734,6 +769,7 @@ EXPORT uint64_t obs_get_video_frame_time(void);
 
 EXPORT double obs_get_active_fps(void);
 EXPORT uint64_t obs_get_average_frame_time_ns(void);
+EXPORT uint64_t obs_get_average_draw_calls(void);
 EXPORT uint64_t obs_get_frame_interval_ns(void);
 
 EXPORT uint32_t obs_get_total_frames(void);
@@ -1130,6 +1166,14 @@ EXPORT void obs_source_set_deinterlace_field_order(
 EXPORT enum obs_deinterlace_field_order
 obs_source_get_deinterlace_field_order(const obs_source_t *source);
 
+/**
+ * Deinterlaces the frames of an async source on the CPU as they're output,
+ * rather than when the source is drawn, so frame filters get deinterlaced
+ * frames.  2x modes output frames at the single rate on the CPU.
+ */
+EXPORT void obs_source_set_deinterlace_cpu(obs_source_t *source, bool cpu);
+EXPORT bool obs_source_get_deinterlace_cpu(const obs_source_t *source);
+
 enum obs_monitoring_type {
 	OBS_MONITORING_TYPE_NONE,
 	OBS_MONITORING_TYPE_MONITOR_ONLY,
@@ -1193,6 +1237,23 @@ EXPORT void obs_source_output_video(obs_source_t *source,
 EXPORT void obs_source_output_video2(obs_source_t *source,
 				     const struct obs_source_frame2 *frame);
 
+/**
+ * Copies a frame once so that it can be output to several sources with
+ * obs_source_output_shared_video without being copied again for each of them.
+ * Release it with obs_source_frame_release_shared once it has been output.
+ */
+EXPORT struct obs_source_frame *
+obs_source_frame_create_shared(const struct obs_source_frame *frame);
+
+/**
+ * Outputs a frame created with obs_source_frame_create_shared.  The source
+ * keeps a reference instead of a copy, unless it has async video filters or
+ * deinterlacing, which could change the frame for the other sources.
+ */
+EXPORT void obs_source_output_shared_video(obs_source_t *source,
+					   struct obs_source_frame *frame);
+EXPORT void obs_source_frame_release_shared(struct obs_source_frame *frame);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 /**
@@ -1332,6 +1393,10 @@ EXPORT bool obs_source_async_unbuffered(const obs_source_t *source);
 EXPORT void obs_source_set_async_decoupled(obs_source_t *source, bool decouple);
 EXPORT bool obs_source_async_decoupled(const obs_source_t *source);
 
+/** Returns the time it took to copy the last frame of an async source into
+ * its textures, in nanoseconds */
+EXPORT uint64_t obs_source_get_async_upload_time(const obs_source_t *source);
+
 EXPORT void obs_source_set_audio_active(obs_source_t *source, bool show);
 EXPORT bool obs_source_audio_active(const obs_source_t *source);
 
@@ -1489,6 +1554,12 @@ EXPORT obs_sceneitem_t *obs_scene_find_source_recursive(obs_scene_t *scene,
 EXPORT obs_sceneitem_t *obs_scene_find_sceneitem_by_id(obs_scene_t *scene,
 						       int64_t id);
 
+/**
+ * Gets the number of visible items that were skipped during the scene's last
+ * render because they were outside of the canvas or hidden by an opaque item
+ */
+EXPORT size_t obs_scene_get_culled_item_count(const obs_scene_t *scene);
+
 /** Enumerates sources within a scene */
 EXPORT void obs_scene_enum_items(obs_scene_t *scene,
 				 bool (*callback)(obs_scene_t *,
@@ -2226,6 +2297,23 @@ static inline void obs_source_frame_destroy(struct obs_source_frame *frame)
 EXPORT void obs_source_frame_copy(struct obs_source_frame *dst,
 				  const struct obs_source_frame *src);
 
+struct obs_frame_pool_stats {
+	uint64_t limit;
+	uint64_t idle_bytes;
+	uint64_t idle_frames;
+	uint64_t peak_idle_bytes;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+};
+
+/**
+ * Sets how much memory unused async video frames may keep allocated in the
+ * frame pool shared by all async sources.
+ */
+EXPORT void obs_set_frame_pool_limit(uint64_t max_bytes);
+EXPORT void obs_get_frame_pool_stats(struct obs_frame_pool_stats *stats);
+
 /* ------------------------------------------------------------------------- */
 /* Get source icon type */
 EXPORT enum obs_icon_type obs_source_get_icon_type(const char *id);
@@ -21,6 +21,18 @@
 #include "platform.h"
 #include "threading.h"
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
 /*
  * NOTE: totally jacked the mem alignment trick from ffmpeg, credit to them:
  *   http://www.ffmpeg.org/
@@ -152,3 +164,345 @@ void *bmemdup(const void *ptr, size_t size)
 
 	return out;
 }
+
+/* ------------------------------------------------------------------------- */
+/* media buffers */
+
+/*
+ * Media buffers of MEDIA_MIN_SIZE and up are mapped directly in size classes
+ * four per power of two.  Freed blocks are kept on a free list per size class
+ * for reuse, up to MEDIA_MAX_CACHED bytes, and are unmapped once they have
+ * not been reused for MEDIA_MAX_IDLE_NS.  On Linux the free lists are also
+ * kept per NUMA node.  A block is only reused by a thread running on the node
+ * that mapped it, and so most likely touched its pages first.
+ */
+
+#define MEDIA_MIN_SIZE (64 * 1024)
+#define MEDIA_HEADER_SIZE 64
+#define MEDIA_MAX_CACHED (256ULL * 1024 * 1024)
+#define MEDIA_MAX_NODES 8
+#define MEDIA_NUM_CLASSES 256
+#define MEDIA_MAX_IDLE_NS 10000000000ULL
+#define MEDIA_EXPIRE_INTERVAL_NS 1000000000ULL
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+struct media_block {
+	/* size of the mapping, 0 if allocated with bmalloc */
+	size_t size;
+	struct media_block *next;
+	uint32_t node;
+	/* when the block was put on its free list */
+	uint64_t free_time;
+};
+
+static void *map_pages(size_t size);
+static void unmap_pages(void *ptr);
+
+static struct base_allocator media_alloc = {map_pages, NULL, unmap_pages};
+static pthread_mutex_t media_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct media_block *free_blocks[MEDIA_MAX_NODES][MEDIA_NUM_CLASSES];
+static struct base_media_stats media_stats = {0};
+static long num_media_allocs = 0;
+static bool media_huge_pages = false;
+static uint64_t last_expire = 0;
+
+#ifdef MADV_HUGEPAGE
+/* Huge pages can only back the 2 MB aligned parts of a mapping, so a mapping
+ * that merely starts on a page boundary would mostly be left with small
+ * pages.  Maps enough to cut a 2 MB aligned range out of it instead. */
+static void *map_huge_pages(size_t size)
+{
+	size_t map_size = size + HUGE_PAGE_SIZE;
+	uint8_t *ptr = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+			    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	uint8_t *aligned;
+	uint8_t *end;
+
+	if (ptr == MAP_FAILED)
+		return NULL;
+
+	aligned = (uint8_t *)(((uintptr_t)ptr + HUGE_PAGE_SIZE - 1) &
+			      ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+	end = aligned + size;
+
+	if (aligned > ptr)
+		munmap(ptr, aligned - ptr);
+	if (end < ptr + map_size)
+		munmap(end, ptr + map_size - end);
+
+	madvise(aligned, size, MADV_HUGEPAGE);
+	return aligned;
+}
+#endif
+
+static void *map_pages(size_t size)
+{
+#ifdef _WIN32
+	return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE,
+			    PAGE_READWRITE);
+#else
+	void *ptr;
+
+#ifdef MADV_HUGEPAGE
+	if (media_huge_pages && size >= HUGE_PAGE_SIZE)
+		return map_huge_pages(size);
+#endif
+
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return ptr == MAP_FAILED ? NULL : ptr;
+#endif
+}
+
+static void unmap_pages(void *ptr)
+{
+#ifdef _WIN32
+	VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+	munmap(ptr, ((struct media_block *)ptr)->size);
+#endif
+}
+
+static inline uint32_t current_node(void)
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+	unsigned int cpu = 0;
+	unsigned int node = 0;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+		return node % MEDIA_MAX_NODES;
+#endif
+	return 0;
+}
+
+static inline int highest_bit(size_t val)
+{
+	int bit = 0;
+	while (val >>= 1)
+		bit++;
+	return bit;
+}
+
+/* rounds the size up to its size class, a multiple of a quarter of the
+ * power of two below it */
+static size_t get_class_size(size_t size, size_t *idx)
+{
+	size_t step = (size_t)1 << (highest_bit(size) - 2);
+	int bit;
+
+	size = (size + step - 1) & ~(step - 1);
+	bit = highest_bit(size);
+
+	*idx = (size_t)bit * 4 + ((size >> (bit - 2)) & 3);
+	return size;
+}
+
+void *bmalloc_media(size_t size)
+{
+	struct media_block *block;
+	size_t class_size;
+	size_t idx;
+	uint32_t node;
+
+	if (size < MEDIA_MIN_SIZE) {
+		block = bmalloc(MEDIA_HEADER_SIZE + size);
+		block->size = 0;
+		os_atomic_inc_long(&num_media_allocs);
+		return (uint8_t *)block + MEDIA_HEADER_SIZE;
+	}
+
+	class_size = get_class_size(MEDIA_HEADER_SIZE + size, &idx);
+	node = current_node();
+
+	pthread_mutex_lock(&media_mutex);
+
+	block = free_blocks[node][idx];
+	if (block) {
+		free_blocks[node][idx] = block->next;
+		media_stats.bytes_cached -= class_size;
+		media_stats.pool_hits++;
+	} else {
+		media_stats.pool_misses++;
+	}
+
+	media_stats.bytes_in_use += class_size;
+
+	pthread_mutex_unlock(&media_mutex);
+
+	if (!block) {
+		block = media_alloc.malloc(class_size);
+		if (!block) {
+			os_breakpoint();
+			bcrash("Out of memory while trying to allocate %lu "
+			       "bytes",
+			       (unsigned long)size);
+		}
+
+		block->size = class_size;
+		block->node = node;
+	}
+
+	block->next = NULL;
+
+	os_atomic_inc_long(&num_allocs);
+	os_atomic_inc_long(&num_media_allocs);
+	return (uint8_t *)block + MEDIA_HEADER_SIZE;
+}
+
+/* Unlinks the blocks that have been on their free lists for longer than
+ * MEDIA_MAX_IDLE_NS.  Blocks are pushed to the front of the lists, so the
+ * expired blocks of a list are always at its end. */
+static struct media_block *expire_blocks(uint64_t now)
+{
+	struct media_block *expired = NULL;
+	uint64_t cutoff;
+
+	last_expire = now;
+	if (now < MEDIA_MAX_IDLE_NS)
+		return NULL;
+
+	cutoff = now - MEDIA_MAX_IDLE_NS;
+
+	for (size_t n = 0; n < MEDIA_MAX_NODES; n++) {
+		for (size_t i = 0; i < MEDIA_NUM_CLASSES; i++) {
+			struct media_block **p_block = &free_blocks[n][i];
+
+			while (*p_block && (*p_block)->free_time >= cutoff)
+				p_block = &(*p_block)->next;
+
+			while (*p_block) {
+				struct media_block *block = *p_block;
+
+				*p_block = block->next;
+				media_stats.bytes_cached -= block->size;
+
+				block->next = expired;
+				expired = block;
+			}
+		}
+	}
+
+	return expired;
+}
+
+static void unmap_blocks(struct media_block *blocks)
+{
+	while (blocks) {
+		struct media_block *next = blocks->next;
+		media_alloc.free(blocks);
+		blocks = next;
+	}
+}
+
+void bfree_media(void *ptr)
+{
+	struct media_block *expired = NULL;
+	struct media_block *block;
+	uint64_t now;
+	size_t idx;
+
+	if (!ptr)
+		return;
+
+	block = (struct media_block *)((uint8_t *)ptr - MEDIA_HEADER_SIZE);
+	os_atomic_dec_long(&num_media_allocs);
+
+	if (!block->size) {
+		bfree(block);
+		return;
+	}
+
+	os_atomic_dec_long(&num_allocs);
+	get_class_size(block->size, &idx);
+	now = os_gettime_ns();
+
+	pthread_mutex_lock(&media_mutex);
+
+	media_stats.bytes_in_use -= block->size;
+
+	if (now - last_expire >= MEDIA_EXPIRE_INTERVAL_NS)
+		expired = expire_blocks(now);
+
+	if (media_stats.bytes_cached + block->size <= MEDIA_MAX_CACHED) {
+		block->free_time = now;
+		block->next = free_blocks[block->node][idx];
+		free_blocks[block->node][idx] = block;
+		media_stats.bytes_cached += block->size;
+		block = NULL;
+	}
+
+	pthread_mutex_unlock(&media_mutex);
+
+	if (block)
+		media_alloc.free(block);
+	unmap_blocks(expired);
+}
+
+long bnum_media_allocs(void)
+{
+	return num_media_allocs;
+}
+
+void base_get_media_stats(struct base_media_stats *stats)
+{
+	if (!stats)
+		return;
+
+	pthread_mutex_lock(&media_mutex);
+	*stats = media_stats;
+	pthread_mutex_unlock(&media_mutex);
+
+	stats->allocs = num_media_allocs;
+}
+
+void base_set_media_allocator(struct base_allocator *defs)
+{
+	media_alloc.malloc = defs->malloc;
+	media_alloc.free = defs->free;
+}
+
+void base_set_media_huge_pages(bool enable)
+{
+	media_huge_pages = enable;
+}
+
+void base_trim_media_pool(void)
+{
+	struct media_block *blocks = NULL;
+
+	pthread_mutex_lock(&media_mutex);
+
+	for (size_t n = 0; n < MEDIA_MAX_NODES; n++) {
+		for (size_t i = 0; i < MEDIA_NUM_CLASSES; i++) {
+			struct media_block *block = free_blocks[n][i];
+
+			while (block) {
+				struct media_block *next = block->next;
+				block->next = blocks;
+				blocks = block;
+				block = next;
+			}
+
+			free_blocks[n][i] = NULL;
+		}
+	}
+
+	media_stats.bytes_cached = 0;
+
+	pthread_mutex_unlock(&media_mutex);
+
+	unmap_blocks(blocks);
+}
+
+void base_expire_media_pool(void)
+{
+	struct media_block *expired = NULL;
+	uint64_t now = os_gettime_ns();
+
+	pthread_mutex_lock(&media_mutex);
+	if (now - last_expire >= MEDIA_EXPIRE_INTERVAL_NS)
+		expired = expire_blocks(now);
+	pthread_mutex_unlock(&media_mutex);
+
+	unmap_blocks(expired);
+}
@@ -43,6 +43,43 @@ EXPORT long bnum_allocs(void);
 
 EXPORT void *bmemdup(const void *ptr, size_t size);
 
+/*
+ * Media buffers are large buffers allocated and freed at frame rate, such as
+ * video frames and encoder packet data.  Buffers of 64 KB and up are served
+ * from pooled page mappings instead of the heap.  Media buffers must be freed
+ * with bfree_media.
+ */
+
+struct base_media_stats {
+	long allocs;
+	uint64_t bytes_in_use;
+	uint64_t bytes_cached;
+	uint64_t pool_hits;
+	uint64_t pool_misses;
+};
+
+EXPORT void *bmalloc_media(size_t size);
+EXPORT void bfree_media(void *ptr);
+
+EXPORT long bnum_media_allocs(void);
+EXPORT void base_get_media_stats(struct base_media_stats *stats);
+
+/* Replaces the functions pooled media buffers are mapped and unmapped with.
+ * Only the malloc and free members are used.  Must be called before any media
+ * buffer is allocated. */
+EXPORT void base_set_media_allocator(struct base_allocator *defs);
+
+/* Backs newly mapped media buffers of 2 MB and up with transparent huge pages
+ * where the OS supports it. */
+EXPORT void base_set_media_huge_pages(bool enable);
+
+/* Unmaps all pooled media buffers that are not in use. */
+EXPORT void base_trim_media_pool(void);
+
+/* Unmaps pooled media buffers that have not been reused for ten seconds.
+ * This is also done as media buffers are freed, at most once per second. */
+EXPORT void base_expire_media_pool(void);
+
 static inline void *bzalloc(size_t size)
 {
 	void *mem = bmalloc(size);
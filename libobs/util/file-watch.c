@@ -0,0 +1,380 @@
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "bmem.h"
+#include "dstr.h"
+#include "platform.h"
+#include "threading.h"
+#include "file-watch.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+#define INOTIFY_MASK                                                    \
+	(IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | \
+	 IN_MOVED_FROM | IN_MOVED_TO)
+#endif
+
+#define POLL_INTERVAL_MS 1000
+
+struct os_file_watch {
+	char *path;
+	os_file_watch_cb callback;
+	void *param;
+
+	/* state for polling */
+	bool exists;
+	time_t mtime;
+	int64_t size;
+
+#ifdef __linux__
+	/* inotify watch of the file's directory, or of the path itself if it
+	 * is a directory.  -1 if the path is polled. */
+	int wd;
+	const char *name;
+#endif
+
+	bool changed;
+	struct os_file_watch *next;
+};
+
+/* protects the watcher thread being started and stopped */
+static pthread_mutex_t thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* protects the watch list, held while callbacks are called */
+static pthread_mutex_t watch_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static struct os_file_watch *first_watch = NULL;
+static pthread_t watch_thread;
+static bool watch_thread_active = false;
+static os_event_t *stop_event = NULL;
+
+#ifdef __linux__
+static int inotify_fd = -1;
+static int wake_fd = -1;
+#endif
+
+static void update_poll_state(struct os_file_watch *watch)
+{
+	struct stat st;
+	bool exists = os_stat(watch->path, &st) == 0;
+
+	if (exists != watch->exists ||
+	    (exists && (st.st_mtime != watch->mtime ||
+			(int64_t)st.st_size != watch->size)))
+		watch->changed = true;
+
+	watch->exists = exists;
+	watch->mtime = exists ? st.st_mtime : 0;
+	watch->size = exists ? (int64_t)st.st_size : 0;
+}
+
+static inline bool is_polled(const struct os_file_watch *watch)
+{
+#ifdef __linux__
+	return watch->wd == -1;
+#else
+	UNUSED_PARAMETER(watch);
+	return true;
+#endif
+}
+
+static void poll_watches(void)
+{
+	for (struct os_file_watch *watch = first_watch; watch;
+	     watch = watch->next) {
+		if (is_polled(watch))
+			update_poll_state(watch);
+	}
+}
+
+static void dispatch_changes(void)
+{
+	for (struct os_file_watch *watch = first_watch; watch;
+	     watch = watch->next) {
+		if (watch->changed) {
+			watch->changed = false;
+			watch->callback(watch->param, watch->path);
+		}
+	}
+}
+
+#ifdef __linux__
+static bool is_directory(const char *path)
+{
+	struct stat st;
+	return os_stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static void add_inotify_watch(struct os_file_watch *watch)
+{
+	struct dstr dir = {0};
+	const char *slash;
+
+	watch->wd = -1;
+	watch->name = NULL;
+
+	if (inotify_fd == -1)
+		return;
+
+	if (is_directory(watch->path)) {
+		watch->wd = inotify_add_watch(inotify_fd, watch->path,
+					      INOTIFY_MASK);
+		return;
+	}
+
+	slash = strrchr(watch->path, '/');
+	if (slash) {
+		dstr_ncopy(&dir, watch->path, slash - watch->path);
+		if (!dir.len)
+			dstr_copy(&dir, "/");
+		watch->name = slash + 1;
+	} else {
+		dstr_copy(&dir, ".");
+		watch->name = watch->path;
+	}
+
+	watch->wd = inotify_add_watch(inotify_fd, dir.array, INOTIFY_MASK);
+	dstr_free(&dir);
+}
+
+static void remove_inotify_watch(struct os_file_watch *watch)
+{
+	if (watch->wd == -1)
+		return;
+
+	/* a directory is only watched once, however many files in it are */
+	for (struct os_file_watch *w = first_watch; w; w = w->next) {
+		if (w->wd == watch->wd)
+			return;
+	}
+
+	inotify_rm_watch(inotify_fd, watch->wd);
+}
+
+static void read_inotify_events(void)
+{
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *event;
+	ssize_t len;
+
+	while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+		for (char *ptr = buf; ptr < buf + len;
+		     ptr += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event *)ptr;
+
+			for (struct os_file_watch *watch = first_watch; watch;
+			     watch = watch->next) {
+				if (watch->wd != event->wd)
+					continue;
+
+				/* the directory went away, fall back to
+				 * polling for it to come back */
+				if (event->mask & IN_IGNORED) {
+					watch->wd = -1;
+					watch->changed = true;
+				} else if (!watch->name ||
+					   (event->len &&
+					    strcmp(watch->name, event->name) ==
+						    0)) {
+					watch->changed = true;
+				}
+			}
+		}
+	}
+}
+
+static void close_inotify(void)
+{
+	if (inotify_fd != -1) {
+		close(wake_fd);
+		close(inotify_fd);
+		wake_fd = -1;
+		inotify_fd = -1;
+	}
+}
+
+/* Returns false once the thread has to stop */
+static bool wait_for_changes(void)
+{
+	struct pollfd fds[2] = {
+		{.fd = inotify_fd, .events = POLLIN},
+		{.fd = wake_fd, .events = POLLIN},
+	};
+
+	if (inotify_fd == -1)
+		return os_event_timedwait(stop_event, POLL_INTERVAL_MS) ==
+		       ETIMEDOUT;
+
+	if (poll(fds, 2, POLL_INTERVAL_MS) < 0 && errno != EINTR)
+		return false;
+	if (fds[1].revents & POLLIN)
+		return false;
+
+	if (fds[0].revents & POLLIN) {
+		pthread_mutex_lock(&watch_mutex);
+		read_inotify_events();
+		pthread_mutex_unlock(&watch_mutex);
+	}
+
+	return true;
+}
+#else
+static bool wait_for_changes(void)
+{
+	return os_event_timedwait(stop_event, POLL_INTERVAL_MS) == ETIMEDOUT;
+}
+#endif
+
+static void *file_watch_thread(void *unused)
+{
+	uint64_t last_poll = os_gettime_ns();
+
+	os_set_thread_name("file watch");
+
+	while (wait_for_changes()) {
+		uint64_t now = os_gettime_ns();
+
+		pthread_mutex_lock(&watch_mutex);
+
+		if (now - last_poll >= POLL_INTERVAL_MS * 1000000ULL) {
+			poll_watches();
+			last_poll = now;
+		}
+
+		dispatch_changes();
+
+		pthread_mutex_unlock(&watch_mutex);
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+static bool start_thread(void)
+{
+	if (os_event_init(&stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		return false;
+
+#ifdef __linux__
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd != -1) {
+		wake_fd = eventfd(0, EFD_CLOEXEC);
+		if (wake_fd == -1) {
+			close(inotify_fd);
+			inotify_fd = -1;
+		}
+	}
+	if (inotify_fd == -1)
+		blog(LOG_WARNING, "os_file_watch: inotify unavailable, "
+				  "polling for changes");
+#endif
+
+	if (pthread_create(&watch_thread, NULL, file_watch_thread, NULL) != 0) {
+		os_event_destroy(stop_event);
+		stop_event = NULL;
+#ifdef __linux__
+		close_inotify();
+#endif
+		return false;
+	}
+
+	watch_thread_active = true;
+	return true;
+}
+
+static void stop_thread(void)
+{
+	os_event_signal(stop_event);
+#ifdef __linux__
+	if (wake_fd != -1) {
+		uint64_t val = 1;
+		if (write(wake_fd, &val, sizeof(val)) != sizeof(val))
+			blog(LOG_WARNING, "os_file_watch: failed to wake "
+					  "the watcher thread");
+	}
+#endif
+
+	pthread_join(watch_thread, NULL);
+	watch_thread_active = false;
+
+	os_event_destroy(stop_event);
+	stop_event = NULL;
+
+#ifdef __linux__
+	close_inotify();
+#endif
+}
+
+os_file_watch_t *os_file_watch_add(const char *path, os_file_watch_cb callback,
+				   void *param)
+{
+	struct os_file_watch *watch;
+
+	if (!path || !*path || !callback)
+		return NULL;
+
+	pthread_mutex_lock(&thread_mutex);
+
+	if (!watch_thread_active && !start_thread()) {
+		pthread_mutex_unlock(&thread_mutex);
+		blog(LOG_ERROR, "os_file_watch: failed to start the watcher "
+				"thread");
+		return NULL;
+	}
+
+	watch = bzalloc(sizeof(struct os_file_watch));
+	watch->path = bstrdup(path);
+	watch->callback = callback;
+	watch->param = param;
+
+	pthread_mutex_lock(&watch_mutex);
+
+#ifdef __linux__
+	add_inotify_watch(watch);
+#endif
+	update_poll_state(watch);
+	watch->changed = false;
+
+	watch->next = first_watch;
+	first_watch = watch;
+
+	pthread_mutex_unlock(&watch_mutex);
+	pthread_mutex_unlock(&thread_mutex);
+	return watch;
+}
+
+void os_file_watch_remove(os_file_watch_t *watch)
+{
+	struct os_file_watch **p_watch;
+
+	if (!watch)
+		return;
+
+	pthread_mutex_lock(&thread_mutex);
+	pthread_mutex_lock(&watch_mutex);
+
+	for (p_watch = &first_watch; *p_watch; p_watch = &(*p_watch)->next) {
+		if (*p_watch == watch) {
+			*p_watch = watch->next;
+			break;
+		}
+	}
+
+#ifdef __linux__
+	remove_inotify_watch(watch);
+#endif
+
+	pthread_mutex_unlock(&watch_mutex);
+
+	if (!first_watch && watch_thread_active)
+		stop_thread();
+
+	pthread_mutex_unlock(&thread_mutex);
+
+	bfree(watch->path);
+	bfree(watch);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ * Watches files and directories for changes from a background thread, so
+ * callers don't have to stat them periodically.  On Linux, inotify is used;
+ * elsewhere, or if inotify can't watch a path, the path is polled once per
+ * second.  A directory is reported as changed when an entry in it is added,
+ * removed or modified.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct os_file_watch;
+typedef struct os_file_watch os_file_watch_t;
+
+/* Called from the watcher thread.  Must not add or remove watches. */
+typedef void (*os_file_watch_cb)(void *param, const char *path);
+
+EXPORT os_file_watch_t *os_file_watch_add(const char *path,
+					  os_file_watch_cb callback,
+					  void *param);
+
+/* Once this returns, the callback is not called for the watch any more. */
+EXPORT void os_file_watch_remove(os_file_watch_t *watch);
+
+#ifdef __cplusplus
+}
+#endif
@@ -54,6 +54,19 @@
 #define _mm_srai_epi16 simde_mm_srai_epi16
 #define _mm_shufflelo_epi16 simde_mm_shufflelo_epi16
 #define _mm_storeu_si128 simde_mm_storeu_si128
+#define _mm_loadu_si128 simde_mm_loadu_si128
+#define _mm_setzero_si128 simde_mm_setzero_si128
+#define _mm_or_si128 simde_mm_or_si128
+#define _mm_avg_epu8 simde_mm_avg_epu8
+#define _mm_subs_epu8 simde_mm_subs_epu8
+#define _mm_max_epu8 simde_mm_max_epu8
+#define _mm_unpacklo_epi8 simde_mm_unpacklo_epi8
+#define _mm_unpackhi_epi8 simde_mm_unpackhi_epi8
+#define _mm_add_epi16 simde_mm_add_epi16
+#define _mm_sub_epi16 simde_mm_sub_epi16
+#define _mm_srli_epi16 simde_mm_srli_epi16
+#define _mm_max_epi16 simde_mm_max_epi16
+#define _mm_min_epi16 simde_mm_min_epi16
 
 #define _MM_SHUFFLE SIMDE_MM_SHUFFLE
 #define _MM_TRANSPOSE4_PS SIMDE_MM_TRANSPOSE4_PS
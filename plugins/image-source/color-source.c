@@ -70,6 +70,11 @@ static void color_source_render(void *data, gs_effect_t *effect)
 
 	struct color_source *context = data;
 
+	/* inside a scene, consecutive color sources are drawn together */
+	if (gs_sprite_batch_add_solid(context->width, context->height,
+				      context->color))
+		return;
+
 	gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
 	gs_eparam_t *color = gs_effect_get_param_by_name(solid, "color");
 	gs_technique_t *tech = gs_effect_get_technique(solid, "Solid");
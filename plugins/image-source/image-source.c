@@ -1,8 +1,9 @@
 #include <obs-module.h>
 #include <graphics/image-file.h>
 #include <util/platform.h>
+#include <util/threading.h>
+#include <util/file-watch.h>
 #include <util/dstr.h>
-#include <sys/stat.h>
 
 #define blog(log_level, format, ...)                    \
 	blog(log_level, "[image_source: '%s'] " format, \
@@ -17,22 +18,14 @@ struct image_source {
 
 	char *file;
 	bool persistent;
-	time_t file_timestamp;
-	float update_time_elapsed;
+	os_file_watch_t *file_watch;
+	volatile bool file_changed;
 	uint64_t last_time;
 	bool active;
 
 	gs_image_file2_t if2;
 };
 
-static time_t get_modified_timestamp(const char *filename)
-{
-	struct stat stats;
-	if (os_stat(filename, &stats) != 0)
-		return -1;
-	return stats.st_mtime;
-}
-
 static const char *image_source_get_name(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -49,9 +42,8 @@ static void image_source_load(struct image_source *context)
 
 	if (file && *file) {
 		debug("loading texture '%s'", file);
-		context->file_timestamp = get_modified_timestamp(file);
+		os_atomic_set_bool(&context->file_changed, false);
 		gs_image_file2_init(&context->if2, file);
-		context->update_time_elapsed = 0;
 
 		obs_enter_graphics();
 		gs_image_file2_init_texture(&context->if2);
@@ -69,12 +61,26 @@ static void image_source_unload(struct image_source *context)
 	obs_leave_graphics();
 }
 
+static void file_changed(void *data, const char *path)
+{
+	struct image_source *context = data;
+	os_atomic_set_bool(&context->file_changed, true);
+
+	UNUSED_PARAMETER(path);
+}
+
 static void image_source_update(void *data, obs_data_t *settings)
 {
 	struct image_source *context = data;
 	const char *file = obs_data_get_string(settings, "file");
 	const bool unload = obs_data_get_bool(settings, "unload");
 
+	if (!context->file || strcmp(context->file, file) != 0) {
+		os_file_watch_remove(context->file_watch);
+		context->file_watch = os_file_watch_add(file, file_changed,
+							context);
+	}
+
 	if (context->file)
 		bfree(context->file);
 	context->file = bstrdup(file);
@@ -121,6 +127,7 @@ static void image_source_destroy(void *data)
 {
 	struct image_source *context = data;
 
+	os_file_watch_remove(context->file_watch);
 	image_source_unload(context);
 
 	if (context->file)
@@ -158,18 +165,9 @@ static void image_source_tick(void *data, float seconds)
 	struct image_source *context = data;
 	uint64_t frame_time = obs_get_video_frame_time();
 
-	context->update_time_elapsed += seconds;
-
-	if (obs_source_showing(context->source)) {
-		if (context->update_time_elapsed >= 1.0f) {
-			time_t t = get_modified_timestamp(context->file);
-			context->update_time_elapsed = 0.0f;
-
-			if (context->file_timestamp != t) {
-				image_source_load(context);
-			}
-		}
-	}
+	if (obs_source_showing(context->source) &&
+	    os_atomic_load_bool(&context->file_changed))
+		image_source_load(context);
 
 	if (obs_source_active(context->source)) {
 		if (!context->active) {
@@ -208,6 +206,8 @@ static void image_source_tick(void *data, float seconds)
 	}
 
 	context->last_time = frame_time;
+
+	UNUSED_PARAMETER(seconds);
 }
 
 static const char *image_filter =
@@ -273,6 +273,7 @@ static struct obs_source_info image_source_info = {
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("image-source", "en-US")
+OBS_MODULE_DEFERRABLE()
 MODULE_EXPORT const char *obs_module_description(void)
 {
 	return "Image/color/slideshow sources";
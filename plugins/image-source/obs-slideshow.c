@@ -1,6 +1,7 @@
 #include <obs-module.h>
 #include <util/threading.h>
 #include <util/platform.h>
+#include <util/file-watch.h>
 #include <util/darray.h>
 #include <util/dstr.h>
 
@@ -66,6 +67,10 @@ extern uint64_t image_source_get_memory_usage(void *data);
 #define BYTES_TO_MBYTES (1024 * 1024)
 #define MAX_MEM_USAGE (400 * BYTES_TO_MBYTES)
 
+/* a directory is rescanned once it has been quiet for this long, so copying
+ * a batch of files into it doesn't rescan it once per file */
+#define RESCAN_DELAY_NS (500 * 1000000ULL)
+
 struct image_file_data {
 	char *path;
 	obs_source_t *source;
@@ -100,10 +105,25 @@ struct slideshow {
 
 	uint32_t cx;
 	uint32_t cy;
-	uint64_t mem_usage;
 
 	pthread_mutex_t mutex;
 	DARRAY(struct image_file_data) files;
+	DARRAY(os_file_watch_t *) dir_watches;
+	volatile bool dirs_changed;
+	uint64_t rescan_time;
+
+	/* watched directories are rescanned on a thread of their own, which
+	 * leaves the new list for the video tick to swap in */
+	pthread_t scan_thread;
+	bool scan_thread_active;
+	os_sem_t *scan_sem;
+	volatile bool scan_exit;
+	volatile bool scanning;
+	DARRAY(struct image_file_data) scanned_files;
+	volatile bool has_scanned_files;
+	uint32_t scanned_cx;
+	uint32_t scanned_cy;
+	uint32_t scan_generation;
 
 	enum behavior behavior;
 
@@ -186,7 +206,8 @@ static const char *ss_getname(void *unused)
 }
 
 static void add_file(struct slideshow *ss, struct darray *array,
-		     const char *path, uint32_t *cx, uint32_t *cy)
+		     const char *path, uint32_t *cx, uint32_t *cy,
+		     uint64_t *mem_usage)
 {
 	DARRAY(struct image_file_data) new_files;
 	struct image_file_data data;
@@ -217,7 +238,7 @@ static void add_file(struct slideshow *ss, struct darray *array,
 			*cy = new_cy;
 
 		void *source_data = obs_obj_get_data(new_source);
-		ss->mem_usage += image_source_get_memory_usage(source_data);
+		*mem_usage += image_source_get_memory_usage(source_data);
 	}
 
 	*array = new_files.da;
@@ -256,10 +277,286 @@ static void do_transition(void *data, bool to_null)
 				     ss->tr_speed, NULL);
 }
 
+static void free_dir_watches(struct slideshow *ss)
+{
+	for (size_t i = 0; i < ss->dir_watches.num; i++)
+		os_file_watch_remove(ss->dir_watches.array[i]);
+	da_free(ss->dir_watches);
+}
+
+static void dir_changed(void *data, const char *path)
+{
+	struct slideshow *ss = data;
+
+	/* the file list is rescanned from the video tick */
+	os_atomic_set_bool(&ss->dirs_changed, true);
+
+	UNUSED_PARAMETER(path);
+}
+
+static void build_file_list(struct slideshow *ss, obs_data_array_t *array,
+			    struct darray *new_files, uint32_t *cx,
+			    uint32_t *cy, bool add_watches)
+{
+	size_t count = obs_data_array_count(array);
+	uint64_t mem_usage = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(array, i);
+		const char *path = obs_data_get_string(item, "value");
+		os_dir_t *dir = os_opendir(path);
+
+		if (dir) {
+			struct dstr dir_path = {0};
+			struct os_dirent *ent;
+
+			for (;;) {
+				const char *ext;
+
+				ent = os_readdir(dir);
+				if (!ent)
+					break;
+				if (ent->directory)
+					continue;
+
+				ext = os_get_path_extension(ent->d_name);
+				if (!valid_extension(ext))
+					continue;
+
+				dstr_copy(&dir_path, path);
+				dstr_cat_ch(&dir_path, '/');
+				dstr_cat(&dir_path, ent->d_name);
+				add_file(ss, new_files, dir_path.array, cx, cy,
+					 &mem_usage);
+
+				if (mem_usage >= MAX_MEM_USAGE)
+					break;
+			}
+
+			dstr_free(&dir_path);
+			os_closedir(dir);
+
+			if (add_watches) {
+				os_file_watch_t *watch = os_file_watch_add(
+					path, dir_changed, ss);
+				if (watch)
+					da_push_back(ss->dir_watches, &watch);
+			}
+		} else {
+			add_file(ss, new_files, path, cx, cy, &mem_usage);
+		}
+
+		obs_data_release(item);
+
+		if (mem_usage >= MAX_MEM_USAGE)
+			break;
+	}
+}
+
+static void get_output_size(obs_data_t *settings, uint32_t *cx, uint32_t *cy)
+{
+	const char *res_str = obs_data_get_string(settings, S_CUSTOM_SIZE);
+	bool aspect_only = false, use_auto = true;
+	int cx_in = 0, cy_in = 0;
+
+	if (strcmp(res_str, T_CUSTOM_SIZE_AUTO) != 0) {
+		int ret = sscanf(res_str, "%dx%d", &cx_in, &cy_in);
+		if (ret == 2) {
+			aspect_only = false;
+			use_auto = false;
+		} else {
+			ret = sscanf(res_str, "%d:%d", &cx_in, &cy_in);
+			if (ret == 2) {
+				aspect_only = true;
+				use_auto = false;
+			}
+		}
+	}
+
+	if (!use_auto) {
+		double cx_f = (double)*cx;
+		double cy_f = (double)*cy;
+
+		double old_aspect = cx_f / cy_f;
+		double new_aspect = (double)cx_in / (double)cy_in;
+
+		if (aspect_only) {
+			if (fabs(old_aspect - new_aspect) > EPSILON) {
+				if (new_aspect > old_aspect)
+					*cx = (uint32_t)(cy_f * new_aspect);
+				else
+					*cy = (uint32_t)(cx_f / new_aspect);
+			}
+		} else {
+			*cx = (uint32_t)cx_in;
+			*cy = (uint32_t)cy_in;
+		}
+	}
+}
+
+static size_t find_file(struct slideshow *ss, const char *path)
+{
+	for (size_t i = 0; i < ss->files.num; i++) {
+		if (strcmp(ss->files.array[i].path, path) == 0)
+			return i;
+	}
+
+	return DARRAY_INVALID;
+}
+
+/* Rebuilds the list of files after a watched directory changed.  This
+ * creates a source and loads the image for every new file, so it's done on
+ * the scan thread instead of the video tick. */
+static void scan_files(struct slideshow *ss)
+{
+	DARRAY(struct image_file_data) new_files;
+	DARRAY(struct image_file_data) old_files;
+	obs_data_t *settings;
+	obs_data_array_t *array;
+	uint32_t generation;
+	uint32_t cx = 0;
+	uint32_t cy = 0;
+
+	pthread_mutex_lock(&ss->mutex);
+	generation = ss->scan_generation;
+	pthread_mutex_unlock(&ss->mutex);
+
+	settings = obs_source_get_settings(ss->source);
+	array = obs_data_get_array(settings, S_FILES);
+
+	da_init(new_files);
+	build_file_list(ss, array, &new_files.da, &cx, &cy, false);
+	get_output_size(settings, &cx, &cy);
+
+	pthread_mutex_lock(&ss->mutex);
+
+	/* the list is stale if the settings were updated in the meantime */
+	if (generation == ss->scan_generation) {
+		old_files.da = ss->scanned_files.da;
+		ss->scanned_files.da = new_files.da;
+		ss->scanned_cx = cx;
+		ss->scanned_cy = cy;
+		os_atomic_set_bool(&ss->has_scanned_files, true);
+	} else {
+		old_files.da = new_files.da;
+	}
+
+	pthread_mutex_unlock(&ss->mutex);
+
+	free_files(&old_files.da);
+	obs_data_array_release(array);
+	obs_data_release(settings);
+}
+
+static void *scan_thread(void *data)
+{
+	struct slideshow *ss = data;
+
+	os_set_thread_name("slideshow: scan");
+
+	while (os_sem_wait(ss->scan_sem) == 0) {
+		if (os_atomic_load_bool(&ss->scan_exit))
+			break;
+
+		scan_files(ss);
+		os_atomic_set_bool(&ss->scanning, false);
+	}
+
+	return NULL;
+}
+
+/* the thread is only started once a watched directory changes */
+static void request_scan(struct slideshow *ss)
+{
+	if (!ss->scan_thread_active) {
+		if (os_sem_init(&ss->scan_sem, 0) != 0)
+			return;
+		if (pthread_create(&ss->scan_thread, NULL, scan_thread, ss) !=
+		    0) {
+			os_sem_destroy(ss->scan_sem);
+			ss->scan_sem = NULL;
+			return;
+		}
+		ss->scan_thread_active = true;
+	}
+
+	os_atomic_set_bool(&ss->scanning, true);
+	os_sem_post(ss->scan_sem);
+}
+
+static void stop_scan_thread(struct slideshow *ss)
+{
+	if (!ss->scan_thread_active)
+		return;
+
+	os_atomic_set_bool(&ss->scan_exit, true);
+	os_sem_post(ss->scan_sem);
+	pthread_join(ss->scan_thread, NULL);
+	os_sem_destroy(ss->scan_sem);
+	ss->scan_thread_active = false;
+}
+
+/* Swaps in the list left by the scan thread, staying on the current slide
+ * if its file is still there */
+static void apply_scanned_files(struct slideshow *ss)
+{
+	DARRAY(struct image_file_data) old_files;
+	char *cur_path = NULL;
+	size_t idx = DARRAY_INVALID;
+	uint32_t cx;
+	uint32_t cy;
+
+	if (!os_atomic_load_bool(&ss->has_scanned_files))
+		return;
+
+	pthread_mutex_lock(&ss->mutex);
+
+	if (!ss->has_scanned_files) {
+		pthread_mutex_unlock(&ss->mutex);
+		return;
+	}
+
+	if (item_valid(ss))
+		cur_path = bstrdup(ss->files.array[ss->cur_item].path);
+
+	old_files.da = ss->files.da;
+	ss->files.da = ss->scanned_files.da;
+	da_init(ss->scanned_files);
+	os_atomic_set_bool(&ss->has_scanned_files, false);
+	cx = ss->scanned_cx;
+	cy = ss->scanned_cy;
+
+	if (cur_path)
+		idx = find_file(ss, cur_path);
+
+	pthread_mutex_unlock(&ss->mutex);
+
+	if (cx != ss->cx || cy != ss->cy) {
+		ss->cx = cx;
+		ss->cy = cy;
+		obs_transition_set_size(ss->transition, cx, cy);
+	}
+
+	if (idx != DARRAY_INVALID) {
+		ss->cur_item = idx;
+	} else {
+		if (ss->cur_item >= ss->files.num)
+			ss->cur_item = 0;
+		if (ss->files.num && !ss->stop)
+			do_transition(ss, false);
+	}
+
+	/* files that are still there keep their sources, so the current
+	 * slide is shown without reloading or transitioning to it again */
+	free_files(&old_files.da);
+	bfree(cur_path);
+}
+
 static void ss_update(void *data, obs_data_t *settings)
 {
 	DARRAY(struct image_file_data) new_files;
 	DARRAY(struct image_file_data) old_files;
+	DARRAY(struct image_file_data) scanned_files;
 	obs_source_t *new_tr = NULL;
 	obs_source_t *old_tr = NULL;
 	struct slideshow *ss = data;
@@ -269,7 +566,6 @@ static void ss_update(void *data, obs_data_t *settings)
 	uint32_t new_speed;
 	uint32_t cx = 0;
 	uint32_t cy = 0;
-	size_t count;
 	const char *behavior;
 	const char *mode;
 
@@ -312,56 +608,12 @@ static void ss_update(void *data, obs_data_t *settings)
 	new_speed = (uint32_t)obs_data_get_int(settings, S_TR_SPEED);
 
 	array = obs_data_get_array(settings, S_FILES);
-	count = obs_data_array_count(array);
 
 	/* ------------------------------------- */
 	/* create new list of sources */
 
-	ss->mem_usage = 0;
-
-	for (size_t i = 0; i < count; i++) {
-		obs_data_t *item = obs_data_array_item(array, i);
-		const char *path = obs_data_get_string(item, "value");
-		os_dir_t *dir = os_opendir(path);
-
-		if (dir) {
-			struct dstr dir_path = {0};
-			struct os_dirent *ent;
-
-			for (;;) {
-				const char *ext;
-
-				ent = os_readdir(dir);
-				if (!ent)
-					break;
-				if (ent->directory)
-					continue;
-
-				ext = os_get_path_extension(ent->d_name);
-				if (!valid_extension(ext))
-					continue;
-
-				dstr_copy(&dir_path, path);
-				dstr_cat_ch(&dir_path, '/');
-				dstr_cat(&dir_path, ent->d_name);
-				add_file(ss, &new_files.da, dir_path.array, &cx,
-					 &cy);
-
-				if (ss->mem_usage >= MAX_MEM_USAGE)
-					break;
-			}
-
-			dstr_free(&dir_path);
-			os_closedir(dir);
-		} else {
-			add_file(ss, &new_files.da, path, &cx, &cy);
-		}
-
-		obs_data_release(item);
-
-		if (ss->mem_usage >= MAX_MEM_USAGE)
-			break;
-	}
+	free_dir_watches(ss);
+	build_file_list(ss, array, &new_files.da, &cx, &cy, true);
 
 	/* ------------------------------------- */
 	/* update settings data */
@@ -370,6 +622,13 @@ static void ss_update(void *data, obs_data_t *settings)
 
 	old_files.da = ss->files.da;
 	ss->files.da = new_files.da;
+
+	/* anything scanned so far is based on the old settings */
+	scanned_files.da = ss->scanned_files.da;
+	da_init(ss->scanned_files);
+	os_atomic_set_bool(&ss->has_scanned_files, false);
+	ss->scan_generation++;
+
 	if (new_tr) {
 		old_tr = ss->transition;
 		ss->transition = new_tr;
@@ -397,46 +656,11 @@ static void ss_update(void *data, obs_data_t *settings)
 	if (old_tr)
 		obs_source_release(old_tr);
 	free_files(&old_files.da);
+	free_files(&scanned_files.da);
 
 	/* ------------------------- */
 
-	const char *res_str = obs_data_get_string(settings, S_CUSTOM_SIZE);
-	bool aspect_only = false, use_auto = true;
-	int cx_in = 0, cy_in = 0;
-
-	if (strcmp(res_str, T_CUSTOM_SIZE_AUTO) != 0) {
-		int ret = sscanf(res_str, "%dx%d", &cx_in, &cy_in);
-		if (ret == 2) {
-			aspect_only = false;
-			use_auto = false;
-		} else {
-			ret = sscanf(res_str, "%d:%d", &cx_in, &cy_in);
-			if (ret == 2) {
-				aspect_only = true;
-				use_auto = false;
-			}
-		}
-	}
-
-	if (!use_auto) {
-		double cx_f = (double)cx;
-		double cy_f = (double)cy;
-
-		double old_aspect = cx_f / cy_f;
-		double new_aspect = (double)cx_in / (double)cy_in;
-
-		if (aspect_only) {
-			if (fabs(old_aspect - new_aspect) > EPSILON) {
-				if (new_aspect > old_aspect)
-					cx = (uint32_t)(cy_f * new_aspect);
-				else
-					cy = (uint32_t)(cx_f / new_aspect);
-			}
-		} else {
-			cx = (uint32_t)cx_in;
-			cy = (uint32_t)cy_in;
-		}
-	}
+	get_output_size(settings, &cx, &cy);
 
 	/* ------------------------- */
 
@@ -444,6 +668,8 @@ static void ss_update(void *data, obs_data_t *settings)
 	ss->cy = cy;
 	ss->cur_item = 0;
 	ss->elapsed = 0.0f;
+	ss->rescan_time = 0;
+	os_atomic_set_bool(&ss->dirs_changed, false);
 	obs_transition_set_size(ss->transition, cx, cy);
 	obs_transition_set_alignment(ss->transition, OBS_ALIGN_CENTER);
 	obs_transition_set_scale_type(ss->transition,
@@ -591,8 +817,11 @@ static void ss_destroy(void *data)
 {
 	struct slideshow *ss = data;
 
+	free_dir_watches(ss);
+	stop_scan_thread(ss);
 	obs_source_release(ss->transition);
 	free_files(&ss->files.da);
+	free_files(&ss->scanned_files.da);
 	pthread_mutex_destroy(&ss->mutex);
 	bfree(ss);
 }
@@ -662,6 +891,19 @@ static void ss_video_tick(void *data, float seconds)
 	if (!ss->transition || !ss->slide_time)
 		return;
 
+	/* ----------------------------------------------------- */
+	/* rescan once the watched directories stop changing     */
+	if (os_atomic_set_bool(&ss->dirs_changed, false))
+		ss->rescan_time = os_gettime_ns() + RESCAN_DELAY_NS;
+
+	if (ss->rescan_time && os_gettime_ns() >= ss->rescan_time &&
+	    !os_atomic_load_bool(&ss->scanning)) {
+		ss->rescan_time = 0;
+		request_scan(ss);
+	}
+
+	apply_scanned_files(ss);
+
 	if (ss->restart_on_activate && !ss->randomize && ss->use_cut) {
 		ss->elapsed = 0.0f;
 		ss->cur_item = 0;
@@ -0,0 +1,581 @@
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <malloc.h>
+#include <windows.h>
+#define inline __inline
+#else
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <libavutil/mem.h>
+#include <libavutil/time.h>
+#include <libavformat/avformat.h>
+
+#include "ffmpeg-mux-io.h"
+
+#define MUX_IO_BLOCK_SIZE (1024 * 1024)
+#define MUX_IO_ALIGNMENT 4096
+#define MUX_IO_MIN_BLOCKS 4
+#define MUX_IO_AVIO_BUFFER_SIZE (64 * 1024)
+#define MUX_IO_SLOW_WRITE_US 100000
+#define MUX_IO_STATS_INTERVAL_US 1000000
+
+struct mux_block {
+	uint8_t *data;
+	size_t size;
+	size_t capacity;
+	int64_t offset;
+};
+
+struct mux_io {
+	int fd;
+	int direct_fd;
+
+	AVIOContext *pb;
+	struct mux_io_settings settings;
+
+	/* blocks are owned by the muxer thread while they are being filled,
+	 * then queued in order for the writer thread */
+	struct mux_block *blocks;
+	size_t num_blocks;
+	struct mux_block **free_blocks;
+	size_t num_free;
+	struct mux_block **pending;
+	size_t pending_start;
+	size_t num_pending;
+	struct mux_block *cur;
+
+	int64_t pos;
+	int64_t end;
+
+	pthread_t thread;
+	bool thread_created;
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond;
+	pthread_cond_t free_cond;
+	bool exit;
+	bool error;
+
+	struct mux_io_stats stats;
+	int64_t last_sync;
+	int64_t last_stats;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static void *aligned_alloc_block(size_t size)
+{
+#ifdef _WIN32
+	return _aligned_malloc(size, MUX_IO_ALIGNMENT);
+#else
+	void *ptr = NULL;
+	if (posix_memalign(&ptr, MUX_IO_ALIGNMENT, size) != 0)
+		return NULL;
+	return ptr;
+#endif
+}
+
+static void aligned_free_block(void *ptr)
+{
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+static int open_file(const char *path)
+{
+#ifdef _WIN32
+	wchar_t *wpath;
+	int size;
+	int fd;
+
+	size = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+	if (!size)
+		return -1;
+
+	wpath = malloc(size * sizeof(wchar_t));
+	MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, size);
+
+	fd = _wopen(wpath, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+		    _S_IREAD | _S_IWRITE);
+	free(wpath);
+	return fd;
+#else
+	return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+#endif
+}
+
+static int open_direct(const char *path)
+{
+#if defined(O_DIRECT) && !defined(_WIN32)
+	return open(path, O_WRONLY | O_DIRECT);
+#else
+	(void)path;
+	return -1;
+#endif
+}
+
+static void close_file(int fd)
+{
+	if (fd == -1)
+		return;
+#ifdef _WIN32
+	_close(fd);
+#else
+	close(fd);
+#endif
+}
+
+static void sync_file(int fd)
+{
+#if defined(_WIN32)
+	_commit(fd);
+#elif defined(__APPLE__)
+	fsync(fd);
+#else
+	fdatasync(fd);
+#endif
+}
+
+static bool write_at(int fd, const uint8_t *data, size_t size, int64_t offset)
+{
+	while (size > 0) {
+#ifdef _WIN32
+		int ret;
+
+		if (_lseeki64(fd, offset, SEEK_SET) < 0)
+			return false;
+
+		ret = _write(fd, data, (unsigned int)size);
+#else
+		ssize_t ret = pwrite(fd, data, size, (off_t)offset);
+		if (ret < 0 && errno == EINTR)
+			continue;
+#endif
+		if (ret <= 0)
+			return false;
+
+		data += ret;
+		size -= (size_t)ret;
+		offset += ret;
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* writer thread                                                             */
+
+static void publish_stats(struct mux_io *io)
+{
+	struct mux_io_stats stats;
+
+	if (!io->settings.stats_cb)
+		return;
+
+	pthread_mutex_lock(&io->mutex);
+	stats = io->stats;
+	pthread_mutex_unlock(&io->mutex);
+
+	io->settings.stats_cb(io->settings.stats_param, &stats);
+}
+
+static void do_periodic_tasks(struct mux_io *io)
+{
+	int64_t now = av_gettime_relative();
+
+	if (io->settings.sync_interval_sec > 0 &&
+	    now - io->last_sync >=
+		    (int64_t)io->settings.sync_interval_sec * 1000000) {
+		sync_file(io->fd);
+		io->last_sync = now;
+
+		pthread_mutex_lock(&io->mutex);
+		io->stats.syncs++;
+		pthread_mutex_unlock(&io->mutex);
+	}
+
+	if (now - io->last_stats >= MUX_IO_STATS_INTERVAL_US) {
+		publish_stats(io);
+		io->last_stats = now;
+	}
+}
+
+static bool write_block(struct mux_io *io, const struct mux_block *block)
+{
+	int fd = io->fd;
+
+	/* only whole, aligned blocks can bypass the page cache; anything
+	 * else, such as header rewrites after a seek, goes the normal way */
+	if (io->direct_fd != -1 && block->size == MUX_IO_BLOCK_SIZE &&
+	    (block->offset % MUX_IO_ALIGNMENT) == 0)
+		fd = io->direct_fd;
+
+	return write_at(fd, block->data, block->size, block->offset);
+}
+
+static void wait_for_work(struct mux_io *io)
+{
+	struct timespec ts;
+
+	timespec_get(&ts, TIME_UTC);
+	ts.tv_sec += 1;
+
+	pthread_cond_timedwait(&io->work_cond, &io->mutex, &ts);
+}
+
+static void *writer_thread(void *data)
+{
+	struct mux_io *io = data;
+
+	for (;;) {
+		struct mux_block *block = NULL;
+		int64_t start, latency;
+		bool success = true;
+
+		pthread_mutex_lock(&io->mutex);
+
+		if (!io->num_pending && !io->exit)
+			wait_for_work(io);
+
+		if (io->num_pending) {
+			block = io->pending[io->pending_start];
+			io->pending_start =
+				(io->pending_start + 1) % io->num_blocks;
+			io->num_pending--;
+		} else if (io->exit) {
+			pthread_mutex_unlock(&io->mutex);
+			break;
+		}
+
+		pthread_mutex_unlock(&io->mutex);
+
+		if (block) {
+			start = av_gettime_relative();
+			if (!io->error)
+				success = write_block(io, block);
+			latency = av_gettime_relative() - start;
+
+			pthread_mutex_lock(&io->mutex);
+
+			if (!success && !io->error) {
+				fprintf(stderr, "Failed to write to file\n");
+				io->error = true;
+			}
+
+			io->stats.bytes_written += (int64_t)block->size;
+			io->stats.writes++;
+			io->stats.total_latency_us += latency;
+			io->stats.pending_bytes -= (int64_t)block->size;
+			if (latency > io->stats.max_latency_us)
+				io->stats.max_latency_us = latency;
+			if (latency >= MUX_IO_SLOW_WRITE_US)
+				io->stats.slow_writes++;
+
+			io->free_blocks[io->num_free++] = block;
+			pthread_cond_signal(&io->free_cond);
+			pthread_mutex_unlock(&io->mutex);
+		}
+
+		do_periodic_tasks(io);
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* AVIO callbacks, called from the muxer thread                              */
+
+static void submit_block(struct mux_io *io)
+{
+	struct mux_block *block = io->cur;
+	size_t idx;
+
+	io->cur = NULL;
+	if (!block)
+		return;
+
+	pthread_mutex_lock(&io->mutex);
+
+	if (!block->size) {
+		io->free_blocks[io->num_free++] = block;
+	} else {
+		idx = (io->pending_start + io->num_pending) % io->num_blocks;
+		io->pending[idx] = block;
+		io->num_pending++;
+		io->stats.pending_bytes += (int64_t)block->size;
+		pthread_cond_signal(&io->work_cond);
+	}
+
+	pthread_mutex_unlock(&io->mutex);
+}
+
+static struct mux_block *get_free_block(struct mux_io *io)
+{
+	struct mux_block *block = NULL;
+
+	pthread_mutex_lock(&io->mutex);
+
+	if (!io->num_free && !io->error) {
+		int64_t start = av_gettime_relative();
+
+		while (!io->num_free && !io->error)
+			pthread_cond_wait(&io->free_cond, &io->mutex);
+
+		io->stats.stall_us += av_gettime_relative() - start;
+	}
+
+	if (!io->error)
+		block = io->free_blocks[--io->num_free];
+
+	pthread_mutex_unlock(&io->mutex);
+	return block;
+}
+
+static int mux_io_write(void *opaque, uint8_t *buf, int buf_size)
+{
+	struct mux_io *io = opaque;
+	size_t remaining = (size_t)buf_size;
+
+	while (remaining > 0) {
+		struct mux_block *block = io->cur;
+		size_t size;
+
+		/* a seek happened since the block was started */
+		if (block && block->offset + (int64_t)block->size != io->pos) {
+			submit_block(io);
+			block = NULL;
+		}
+
+		if (!block) {
+			block = get_free_block(io);
+			if (!block)
+				return AVERROR(EIO);
+
+			/* after a seek or a flush, end the block on an
+			 * aligned offset so the following ones are aligned */
+			block->offset = io->pos;
+			block->size = 0;
+			block->capacity = MUX_IO_BLOCK_SIZE -
+					  (size_t)(io->pos % MUX_IO_ALIGNMENT);
+			io->cur = block;
+		}
+
+		size = block->capacity - block->size;
+		if (size > remaining)
+			size = remaining;
+
+		memcpy(block->data + block->size, buf, size);
+		block->size += size;
+		buf += size;
+		remaining -= size;
+
+		io->pos += (int64_t)size;
+		if (io->pos > io->end)
+			io->end = io->pos;
+
+		if (block->size == block->capacity)
+			submit_block(io);
+	}
+
+	return buf_size;
+}
+
+static int64_t mux_io_seek(void *opaque, int64_t offset, int whence)
+{
+	struct mux_io *io = opaque;
+
+	switch (whence & ~AVSEEK_FORCE) {
+	case SEEK_SET:
+		io->pos = offset;
+		break;
+	case SEEK_CUR:
+		io->pos += offset;
+		break;
+	case SEEK_END:
+		io->pos = io->end + offset;
+		break;
+	case AVSEEK_SIZE:
+		return io->end;
+	default:
+		return AVERROR(EINVAL);
+	}
+
+	return io->pos;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void mux_io_free(struct mux_io *io)
+{
+	if (io->pb) {
+		av_freep(&io->pb->buffer);
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 80, 100)
+		avio_context_free(&io->pb);
+#else
+		av_freep(&io->pb);
+#endif
+	}
+
+	if (io->blocks) {
+		for (size_t i = 0; i < io->num_blocks; i++)
+			aligned_free_block(io->blocks[i].data);
+	}
+
+	close_file(io->direct_fd);
+	close_file(io->fd);
+
+	pthread_mutex_destroy(&io->mutex);
+	pthread_cond_destroy(&io->work_cond);
+	pthread_cond_destroy(&io->free_cond);
+
+	free(io->blocks);
+	free(io->free_blocks);
+	free(io->pending);
+	free(io);
+}
+
+static bool init_blocks(struct mux_io *io)
+{
+	size_t num = (size_t)io->settings.buffer_size_mb * 1024 * 1024 /
+		     MUX_IO_BLOCK_SIZE;
+	if (num < MUX_IO_MIN_BLOCKS)
+		num = MUX_IO_MIN_BLOCKS;
+
+	io->blocks = calloc(num, sizeof(*io->blocks));
+	io->free_blocks = calloc(num, sizeof(*io->free_blocks));
+	io->pending = calloc(num, sizeof(*io->pending));
+	if (!io->blocks || !io->free_blocks || !io->pending)
+		return false;
+
+	io->num_blocks = num;
+
+	for (size_t i = 0; i < num; i++) {
+		io->blocks[i].data = aligned_alloc_block(MUX_IO_BLOCK_SIZE);
+		if (!io->blocks[i].data)
+			return false;
+
+		io->free_blocks[io->num_free++] = &io->blocks[i];
+	}
+
+	return true;
+}
+
+int mux_io_open(struct mux_io **p_io, AVIOContext **pb, const char *path,
+		const struct mux_io_settings *settings)
+{
+	struct mux_io *io = calloc(1, sizeof(*io));
+	uint8_t *avio_buf;
+
+	if (!io)
+		return AVERROR(ENOMEM);
+
+	io->fd = -1;
+	io->direct_fd = -1;
+	io->settings = *settings;
+
+	pthread_mutex_init(&io->mutex, NULL);
+	pthread_cond_init(&io->work_cond, NULL);
+	pthread_cond_init(&io->free_cond, NULL);
+
+	io->fd = open_file(path);
+	if (io->fd == -1) {
+		mux_io_free(io);
+		return AVERROR(EIO);
+	}
+
+	if (settings->direct_io) {
+		io->direct_fd = open_direct(path);
+		if (io->direct_fd == -1)
+			printf("Direct I/O is not available for '%s'\n", path);
+	}
+
+	if (!init_blocks(io)) {
+		mux_io_free(io);
+		return AVERROR(ENOMEM);
+	}
+
+	avio_buf = av_malloc(MUX_IO_AVIO_BUFFER_SIZE);
+	io->pb = avio_alloc_context(avio_buf, MUX_IO_AVIO_BUFFER_SIZE, 1, io,
+				    NULL, mux_io_write, mux_io_seek);
+	if (!io->pb) {
+		av_free(avio_buf);
+		mux_io_free(io);
+		return AVERROR(ENOMEM);
+	}
+
+	io->last_sync = io->last_stats = av_gettime_relative();
+
+	if (pthread_create(&io->thread, NULL, writer_thread, io) != 0) {
+		mux_io_free(io);
+		return AVERROR(ENOMEM);
+	}
+
+	io->thread_created = true;
+
+	printf("Writing through %d MB of %d KB blocks%s\n",
+	       (int)(io->num_blocks * MUX_IO_BLOCK_SIZE / (1024 * 1024)),
+	       MUX_IO_BLOCK_SIZE / 1024,
+	       io->direct_fd != -1 ? " with direct I/O" : "");
+
+	*pb = io->pb;
+	*p_io = io;
+	return 0;
+}
+
+int mux_io_close(struct mux_io *io)
+{
+	bool error;
+
+	if (!io)
+		return 0;
+
+	avio_flush(io->pb);
+	submit_block(io);
+
+	pthread_mutex_lock(&io->mutex);
+	io->exit = true;
+	pthread_cond_signal(&io->work_cond);
+	pthread_mutex_unlock(&io->mutex);
+
+	if (io->thread_created)
+		pthread_join(io->thread, NULL);
+
+	if (io->settings.sync_interval_sec > 0)
+		sync_file(io->fd);
+
+	publish_stats(io);
+
+	error = io->error;
+	mux_io_free(io);
+	return error ? -1 : 0;
+}
+
+void mux_io_flush(struct mux_io *io)
+{
+	submit_block(io);
+}
+
+bool mux_io_failed(struct mux_io *io)
+{
+	bool error;
+
+	pthread_mutex_lock(&io->mutex);
+	error = io->error;
+	pthread_mutex_unlock(&io->mutex);
+
+	return error;
+}
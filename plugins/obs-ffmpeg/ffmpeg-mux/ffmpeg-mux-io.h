@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libavformat/avio.h>
+
+/*
+ * File output for the muxer.  Whatever libavformat writes is gathered into
+ * large aligned blocks which a separate thread writes to disk, so that a slow
+ * disk doesn't stall reading packets from the pipe until the buffer fills.
+ */
+
+struct mux_io_stats;
+
+struct mux_io_settings {
+	/* total memory used for blocks waiting to be written */
+	int buffer_size_mb;
+	/* write full blocks with O_DIRECT where the platform supports it */
+	bool direct_io;
+	/* flush file data to the disk this often, 0 to leave it to the OS */
+	int sync_interval_sec;
+	/* periodically receives a mux_io_stats snapshot from the writer
+	 * thread, and a final one when the file is closed, or NULL */
+	void (*stats_cb)(void *param, const struct mux_io_stats *stats);
+	void *stats_param;
+};
+
+struct mux_io_stats {
+	int64_t bytes_written;
+	int64_t writes;
+	int64_t total_latency_us;
+	int64_t max_latency_us;
+	int64_t slow_writes;
+	int64_t stall_us;
+	int64_t pending_bytes;
+	int64_t syncs;
+};
+
+struct mux_io;
+
+extern int mux_io_open(struct mux_io **io, AVIOContext **pb, const char *path,
+		       const struct mux_io_settings *settings);
+
+/* Writes out everything still queued and closes the file.  The AVIOContext
+ * is freed as well.  Returns 0 on success. */
+extern int mux_io_close(struct mux_io *io);
+
+/* Queues whatever has been written so far for the writer thread, even if
+ * it doesn't fill a block.  Call avio_flush first. */
+extern void mux_io_flush(struct mux_io *io);
+
+extern bool mux_io_failed(struct mux_io *io);
@@ -0,0 +1,776 @@
+#ifdef _WIN32
+#include <windows.h>
+#define inline __inline
+#else
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "ffmpeg-mux-shm.h"
+
+#if defined(_WIN32) || defined(__linux__)
+#define FFM_SHM_SUPPORTED 1
+#else
+#define FFM_SHM_SUPPORTED 0
+#endif
+
+#define FFM_SHM_MAGIC 0x4d484646 /* "FFHM" */
+#define FFM_SHM_MIN_CAPACITY (64 * 1024)
+#define FFM_SHM_MAX_CAPACITY (256 * 1024 * 1024)
+
+/* how long a doorbell wait sleeps before checking on the other side */
+#define FFM_SHM_WAIT_MS 100
+#define FFM_SHM_HEARTBEAT_MS 100
+
+/* the consumer is considered gone when its heartbeat has stopped for this
+ * many waits (3 seconds); its main thread may well be blocked on the disk
+ * for longer than that, but the heartbeat comes from its own thread */
+#define FFM_SHM_DEAD_WAITS 30
+
+enum ffm_shm_state {
+	FFM_SHM_PENDING,
+	FFM_SHM_ATTACHED,
+	FFM_SHM_ABANDONED,
+};
+
+enum ffm_shm_bell {
+	FFM_SHM_BELL_DATA,
+	FFM_SHM_BELL_SPACE,
+};
+
+/* Positions count bytes since the start and are allowed to wrap, the
+ * capacity is a power of two so they can be masked into an offset.  All
+ * fields are only accessed through the atomic helpers below. */
+struct ffm_shm_header {
+	uint32_t magic;
+	uint32_t capacity;
+	uint32_t data_offset;
+	volatile uint32_t state;
+
+	/* written by the producer */
+	volatile uint32_t write_pos;
+	volatile uint32_t closed;
+
+	/* written by the consumer */
+	volatile uint32_t read_pos;
+	volatile uint32_t reader_closed;
+	volatile uint32_t heartbeat;
+
+	/* doorbells, indexed by enum ffm_shm_bell */
+	volatile uint32_t seq[2];
+	volatile uint32_t waiting[2];
+
+	/* written by the consumer, stats_seq is odd while they're being
+	 * updated and 0 until the first update */
+	volatile uint32_t stats_seq;
+	uint32_t num_stats;
+	volatile int64_t stats[FFM_SHM_MAX_STATS];
+};
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef _WIN32
+static inline uint32_t atomic_load32(volatile uint32_t *ptr)
+{
+	return (uint32_t)InterlockedOr((volatile long *)ptr, 0);
+}
+
+static inline void atomic_store32(volatile uint32_t *ptr, uint32_t val)
+{
+	InterlockedExchange((volatile long *)ptr, (long)val);
+}
+
+static inline uint32_t atomic_inc32(volatile uint32_t *ptr)
+{
+	return (uint32_t)InterlockedIncrement((volatile long *)ptr);
+}
+
+static inline bool atomic_cas32(volatile uint32_t *ptr, uint32_t old_val,
+				uint32_t new_val)
+{
+	return (uint32_t)InterlockedCompareExchange((volatile long *)ptr,
+						    (long)new_val,
+						    (long)old_val) == old_val;
+}
+#else
+static inline uint32_t atomic_load32(volatile uint32_t *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_store32(volatile uint32_t *ptr, uint32_t val)
+{
+	__atomic_store_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t atomic_inc32(volatile uint32_t *ptr)
+{
+	return __atomic_add_fetch(ptr, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline bool atomic_cas32(volatile uint32_t *ptr, uint32_t old_val,
+				uint32_t new_val)
+{
+	return __atomic_compare_exchange_n(ptr, &old_val, new_val, false,
+					   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#endif
+
+static void sleep_ms(uint32_t ms)
+{
+#ifdef _WIN32
+	Sleep(ms);
+#else
+	struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000};
+	nanosleep(&ts, NULL);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+/* doorbells                                                                 */
+
+#ifdef __linux__
+static void futex_wait(volatile uint32_t *addr, uint32_t val, uint32_t ms)
+{
+	struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000};
+	syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void futex_wake(volatile uint32_t *addr)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+#endif
+
+static void ring_bell(struct ffm_shm *shm, enum ffm_shm_bell bell)
+{
+	atomic_inc32(&shm->header->seq[bell]);
+#ifdef _WIN32
+	SetEvent(shm->events[bell]);
+#elif defined(__linux__)
+	futex_wake(&shm->header->seq[bell]);
+#endif
+}
+
+/* only rings when the other side said it's about to sleep, which is what
+ * keeps the common case free of system calls */
+static inline void ring_bell_if_waiting(struct ffm_shm *shm,
+					enum ffm_shm_bell bell)
+{
+	if (atomic_load32(&shm->header->waiting[bell]))
+		ring_bell(shm, bell);
+}
+
+/* 'seq' must have been read before checking the condition being waited
+ * for, so a ring in between makes the wait return right away */
+static void wait_bell(struct ffm_shm *shm, enum ffm_shm_bell bell,
+		      uint32_t seq)
+{
+#ifdef _WIN32
+	(void)seq;
+	WaitForSingleObject(shm->events[bell], FFM_SHM_WAIT_MS);
+#elif defined(__linux__)
+	futex_wait(&shm->header->seq[bell], seq, FFM_SHM_WAIT_MS);
+#else
+	(void)shm;
+	(void)bell;
+	(void)seq;
+	sleep_ms(FFM_SHM_WAIT_MS);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+/* mapping                                                                   */
+
+static inline uint32_t data_offset(void)
+{
+	return (sizeof(struct ffm_shm_header) + 63) & ~63;
+}
+
+static uint32_t round_capacity(size_t capacity)
+{
+	uint32_t size = FFM_SHM_MIN_CAPACITY;
+
+	if (capacity > FFM_SHM_MAX_CAPACITY)
+		capacity = FFM_SHM_MAX_CAPACITY;
+	while (size < capacity)
+		size <<= 1;
+	return size;
+}
+
+#ifdef _WIN32
+static bool create_events(struct ffm_shm *shm, bool create)
+{
+	char name[FFM_SHM_NAME_SIZE + 8];
+
+	for (int i = 0; i < 2; i++) {
+		snprintf(name, sizeof(name), "%s-%s", shm->name,
+			 i == FFM_SHM_BELL_DATA ? "data" : "space");
+		shm->events[i] = create ? CreateEventA(NULL, false, false, name)
+					: OpenEventA(EVENT_MODIFY_STATE |
+							     SYNCHRONIZE,
+						     false, name);
+		if (!shm->events[i])
+			return false;
+	}
+
+	return true;
+}
+
+static bool map_ring(struct ffm_shm *shm, uint32_t size, bool create)
+{
+	if (create) {
+		shm->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL,
+						  PAGE_READWRITE, 0, size,
+						  shm->name);
+		if (shm->mapping && GetLastError() == ERROR_ALREADY_EXISTS) {
+			CloseHandle(shm->mapping);
+			shm->mapping = NULL;
+		}
+	} else {
+		shm->mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, false,
+						shm->name);
+	}
+
+	if (!shm->mapping)
+		return false;
+
+	shm->header = MapViewOfFile(shm->mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+				    size);
+	return shm->header && create_events(shm, create);
+}
+
+static void unmap_ring(struct ffm_shm *shm, uint32_t size)
+{
+	for (int i = 0; i < 2; i++) {
+		if (shm->events[i])
+			CloseHandle(shm->events[i]);
+		shm->events[i] = NULL;
+	}
+
+	if (shm->header)
+		UnmapViewOfFile(shm->header);
+	if (shm->mapping)
+		CloseHandle(shm->mapping);
+	shm->mapping = NULL;
+	(void)size;
+}
+
+static inline unsigned long get_pid(void)
+{
+	return GetCurrentProcessId();
+}
+
+static inline void unlink_ring(struct ffm_shm *shm)
+{
+	(void)shm;
+}
+#elif defined(__linux__)
+static bool map_ring(struct ffm_shm *shm, uint32_t size, bool create)
+{
+	void *ptr;
+	int fd;
+
+	if (create)
+		fd = shm_open(shm->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	else
+		fd = shm_open(shm->name, O_RDWR, 0);
+	if (fd == -1)
+		return false;
+
+	if (create && ftruncate(fd, size) != 0) {
+		close(fd);
+		shm_unlink(shm->name);
+		return false;
+	}
+
+	if (!create) {
+		struct stat st;
+		if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < size) {
+			close(fd);
+			return false;
+		}
+	}
+
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (ptr == MAP_FAILED) {
+		if (create)
+			shm_unlink(shm->name);
+		return false;
+	}
+
+	shm->header = ptr;
+	return true;
+}
+
+static void unmap_ring(struct ffm_shm *shm, uint32_t size)
+{
+	if (shm->header)
+		munmap(shm->header, size);
+}
+
+static inline unsigned long get_pid(void)
+{
+	return (unsigned long)getpid();
+}
+
+/* the mapping stays valid for everyone who has it mapped already, so the
+ * name is removed as soon as the consumer has attached (or given up) to
+ * not leave anything behind in /dev/shm if obs exits uncleanly */
+static inline void unlink_ring(struct ffm_shm *shm)
+{
+	if (*shm->name)
+		shm_unlink(shm->name);
+	*shm->name = 0;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* producer                                                                  */
+
+bool ffm_shm_create(struct ffm_shm *shm, size_t capacity)
+{
+#if FFM_SHM_SUPPORTED
+	static volatile uint32_t counter = 0;
+	uint32_t id = atomic_inc32(&counter);
+	uint32_t size;
+
+	memset(shm, 0, sizeof(*shm));
+	shm->producer = true;
+	shm->capacity = round_capacity(capacity);
+	size = data_offset() + shm->capacity;
+
+	/* the name ends up in the mux process' io settings, which are parsed
+	 * with backslash escapes, so the session local namespace that Windows
+	 * uses by default isn't spelled out */
+#ifdef _WIN32
+	snprintf(shm->name, sizeof(shm->name), "obs-ffmpeg-mux-%lu-%u",
+		 get_pid(), id);
+#else
+	snprintf(shm->name, sizeof(shm->name), "/obs-ffmpeg-mux-%lu-%u",
+		 get_pid(), id);
+#endif
+
+	if (!map_ring(shm, size, true)) {
+		unmap_ring(shm, size);
+		memset(shm, 0, sizeof(*shm));
+		return false;
+	}
+
+	memset(shm->header, 0, sizeof(*shm->header));
+	shm->header->capacity = shm->capacity;
+	shm->header->data_offset = data_offset();
+	shm->header->state = FFM_SHM_PENDING;
+	atomic_store32(&shm->header->magic, FFM_SHM_MAGIC);
+
+	shm->data = (uint8_t *)shm->header + data_offset();
+	return true;
+#else
+	memset(shm, 0, sizeof(*shm));
+	(void)capacity;
+	return false;
+#endif
+}
+
+bool ffm_shm_wait_attach(struct ffm_shm *shm, uint32_t timeout_ms)
+{
+	struct ffm_shm_header *header = shm->header;
+	uint32_t waited = 0;
+	bool attached;
+
+	if (!header)
+		return false;
+
+	atomic_store32(&header->waiting[FFM_SHM_BELL_SPACE], 1);
+
+	for (;;) {
+		uint32_t seq = atomic_load32(&header->seq[FFM_SHM_BELL_SPACE]);
+
+		if (atomic_load32(&header->state) != FFM_SHM_PENDING)
+			break;
+
+		/* whoever changes the state first wins, so the consumer can't
+		 * attach after the producer has gone back to the pipe */
+		if (waited >= timeout_ms) {
+			atomic_cas32(&header->state, FFM_SHM_PENDING,
+				     FFM_SHM_ABANDONED);
+			break;
+		}
+
+		wait_bell(shm, FFM_SHM_BELL_SPACE, seq);
+		waited += FFM_SHM_WAIT_MS;
+	}
+
+	atomic_store32(&header->waiting[FFM_SHM_BELL_SPACE], 0);
+
+	attached = atomic_load32(&header->state) == FFM_SHM_ATTACHED;
+#if FFM_SHM_SUPPORTED
+	unlink_ring(shm);
+#endif
+	return attached;
+}
+
+/* waits for the consumer to free up some space, returns false if the
+ * consumer is gone */
+static bool wait_for_space(struct ffm_shm *shm, uint32_t *last_heartbeat,
+			   uint32_t *dead_waits)
+{
+	struct ffm_shm_header *header = shm->header;
+	uint32_t seq = atomic_load32(&header->seq[FFM_SHM_BELL_SPACE]);
+	uint32_t heartbeat;
+	bool full;
+
+	atomic_store32(&header->waiting[FFM_SHM_BELL_SPACE], 1);
+	full = atomic_load32(&header->write_pos) -
+		       atomic_load32(&header->read_pos) ==
+	       shm->capacity;
+	if (full && !atomic_load32(&header->reader_closed))
+		wait_bell(shm, FFM_SHM_BELL_SPACE, seq);
+	atomic_store32(&header->waiting[FFM_SHM_BELL_SPACE], 0);
+
+	if (atomic_load32(&header->reader_closed))
+		return false;
+
+	heartbeat = atomic_load32(&header->heartbeat);
+	if (heartbeat != *last_heartbeat) {
+		*last_heartbeat = heartbeat;
+		*dead_waits = 0;
+	} else if (full && ++*dead_waits >= FFM_SHM_DEAD_WAITS) {
+		fprintf(stderr, "ffmpeg-mux stopped responding\n");
+		return false;
+	}
+
+	return true;
+}
+
+bool ffm_shm_write(struct ffm_shm *shm, const void *vdata, size_t size)
+{
+	struct ffm_shm_header *header = shm->header;
+	const uint8_t *data = vdata;
+	const uint32_t mask = shm->capacity - 1;
+	uint32_t last_heartbeat = atomic_load32(&header->heartbeat);
+	uint32_t dead_waits = 0;
+
+	while (size > 0) {
+		uint32_t write_pos = header->write_pos;
+		uint32_t used = write_pos - atomic_load32(&header->read_pos);
+		uint32_t space = shm->capacity - used;
+		uint32_t offset = write_pos & mask;
+		uint32_t count;
+		uint32_t first;
+
+		if (atomic_load32(&header->reader_closed))
+			return false;
+
+		if (!space) {
+			if (!wait_for_space(shm, &last_heartbeat, &dead_waits))
+				return false;
+			continue;
+		}
+
+		count = size < space ? (uint32_t)size : space;
+		first = shm->capacity - offset;
+		if (first > count)
+			first = count;
+
+		memcpy(shm->data + offset, data, first);
+		memcpy(shm->data, data + first, count - first);
+
+		/* publishes the data, then checks if the reader needs waking
+		 * (both are full barriers, so neither side can miss the
+		 * other) */
+		atomic_store32(&header->write_pos, write_pos + count);
+		ring_bell_if_waiting(shm, FFM_SHM_BELL_DATA);
+
+		data += count;
+		size -= count;
+	}
+
+	return true;
+}
+
+void ffm_shm_close(struct ffm_shm *shm)
+{
+	if (!shm->header)
+		return;
+
+	atomic_store32(&shm->header->closed, 1);
+	ring_bell(shm, FFM_SHM_BELL_DATA);
+}
+
+/* ------------------------------------------------------------------------- */
+/* consumer                                                                  */
+
+struct heartbeat {
+	pthread_t thread;
+	volatile uint32_t exit;
+	volatile uint32_t *counter;
+};
+
+static void *heartbeat_thread(void *data)
+{
+	struct heartbeat *hb = data;
+
+	while (!atomic_load32(&hb->exit)) {
+		atomic_inc32(hb->counter);
+		sleep_ms(FFM_SHM_HEARTBEAT_MS);
+	}
+
+	return NULL;
+}
+
+static void stop_heartbeat(struct ffm_shm *shm)
+{
+	struct heartbeat *hb = shm->heartbeat;
+
+	if (!hb)
+		return;
+
+	atomic_store32(&hb->exit, 1);
+	pthread_join(hb->thread, NULL);
+	free(hb);
+	shm->heartbeat = NULL;
+}
+
+static bool start_heartbeat(struct ffm_shm *shm)
+{
+	struct heartbeat *hb = calloc(1, sizeof(*hb));
+
+	hb->counter = &shm->header->heartbeat;
+	if (pthread_create(&hb->thread, NULL, heartbeat_thread, hb) != 0) {
+		free(hb);
+		return false;
+	}
+
+	shm->heartbeat = hb;
+	return true;
+}
+
+/* the producer keeps the pipe open but doesn't write to it while the ring
+ * is in use, so the pipe closing (or becoming readable) means it's gone */
+static bool producer_gone(void)
+{
+#ifdef _WIN32
+	DWORD avail = 0;
+	return !PeekNamedPipe(GetStdHandle(STD_INPUT_HANDLE), NULL, 0, NULL,
+			      &avail, NULL) ||
+	       avail > 0;
+#else
+	struct pollfd pfd = {.fd = STDIN_FILENO, .events = POLLIN};
+	return poll(&pfd, 1, 0) > 0;
+#endif
+}
+
+bool ffm_shm_open(struct ffm_shm *shm, const char *name)
+{
+#if FFM_SHM_SUPPORTED
+	struct ffm_shm_header *header;
+	uint32_t capacity;
+	uint32_t size = data_offset();
+
+	memset(shm, 0, sizeof(*shm));
+	snprintf(shm->name, sizeof(shm->name), "%s", name);
+
+	/* map the header first to find out how large the ring is */
+	if (!map_ring(shm, size, false))
+		goto fail;
+
+	header = shm->header;
+	capacity = header->capacity;
+	if (atomic_load32(&header->magic) != FFM_SHM_MAGIC ||
+	    header->data_offset != data_offset() ||
+	    capacity < FFM_SHM_MIN_CAPACITY ||
+	    capacity > FFM_SHM_MAX_CAPACITY || (capacity & (capacity - 1)))
+		goto fail;
+
+	unmap_ring(shm, size);
+	shm->header = NULL;
+
+	size = data_offset() + capacity;
+	if (!map_ring(shm, size, false))
+		goto fail;
+
+	shm->capacity = capacity;
+	shm->data = (uint8_t *)shm->header + data_offset();
+
+	if (!start_heartbeat(shm))
+		goto fail;
+
+	if (!atomic_cas32(&shm->header->state, FFM_SHM_PENDING,
+			  FFM_SHM_ATTACHED)) {
+		stop_heartbeat(shm);
+		goto fail;
+	}
+
+	ring_bell(shm, FFM_SHM_BELL_SPACE);
+	return true;
+
+fail:
+	unmap_ring(shm, size);
+	memset(shm, 0, sizeof(*shm));
+	return false;
+#else
+	memset(shm, 0, sizeof(*shm));
+	(void)name;
+	return false;
+#endif
+}
+
+/* waits for the producer to write more, returns false at end of file */
+static bool wait_for_data(struct ffm_shm *shm)
+{
+	struct ffm_shm_header *header = shm->header;
+	uint32_t seq = atomic_load32(&header->seq[FFM_SHM_BELL_DATA]);
+	uint32_t closed;
+	bool empty;
+
+	atomic_store32(&header->waiting[FFM_SHM_BELL_DATA], 1);
+
+	/* 'closed' is set after the last write, so if it's seen here, the
+	 * write position checked after it is final */
+	closed = atomic_load32(&header->closed);
+	empty = atomic_load32(&header->write_pos) ==
+		atomic_load32(&header->read_pos);
+	if (empty && !closed)
+		wait_bell(shm, FFM_SHM_BELL_DATA, seq);
+
+	atomic_store32(&header->waiting[FFM_SHM_BELL_DATA], 0);
+
+	if (empty && closed)
+		return false;
+	if (empty && producer_gone()) {
+		fprintf(stderr, "Lost connection to obs\n");
+		return false;
+	}
+
+	return true;
+}
+
+size_t ffm_shm_read(struct ffm_shm *shm, void *vdata, size_t size)
+{
+	struct ffm_shm_header *header = shm->header;
+	uint8_t *data = vdata;
+	const uint32_t mask = shm->capacity - 1;
+	size_t total = size;
+
+	while (size > 0) {
+		uint32_t read_pos = header->read_pos;
+		uint32_t avail = atomic_load32(&header->write_pos) - read_pos;
+		uint32_t offset = read_pos & mask;
+		uint32_t count;
+		uint32_t first;
+
+		if (!avail) {
+			if (!wait_for_data(shm))
+				return 0;
+			continue;
+		}
+
+		count = size < avail ? (uint32_t)size : avail;
+		first = shm->capacity - offset;
+		if (first > count)
+			first = count;
+
+		memcpy(data, shm->data + offset, first);
+		memcpy(data + first, shm->data, count - first);
+
+		atomic_store32(&header->read_pos, read_pos + count);
+		ring_bell_if_waiting(shm, FFM_SHM_BELL_SPACE);
+
+		data += count;
+		size -= count;
+	}
+
+	return total;
+}
+
+/* ------------------------------------------------------------------------- */
+/* stats                                                                     */
+
+#define FFM_SHM_STATS_TRIES 100
+
+void ffm_shm_publish_stats(struct ffm_shm *shm, const int64_t *stats,
+			   size_t num)
+{
+	struct ffm_shm_header *header = shm->header;
+
+	if (!header)
+		return;
+	if (num > FFM_SHM_MAX_STATS)
+		num = FFM_SHM_MAX_STATS;
+
+	atomic_inc32(&header->stats_seq);
+	for (size_t i = 0; i < num; i++)
+		header->stats[i] = stats[i];
+	header->num_stats = (uint32_t)num;
+	atomic_inc32(&header->stats_seq);
+}
+
+bool ffm_shm_read_stats(struct ffm_shm *shm, int64_t *stats, size_t num)
+{
+	struct ffm_shm_header *header = shm->header;
+
+	if (!header)
+		return false;
+
+	/* a single writer that only updates about once a second, so this
+	 * practically never has to retry */
+	for (int i = 0; i < FFM_SHM_STATS_TRIES; i++) {
+		uint32_t seq = atomic_load32(&header->stats_seq);
+
+		if (!seq)
+			return false;
+
+		if ((seq & 1) == 0) {
+			uint32_t avail = header->num_stats;
+
+			for (size_t j = 0; j < num && j < avail; j++)
+				stats[j] = header->stats[j];
+
+			if (atomic_load32(&header->stats_seq) == seq)
+				return num <= avail;
+		}
+
+		sleep_ms(1);
+	}
+
+	return false;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void ffm_shm_free(struct ffm_shm *shm)
+{
+	if (!shm->header)
+		return;
+
+	if (!shm->producer) {
+		stop_heartbeat(shm);
+		atomic_store32(&shm->header->reader_closed, 1);
+		ring_bell(shm, FFM_SHM_BELL_SPACE);
+	}
+
+#if FFM_SHM_SUPPORTED
+	if (shm->producer)
+		unlink_ring(shm);
+	unmap_ring(shm, data_offset() + shm->capacity);
+#endif
+	memset(shm, 0, sizeof(*shm));
+}
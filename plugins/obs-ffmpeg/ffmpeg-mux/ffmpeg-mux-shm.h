@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Shared memory byte ring between obs (the producer) and obs-ffmpeg-mux (the
+ * consumer), used in place of the stdin pipe for packet data.
+ *
+ * The producer creates a named mapping and passes its name to the mux
+ * process, which attaches to it as soon as it starts.  Each side sleeps on a
+ * doorbell (a futex on Linux, a named event on Windows) only when the ring is
+ * empty or full, and the other side only rings it when someone is waiting,
+ * so a steady stream of packets needs no system calls at all.
+ *
+ * If the mapping can't be created, or the mux process doesn't attach in
+ * time, both sides use the pipe as before.  Platforms without a doorbell
+ * implementation always use the pipe.
+ */
+
+#define FFM_SHM_NAME_SIZE 64
+#define FFM_SHM_MAX_STATS 16
+
+struct ffm_shm_header;
+
+struct ffm_shm {
+	struct ffm_shm_header *header;
+	uint8_t *data;
+	uint32_t capacity;
+	bool producer;
+	char name[FFM_SHM_NAME_SIZE];
+
+#ifdef _WIN32
+	void *mapping;
+	void *events[2];
+#endif
+
+	/* consumer: keeps telling the producer that the process is alive */
+	void *heartbeat;
+};
+
+/* producer: creates a ring of at least 'capacity' bytes */
+extern bool ffm_shm_create(struct ffm_shm *shm, size_t capacity);
+
+/* producer: waits for the consumer to attach.  Returns false if it didn't
+ * attach in time, in which case the consumer can no longer attach either
+ * and the pipe has to be used. */
+extern bool ffm_shm_wait_attach(struct ffm_shm *shm, uint32_t timeout_ms);
+
+/* producer: blocks until all of 'data' is in the ring.  Fails if the
+ * consumer has exited or stopped responding. */
+extern bool ffm_shm_write(struct ffm_shm *shm, const void *data, size_t size);
+
+/* producer: marks the end of the data, the consumer reads the rest and then
+ * gets end of file */
+extern void ffm_shm_close(struct ffm_shm *shm);
+
+/* consumer: attaches to the ring created by the producer */
+extern bool ffm_shm_open(struct ffm_shm *shm, const char *name);
+
+/* consumer: same semantics as reading the pipe, returns 'size' on success
+ * and 0 once the producer has closed the ring or exited */
+extern size_t ffm_shm_read(struct ffm_shm *shm, void *data, size_t size);
+
+/* consumer: publishes a snapshot of up to FFM_SHM_MAX_STATS counters for the
+ * producer, which can still read the last one after the consumer exits */
+extern void ffm_shm_publish_stats(struct ffm_shm *shm, const int64_t *stats,
+				  size_t num);
+
+/* producer: reads the last snapshot published, returns false if there is
+ * none yet */
+extern bool ffm_shm_read_stats(struct ffm_shm *shm, int64_t *stats,
+			       size_t num);
+
+/* either side: detaches from the ring.  A consumer detaching makes any
+ * further writes fail. */
+extern void ffm_shm_free(struct ffm_shm *shm);
+
+static inline bool ffm_shm_valid(const struct ffm_shm *shm)
+{
+	return shm->header != NULL;
+}
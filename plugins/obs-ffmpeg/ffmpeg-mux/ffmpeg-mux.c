@@ -25,9 +25,13 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "ffmpeg-mux.h"
+#include "ffmpeg-mux-io.h"
+#include "ffmpeg-mux-shm.h"
 
 #include <libavformat/avformat.h>
+#include <libavutil/time.h>
 
 #if LIBAVCODEC_VERSION_MAJOR >= 58
 #define CODEC_FLAG_GLOBAL_H AV_CODEC_FLAG_GLOBAL_HEADER
@@ -81,6 +85,7 @@ struct main_params {
 	int fps_den;
 	char *acodec;
 	char *muxer_settings;
+	char *io_settings;
 };
 
 struct audio_params {
@@ -104,6 +109,10 @@ struct ffmpeg_mux {
 	struct header video_header;
 	struct header *audio_header;
 	int num_audio_streams;
+	struct mux_io *io;
+	struct ffm_shm shm;
+	int64_t fragment_interval;
+	int64_t last_flush;
 	bool initialized;
 	char error[4096];
 };
@@ -116,8 +125,16 @@ static void header_free(struct header *header)
 static void free_avformat(struct ffmpeg_mux *ffm)
 {
 	if (ffm->output) {
-		if ((ffm->output->oformat->flags & AVFMT_NOFILE) == 0)
+		if (ffm->io) {
+			if (mux_io_close(ffm->io) != 0)
+				fprintf(stderr, "Failed to write '%s'\n",
+					ffm->params.file);
+			ffm->output->pb = NULL;
+			ffm->io = NULL;
+
+		} else if ((ffm->output->oformat->flags & AVFMT_NOFILE) == 0) {
 			avio_close(ffm->output->pb);
+		}
 
 		avformat_free_context(ffm->output);
 		ffm->output = NULL;
@@ -154,6 +171,7 @@ static void ffmpeg_mux_free(struct ffmpeg_mux *ffm)
 		free(ffm->audio);
 	}
 
+	ffm_shm_free(&ffm->shm);
 	memset(ffm, 0, sizeof(*ffm));
 }
 
@@ -259,6 +277,10 @@ static bool init_params(int *argc, char ***argv, struct main_params *params,
 
 	get_opt_str(argc, argv, &params->muxer_settings, "muxer settings");
 
+	/* optional, older callers don't pass it */
+	if (*argc > 0)
+		get_opt_str(argc, argv, &params->io_settings, "io settings");
+
 	return true;
 }
 
@@ -404,11 +426,14 @@ static void ffmpeg_mux_header(struct ffmpeg_mux *ffm, uint8_t *data,
 	}
 }
 
-static size_t safe_read(void *vdata, size_t size)
+static size_t safe_read(struct ffmpeg_mux *ffm, void *vdata, size_t size)
 {
 	uint8_t *data = vdata;
 	size_t total = size;
 
+	if (ffm_shm_valid(&ffm->shm))
+		return ffm_shm_read(&ffm->shm, vdata, size);
+
 	while (size > 0) {
 		size_t in_size = fread(data, 1, size, stdin);
 		if (in_size == 0)
@@ -425,11 +450,11 @@ static bool ffmpeg_mux_get_header(struct ffmpeg_mux *ffm)
 {
 	struct ffm_packet_info info = {0};
 
-	bool success = safe_read(&info, sizeof(info)) == sizeof(info);
+	bool success = safe_read(ffm, &info, sizeof(info)) == sizeof(info);
 	if (success) {
 		uint8_t *data = malloc(info.size);
 
-		if (safe_read(data, info.size) == info.size) {
+		if (safe_read(ffm, data, info.size) == info.size) {
 			ffmpeg_mux_header(ffm, data, &info);
 		} else {
 			success = false;
@@ -462,17 +487,150 @@ static inline bool ffmpeg_mux_get_extra_data(struct ffmpeg_mux *ffm)
 #pragma warning(disable : 4996)
 #endif
 
+/* in the order read_write_stats in obs-ffmpeg-mux.c expects them */
+static void publish_io_stats(void *param, const struct mux_io_stats *stats)
+{
+	struct ffmpeg_mux *ffm = param;
+	const int64_t values[] = {
+		stats->bytes_written, stats->writes,
+		stats->total_latency_us, stats->max_latency_us,
+		stats->slow_writes, stats->stall_us,
+		stats->pending_bytes, stats->syncs,
+	};
+
+	ffm_shm_publish_stats(&ffm->shm, values,
+			      sizeof(values) / sizeof(values[0]));
+}
+
+static void get_io_settings(struct ffmpeg_mux *ffm,
+			    struct mux_io_settings *settings)
+{
+	AVDictionary *dict = NULL;
+	AVDictionaryEntry *entry;
+
+	settings->buffer_size_mb = 0;
+	settings->direct_io = false;
+	settings->sync_interval_sec = 0;
+	settings->stats_cb = publish_io_stats;
+	settings->stats_param = ffm;
+
+	if (!ffm->params.io_settings || !*ffm->params.io_settings)
+		return;
+
+	if (av_dict_parse_string(&dict, ffm->params.io_settings, "=", " ",
+				 0) < 0) {
+		fprintf(stderr, "Failed to parse io settings: %s\n",
+			ffm->params.io_settings);
+		av_dict_free(&dict);
+		return;
+	}
+
+	entry = av_dict_get(dict, "buffer_size_mb", NULL, 0);
+	if (entry)
+		settings->buffer_size_mb = atoi(entry->value);
+	entry = av_dict_get(dict, "direct_io", NULL, 0);
+	if (entry)
+		settings->direct_io = atoi(entry->value) != 0;
+	entry = av_dict_get(dict, "sync_interval", NULL, 0);
+	if (entry)
+		settings->sync_interval_sec = atoi(entry->value);
+
+	av_dict_free(&dict);
+}
+
+/* For fragmented files, anything written to the pipe is pushed out to the
+ * file once per fragment so that a crash loses at most one fragment. */
+static void get_fragment_settings(struct ffmpeg_mux *ffm, AVDictionary *dict)
+{
+	AVDictionaryEntry *flags = av_dict_get(dict, "movflags", NULL, 0);
+	AVDictionaryEntry *duration =
+		av_dict_get(dict, "frag_duration", NULL, 0);
+
+	ffm->fragment_interval = 0;
+
+	if (!flags || !strstr(flags->value, "frag_"))
+		return;
+
+	ffm->fragment_interval = duration ? strtoll(duration->value, NULL, 10)
+					  : 0;
+	if (ffm->fragment_interval <= 0)
+		ffm->fragment_interval = 2000000;
+
+	ffm->last_flush = av_gettime_relative();
+	printf("Writing fragmented file, flushing every %d ms\n",
+	       (int)(ffm->fragment_interval / 1000));
+}
+
+static void flush_fragments(struct ffmpeg_mux *ffm)
+{
+	int64_t now = av_gettime_relative();
+
+	if (now - ffm->last_flush < ffm->fragment_interval)
+		return;
+
+	avio_flush(ffm->output->pb);
+	if (ffm->io)
+		mux_io_flush(ffm->io);
+
+	ffm->last_flush = now;
+}
+
+static inline bool is_network_path(const char *path)
+{
+	return strstr(path, "://") != NULL;
+}
+
+/* faststart moves the index to the front of the file when it's finished by
+ * reading the file back through a handle of its own, which would miss
+ * whatever is still waiting to be written by the writer thread */
+static bool reads_back_output(AVDictionary *dict)
+{
+	AVDictionaryEntry *flags = av_dict_get(dict, "movflags", NULL, 0);
+	return flags && strstr(flags->value, "faststart") != NULL;
+}
+
 static inline int open_output_file(struct ffmpeg_mux *ffm)
 {
 	AVOutputFormat *format = ffm->output->oformat;
+	struct mux_io_settings io_settings;
 	int ret;
 
-	if ((format->flags & AVFMT_NOFILE) == 0) {
+	AVDictionary *dict = NULL;
+	if ((ret = av_dict_parse_string(&dict, ffm->params.muxer_settings, "=",
+					" ", 0))) {
+		fprintf(stderr, "Failed to parse muxer settings: %s\n%s",
+			av_err2str(ret), ffm->params.muxer_settings);
+
+		av_dict_free(&dict);
+	}
+
+	get_io_settings(ffm, &io_settings);
+
+	if (io_settings.buffer_size_mb > 0 && reads_back_output(dict)) {
+		printf("Not buffering writes, faststart reads the file "
+		       "back\n");
+		io_settings.buffer_size_mb = 0;
+	}
+
+	if ((format->flags & AVFMT_NOFILE) == 0 &&
+	    io_settings.buffer_size_mb > 0 &&
+	    !is_network_path(ffm->params.file)) {
+		ret = mux_io_open(&ffm->io, &ffm->output->pb, ffm->params.file,
+				  &io_settings);
+		if (ret < 0) {
+			fprintf(stderr, "Couldn't open '%s', %s",
+				ffm->params.file, av_err2str(ret));
+			av_dict_free(&dict);
+			return FFM_ERROR;
+		}
+
+	} else if ((format->flags & AVFMT_NOFILE) == 0) {
 		ret = avio_open(&ffm->output->pb, ffm->params.file,
 				AVIO_FLAG_WRITE);
 		if (ret < 0) {
 			fprintf(stderr, "Couldn't open '%s', %s",
 				ffm->params.file, av_err2str(ret));
+			av_dict_free(&dict);
 			return FFM_ERROR;
 		}
 	}
@@ -481,15 +639,6 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 		sizeof(ffm->output->filename));
 	ffm->output->filename[sizeof(ffm->output->filename) - 1] = 0;
 
-	AVDictionary *dict = NULL;
-	if ((ret = av_dict_parse_string(&dict, ffm->params.muxer_settings, "=",
-					" ", 0))) {
-		fprintf(stderr, "Failed to parse muxer settings: %s\n%s",
-			av_err2str(ret), ffm->params.muxer_settings);
-
-		av_dict_free(&dict);
-	}
-
 	if (av_dict_count(dict) > 0) {
 		printf("Using muxer settings:");
 
@@ -501,6 +650,8 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 		printf("\n");
 	}
 
+	get_fragment_settings(ffm, dict);
+
 	ret = avformat_write_header(ffm->output, &dict);
 	if (ret < 0) {
 		fprintf(stderr, "Error opening '%s': %s", ffm->params.file,
@@ -568,6 +719,29 @@ static int ffmpeg_mux_init_context(struct ffmpeg_mux *ffm)
 	return FFM_SUCCESS;
 }
 
+/* packets come through a shared memory ring if obs created one ("shm" in the
+ * io settings), and from stdin if there is none or attaching to it fails */
+static void open_input(struct ffmpeg_mux *ffm)
+{
+	AVDictionary *dict = NULL;
+	AVDictionaryEntry *entry;
+
+	if (!ffm->params.io_settings || !*ffm->params.io_settings)
+		return;
+	if (av_dict_parse_string(&dict, ffm->params.io_settings, "=", " ",
+				 0) < 0) {
+		av_dict_free(&dict);
+		return;
+	}
+
+	entry = av_dict_get(dict, "shm", NULL, 0);
+	if (entry && !ffm_shm_open(&ffm->shm, entry->value))
+		fprintf(stderr, "Couldn't attach to '%s', reading from stdin\n",
+			entry->value);
+
+	av_dict_free(&dict);
+}
+
 static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc,
 				    char *argv[])
 {
@@ -576,6 +750,8 @@ static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc,
 	if (!init_params(&argc, &argv, &ffm->params, &ffm->audio))
 		return FFM_ERROR;
 
+	open_input(ffm);
+
 	if (ffm->params.tracks) {
 		ffm->audio_header =
 			calloc(1, sizeof(struct header) * ffm->params.tracks);
@@ -671,6 +847,7 @@ int main(int argc, char *argv[])
 	struct ffm_packet_info info = {0};
 	struct ffmpeg_mux ffm = {0};
 	struct resize_buf rb = {0};
+	bool write_failed = false;
 	bool fail = false;
 	int ret;
 
@@ -702,14 +879,26 @@ int main(int argc, char *argv[])
 		return ret;
 	}
 
-	while (!fail && safe_read(&info, sizeof(info)) == sizeof(info)) {
+	while (!fail && safe_read(&ffm, &info, sizeof(info)) == sizeof(info)) {
 		resize_buf_resize(&rb, info.size);
 
-		if (safe_read(rb.buf, info.size) == info.size) {
+		if (safe_read(&ffm, rb.buf, info.size) == info.size) {
 			ffmpeg_mux_packet(&ffm, rb.buf, &info);
+
+			if (ffm.fragment_interval)
+				flush_fragments(&ffm);
 		} else {
 			fail = true;
 		}
+
+		/* stop reading once the disk has failed, so that the output
+		 * notices right away instead of when the pipe fills up */
+		if (ffm.io && mux_io_failed(ffm.io)) {
+			fprintf(stderr, "Failed to write to '%s'\n",
+				ffm.params.file);
+			write_failed = true;
+			fail = true;
+		}
 	}
 
 	ffmpeg_mux_free(&ffm);
@@ -720,5 +909,5 @@ int main(int argc, char *argv[])
 		free(argv[i]);
 	free(argv);
 #endif
-	return 0;
+	return write_failed ? FFM_ERROR : 0;
 }
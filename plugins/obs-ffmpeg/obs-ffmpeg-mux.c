@@ -24,7 +24,9 @@
 #include <util/platform.h>
 #include <util/circlebuf.h>
 #include <util/threading.h>
+#include <inttypes.h>
 #include "ffmpeg-mux/ffmpeg-mux.h"
+#include "ffmpeg-mux/ffmpeg-mux-shm.h"
 
 #ifdef _WIN32
 #include "util/windows/win-version.h"
@@ -39,6 +41,21 @@
 #define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
 #define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
 
+#define OPT_WRITE_BUFFER_SIZE "write_buffer_size_mb"
+#define OPT_WRITE_OVERFLOW "write_overflow"
+#define OPT_SHM_TRANSPORT "shm_transport"
+#define OPT_SHM_BUFFER_SIZE "shm_buffer_size_mb"
+#define OPT_IO_BUFFER_SIZE "io_buffer_size_mb"
+#define OPT_DIRECT_IO "direct_io"
+#define OPT_SYNC_INTERVAL "sync_interval_sec"
+#define OPT_FRAGMENTED "fragmented"
+#define OPT_FRAGMENT_INTERVAL "fragment_interval_ms"
+
+enum write_overflow {
+	WRITE_OVERFLOW_BLOCK,
+	WRITE_OVERFLOW_DROP,
+};
+
 struct ffmpeg_muxer {
 	obs_output_t *output;
 	os_process_pipe_t *pipe;
@@ -66,6 +83,33 @@ struct ffmpeg_muxer {
 	volatile bool muxing;
 
 	bool is_network;
+
+	/* packets are handed to the mux process from a separate thread so
+	 * that a slow disk or a stalled mux process doesn't hold up the
+	 * encoder */
+	pthread_t write_thread;
+	bool write_thread_active;
+	pthread_mutex_t write_mutex;
+	os_sem_t *write_sem;
+	os_event_t *write_space_event;
+	struct circlebuf write_packets;
+	size_t write_buffer_size;
+	size_t write_buffer_peak;
+	size_t max_write_buffer_size;
+	enum write_overflow write_overflow;
+	bool write_dropping;
+	uint64_t write_dropped;
+	volatile bool write_exit;
+	volatile bool write_error;
+
+	/* packet data goes through a shared memory ring when the mux process
+	 * attaches to it, and through its stdin pipe otherwise */
+	struct ffm_shm shm;
+	bool use_shm;
+
+	/* held while the ring is freed and while the stats that the mux
+	 * process' disk writer periodically publishes in it are read */
+	pthread_mutex_t shm_mutex;
 };
 
 static const char *ffmpeg_mux_getname(void *type)
@@ -97,32 +141,91 @@ static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 	stream->keyframes = 0;
 }
 
+static bool start_write_thread(struct ffmpeg_muxer *stream);
+static void stop_write_thread(struct ffmpeg_muxer *stream);
+static void get_write_stats_proc(void *data, calldata_t *cd);
+
 static void ffmpeg_mux_destroy(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
 
+	stop_write_thread(stream);
 	replay_buffer_clear(stream);
 	if (stream->mux_thread_joinable)
 		pthread_join(stream->mux_thread, NULL);
 	da_free(stream->mux_packets);
 
 	os_process_pipe_destroy(stream->pipe);
+	ffm_shm_free(&stream->shm);
 	dstr_free(&stream->path);
+
+	circlebuf_free(&stream->write_packets);
+	os_event_destroy(stream->write_space_event);
+	os_sem_destroy(stream->write_sem);
+	pthread_mutex_destroy(&stream->write_mutex);
+	pthread_mutex_destroy(&stream->shm_mutex);
 	bfree(stream);
 }
 
-static void *ffmpeg_mux_create(obs_data_t *settings, obs_output_t *output)
+static struct ffmpeg_muxer *ffmpeg_muxer_alloc(obs_output_t *output)
 {
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
 	stream->output = output;
 
+	if (pthread_mutex_init(&stream->write_mutex, NULL) != 0)
+		goto fail;
+	if (pthread_mutex_init(&stream->shm_mutex, NULL) != 0)
+		goto fail;
+	if (os_sem_init(&stream->write_sem, 0) != 0)
+		goto fail;
+	if (os_event_init(&stream->write_space_event, OS_EVENT_TYPE_AUTO) !=
+	    0)
+		goto fail;
+
+	return stream;
+
+fail:
+	if (stream->write_sem)
+		os_sem_destroy(stream->write_sem);
+	pthread_mutex_destroy(&stream->write_mutex);
+	pthread_mutex_destroy(&stream->shm_mutex);
+	bfree(stream);
+	return NULL;
+}
+
+static void *ffmpeg_mux_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct ffmpeg_muxer *stream = ffmpeg_muxer_alloc(output);
+	if (!stream)
+		return NULL;
+
 	if (obs_output_get_flags(output) & OBS_OUTPUT_SERVICE)
 		stream->is_network = true;
 
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph,
+			 "void get_write_stats(out int avg_latency_us, "
+			 "out int max_latency_us, out int slow_writes, "
+			 "out int pending_bytes)",
+			 get_write_stats_proc, stream);
+
 	UNUSED_PARAMETER(settings);
 	return stream;
 }
 
+static void ffmpeg_mux_defaults(obs_data_t *s)
+{
+	obs_data_set_default_int(s, OPT_WRITE_BUFFER_SIZE, 64);
+	obs_data_set_default_string(s, OPT_WRITE_OVERFLOW, "block");
+	obs_data_set_default_bool(s, OPT_SHM_TRANSPORT, true);
+	obs_data_set_default_int(s, OPT_SHM_BUFFER_SIZE, 8);
+	obs_data_set_default_int(s, OPT_IO_BUFFER_SIZE, 16);
+	obs_data_set_default_bool(s, OPT_DIRECT_IO, false);
+	obs_data_set_default_int(s, OPT_SYNC_INTERVAL, 0);
+	obs_data_set_default_bool(s, OPT_FRAGMENTED, false);
+	obs_data_set_default_int(s, OPT_FRAGMENT_INTERVAL, 2000);
+}
+
 #ifdef _WIN32
 #define FFMPEG_MUX "obs-ffmpeg-mux.exe"
 #else
@@ -209,12 +312,59 @@ static void log_muxer_params(struct ffmpeg_muxer *stream, const char *settings)
 	av_dict_free(&dict);
 }
 
+static bool is_mp4_path(const char *path)
+{
+	const char *ext = path ? strrchr(path, '.') : NULL;
+	return ext && (astrcmpi(ext, ".mp4") == 0 ||
+		       astrcmpi(ext, ".mov") == 0 ||
+		       astrcmpi(ext, ".m4v") == 0);
+}
+
+/* Fragmented MP4/MOV: an empty moov up front and a moof+mdat pair per
+ * fragment, so everything up to the last fragment stays playable if the
+ * program or system dies.  Stopping only appends the random access index
+ * (mfra); none of the media data gets rewritten. */
+static void add_fragment_params(struct dstr *mux, obs_data_t *settings,
+				struct ffmpeg_muxer *stream)
+{
+	int64_t interval = obs_data_get_int(settings, OPT_FRAGMENT_INTERVAL);
+
+	if (!obs_data_get_bool(settings, OPT_FRAGMENTED))
+		return;
+	if (!is_mp4_path(stream->path.array))
+		return;
+
+	/* custom movflags from the user win */
+	if (mux->array && strstr(mux->array, "movflags") != NULL) {
+		info("Custom movflags set, not writing a fragmented file");
+		return;
+	}
+
+	if (interval < 100)
+		interval = 100;
+
+	struct dstr frag = {0};
+	dstr_printf(&frag,
+		    "movflags=frag_keyframe+empty_moov+delay_moov+"
+		    "default_base_moof frag_duration=%" PRId64,
+		    interval * 1000);
+
+	if (!dstr_is_empty(mux)) {
+		dstr_cat_ch(&frag, ' ');
+		dstr_cat_dstr(&frag, mux);
+	}
+
+	dstr_free(mux);
+	*mux = frag;
+}
+
 static void add_muxer_params(struct dstr *cmd, struct ffmpeg_muxer *stream)
 {
 	obs_data_t *settings = obs_output_get_settings(stream->output);
 	struct dstr mux = {0};
 
 	dstr_copy(&mux, obs_data_get_string(settings, "muxer_settings"));
+	add_fragment_params(&mux, settings, stream);
 
 	log_muxer_params(stream, mux.array);
 
@@ -226,6 +376,20 @@ static void add_muxer_params(struct dstr *cmd, struct ffmpeg_muxer *stream)
 	dstr_free(&mux);
 }
 
+static void add_io_params(struct dstr *cmd, struct ffmpeg_muxer *stream)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+
+	dstr_catf(cmd, "\"buffer_size_mb=%d direct_io=%d sync_interval=%d",
+		  (int)obs_data_get_int(settings, OPT_IO_BUFFER_SIZE),
+		  (int)obs_data_get_bool(settings, OPT_DIRECT_IO),
+		  (int)obs_data_get_int(settings, OPT_SYNC_INTERVAL));
+	if (ffm_shm_valid(&stream->shm))
+		dstr_catf(cmd, " shm=%s", stream->shm.name);
+	dstr_cat(cmd, "\" ");
+	obs_data_release(settings);
+}
+
 static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
 			       const char *path)
 {
@@ -265,6 +429,7 @@ static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
 	}
 
 	add_muxer_params(cmd, stream);
+	add_io_params(cmd, stream);
 }
 
 static inline void start_pipe(struct ffmpeg_muxer *stream, const char *path)
@@ -296,6 +461,29 @@ static void set_file_not_readable_error(struct ffmpeg_muxer *stream,
 	obs_data_release(settings);
 }
 
+/* the mux process attaches to the ring right after it starts, before it
+ * does anything that could take a while */
+#define SHM_ATTACH_TIMEOUT_MS 5000
+
+static void start_shm(struct ffmpeg_muxer *stream)
+{
+	stream->use_shm = false;
+	if (!ffm_shm_valid(&stream->shm))
+		return;
+
+	stream->use_shm =
+		ffm_shm_wait_attach(&stream->shm, SHM_ATTACH_TIMEOUT_MS);
+	if (stream->use_shm) {
+		info("Sending packets through a %" PRIu32 " KiB shared "
+		     "memory ring",
+		     stream->shm.capacity / 1024);
+	} else {
+		warn("ffmpeg-mux didn't attach to the shared memory ring, "
+		     "using the pipe");
+		ffm_shm_free(&stream->shm);
+	}
+}
+
 static bool ffmpeg_mux_start(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -334,6 +522,22 @@ static bool ffmpeg_mux_start(void *data)
 		os_unlink(path);
 	}
 
+	stream->max_write_buffer_size =
+		(size_t)obs_data_get_int(settings, OPT_WRITE_BUFFER_SIZE) *
+		(1024 * 1024);
+	stream->write_overflow =
+		strcmp(obs_data_get_string(settings, OPT_WRITE_OVERFLOW),
+		       "drop") == 0
+			? WRITE_OVERFLOW_DROP
+			: WRITE_OVERFLOW_BLOCK;
+
+	if (obs_data_get_bool(settings, OPT_SHM_TRANSPORT) &&
+	    !ffm_shm_create(&stream->shm,
+			    (size_t)obs_data_get_int(settings,
+						     OPT_SHM_BUFFER_SIZE) *
+				    (1024 * 1024)))
+		warn("Failed to create shared memory ring, using the pipe");
+
 	start_pipe(stream, path);
 	obs_data_release(settings);
 
@@ -341,6 +545,20 @@ static bool ffmpeg_mux_start(void *data)
 		obs_output_set_last_error(
 			stream->output, obs_module_text("HelperProcessFailed"));
 		warn("Failed to create process pipe");
+		ffm_shm_free(&stream->shm);
+		return false;
+	}
+
+	start_shm(stream);
+
+	if (!start_write_thread(stream)) {
+		obs_output_set_last_error(
+			stream->output, obs_module_text("HelperProcessFailed"));
+		warn("Failed to create write thread");
+		os_process_pipe_destroy(stream->pipe);
+		stream->pipe = NULL;
+		ffm_shm_free(&stream->shm);
+		stream->use_shm = false;
 		return false;
 	}
 
@@ -354,15 +572,100 @@ static bool ffmpeg_mux_start(void *data)
 	return true;
 }
 
+struct mux_write_stats {
+	int64_t bytes_written;
+	int64_t writes;
+	int64_t total_latency_us;
+	int64_t max_latency_us;
+	int64_t slow_writes;
+	int64_t stall_us;
+	int64_t pending_bytes;
+	int64_t syncs;
+};
+
+/* published by the mux process in the shared memory ring, in the order of
+ * publish_io_stats in ffmpeg-mux/ffmpeg-mux.c, so they're only available
+ * while the ring is used */
+static bool read_write_stats(struct ffmpeg_muxer *stream,
+			     struct mux_write_stats *stats)
+{
+	int64_t val[8];
+
+	if (!stream->use_shm || !ffm_shm_read_stats(&stream->shm, val, 8))
+		return false;
+
+	stats->bytes_written = val[0];
+	stats->writes = val[1];
+	stats->total_latency_us = val[2];
+	stats->max_latency_us = val[3];
+	stats->slow_writes = val[4];
+	stats->stall_us = val[5];
+	stats->pending_bytes = val[6];
+	stats->syncs = val[7];
+	return true;
+}
+
+static void log_write_stats(struct ffmpeg_muxer *stream)
+{
+	struct mux_write_stats stats;
+
+	if (!read_write_stats(stream, &stats))
+		return;
+
+	info("Disk writes: %" PRId64 " (%" PRId64 " MiB), average latency: "
+	     "%" PRId64 " us, max latency: %" PRId64 " us, slow writes: "
+	     "%" PRId64 ", time stalled on full buffer: %" PRId64 " ms",
+	     stats.writes, stats.bytes_written / (1024 * 1024),
+	     stats.writes ? stats.total_latency_us / stats.writes : 0,
+	     stats.max_latency_us, stats.slow_writes, stats.stall_us / 1000);
+}
+
+static void get_write_stats_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_muxer *stream = data;
+	struct mux_write_stats stats;
+	bool success;
+
+	/* deactivate can free the ring on another thread */
+	pthread_mutex_lock(&stream->shm_mutex);
+	success = active(stream) && read_write_stats(stream, &stats);
+	pthread_mutex_unlock(&stream->shm_mutex);
+
+	if (!success)
+		return;
+
+	calldata_set_int(cd, "avg_latency_us",
+			 stats.writes ? stats.total_latency_us / stats.writes
+				      : 0);
+	calldata_set_int(cd, "max_latency_us", stats.max_latency_us);
+	calldata_set_int(cd, "slow_writes", stats.slow_writes);
+	calldata_set_int(cd, "pending_bytes", stats.pending_bytes);
+}
+
 static int deactivate(struct ffmpeg_muxer *stream, int code)
 {
 	int ret = -1;
 
 	if (active(stream)) {
+		stop_write_thread(stream);
+
+		/* lets the mux process read what's left in the ring before
+		 * waiting for it to exit */
+		if (stream->use_shm)
+			ffm_shm_close(&stream->shm);
+
 		ret = os_process_pipe_destroy(stream->pipe);
 		stream->pipe = NULL;
 
+		/* the mux process has published its final stats by now */
+		log_write_stats(stream);
+
+		pthread_mutex_lock(&stream->shm_mutex);
 		os_atomic_set_bool(&stream->active, false);
+		stream->use_shm = false;
+		ffm_shm_free(&stream->shm);
+		pthread_mutex_unlock(&stream->shm_mutex);
+
 		os_atomic_set_bool(&stream->sent_headers, false);
 
 		info("Output of file '%s' stopped", stream->path.array);
@@ -420,11 +723,19 @@ static void signal_failure(struct ffmpeg_muxer *stream)
 	os_atomic_set_bool(&stream->capturing, false);
 }
 
-static bool write_packet(struct ffmpeg_muxer *stream,
-			 struct encoder_packet *packet)
+static inline bool write_to_mux(struct ffmpeg_muxer *stream,
+				const void *data, size_t size)
+{
+	if (stream->use_shm)
+		return ffm_shm_write(&stream->shm, data, size);
+
+	return os_process_pipe_write(stream->pipe, data, size) == size;
+}
+
+static bool write_packet_to_mux(struct ffmpeg_muxer *stream,
+				struct encoder_packet *packet)
 {
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
-	size_t ret;
 
 	struct ffm_packet_info info = {.pts = packet->pts,
 				       .dts = packet->dts,
@@ -434,18 +745,13 @@ static bool write_packet(struct ffmpeg_muxer *stream,
 							: FFM_PACKET_AUDIO,
 				       .keyframe = packet->keyframe};
 
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info,
-				    sizeof(info));
-	if (ret != sizeof(info)) {
-		warn("os_process_pipe_write for info structure failed");
-		signal_failure(stream);
+	if (!write_to_mux(stream, &info, sizeof(info))) {
+		warn("Writing the info structure to ffmpeg-mux failed");
 		return false;
 	}
 
-	ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
-	if (ret != packet->size) {
-		warn("os_process_pipe_write for packet data failed");
-		signal_failure(stream);
+	if (!write_to_mux(stream, packet->data, packet->size)) {
+		warn("Writing packet data to ffmpeg-mux failed");
 		return false;
 	}
 
@@ -453,6 +759,160 @@ static bool write_packet(struct ffmpeg_muxer *stream,
 	return true;
 }
 
+static bool write_packet(struct ffmpeg_muxer *stream,
+			 struct encoder_packet *packet)
+{
+	if (!write_packet_to_mux(stream, packet)) {
+		signal_failure(stream);
+		return false;
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------ */
+/* async writer                                                             */
+
+static void *write_thread(void *data)
+{
+	struct ffmpeg_muxer *stream = data;
+
+	os_set_thread_name("ffmpeg-mux: write_thread");
+
+	while (os_sem_wait(stream->write_sem) == 0) {
+		struct encoder_packet packet;
+		bool have_packet = false;
+
+		pthread_mutex_lock(&stream->write_mutex);
+		if (stream->write_packets.size) {
+			circlebuf_pop_front(&stream->write_packets, &packet,
+					    sizeof(packet));
+			stream->write_buffer_size -= packet.size;
+			have_packet = true;
+		}
+		pthread_mutex_unlock(&stream->write_mutex);
+
+		if (!have_packet) {
+			/* the queue is only empty on wakeup once it has
+			 * been drained and the thread was asked to exit */
+			if (os_atomic_load_bool(&stream->write_exit))
+				break;
+			continue;
+		}
+
+		bool success = write_packet_to_mux(stream, &packet);
+		obs_encoder_packet_release(&packet);
+		os_event_signal(stream->write_space_event);
+
+		if (!success) {
+			os_atomic_set_bool(&stream->write_error, true);
+			break;
+		}
+	}
+
+	os_event_signal(stream->write_space_event);
+	return NULL;
+}
+
+static bool start_write_thread(struct ffmpeg_muxer *stream)
+{
+	os_atomic_set_bool(&stream->write_exit, false);
+	os_atomic_set_bool(&stream->write_error, false);
+	stream->write_dropping = false;
+	stream->write_dropped = 0;
+	stream->write_buffer_peak = 0;
+
+	stream->write_thread_active = pthread_create(&stream->write_thread,
+						     NULL, write_thread,
+						     stream) == 0;
+	return stream->write_thread_active;
+}
+
+static void free_write_packets(struct ffmpeg_muxer *stream)
+{
+	pthread_mutex_lock(&stream->write_mutex);
+	while (stream->write_packets.size) {
+		struct encoder_packet packet;
+		circlebuf_pop_front(&stream->write_packets, &packet,
+				    sizeof(packet));
+		obs_encoder_packet_release(&packet);
+	}
+	stream->write_buffer_size = 0;
+	pthread_mutex_unlock(&stream->write_mutex);
+}
+
+/* lets the writer drain whatever is still queued, then joins it */
+static void stop_write_thread(struct ffmpeg_muxer *stream)
+{
+	if (!stream->write_thread_active)
+		return;
+
+	os_atomic_set_bool(&stream->write_exit, true);
+	os_sem_post(stream->write_sem);
+	pthread_join(stream->write_thread, NULL);
+	stream->write_thread_active = false;
+
+	free_write_packets(stream);
+
+	if (stream->write_dropped)
+		info("Dropped %" PRIu64 " video packets because the write "
+		     "buffer was full",
+		     stream->write_dropped);
+	info("Peak write buffer usage: %" PRIu64 " KiB",
+	     (uint64_t)stream->write_buffer_peak / 1024);
+}
+
+/* returns false if the packet was dropped due to overflow */
+static bool queue_packet(struct ffmpeg_muxer *stream,
+			 struct encoder_packet *packet)
+{
+	bool is_video = packet->type == OBS_ENCODER_VIDEO;
+	struct encoder_packet ref;
+
+	pthread_mutex_lock(&stream->write_mutex);
+
+	if (stream->write_overflow == WRITE_OVERFLOW_BLOCK) {
+		while (stream->max_write_buffer_size &&
+		       stream->write_buffer_size >
+			       stream->max_write_buffer_size &&
+		       !os_atomic_load_bool(&stream->write_error)) {
+			pthread_mutex_unlock(&stream->write_mutex);
+			os_event_wait(stream->write_space_event);
+			pthread_mutex_lock(&stream->write_mutex);
+		}
+
+	} else if (is_video) {
+		/* once over the limit, drop video until the next keyframe
+		 * that fits so the file stays decodable; audio is small and
+		 * is always kept */
+		bool full = stream->max_write_buffer_size &&
+			    stream->write_buffer_size + packet->size >
+				    stream->max_write_buffer_size;
+
+		if (full)
+			stream->write_dropping = true;
+		else if (packet->keyframe)
+			stream->write_dropping = false;
+
+		if (stream->write_dropping) {
+			stream->write_dropped++;
+			pthread_mutex_unlock(&stream->write_mutex);
+			return false;
+		}
+	}
+
+	obs_encoder_packet_ref(&ref, packet);
+	circlebuf_push_back(&stream->write_packets, &ref, sizeof(ref));
+	stream->write_buffer_size += ref.size;
+	if (stream->write_buffer_size > stream->write_buffer_peak)
+		stream->write_buffer_peak = stream->write_buffer_size;
+
+	pthread_mutex_unlock(&stream->write_mutex);
+
+	os_sem_post(stream->write_sem);
+	return true;
+}
+
 static bool send_audio_headers(struct ffmpeg_muxer *stream,
 			       obs_encoder_t *aencoder, size_t idx)
 {
@@ -515,6 +975,11 @@ static void ffmpeg_mux_data(void *data, struct encoder_packet *packet)
 		stream->sent_headers = true;
 	}
 
+	if (os_atomic_load_bool(&stream->write_error)) {
+		signal_failure(stream);
+		return;
+	}
+
 	if (stopping(stream)) {
 		if (packet->sys_dts_usec >= stream->stop_ts) {
 			deactivate(stream, 0);
@@ -522,7 +987,7 @@ static void ffmpeg_mux_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	write_packet(stream, packet);
+	queue_packet(stream, packet);
 }
 
 static obs_properties_t *ffmpeg_mux_properties(void *unused)
@@ -553,6 +1018,7 @@ struct obs_output_info ffmpeg_muxer = {
 	.stop = ffmpeg_mux_stop,
 	.encoded_packet = ffmpeg_mux_data,
 	.get_total_bytes = ffmpeg_mux_total_bytes,
+	.get_defaults = ffmpeg_mux_defaults,
 	.get_properties = ffmpeg_mux_properties,
 };
 
@@ -583,6 +1049,7 @@ struct obs_output_info ffmpeg_mpegts_muxer = {
 	.stop = ffmpeg_mux_stop,
 	.encoded_packet = ffmpeg_mux_data,
 	.get_total_bytes = ffmpeg_mux_total_bytes,
+	.get_defaults = ffmpeg_mux_defaults,
 	.get_properties = ffmpeg_mux_properties,
 	.get_connect_time_ms = ffmpeg_mpegts_mux_connect_time,
 };
@@ -635,8 +1102,9 @@ static void get_last_replay(void *data, calldata_t *cd)
 static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 {
 	UNUSED_PARAMETER(settings);
-	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
-	stream->output = output;
+	struct ffmpeg_muxer *stream = ffmpeg_muxer_alloc(output);
+	if (!stream)
+		return NULL;
 
 	stream->hotkey =
 		obs_hotkey_register_output(output, "ReplayBuffer.Save",
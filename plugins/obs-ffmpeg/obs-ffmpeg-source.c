@@ -22,6 +22,7 @@
 #include "obs-ffmpeg-formats.h"
 
 #include <media-playback/media.h>
+#include <media-playback/media-pool.h>
 
 #define FF_LOG(level, format, ...) \
 	blog(level, "[Media Source]: " format, ##__VA_ARGS__)
@@ -32,8 +33,9 @@
 	FF_LOG_S(s->source, level, format, ##__VA_ARGS__)
 
 struct ffmpeg_source {
-	mp_media_t media;
+	mp_media_t *media;
 	bool media_valid;
+	bool media_joined;
 	bool destroy_media;
 
 	struct SwsContext *sws_ctx;
@@ -50,6 +52,9 @@ struct ffmpeg_source {
 	char *input_format;
 	int buffering_mb;
 	int speed_percent;
+	int decode_ahead_frames;
+	int frame_cache_mb;
+	bool prewarm_cache;
 	bool is_looping;
 	bool is_local_file;
 	bool is_hw_decoding;
@@ -57,6 +62,8 @@ struct ffmpeg_source {
 	bool restart_on_activate;
 	bool close_when_inactive;
 	bool seekable;
+	bool share_decoder;
+	bool decoder_unshared;
 
 	pthread_t reconnect_thread;
 	bool stop_reconnect;
@@ -89,6 +96,10 @@ static bool is_local_file_modified(obs_properties_t *props,
 	obs_property_t *buffering = obs_properties_get(props, "buffering_mb");
 	obs_property_t *seekable = obs_properties_get(props, "seekable");
 	obs_property_t *speed = obs_properties_get(props, "speed_percent");
+	obs_property_t *frame_cache =
+		obs_properties_get(props, "frame_cache_mb");
+	obs_property_t *share_decoder =
+		obs_properties_get(props, "share_decoder");
 	obs_property_t *reconnect_delay_sec =
 		obs_properties_get(props, "reconnect_delay_sec");
 	obs_property_set_visible(input, !enabled);
@@ -97,6 +108,8 @@ static bool is_local_file_modified(obs_properties_t *props,
 	obs_property_set_visible(local_file, enabled);
 	obs_property_set_visible(looping, enabled);
 	obs_property_set_visible(speed, enabled);
+	obs_property_set_visible(frame_cache, enabled);
+	obs_property_set_visible(share_decoder, enabled);
 	obs_property_set_visible(seekable, !enabled);
 	obs_property_set_visible(reconnect_delay_sec, !enabled);
 
@@ -112,6 +125,9 @@ static void ffmpeg_source_defaults(obs_data_t *settings)
 	obs_data_set_default_int(settings, "reconnect_delay_sec", 10);
 	obs_data_set_default_int(settings, "buffering_mb", 2);
 	obs_data_set_default_int(settings, "speed_percent", 100);
+	obs_data_set_default_int(settings, "decode_ahead_frames", 8);
+	obs_data_set_default_int(settings, "frame_cache_mb", 0);
+	obs_data_set_default_bool(settings, "share_decoder", false);
 }
 
 static const char *media_filter =
@@ -206,6 +222,22 @@ static obs_properties_t *ffmpeg_source_getproperties(void *data)
 					     1, 200, 1);
 	obs_property_int_set_suffix(prop, "%");
 
+	obs_properties_add_int_slider(props, "decode_ahead_frames",
+				      obs_module_text("DecodeAheadFrames"), 1,
+				      64, 1);
+
+	prop = obs_properties_add_int_slider(props, "frame_cache_mb",
+					     obs_module_text("FrameCacheMB"),
+					     0, 2048, 16);
+	obs_property_int_set_suffix(prop, " MB");
+	obs_property_set_long_description(
+		prop, obs_module_text("FrameCacheMB.ToolTip"));
+
+	prop = obs_properties_add_bool(props, "share_decoder",
+				       obs_module_text("ShareDecoder"));
+	obs_property_set_long_description(
+		prop, obs_module_text("ShareDecoder.ToolTip"));
+
 	prop = obs_properties_add_list(props, "color_range",
 				       obs_module_text("ColorRange"),
 				       OBS_COMBO_TYPE_LIST,
@@ -230,6 +262,9 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 		"\tinput:                   %s\n"
 		"\tinput_format:            %s\n"
 		"\tspeed:                   %d\n"
+		"\tdecode_ahead_frames:     %d\n"
+		"\tframe_cache_mb:          %d\n"
+		"\tshare_decoder:           %s\n"
 		"\tis_looping:              %s\n"
 		"\tis_hw_decoding:          %s\n"
 		"\tis_clear_on_media_end:   %s\n"
@@ -237,7 +272,9 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 		"\tclose_when_inactive:     %s",
 		input ? input : "(null)",
 		input_format ? input_format : "(null)", s->speed_percent,
-		s->is_looping ? "yes" : "no", s->is_hw_decoding ? "yes" : "no",
+		s->decode_ahead_frames, s->frame_cache_mb,
+		s->share_decoder ? "yes" : "no", s->is_looping ? "yes" : "no",
+		s->is_hw_decoding ? "yes" : "no",
 		s->is_clear_on_media_end ? "yes" : "no",
 		s->restart_on_activate ? "yes" : "no",
 		s->close_when_inactive ? "yes" : "no");
@@ -249,6 +286,12 @@ static void get_frame(void *opaque, struct obs_source_frame *f)
 	obs_source_output_video(s->source, f);
 }
 
+static void get_shared_frame(void *opaque, struct obs_source_frame *f)
+{
+	struct ffmpeg_source *s = opaque;
+	obs_source_output_shared_video(s->source, f);
+}
+
 static void preload_frame(void *opaque, struct obs_source_frame *f)
 {
 	struct ffmpeg_source *s = opaque;
@@ -274,6 +317,11 @@ static void get_audio(void *opaque, struct obs_source_audio *a)
 static void media_stopped(void *opaque)
 {
 	struct ffmpeg_source *s = opaque;
+	long late_frames = mp_media_get_late_frames(s->media);
+
+	if (late_frames)
+		FF_BLOG(LOG_INFO, "Decoder fell behind %ld time(s)",
+			late_frames);
 	if (s->is_clear_on_media_end) {
 		obs_source_output_video(s->source, NULL);
 	}
@@ -294,17 +342,65 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.v_preload_cb = preload_frame,
 			.a_cb = get_audio,
 			.stop_cb = media_stopped,
+			.v_shared_cb = get_shared_frame,
 			.path = s->input,
 			.format = s->input_format,
 			.buffering = s->buffering_mb * 1024 * 1024,
 			.speed = s->speed_percent,
+			.decode_ahead_frames = s->decode_ahead_frames,
+			.frame_cache_mb = s->frame_cache_mb,
+			.prewarm_cache = s->prewarm_cache,
 			.force_range = s->range,
 			.hardware_decoding = s->is_hw_decoding,
 			.is_local_file = s->is_local_file || s->seekable,
 			.reconnecting = s->reconnecting,
 		};
 
-		s->media_valid = mp_media_init(&s->media, &info);
+		bool share = s->share_decoder && !s->decoder_unshared &&
+			     s->is_local_file;
+
+		s->media = mp_media_pool_acquire(&info, s->is_looping, share,
+						 &s->media_joined);
+		s->media_valid = s->media != NULL;
+	}
+}
+
+static void ffmpeg_source_close(struct ffmpeg_source *s)
+{
+	if (s->media_valid) {
+		mp_media_pool_release(s->media, s);
+		s->media = NULL;
+		s->media_valid = false;
+		s->media_joined = false;
+	}
+}
+
+/* Playback controls only apply to this source, so if it shares its decoder
+ * with other sources it switches to a decoder of its own first.  With
+ * 'resume' set, the new decoder carries on from the same position. */
+static void ffmpeg_source_unshare(struct ffmpeg_source *s, bool resume)
+{
+	int64_t ms;
+
+	if (!s->media_valid || s->decoder_unshared ||
+	    mp_media_pool_get_clients(s->media) < 2)
+		return;
+
+	ms = mp_get_current_time(s->media);
+	ffmpeg_source_close(s);
+
+	s->decoder_unshared = true;
+	ffmpeg_source_open(s);
+
+	if (!resume || !s->media_valid)
+		return;
+
+	if (s->state == OBS_MEDIA_STATE_PLAYING ||
+	    s->state == OBS_MEDIA_STATE_PAUSED) {
+		mp_media_play(s->media, s->is_looping, false);
+		mp_media_seek_to(s->media, ms);
+		if (s->state == OBS_MEDIA_STATE_PAUSED)
+			mp_media_play_pause(s->media, true);
 	}
 }
 
@@ -316,9 +412,14 @@ static void ffmpeg_source_start(struct ffmpeg_source *s)
 	if (!s->media_valid)
 		return;
 
-	mp_media_play(&s->media, s->is_looping, s->reconnecting);
-	if (s->is_local_file)
-		obs_source_show_preloaded_video(s->source);
+	/* joined a shared media that another source is already playing */
+	if (s->media_joined) {
+		s->media_joined = false;
+	} else {
+		mp_media_play(s->media, s->is_looping, s->reconnecting);
+		if (s->is_local_file)
+			obs_source_show_preloaded_video(s->source);
+	}
 
 	set_media_state(s, OBS_MEDIA_STATE_PLAYING);
 	obs_source_media_started(s->source);
@@ -350,10 +451,7 @@ static void ffmpeg_source_tick(void *data, float seconds)
 
 	struct ffmpeg_source *s = data;
 	if (s->destroy_media) {
-		if (s->media_valid) {
-			mp_media_free(&s->media);
-			s->media_valid = false;
-		}
+		ffmpeg_source_close(s);
 
 		s->destroy_media = false;
 
@@ -423,16 +521,19 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 							   "color_range");
 	s->buffering_mb = (int)obs_data_get_int(settings, "buffering_mb");
 	s->speed_percent = (int)obs_data_get_int(settings, "speed_percent");
+	s->decode_ahead_frames =
+		(int)obs_data_get_int(settings, "decode_ahead_frames");
+	s->frame_cache_mb = (int)obs_data_get_int(settings, "frame_cache_mb");
+	s->prewarm_cache = obs_data_get_bool(settings, "prewarm_cache");
 	s->is_local_file = is_local_file;
 	s->seekable = obs_data_get_bool(settings, "seekable");
+	s->share_decoder = obs_data_get_bool(settings, "share_decoder");
+	s->decoder_unshared = false;
 
 	if (s->speed_percent < 1 || s->speed_percent > 200)
 		s->speed_percent = 100;
 
-	if (s->media_valid) {
-		mp_media_free(&s->media);
-		s->media_valid = false;
-	}
+	ffmpeg_source_close(s);
 
 	bool active = obs_source_active(s->source);
 	if (!s->close_when_inactive || active)
@@ -473,8 +574,8 @@ static void get_duration(void *data, calldata_t *cd)
 {
 	struct ffmpeg_source *s = data;
 	int64_t dur = 0;
-	if (s->media.fmt)
-		dur = s->media.fmt->duration;
+	if (s->media_valid && s->media->fmt)
+		dur = s->media->fmt->duration;
 
 	calldata_set_int(cd, "duration", dur * 1000);
 }
@@ -484,13 +585,13 @@ static void get_nb_frames(void *data, calldata_t *cd)
 	struct ffmpeg_source *s = data;
 	int64_t frames = 0;
 
-	if (!s->media.fmt) {
+	if (!s->media_valid || !s->media->fmt) {
 		calldata_set_int(cd, "num_frames", frames);
 		return;
 	}
 
 	int video_stream_index = av_find_best_stream(
-		s->media.fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+		s->media->fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
 
 	if (video_stream_index < 0) {
 		FF_BLOG(LOG_WARNING, "Getting number of frames failed: No "
@@ -499,7 +600,7 @@ static void get_nb_frames(void *data, calldata_t *cd)
 		return;
 	}
 
-	AVStream *stream = s->media.fmt->streams[video_stream_index];
+	AVStream *stream = s->media->fmt->streams[video_stream_index];
 
 	if (stream->nb_frames > 0) {
 		frames = stream->nb_frames;
@@ -507,7 +608,7 @@ static void get_nb_frames(void *data, calldata_t *cd)
 		FF_BLOG(LOG_DEBUG, "nb_frames not set, estimating using frame "
 				   "rate and duration");
 		AVRational avg_frame_rate = stream->avg_frame_rate;
-		frames = (int64_t)ceil((double)s->media.fmt->duration /
+		frames = (int64_t)ceil((double)s->media->fmt->duration /
 				       (double)AV_TIME_BASE *
 				       (double)avg_frame_rate.num /
 				       (double)avg_frame_rate.den);
@@ -612,8 +713,7 @@ static void ffmpeg_source_destroy(void *data)
 		if (s->reconnect_thread_valid)
 			pthread_join(s->reconnect_thread, NULL);
 	}
-	if (s->media_valid)
-		mp_media_free(&s->media);
+	ffmpeg_source_close(s);
 
 	if (s->sws_ctx != NULL)
 		sws_freeContext(s->sws_ctx);
@@ -636,8 +736,10 @@ static void ffmpeg_source_deactivate(void *data)
 	struct ffmpeg_source *s = data;
 
 	if (s->restart_on_activate) {
+		ffmpeg_source_unshare(s, false);
+
 		if (s->media_valid) {
-			mp_media_stop(&s->media);
+			mp_media_stop(s->media);
 
 			if (s->is_clear_on_media_end)
 				obs_source_output_video(s->source, NULL);
@@ -655,7 +757,8 @@ static void ffmpeg_source_play_pause(void *data, bool pause)
 	if (!s->media_valid)
 		return;
 
-	mp_media_play_pause(&s->media, pause);
+	ffmpeg_source_unshare(s, true);
+	mp_media_play_pause(s->media, pause);
 
 	if (pause)
 		set_media_state(s, OBS_MEDIA_STATE_PAUSED);
@@ -668,7 +771,8 @@ static void ffmpeg_source_stop(void *data)
 	struct ffmpeg_source *s = data;
 
 	if (s->media_valid) {
-		mp_media_stop(&s->media);
+		ffmpeg_source_unshare(s, false);
+		mp_media_stop(s->media);
 		obs_source_output_video(s->source, NULL);
 		set_media_state(s, OBS_MEDIA_STATE_STOPPED);
 	}
@@ -678,8 +782,13 @@ static void ffmpeg_source_restart(void *data)
 {
 	struct ffmpeg_source *s = data;
 
-	if (obs_source_showing(s->source))
+	if (obs_source_showing(s->source)) {
+		/* a source that just joined media which is already playing
+		 * isn't restarted, see ffmpeg_source_start */
+		if (!s->media_joined)
+			ffmpeg_source_unshare(s, false);
 		ffmpeg_source_start(s);
+	}
 
 	set_media_state(s, OBS_MEDIA_STATE_PLAYING);
 }
@@ -689,8 +798,8 @@ static int64_t ffmpeg_source_get_duration(void *data)
 	struct ffmpeg_source *s = data;
 	int64_t dur = 0;
 
-	if (s->media.fmt)
-		dur = s->media.fmt->duration / INT64_C(1000);
+	if (s->media_valid && s->media->fmt)
+		dur = s->media->fmt->duration / INT64_C(1000);
 
 	return dur;
 }
@@ -699,14 +808,20 @@ static int64_t ffmpeg_source_get_time(void *data)
 {
 	struct ffmpeg_source *s = data;
 
-	return mp_get_current_time(&s->media);
+	if (!s->media_valid)
+		return 0;
+
+	return mp_get_current_time(s->media);
 }
 
 static void ffmpeg_source_set_time(void *data, int64_t ms)
 {
 	struct ffmpeg_source *s = data;
 
-	mp_media_seek_to(&s->media, ms);
+	if (s->media_valid) {
+		ffmpeg_source_unshare(s, true);
+		mp_media_seek_to(s->media, ms);
+	}
 }
 
 static enum obs_media_state ffmpeg_source_get_state(void *data)
@@ -26,6 +26,15 @@ struct lut_filter_data {
 	gs_effect_t *effect;
 	gs_texture_t *target;
 
+	gs_eparam_t *clut_1d_param;
+	gs_eparam_t *clut_3d_param;
+	gs_eparam_t *clut_amount_param;
+	gs_eparam_t *clut_scale_param;
+	gs_eparam_t *clut_offset_param;
+	gs_eparam_t *domain_min_param;
+	gs_eparam_t *domain_max_param;
+	gs_eparam_t *cube_width_i_param;
+
 	gs_image_file_t image;
 
 	uint32_t cube_width;
@@ -338,6 +347,25 @@ static void color_grade_filter_update(void *data, obs_data_t *settings)
 	filter->effect = gs_effect_create_from_file(effect_path, NULL);
 	bfree(effect_path);
 
+	if (filter->effect) {
+		filter->clut_1d_param =
+			gs_effect_get_param_by_name(filter->effect, "clut_1d");
+		filter->clut_3d_param =
+			gs_effect_get_param_by_name(filter->effect, "clut_3d");
+		filter->clut_amount_param = gs_effect_get_param_by_name(
+			filter->effect, "clut_amount");
+		filter->clut_scale_param = gs_effect_get_param_by_name(
+			filter->effect, "clut_scale");
+		filter->clut_offset_param = gs_effect_get_param_by_name(
+			filter->effect, "clut_offset");
+		filter->domain_min_param = gs_effect_get_param_by_name(
+			filter->effect, "domain_min");
+		filter->domain_max_param = gs_effect_get_param_by_name(
+			filter->effect, "domain_max");
+		filter->cube_width_i_param = gs_effect_get_param_by_name(
+			filter->effect, "cube_width_i");
+	}
+
 	obs_leave_graphics();
 }
 
@@ -413,7 +441,6 @@ static void color_grade_filter_render(void *data, gs_effect_t *effect)
 {
 	struct lut_filter_data *filter = data;
 	obs_source_t *target = obs_filter_get_target(filter->context);
-	gs_eparam_t *param;
 
 	if (!target || !filter->target || !filter->effect) {
 		obs_source_skip_video_filter(filter->context);
@@ -424,33 +451,21 @@ static void color_grade_filter_render(void *data, gs_effect_t *effect)
 					     OBS_ALLOW_DIRECT_RENDERING))
 		return;
 
-	const char *clut_texture_name = "clut_3d";
+	gs_eparam_t *clut_param = filter->clut_3d_param;
 	const char *tech_name = "Draw3D";
 	if (filter->clut_dim == CLUT_1D) {
-		clut_texture_name = "clut_1d";
+		clut_param = filter->clut_1d_param;
 		tech_name = "Draw1D";
 	}
 
-	param = gs_effect_get_param_by_name(filter->effect, clut_texture_name);
-	gs_effect_set_texture(param, filter->target);
-
-	param = gs_effect_get_param_by_name(filter->effect, "clut_amount");
-	gs_effect_set_float(param, filter->clut_amount);
-
-	param = gs_effect_get_param_by_name(filter->effect, "clut_scale");
-	gs_effect_set_vec3(param, &filter->clut_scale);
-
-	param = gs_effect_get_param_by_name(filter->effect, "clut_offset");
-	gs_effect_set_vec3(param, &filter->clut_offset);
-
-	param = gs_effect_get_param_by_name(filter->effect, "domain_min");
-	gs_effect_set_vec3(param, &filter->domain_min);
-
-	param = gs_effect_get_param_by_name(filter->effect, "domain_max");
-	gs_effect_set_vec3(param, &filter->domain_max);
-
-	param = gs_effect_get_param_by_name(filter->effect, "cube_width_i");
-	gs_effect_set_float(param, 1.0f / filter->cube_width);
+	gs_effect_set_texture(clut_param, filter->target);
+	gs_effect_set_float(filter->clut_amount_param, filter->clut_amount);
+	gs_effect_set_vec3(filter->clut_scale_param, &filter->clut_scale);
+	gs_effect_set_vec3(filter->clut_offset_param, &filter->clut_offset);
+	gs_effect_set_vec3(filter->domain_min_param, &filter->domain_min);
+	gs_effect_set_vec3(filter->domain_max_param, &filter->domain_max);
+	gs_effect_set_float(filter->cube_width_i_param,
+			    1.0f / filter->cube_width);
 
 	obs_source_process_filter_tech_end(filter->context, filter->effect, 0,
 					   0, tech_name);
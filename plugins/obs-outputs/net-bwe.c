@@ -0,0 +1,135 @@
+#include "net-bwe.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/sockios.h>
+#endif
+
+/* weight of each new sample in the smoothed estimate */
+#define BWE_EWMA_WEIGHT 0.25
+
+void net_bwe_reset(struct net_bwe *bwe)
+{
+	bwe->interval_start_ns = 0;
+	bwe->interval_bytes = 0;
+	bwe->interval_blocked_ns = 0;
+	bwe->interval_outq = -1;
+	bwe->est_kbps = 0.0;
+	bwe->est_valid = false;
+	bwe->rtt_ms = 0;
+	bwe->min_rtt_ms = 0;
+	bwe->has_tcp_info = false;
+}
+
+/* number of bytes still sitting in the kernel send queue, or -1 if the
+ * platform can't tell us */
+static int64_t get_send_queue_size(net_bwe_socket_t sock)
+{
+#ifdef __linux__
+	int outq = 0;
+	if (ioctl(sock, SIOCOUTQ, &outq) == 0)
+		return outq;
+#else
+	(void)sock;
+#endif
+	return -1;
+}
+
+void net_bwe_add_rtt(struct net_bwe *bwe, uint32_t rtt_ms)
+{
+	if (!rtt_ms)
+		rtt_ms = 1;
+
+	bwe->has_tcp_info = true;
+	bwe->rtt_ms = rtt_ms;
+	if (!bwe->min_rtt_ms || rtt_ms < bwe->min_rtt_ms)
+		bwe->min_rtt_ms = rtt_ms;
+}
+
+static void sample_tcp_info(struct net_bwe *bwe, net_bwe_socket_t sock)
+{
+#ifdef __linux__
+	struct tcp_info info;
+	socklen_t len = sizeof(info);
+
+	if (getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &len) != 0)
+		return;
+	if (!info.tcpi_rtt)
+		return;
+
+	net_bwe_add_rtt(bwe, info.tcpi_rtt / 1000);
+#else
+	(void)bwe;
+	(void)sock;
+#endif
+}
+
+bool net_bwe_add_sample(struct net_bwe *bwe, size_t size, uint64_t send_beg,
+			uint64_t send_end, int64_t outq)
+{
+	uint64_t elapsed;
+	int64_t delivered;
+	double rate_kbps;
+	bool link_limited;
+
+	if (!bwe->interval_start_ns) {
+		bwe->interval_start_ns = send_beg;
+		bwe->interval_outq = outq;
+	}
+
+	bwe->interval_bytes += size;
+	bwe->interval_blocked_ns += send_end - send_beg;
+
+	elapsed = send_end - bwe->interval_start_ns;
+	if (elapsed < NET_BWE_INTERVAL_NS)
+		return false;
+
+	/* only count what actually left the local send queue */
+	delivered = (int64_t)bwe->interval_bytes;
+	if (outq >= 0 && bwe->interval_outq >= 0)
+		delivered -= outq - bwe->interval_outq;
+	if (delivered < 0)
+		delivered = 0;
+
+	rate_kbps = (double)delivered * 8000000.0 / (double)elapsed;
+
+	/* if the sender spent most of the interval blocked, or the send queue
+	 * grew noticeably, the link was the bottleneck for this sample */
+	link_limited = bwe->interval_blocked_ns * 2 >= elapsed ||
+		       (outq >= 0 && bwe->interval_outq >= 0 &&
+			outq - bwe->interval_outq >
+				(int64_t)bwe->interval_bytes / 4);
+
+	if (!bwe->est_valid) {
+		bwe->est_kbps = rate_kbps;
+		bwe->est_valid = true;
+	} else if (link_limited || rate_kbps > bwe->est_kbps) {
+		bwe->est_kbps += BWE_EWMA_WEIGHT * (rate_kbps - bwe->est_kbps);
+	}
+
+	bwe->interval_start_ns = send_end;
+	bwe->interval_bytes = 0;
+	bwe->interval_blocked_ns = 0;
+	bwe->interval_outq = outq;
+	return true;
+}
+
+bool net_bwe_add_send(struct net_bwe *bwe, net_bwe_socket_t sock,
+		      size_t size, uint64_t send_beg, uint64_t send_end)
+{
+	int64_t outq = -1;
+
+	/* the queue size is only needed at interval boundaries, which saves
+	 * an ioctl for every packet */
+	if (net_bwe_needs_queue_size(bwe, send_end))
+		outq = get_send_queue_size(sock);
+
+	if (!net_bwe_add_sample(bwe, size, send_beg, send_end, outq))
+		return false;
+
+	sample_tcp_info(bwe, sock);
+	return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+typedef SOCKET net_bwe_socket_t;
+#else
+typedef int net_bwe_socket_t;
+#endif
+
+/*
+ * Estimates the available upstream bandwidth of a stream socket.
+ *
+ * Every packet handed to the socket is recorded along with how long the send
+ * blocked for.  Once per sampling interval the bytes that actually left the
+ * local send queue are turned into a delivery rate, which is smoothed with an
+ * EWMA.  Samples taken while the sender was not blocked are application
+ * limited and can only raise the estimate, while samples taken while the
+ * socket was backed up reflect the link and are applied as-is.
+ *
+ * Where the platform exposes TCP statistics (TCP_INFO on Linux) the round
+ * trip time is tracked too, so that callers can tell whether the path is
+ * starting to queue before the local buffer grows.
+ *
+ * net_bwe_add_send() queries the socket itself.  The estimator underneath it
+ * (net_bwe_add_sample() and net_bwe_add_rtt()) takes the send queue size and
+ * RTT as plain values, so it can also be driven by a simulated link.
+ */
+
+/* how often a new sample is taken */
+#define NET_BWE_INTERVAL_NS (250ULL * 1000000ULL)
+
+struct net_bwe {
+	uint64_t interval_start_ns;
+	uint64_t interval_bytes;
+	uint64_t interval_blocked_ns;
+	int64_t interval_outq;
+
+	double est_kbps;
+	bool est_valid;
+
+	uint32_t rtt_ms;
+	uint32_t min_rtt_ms;
+	bool has_tcp_info;
+};
+
+extern void net_bwe_reset(struct net_bwe *bwe);
+
+/* Records a packet of 'size' bytes that was written to 'sock' between
+ * 'send_beg' and 'send_end' (os_gettime_ns timestamps).  Returns true when
+ * a new estimate was produced. */
+extern bool net_bwe_add_send(struct net_bwe *bwe, net_bwe_socket_t sock,
+			     size_t size, uint64_t send_beg, uint64_t send_end);
+
+/* True if the next sample will close the sampling interval (or open the
+ * first one), which is when the size of the local send queue is needed */
+static inline bool net_bwe_needs_queue_size(const struct net_bwe *bwe,
+					    uint64_t send_end)
+{
+	return !bwe->interval_start_ns ||
+	       send_end - bwe->interval_start_ns >= NET_BWE_INTERVAL_NS;
+}
+
+/* Same as net_bwe_add_send(), but with the number of bytes still sitting in
+ * the local send queue after the send given directly in 'outq' (-1 if
+ * unknown).  'outq' is only used when net_bwe_needs_queue_size() is true. */
+extern bool net_bwe_add_sample(struct net_bwe *bwe, size_t size,
+			       uint64_t send_beg, uint64_t send_end,
+			       int64_t outq);
+
+/* Records a round trip time measurement of the connection */
+extern void net_bwe_add_rtt(struct net_bwe *bwe, uint32_t rtt_ms);
+
+/* Current estimate in kbps, or 0 if not enough data has been sampled */
+static inline long net_bwe_get_kbps(const struct net_bwe *bwe)
+{
+	return bwe->est_valid ? (long)bwe->est_kbps : 0;
+}
+
+/* True if the smoothed RTT has grown well beyond the lowest RTT observed,
+ * which indicates that a queue is building somewhere along the path */
+static inline bool net_bwe_rtt_inflated(const struct net_bwe *bwe)
+{
+	if (!bwe->has_tcp_info || !bwe->min_rtt_ms)
+		return false;
+
+	return bwe->rtt_ms > bwe->min_rtt_ms * 3 / 2 + 10;
+}
@@ -30,10 +30,14 @@
 #endif
 
 /* dynamic bitrate coefficients */
-#define DBR_INC_TIMER (30ULL * SEC_TO_NSEC)
+#define DBR_INC_TIMER (10ULL * SEC_TO_NSEC)
+#define DBR_INC_STEP_TIMER (2ULL * SEC_TO_NSEC)
+#define DBR_DEC_TIMER (1ULL * SEC_TO_NSEC)
 #define DBR_TRIGGER_USEC (200ULL * MSEC_TO_USEC)
-#define MIN_ESTIMATE_DURATION_MS 1000
-#define MAX_ESTIMATE_DURATION_MS 2000
+#define DBR_HEADROOM_PERCENT 90
+#define DBR_FALLBACK_DEC_PERCENT 75
+#define DBR_MAX_DEC_PERCENT 50
+#define DBR_INC_PERCENT 5
 
 static const char *rtmp_stream_getname(void *unused)
 {
@@ -51,6 +55,35 @@ static void log_rtmp(int level, const char *format, va_list args)
 
 static inline size_t num_buffered_packets(struct rtmp_stream *stream);
 
+static inline bool packet_dropped(const struct encoder_packet *packet)
+{
+	return !packet->data;
+}
+
+static inline int priority_idx(const struct encoder_packet *packet)
+{
+	if (packet->drop_priority < OBS_NAL_PRIORITY_DISPOSABLE)
+		return OBS_NAL_PRIORITY_DISPOSABLE;
+	if (packet->drop_priority > OBS_NAL_PRIORITY_HIGHEST)
+		return OBS_NAL_PRIORITY_HIGHEST;
+	return packet->drop_priority;
+}
+
+/* assumes packets_mutex is locked */
+static inline void track_packet(struct rtmp_stream *stream,
+				const struct encoder_packet *packet, bool add)
+{
+	if (add) {
+		stream->live_packets++;
+		if (packet->type == OBS_ENCODER_VIDEO)
+			stream->video_packets[priority_idx(packet)]++;
+	} else {
+		stream->live_packets--;
+		if (packet->type == OBS_ENCODER_VIDEO)
+			stream->video_packets[priority_idx(packet)]--;
+	}
+}
+
 static inline void free_packets(struct rtmp_stream *stream)
 {
 	size_t num_packets;
@@ -66,6 +99,10 @@ static inline void free_packets(struct rtmp_stream *stream)
 		circlebuf_pop_front(&stream->packets, &packet, sizeof(packet));
 		obs_encoder_packet_release(&packet);
 	}
+
+	stream->packets_popped = stream->packets_pushed;
+	stream->live_packets = 0;
+	memset(stream->video_packets, 0, sizeof(stream->video_packets));
 	pthread_mutex_unlock(&stream->packets_mutex);
 }
 
@@ -125,7 +162,6 @@ static void rtmp_stream_destroy(void *data)
 #ifdef TEST_FRAMEDROPS
 	circlebuf_free(&stream->droptest_info);
 #endif
-	circlebuf_free(&stream->dbr_frames);
 	pthread_mutex_destroy(&stream->dbr_mutex);
 
 	os_event_destroy(stream->buffer_space_available_event);
@@ -239,10 +275,16 @@ static inline bool get_next_packet(struct rtmp_stream *stream,
 	bool new_packet = false;
 
 	pthread_mutex_lock(&stream->packets_mutex);
-	if (stream->packets.size) {
+	while (stream->packets.size) {
 		circlebuf_pop_front(&stream->packets, packet,
 				    sizeof(struct encoder_packet));
-		new_packet = true;
+		stream->packets_popped++;
+
+		if (!packet_dropped(packet)) {
+			track_packet(stream, packet, false);
+			new_packet = true;
+			break;
+		}
 	}
 	pthread_mutex_unlock(&stream->packets_mutex);
 
@@ -530,35 +572,25 @@ static void set_output_error(struct rtmp_stream *stream)
 		obs_output_set_last_error(stream->output, msg);
 }
 
-static void dbr_add_frame(struct rtmp_stream *stream, struct dbr_frame *back)
+static void dbr_add_frame(struct rtmp_stream *stream, size_t size,
+			  uint64_t send_beg, uint64_t send_end)
 {
-	struct dbr_frame front;
-	uint64_t dur;
-
-	circlebuf_push_back(&stream->dbr_frames, back, sizeof(*back));
-	circlebuf_peek_front(&stream->dbr_frames, &front, sizeof(front));
-
-	stream->dbr_data_size += back->size;
-
-	dur = (back->send_end - front.send_beg) / 1000000;
-
-	if (dur >= MAX_ESTIMATE_DURATION_MS) {
-		stream->dbr_data_size -= front.size;
-		circlebuf_pop_front(&stream->dbr_frames, NULL, sizeof(front));
-	}
-
-	stream->dbr_est_bitrate =
-		(dur >= MIN_ESTIMATE_DURATION_MS)
-			? (long)(stream->dbr_data_size * 1000 / dur)
-			: 0;
-	stream->dbr_est_bitrate *= 8;
-	stream->dbr_est_bitrate /= 1000;
-
-	if (stream->dbr_est_bitrate) {
-		stream->dbr_est_bitrate -= stream->audio_bitrate;
-		if (stream->dbr_est_bitrate < 50)
-			stream->dbr_est_bitrate = 50;
+	bool updated;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	updated = net_bwe_add_send(&stream->dbr_bwe,
+				   stream->rtmp.m_sb.sb_socket, size, send_beg,
+				   send_end);
+
+	if (updated) {
+		stream->dbr_est_bitrate = net_bwe_get_kbps(&stream->dbr_bwe);
+		if (stream->dbr_est_bitrate) {
+			stream->dbr_est_bitrate -= stream->audio_bitrate;
+			if (stream->dbr_est_bitrate < 50)
+				stream->dbr_est_bitrate = 50;
+		}
 	}
+	pthread_mutex_unlock(&stream->dbr_mutex);
 }
 
 static void dbr_set_bitrate(struct rtmp_stream *stream);
@@ -571,7 +603,8 @@ static void *send_thread(void *data)
 
 	while (os_sem_wait(stream->send_sem) == 0) {
 		struct encoder_packet packet;
-		struct dbr_frame dbr_frame;
+		uint64_t send_beg = 0;
+		size_t send_size = 0;
 
 		if (stopping(stream) && stream->stop_ts == 0) {
 			break;
@@ -595,8 +628,8 @@ static void *send_thread(void *data)
 		}
 
 		if (stream->dbr_enabled) {
-			dbr_frame.send_beg = os_gettime_ns();
-			dbr_frame.size = packet.size;
+			send_beg = os_gettime_ns();
+			send_size = packet.size;
 		}
 
 		if (send_packet(stream, &packet, false, packet.track_idx) < 0) {
@@ -605,11 +638,8 @@ static void *send_thread(void *data)
 		}
 
 		if (stream->dbr_enabled) {
-			dbr_frame.send_end = os_gettime_ns();
-
-			pthread_mutex_lock(&stream->dbr_mutex);
-			dbr_add_frame(stream, &dbr_frame);
-			pthread_mutex_unlock(&stream->dbr_mutex);
+			dbr_add_frame(stream, send_size, send_beg,
+				      os_gettime_ns());
 		}
 	}
 
@@ -1058,14 +1088,18 @@ static bool init_connect(struct rtmp_stream *stream)
 	obs_data_t *vsettings = obs_encoder_get_settings(venc);
 	obs_data_t *asettings = obs_encoder_get_settings(aenc);
 
-	circlebuf_free(&stream->dbr_frames);
+	net_bwe_reset(&stream->dbr_bwe);
 	stream->audio_bitrate = (long)obs_data_get_int(asettings, "bitrate");
-	stream->dbr_data_size = 0;
 	stream->dbr_orig_bitrate = (long)obs_data_get_int(vsettings, "bitrate");
 	stream->dbr_cur_bitrate = stream->dbr_orig_bitrate;
 	stream->dbr_est_bitrate = 0;
-	stream->dbr_inc_bitrate = stream->dbr_orig_bitrate / 10;
+	stream->dbr_prev_bitrate = 0;
+	stream->dbr_inc_bitrate =
+		stream->dbr_orig_bitrate * DBR_INC_PERCENT / 100;
+	if (stream->dbr_inc_bitrate < 50)
+		stream->dbr_inc_bitrate = 50;
 	stream->dbr_inc_timeout = 0;
+	stream->dbr_dec_timeout = 0;
 	stream->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE);
 
 	caps = obs_encoder_get_caps(venc);
@@ -1147,12 +1181,32 @@ static inline bool add_packet(struct rtmp_stream *stream,
 {
 	circlebuf_push_back(&stream->packets, packet,
 			    sizeof(struct encoder_packet));
+	stream->packets_pushed++;
+	track_packet(stream, packet, true);
 	return true;
 }
 
 static inline size_t num_buffered_packets(struct rtmp_stream *stream)
 {
-	return stream->packets.size / sizeof(struct encoder_packet);
+	return stream->live_packets;
+}
+
+static inline struct encoder_packet *packet_at(struct rtmp_stream *stream,
+					       uint64_t pos)
+{
+	size_t idx = (size_t)(pos - stream->packets_popped);
+	return circlebuf_data(&stream->packets,
+			      idx * sizeof(struct encoder_packet));
+}
+
+static inline size_t num_video_packets_below(struct rtmp_stream *stream,
+					     int priority)
+{
+	size_t count = 0;
+
+	for (int i = 0; i < priority && i <= OBS_NAL_PRIORITY_HIGHEST; i++)
+		count += stream->video_packets[i];
+	return count;
 }
 
 static void drop_frames(struct rtmp_stream *stream, const char *name,
@@ -1160,7 +1214,11 @@ static void drop_frames(struct rtmp_stream *stream, const char *name,
 {
 	UNUSED_PARAMETER(pframes);
 
-	struct circlebuf new_buf = {0};
+	int idx = highest_priority > OBS_NAL_PRIORITY_HIGHEST
+			  ? OBS_NAL_PRIORITY_HIGHEST
+			  : highest_priority;
+	size_t droppable = num_video_packets_below(stream, highest_priority);
+	uint64_t pos = stream->drop_scan[idx];
 	int num_frames_dropped = 0;
 
 #ifdef _DEBUG
@@ -1169,25 +1227,31 @@ static void drop_frames(struct rtmp_stream *stream, const char *name,
 	UNUSED_PARAMETER(name);
 #endif
 
-	circlebuf_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
+	/* packets before the last scan position for this priority have
+	 * already been filtered, and anything queued since then is only
+	 * scanned until every droppable packet has been found */
+	if (pos < stream->packets_popped)
+		pos = stream->packets_popped;
 
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		circlebuf_pop_front(&stream->packets, &packet, sizeof(packet));
+	for (; droppable && pos < stream->packets_pushed; pos++) {
+		struct encoder_packet *packet = packet_at(stream, pos);
 
 		/* do not drop audio data or video keyframes */
-		if (packet.type == OBS_ENCODER_AUDIO ||
-		    packet.drop_priority >= highest_priority) {
-			circlebuf_push_back(&new_buf, &packet, sizeof(packet));
+		if (packet_dropped(packet) ||
+		    packet->type == OBS_ENCODER_AUDIO ||
+		    packet->drop_priority >= highest_priority)
+			continue;
 
-		} else {
-			num_frames_dropped++;
-			obs_encoder_packet_release(&packet);
-		}
+		track_packet(stream, packet, false);
+		obs_encoder_packet_release(packet);
+		num_frames_dropped++;
+		droppable--;
 	}
 
-	circlebuf_free(&stream->packets);
-	stream->packets = new_buf;
+	for (int i = 0; i <= idx; i++) {
+		if (stream->drop_scan[i] < stream->packets_pushed)
+			stream->drop_scan[i] = stream->packets_pushed;
+	}
 
 	if (stream->min_priority < highest_priority)
 		stream->min_priority = highest_priority;
@@ -1204,80 +1268,74 @@ static void drop_frames(struct rtmp_stream *stream, const char *name,
 static bool find_first_video_packet(struct rtmp_stream *stream,
 				    struct encoder_packet *first)
 {
-	size_t count = stream->packets.size / sizeof(*first);
-
-	for (size_t i = 0; i < count; i++) {
-		struct encoder_packet *cur =
-			circlebuf_data(&stream->packets, i * sizeof(*first));
-		if (cur->type == OBS_ENCODER_VIDEO && !cur->keyframe) {
+	uint64_t pos = stream->first_video_scan;
+
+	if (pos < stream->packets_popped)
+		pos = stream->packets_popped;
+
+	/* the first droppable video packet only ever moves forward, so
+	 * resume from where the last search stopped */
+	for (; pos < stream->packets_pushed; pos++) {
+		struct encoder_packet *cur = packet_at(stream, pos);
+		if (!packet_dropped(cur) && cur->type == OBS_ENCODER_VIDEO &&
+		    !cur->keyframe) {
+			stream->first_video_scan = pos;
 			*first = *cur;
 			return true;
 		}
 	}
 
+	stream->first_video_scan = pos;
 	return false;
 }
 
+/* Picks a lower bitrate once the send buffer starts backing up.  The
+ * measured link throughput (minus some headroom) is used as the target when
+ * it is below the current bitrate; otherwise the estimate is lagging behind
+ * the congestion, so back off by a fixed ratio instead.  A single step never
+ * more than halves the bitrate, and steps are spaced out so the encoder has
+ * time to react before the buffer is judged again. */
 static bool dbr_bitrate_lowered(struct rtmp_stream *stream)
 {
 	long prev_bitrate = stream->dbr_prev_bitrate;
-	long est_bitrate = 0;
+	long cur_bitrate = stream->dbr_cur_bitrate;
+	long est_bitrate = stream->dbr_est_bitrate;
+	long min_bitrate = cur_bitrate * DBR_MAX_DEC_PERCENT / 100;
 	long new_bitrate;
+	uint64_t t = os_gettime_ns();
 
-	if (stream->dbr_est_bitrate &&
-	    stream->dbr_est_bitrate < stream->dbr_cur_bitrate) {
-		stream->dbr_data_size = 0;
-		circlebuf_pop_front(&stream->dbr_frames, NULL,
-				    stream->dbr_frames.size);
-		est_bitrate = stream->dbr_est_bitrate / 100 * 100;
-		if (est_bitrate < 50) {
-			est_bitrate = 50;
-		}
-	}
+	if (t < stream->dbr_dec_timeout)
+		return false;
 
-#if 0
-	if (prev_bitrate && est_bitrate) {
-		if (prev_bitrate < est_bitrate) {
-			blog(LOG_INFO, "going back to prev bitrate: "
-					"prev_bitrate (%d) < est_bitrate (%d)",
-					prev_bitrate,
-					est_bitrate);
-			new_bitrate = prev_bitrate;
-		} else {
-			new_bitrate = est_bitrate;
-		}
-		new_bitrate = est_bitrate;
-	} else if (prev_bitrate) {
+	if (prev_bitrate && prev_bitrate < cur_bitrate &&
+	    (!est_bitrate || est_bitrate >= prev_bitrate)) {
+		/* the last increase was too much, undo it */
 		new_bitrate = prev_bitrate;
 		info("going back to prev bitrate");
 
-	} else if (est_bitrate) {
-		new_bitrate = est_bitrate;
+	} else if (est_bitrate && est_bitrate < cur_bitrate) {
+		new_bitrate = est_bitrate * DBR_HEADROOM_PERCENT / 100;
 
 	} else {
-		return false;
+		new_bitrate = cur_bitrate * DBR_FALLBACK_DEC_PERCENT / 100;
 	}
-#else
-	if (est_bitrate) {
-		new_bitrate = est_bitrate;
 
-	} else if (prev_bitrate) {
-		new_bitrate = prev_bitrate;
-		info("going back to prev bitrate");
+	if (new_bitrate < min_bitrate)
+		new_bitrate = min_bitrate;
 
-	} else {
-		return false;
-	}
+	new_bitrate = new_bitrate / 50 * 50;
+	if (new_bitrate < 50)
+		new_bitrate = 50;
 
-	if (new_bitrate == stream->dbr_cur_bitrate) {
+	if (new_bitrate >= cur_bitrate)
 		return false;
-	}
-#endif
 
 	stream->dbr_prev_bitrate = 0;
 	stream->dbr_cur_bitrate = new_bitrate;
-	stream->dbr_inc_timeout = os_gettime_ns() + DBR_INC_TIMER;
-	info("bitrate decreased to: %ld", stream->dbr_cur_bitrate);
+	stream->dbr_dec_timeout = t + DBR_DEC_TIMER;
+	stream->dbr_inc_timeout = t + DBR_INC_TIMER;
+	info("bitrate decreased to: %ld (estimated bandwidth: %ld)",
+	     stream->dbr_cur_bitrate, est_bitrate);
 	return true;
 }
 
@@ -1302,7 +1360,7 @@ static void dbr_inc_bitrate(struct rtmp_stream *stream)
 		info("bitrate increased to: %ld, done",
 		     stream->dbr_cur_bitrate);
 	} else if (stream->dbr_cur_bitrate < stream->dbr_orig_bitrate) {
-		stream->dbr_inc_timeout = os_gettime_ns() + DBR_INC_TIMER;
+		stream->dbr_inc_timeout = os_gettime_ns() + DBR_INC_STEP_TIMER;
 		info("bitrate increased to: %ld, waiting",
 		     stream->dbr_cur_bitrate);
 	}
@@ -1324,9 +1382,24 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 			uint64_t t = os_gettime_ns();
 
 			if (t >= stream->dbr_inc_timeout) {
-				stream->dbr_inc_timeout = 0;
-				dbr_inc_bitrate(stream);
-				dbr_set_bitrate(stream);
+				bool rtt_inflated;
+
+				pthread_mutex_lock(&stream->dbr_mutex);
+				rtt_inflated =
+					net_bwe_rtt_inflated(&stream->dbr_bwe);
+				pthread_mutex_unlock(&stream->dbr_mutex);
+
+				/* only probe upwards while the path is clear,
+				 * otherwise check again a bit later */
+				if (rtt_inflated ||
+				    stream->congestion > 0.25f) {
+					stream->dbr_inc_timeout =
+						t + DBR_INC_STEP_TIMER;
+				} else {
+					stream->dbr_inc_timeout = 0;
+					dbr_inc_bitrate(stream);
+					dbr_set_bitrate(stream);
+				}
 			}
 		}
 	}
@@ -9,6 +9,7 @@
 #include "librtmp/log.h"
 #include "flv-mux.h"
 #include "net-if.h"
+#include "net-bwe.h"
 
 #ifdef _WIN32
 #include <Iphlpapi.h>
@@ -46,12 +47,6 @@ struct droptest_info {
 };
 #endif
 
-struct dbr_frame {
-	uint64_t send_beg;
-	uint64_t send_end;
-	size_t size;
-};
-
 struct rtmp_stream {
 	obs_output_t *output;
 
@@ -90,6 +85,16 @@ struct rtmp_stream {
 
 	int64_t last_dts_usec;
 
+	/* packet queue bookkeeping.  dropped packets are released in place
+	 * and left in the queue as empty tombstones until the send thread pops
+	 * them, positions are absolute packet sequence numbers */
+	uint64_t packets_pushed;
+	uint64_t packets_popped;
+	uint64_t first_video_scan;
+	uint64_t drop_scan[OBS_NAL_PRIORITY_HIGHEST + 1];
+	size_t live_packets;
+	size_t video_packets[OBS_NAL_PRIORITY_HIGHEST + 1];
+
 	uint64_t total_bytes_sent;
 	int dropped_frames;
 
@@ -101,9 +106,9 @@ struct rtmp_stream {
 #endif
 
 	pthread_mutex_t dbr_mutex;
-	struct circlebuf dbr_frames;
-	size_t dbr_data_size;
+	struct net_bwe dbr_bwe;
 	uint64_t dbr_inc_timeout;
+	uint64_t dbr_dec_timeout;
 	long audio_bitrate;
 	long dbr_est_bitrate;
 	long dbr_orig_bitrate;
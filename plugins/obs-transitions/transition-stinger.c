@@ -4,6 +4,9 @@
 #define TIMING_TIME 0
 #define TIMING_FRAME 1
 
+/* memory the media source may use to keep the decoded stinger around */
+#define STINGER_FRAME_CACHE_MB 512
+
 enum fade_style { FADE_STYLE_FADE_OUT_FADE_IN, FADE_STYLE_CROSS_FADE };
 
 struct stinger_info {
@@ -45,6 +48,13 @@ static void stinger_update(void *data, obs_data_t *settings)
 
 	obs_data_t *media_settings = obs_data_create();
 	obs_data_set_string(media_settings, "local_file", path);
+	/* decode the whole stinger into memory while it's loaded rather than
+	 * during the first transition */
+	if (obs_data_get_bool(settings, "cache_frames")) {
+		obs_data_set_int(media_settings, "frame_cache_mb",
+				 STINGER_FRAME_CACHE_MB);
+		obs_data_set_bool(media_settings, "prewarm_cache", true);
+	}
 
 	obs_source_release(s->media_source);
 	struct dstr name;
@@ -357,6 +367,9 @@ static obs_properties_t *stinger_properties(void *data)
 				  obs_module_text("AudioFadeStyle.CrossFade"),
 				  FADE_STYLE_CROSS_FADE);
 
+	obs_properties_add_bool(ppts, "cache_frames",
+				obs_module_text("CacheFrames"));
+
 	UNUSED_PARAMETER(data);
 	return ppts;
 }
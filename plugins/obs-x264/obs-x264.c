@@ -661,19 +661,39 @@ static void parse_packet(struct obs_x264 *obsx264,
 			 struct encoder_packet *packet, x264_nal_t *nals,
 			 int nal_count, x264_picture_t *pic_out)
 {
+	uint8_t *end;
+
 	if (!nal_count)
 		return;
 
-	da_resize(obsx264->packet_data, 0);
+	/* x264 writes the payloads of all NALs back to back in its own
+	 * buffer, which stays valid until the next encode call.  libobs
+	 * copies the packet once before encode returns, so hand that buffer
+	 * over as-is rather than gathering the NALs into another one. */
+	end = nals[0].p_payload;
+	for (int i = 0; i < nal_count && end; i++) {
+		if (nals[i].p_payload != end)
+			end = NULL;
+		else
+			end += nals[i].i_payload;
+	}
 
-	for (int i = 0; i < nal_count; i++) {
-		x264_nal_t *nal = nals + i;
-		da_push_back_array(obsx264->packet_data, nal->p_payload,
-				   nal->i_payload);
+	if (end) {
+		packet->data = nals[0].p_payload;
+		packet->size = (size_t)(end - nals[0].p_payload);
+	} else {
+		da_resize(obsx264->packet_data, 0);
+
+		for (int i = 0; i < nal_count; i++) {
+			x264_nal_t *nal = nals + i;
+			da_push_back_array(obsx264->packet_data,
+					   nal->p_payload, nal->i_payload);
+		}
+
+		packet->data = obsx264->packet_data.array;
+		packet->size = obsx264->packet_data.num;
 	}
 
-	packet->data = obsx264->packet_data.array;
-	packet->size = obsx264->packet_data.num;
 	packet->type = OBS_ENCODER_VIDEO;
 	packet->pts = pic_out->i_pts;
 	packet->dts = pic_out->i_dts;
@@ -0,0 +1,453 @@
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "glyph-atlas.h"
+
+#define PAGE_SIZE GLYPH_ATLAS_PAGE_SIZE
+
+#define GLYPH_BLOCK_SIZE 256
+#define GLYPH_BLOCKS 256
+
+/* pages drawn more recently than this are never cleared to make room, so two
+ * sources can't keep evicting each other's glyphs every frame */
+#define EVICT_MIN_IDLE_NS 1000000000ULL
+
+struct atlas_glyph {
+	struct glyph_info info;
+	bool cached;
+};
+
+struct atlas_page {
+	gs_texture_t *tex;
+	uint8_t *pixels;
+
+	uint32_t shelf_x, shelf_y, shelf_h;
+
+	/* area of the pixels that still has to be uploaded, empty if
+	 * dirty_x2 is 0 */
+	uint32_t dirty_x, dirty_y, dirty_x2, dirty_y2;
+
+	uint64_t last_used;
+	uint64_t cache_id;
+};
+
+struct glyph_atlas {
+	char *path;
+	FT_Long index;
+	uint16_t size;
+	FT_Render_Mode render_mode;
+	long refs;
+
+	pthread_mutex_t mutex;
+	struct atlas_glyph *glyphs[GLYPH_BLOCKS];
+	struct atlas_page pages[GLYPH_ATLAS_MAX_PAGES];
+	uint32_t num_pages;
+	uint32_t cur_page;
+	uint64_t cache_id;
+	volatile long generation;
+	bool out_of_space;
+
+	struct glyph_atlas *next;
+};
+
+static pthread_mutex_t atlas_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct glyph_atlas *first_atlas = NULL;
+
+struct glyph_atlas *glyph_atlas_acquire(const char *path, FT_Long index,
+					uint16_t size,
+					FT_Render_Mode render_mode)
+{
+	struct glyph_atlas *atlas;
+
+	if (!path)
+		return NULL;
+
+	pthread_mutex_lock(&atlas_list_mutex);
+
+	for (atlas = first_atlas; atlas; atlas = atlas->next) {
+		if (atlas->index == index && atlas->size == size &&
+		    atlas->render_mode == render_mode &&
+		    strcmp(atlas->path, path) == 0) {
+			atlas->refs++;
+			goto done;
+		}
+	}
+
+	atlas = bzalloc(sizeof(struct glyph_atlas));
+	atlas->path = bstrdup(path);
+	atlas->index = index;
+	atlas->size = size;
+	atlas->render_mode = render_mode;
+	atlas->refs = 1;
+	pthread_mutex_init(&atlas->mutex, NULL);
+
+	atlas->next = first_atlas;
+	first_atlas = atlas;
+
+done:
+	pthread_mutex_unlock(&atlas_list_mutex);
+	return atlas;
+}
+
+static void glyph_atlas_destroy(struct glyph_atlas *atlas)
+{
+	obs_enter_graphics();
+	for (uint32_t i = 0; i < atlas->num_pages; i++)
+		gs_texture_destroy(atlas->pages[i].tex);
+	obs_leave_graphics();
+
+	for (uint32_t i = 0; i < atlas->num_pages; i++)
+		bfree(atlas->pages[i].pixels);
+	for (size_t i = 0; i < GLYPH_BLOCKS; i++)
+		bfree(atlas->glyphs[i]);
+
+	pthread_mutex_destroy(&atlas->mutex);
+	bfree(atlas->path);
+	bfree(atlas);
+}
+
+void glyph_atlas_release(struct glyph_atlas *atlas)
+{
+	struct glyph_atlas **p_atlas;
+
+	if (!atlas)
+		return;
+
+	pthread_mutex_lock(&atlas_list_mutex);
+
+	if (--atlas->refs > 0) {
+		pthread_mutex_unlock(&atlas_list_mutex);
+		return;
+	}
+
+	for (p_atlas = &first_atlas; *p_atlas; p_atlas = &(*p_atlas)->next) {
+		if (*p_atlas == atlas) {
+			*p_atlas = atlas->next;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&atlas_list_mutex);
+
+	glyph_atlas_destroy(atlas);
+}
+
+static struct atlas_glyph *get_glyph(struct glyph_atlas *atlas,
+				     FT_UInt glyph_index, bool create)
+{
+	const size_t block = glyph_index / GLYPH_BLOCK_SIZE;
+
+	if (block >= GLYPH_BLOCKS)
+		return NULL;
+
+	if (!atlas->glyphs[block]) {
+		if (!create)
+			return NULL;
+		atlas->glyphs[block] = bzalloc(sizeof(struct atlas_glyph) *
+					       GLYPH_BLOCK_SIZE);
+	}
+
+	return &atlas->glyphs[block][glyph_index % GLYPH_BLOCK_SIZE];
+}
+
+static inline void mark_dirty(struct atlas_page *page, uint32_t x, uint32_t y,
+			      uint32_t w, uint32_t h)
+{
+	if (!page->dirty_x2) {
+		page->dirty_x = x;
+		page->dirty_y = y;
+		page->dirty_x2 = x + w;
+		page->dirty_y2 = y + h;
+		return;
+	}
+
+	if (x < page->dirty_x)
+		page->dirty_x = x;
+	if (y < page->dirty_y)
+		page->dirty_y = y;
+	if (x + w > page->dirty_x2)
+		page->dirty_x2 = x + w;
+	if (y + h > page->dirty_y2)
+		page->dirty_y2 = y + h;
+}
+
+static bool page_alloc(struct atlas_page *page, uint32_t w, uint32_t h,
+		       uint32_t *x, uint32_t *y)
+{
+	if (page->shelf_x + w > PAGE_SIZE) {
+		page->shelf_x = 0;
+		page->shelf_y += page->shelf_h + 1;
+		page->shelf_h = 0;
+	}
+
+	if (w > PAGE_SIZE || page->shelf_y + h > PAGE_SIZE)
+		return false;
+
+	*x = page->shelf_x;
+	*y = page->shelf_y;
+
+	page->shelf_x += w + 1;
+	if (h > page->shelf_h)
+		page->shelf_h = h;
+	return true;
+}
+
+static void evict_page(struct glyph_atlas *atlas, uint32_t page_idx)
+{
+	struct atlas_page *page = &atlas->pages[page_idx];
+
+	for (size_t i = 0; i < GLYPH_BLOCKS; i++) {
+		struct atlas_glyph *block = atlas->glyphs[i];
+		if (!block)
+			continue;
+
+		for (size_t j = 0; j < GLYPH_BLOCK_SIZE; j++) {
+			if (block[j].cached && block[j].info.page == page_idx)
+				block[j].cached = false;
+		}
+	}
+
+	memset(page->pixels, 0, PAGE_SIZE * PAGE_SIZE);
+	page->shelf_x = 0;
+	page->shelf_y = 0;
+	page->shelf_h = 0;
+	mark_dirty(page, 0, 0, PAGE_SIZE, PAGE_SIZE);
+
+	os_atomic_inc_long(&atlas->generation);
+}
+
+/* Finds room for a glyph on the page currently being filled, then on a new
+ * page, and finally on the least recently drawn page that the text being
+ * cached doesn't use. */
+static struct atlas_page *find_space(struct glyph_atlas *atlas, uint32_t w,
+				     uint32_t h, uint32_t *x, uint32_t *y,
+				     uint32_t *page_idx)
+{
+	struct atlas_page *page;
+	uint64_t now = os_gettime_ns();
+	uint64_t oldest = now;
+	uint32_t victim = GLYPH_ATLAS_MAX_PAGES;
+
+	if (atlas->num_pages) {
+		page = &atlas->pages[atlas->cur_page];
+		if (page_alloc(page, w, h, x, y)) {
+			*page_idx = atlas->cur_page;
+			return page;
+		}
+	}
+
+	if (atlas->num_pages < GLYPH_ATLAS_MAX_PAGES) {
+		victim = atlas->num_pages++;
+		page = &atlas->pages[victim];
+		page->pixels = bzalloc(PAGE_SIZE * PAGE_SIZE);
+	} else {
+		for (uint32_t i = 0; i < atlas->num_pages; i++) {
+			page = &atlas->pages[i];
+			if (page->cache_id == atlas->cache_id)
+				continue;
+			if (now - page->last_used < EVICT_MIN_IDLE_NS)
+				continue;
+			if (page->last_used <= oldest) {
+				oldest = page->last_used;
+				victim = i;
+			}
+		}
+
+		if (victim == GLYPH_ATLAS_MAX_PAGES)
+			return NULL;
+
+		evict_page(atlas, victim);
+		page = &atlas->pages[victim];
+	}
+
+	atlas->cur_page = victim;
+	page->last_used = now;
+
+	*page_idx = victim;
+	return page_alloc(page, w, h, x, y) ? page : NULL;
+}
+
+static inline uint8_t get_pixel_value(const unsigned char *buf_row,
+				      FT_Render_Mode render_mode,
+				      const uint32_t x)
+{
+	if (render_mode == FT_RENDER_MODE_NORMAL) {
+		return buf_row[x];
+	}
+
+	const uint32_t byte_index = x / 8;
+	const uint8_t bit_index = x % 8;
+	const bool pixel_set = (buf_row[byte_index] >> (7 - bit_index)) & 1;
+	return pixel_set ? 255 : 0;
+}
+
+static void rasterize(struct atlas_page *page, FT_GlyphSlot slot,
+		      const FT_Render_Mode render_mode, const uint32_t dx,
+		      const uint32_t dy)
+{
+	/**
+	 * The pitch's absolute value is the number of bytes taken by one bitmap
+	 * row, including padding.
+	 *
+	 * Source: https://www.freetype.org/freetype2/docs/reference/ft2-basic_types.html
+	 */
+	const int pitch = abs(slot->bitmap.pitch);
+
+	for (uint32_t y = 0; y < slot->bitmap.rows; y++) {
+		const unsigned char *src = &slot->bitmap.buffer[y * pitch];
+		uint8_t *row = page->pixels + (dy + y) * PAGE_SIZE + dx;
+
+		for (uint32_t x = 0; x < slot->bitmap.width; x++)
+			row[x] = get_pixel_value(src, render_mode, x);
+	}
+}
+
+static bool add_glyph(struct glyph_atlas *atlas, FT_Face face,
+		      FT_UInt glyph_index, struct atlas_glyph *glyph)
+{
+	const FT_Int32 load_mode = atlas->render_mode == FT_RENDER_MODE_MONO
+					   ? FT_LOAD_TARGET_MONO
+					   : FT_LOAD_DEFAULT;
+	FT_GlyphSlot slot = face->glyph;
+	struct atlas_page *page;
+	uint32_t x = 0, y = 0, page_idx = 0;
+
+	FT_Load_Glyph(face, glyph_index, load_mode);
+	FT_Render_Glyph(slot, atlas->render_mode);
+
+	const uint32_t g_w = slot->bitmap.width;
+	const uint32_t g_h = slot->bitmap.rows;
+
+	if (g_w && g_h) {
+		page = find_space(atlas, g_w, g_h, &x, &y, &page_idx);
+		if (!page)
+			return false;
+
+		rasterize(page, slot, atlas->render_mode, x, y);
+		mark_dirty(page, x, y, g_w, g_h);
+		page->cache_id = atlas->cache_id;
+	}
+
+	glyph->info.u = (float)x / (float)PAGE_SIZE;
+	glyph->info.u2 = (float)(x + g_w) / (float)PAGE_SIZE;
+	glyph->info.v = (float)y / (float)PAGE_SIZE;
+	glyph->info.v2 = (float)(y + g_h) / (float)PAGE_SIZE;
+	glyph->info.w = g_w;
+	glyph->info.h = g_h;
+	glyph->info.yoff = slot->bitmap_top;
+	glyph->info.xoff = slot->bitmap_left;
+	glyph->info.xadv = slot->advance.x >> 6;
+	glyph->info.page = page_idx;
+	glyph->cached = true;
+	return true;
+}
+
+void glyph_atlas_cache(struct glyph_atlas *atlas, FT_Face face,
+		       const wchar_t *text)
+{
+	if (!atlas || !face || !text)
+		return;
+
+	const size_t len = wcslen(text);
+
+	pthread_mutex_lock(&atlas->mutex);
+	atlas->cache_id++;
+
+	for (size_t i = 0; i < len; i++) {
+		const FT_UInt glyph_index = FT_Get_Char_Index(face, text[i]);
+		struct atlas_glyph *glyph = get_glyph(atlas, glyph_index, true);
+
+		if (!glyph)
+			continue;
+
+		if (glyph->cached) {
+			if (glyph->info.w && glyph->info.h)
+				atlas->pages[glyph->info.page].cache_id =
+					atlas->cache_id;
+			continue;
+		}
+
+		if (!add_glyph(atlas, face, glyph_index, glyph)) {
+			if (!atlas->out_of_space) {
+				blog(LOG_WARNING,
+				     "Out of space trying to render glyphs");
+				atlas->out_of_space = true;
+			}
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&atlas->mutex);
+}
+
+bool glyph_atlas_get_glyph(struct glyph_atlas *atlas, FT_UInt glyph_index,
+			   struct glyph_info *info)
+{
+	struct atlas_glyph *glyph;
+	bool found = false;
+
+	if (!atlas)
+		return false;
+
+	pthread_mutex_lock(&atlas->mutex);
+
+	glyph = get_glyph(atlas, glyph_index, false);
+	if (glyph && glyph->cached) {
+		*info = glyph->info;
+		found = true;
+	}
+
+	pthread_mutex_unlock(&atlas->mutex);
+	return found;
+}
+
+long glyph_atlas_get_generation(struct glyph_atlas *atlas)
+{
+	return atlas ? os_atomic_load_long(&atlas->generation) : 0;
+}
+
+static void upload_page(struct atlas_page *page)
+{
+	if (page->tex && page->dirty_x2) {
+		const uint8_t *data = page->pixels +
+				      page->dirty_y * PAGE_SIZE + page->dirty_x;
+
+		if (!gs_texture_set_region(page->tex, page->dirty_x,
+					   page->dirty_y,
+					   page->dirty_x2 - page->dirty_x,
+					   page->dirty_y2 - page->dirty_y,
+					   data, PAGE_SIZE)) {
+			gs_texture_destroy(page->tex);
+			page->tex = NULL;
+		}
+	}
+
+	if (!page->tex)
+		page->tex = gs_texture_create(PAGE_SIZE, PAGE_SIZE, GS_A8, 1,
+					      (const uint8_t **)&page->pixels,
+					      0);
+
+	page->dirty_x2 = 0;
+}
+
+gs_texture_t *glyph_atlas_get_texture(struct glyph_atlas *atlas,
+				      uint32_t page_idx)
+{
+	gs_texture_t *tex = NULL;
+
+	if (!atlas)
+		return NULL;
+
+	pthread_mutex_lock(&atlas->mutex);
+
+	if (page_idx < atlas->num_pages) {
+		struct atlas_page *page = &atlas->pages[page_idx];
+
+		upload_page(page);
+		page->last_used = os_gettime_ns();
+		tex = page->tex;
+	}
+
+	pthread_mutex_unlock(&atlas->mutex);
+	return tex;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <obs-module.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+/*
+ * Glyph atlases are shared by every text source that uses the same font file,
+ * face, pixel size and render mode.  Glyphs are packed onto shelves in A8
+ * pages, and only the part of a page that changed is uploaded when it is next
+ * drawn.  Once all pages are full, the page that was drawn least recently is
+ * cleared and reused, which bumps the atlas generation so that sources know
+ * to rebuild their vertex buffers.
+ */
+
+#define GLYPH_ATLAS_PAGE_SIZE 2048
+#define GLYPH_ATLAS_MAX_PAGES 4
+
+struct glyph_info {
+	float u, v, u2, v2;
+	int32_t w, h, xoff, yoff;
+	int32_t xadv;
+	uint32_t page;
+};
+
+struct glyph_atlas;
+
+extern struct glyph_atlas *glyph_atlas_acquire(const char *path,
+					       FT_Long index, uint16_t size,
+					       FT_Render_Mode render_mode);
+extern void glyph_atlas_release(struct glyph_atlas *atlas);
+
+/* Rasterizes the glyphs of the text that aren't in the atlas yet.  The face
+ * must already be set to the pixel size of the atlas. */
+extern void glyph_atlas_cache(struct glyph_atlas *atlas, FT_Face face,
+			      const wchar_t *text);
+
+extern bool glyph_atlas_get_glyph(struct glyph_atlas *atlas,
+				  FT_UInt glyph_index, struct glyph_info *info);
+extern long glyph_atlas_get_generation(struct glyph_atlas *atlas);
+
+/* Must be called from within the graphics context.  Uploads whatever changed
+ * on the page since it was last drawn. */
+extern gs_texture_t *glyph_atlas_get_texture(struct glyph_atlas *atlas,
+					     uint32_t page);
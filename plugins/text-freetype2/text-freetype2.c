@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <util/platform.h>
+#include <util/threading.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include <sys/stat.h>
@@ -33,8 +34,6 @@ MODULE_EXPORT const char *obs_module_description(void)
 	return "FreeType2 text source";
 }
 
-uint32_t texbuf_w = 2048, texbuf_h = 2048;
-
 static struct obs_source_info freetype2_source_info_v1 = {
 	.id = "text_ft2_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
@@ -196,32 +195,26 @@ static void ft2_source_destroy(void *data)
 		srcdata->font_face = NULL;
 	}
 
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
-		}
-	}
+	glyph_atlas_release(srcdata->atlas);
+	srcdata->atlas = NULL;
 
 	if (srcdata->font_name != NULL)
 		bfree(srcdata->font_name);
 	if (srcdata->font_style != NULL)
 		bfree(srcdata->font_style);
+	if (srcdata->font_path != NULL)
+		bfree(srcdata->font_path);
 	if (srcdata->text != NULL)
 		bfree(srcdata->text);
-	if (srcdata->texbuf != NULL)
-		bfree(srcdata->texbuf);
 	if (srcdata->colorbuf != NULL)
 		bfree(srcdata->colorbuf);
 	if (srcdata->text_file != NULL)
 		bfree(srcdata->text_file);
 
+	os_file_watch_remove(srcdata->file_watch);
+
 	obs_enter_graphics();
 
-	if (srcdata->tex != NULL) {
-		gs_texture_destroy(srcdata->tex);
-		srcdata->tex = NULL;
-	}
 	if (srcdata->vbuf != NULL) {
 		gs_vertexbuffer_destroy(srcdata->vbuf);
 		srcdata->vbuf = NULL;
@@ -242,7 +235,7 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	if (srcdata == NULL)
 		return;
 
-	if (srcdata->tex == NULL || srcdata->vbuf == NULL)
+	if (srcdata->atlas == NULL || srcdata->vbuf == NULL)
 		return;
 	if (srcdata->text == NULL || *srcdata->text == 0)
 		return;
@@ -253,8 +246,7 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	if (srcdata->drop_shadow)
 		draw_drop_shadow(srcdata);
 
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
-			(uint32_t)wcslen(srcdata->text) * 6);
+	draw_glyph_pages(srcdata);
 
 	UNUSED_PARAMETER(effect);
 }
@@ -264,33 +256,37 @@ static void ft2_video_tick(void *data, float seconds)
 	struct ft2_source *srcdata = data;
 	if (srcdata == NULL)
 		return;
-	if (!srcdata->from_file || !srcdata->text_file)
-		return;
 
-	if (os_gettime_ns() - srcdata->last_checked >= 1000000000) {
-		time_t t = get_modified_timestamp(srcdata->text_file);
-		srcdata->last_checked = os_gettime_ns();
+	/* another source cleared an atlas page that this one was using */
+	long generation = glyph_atlas_get_generation(srcdata->atlas);
+	if (srcdata->atlas && srcdata->atlas_generation != generation) {
+		cache_glyphs(srcdata, srcdata->text);
+		set_up_vertex_buffer(srcdata);
+	}
 
-		if (srcdata->update_file) {
-			if (srcdata->log_mode)
-				read_from_end(srcdata, srcdata->text_file);
-			else
-				load_text_from_file(srcdata,
-						    srcdata->text_file);
-			cache_glyphs(srcdata, srcdata->text);
-			set_up_vertex_buffer(srcdata);
-			srcdata->update_file = false;
-		}
+	if (!srcdata->from_file || !srcdata->text_file)
+		return;
 
-		if (srcdata->m_timestamp != t) {
-			srcdata->m_timestamp = t;
-			srcdata->update_file = true;
-		}
+	if (os_atomic_set_bool(&srcdata->file_changed, false)) {
+		if (srcdata->log_mode)
+			read_from_end(srcdata, srcdata->text_file);
+		else
+			load_text_from_file(srcdata, srcdata->text_file);
+		cache_glyphs(srcdata, srcdata->text);
+		set_up_vertex_buffer(srcdata);
 	}
 
 	UNUSED_PARAMETER(seconds);
 }
 
+static void text_file_changed(void *data, const char *path)
+{
+	struct ft2_source *srcdata = data;
+	os_atomic_set_bool(&srcdata->file_changed, true);
+
+	UNUSED_PARAMETER(path);
+}
+
 static bool init_font(struct ft2_source *srcdata)
 {
 	FT_Long index;
@@ -305,9 +301,22 @@ static bool init_font(struct ft2_source *srcdata)
 		srcdata->font_face = NULL;
 	}
 
+	bfree(srcdata->font_path);
+	srcdata->font_path = bstrdup(path);
+	srcdata->font_index = index;
+
 	return FT_New_Face(ft2_lib, path, index, &srcdata->font_face) == 0;
 }
 
+static void update_atlas(struct ft2_source *srcdata)
+{
+	glyph_atlas_release(srcdata->atlas);
+	srcdata->atlas = glyph_atlas_acquire(srcdata->font_path,
+					     srcdata->font_index,
+					     srcdata->font_size,
+					     get_render_mode(srcdata));
+}
+
 static void ft2_source_update(void *data, obs_data_t *settings)
 {
 	struct ft2_source *srcdata = data;
@@ -368,8 +377,6 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	if (ft2_lib == NULL)
 		goto error;
 
-	const size_t texbuf_size = (size_t)texbuf_w * (size_t)texbuf_h;
-
 	if (srcdata->draw_effect == NULL) {
 		char *effect_file = NULL;
 		char *error_string = NULL;
@@ -395,10 +402,10 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	const bool aa_changed = srcdata->antialiasing != new_aa_setting;
 	if (aa_changed) {
 		srcdata->antialiasing = new_aa_setting;
-		if (srcdata->texbuf != NULL) {
-			memset(srcdata->texbuf, 0, texbuf_size);
+		if (srcdata->font_face) {
+			update_atlas(srcdata);
+			cache_standard_glyphs(srcdata);
 		}
-		cache_standard_glyphs(srcdata);
 	}
 
 	srcdata->file_load_failed = false;
@@ -433,14 +440,8 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 		FT_Select_Charmap(srcdata->font_face, FT_ENCODING_UNICODE);
 	}
 
-	if (srcdata->texbuf != NULL) {
-		bfree(srcdata->texbuf);
-		srcdata->texbuf = NULL;
-	}
-	srcdata->texbuf = bzalloc(texbuf_size);
-
-	if (srcdata->font_face)
-		cache_standard_glyphs(srcdata);
+	update_atlas(srcdata);
+	cache_standard_glyphs(srcdata);
 
 skip_font_load:
 	if (from_file) {
@@ -465,13 +466,15 @@ skip_font_load:
 				goto error;
 
 			bfree(srcdata->text_file);
+			os_file_watch_remove(srcdata->file_watch);
 
 			srcdata->text_file = bstrdup(tmp);
+			srcdata->file_watch = os_file_watch_add(
+				tmp, text_file_changed, srcdata);
 			if (chat_log_mode)
 				read_from_end(srcdata, tmp);
 			else
 				load_text_from_file(srcdata, tmp);
-			srcdata->last_checked = os_gettime_ns();
 		}
 	} else {
 		const char *tmp = obs_data_get_string(settings, "text");
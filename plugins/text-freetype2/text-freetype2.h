@@ -18,16 +18,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <obs-module.h>
+#include <util/file-watch.h>
 #include <ft2build.h>
-
-#define num_cache_slots 65535
-#define src_glyph srcdata->cacheglyphs[glyph_index]
-
-struct glyph_info {
-	float u, v, u2, v2;
-	int32_t w, h, xoff, yoff;
-	int32_t xadv;
-};
+#include "glyph-atlas.h"
 
 struct ft2_source {
 	char *font_name;
@@ -40,24 +33,22 @@ struct ft2_source {
 	bool antialiasing;
 	char *text_file;
 	wchar_t *text;
-	time_t m_timestamp;
-	bool update_file;
-	uint64_t last_checked;
+	os_file_watch_t *file_watch;
+	volatile bool file_changed;
 
 	uint32_t cx, cy, max_h, custom_width;
-	uint32_t texbuf_x, texbuf_y;
 	uint32_t color[2];
 	uint32_t *colorbuf;
 
 	int32_t cur_scroll, scroll_speed;
 
-	gs_texture_t *tex;
-
-	struct glyph_info *cacheglyphs[num_cache_slots];
-
 	FT_Face font_face;
+	char *font_path;
+	FT_Long font_index;
 
-	uint8_t *texbuf;
+	struct glyph_atlas *atlas;
+	long atlas_generation;
+	uint32_t page_glyphs[GLYPH_ATLAS_MAX_PAGES];
 	gs_vertbuffer_t *vbuf;
 
 	gs_effect_t *draw_effect;
@@ -77,6 +68,7 @@ static void ft2_source_update(void *data, obs_data_t *settings);
 static void ft2_source_render(void *data, gs_effect_t *effect);
 static void ft2_video_tick(void *data, float seconds);
 
+void draw_glyph_pages(struct ft2_source *srcdata);
 void draw_outlines(struct ft2_source *srcdata);
 void draw_drop_shadow(struct ft2_source *srcdata);
 
@@ -89,10 +81,10 @@ static const char *ft2_source_get_name(void *unused);
 
 uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata);
 
-time_t get_modified_timestamp(char *filename);
 void load_text_from_file(struct ft2_source *srcdata, const char *filename);
 void read_from_end(struct ft2_source *srcdata, const char *filename);
 
+FT_Render_Mode get_render_mode(struct ft2_source *srcdata);
 void cache_standard_glyphs(struct ft2_source *srcdata);
 void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs);
 
@@ -19,14 +19,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <util/platform.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
-#include <sys/stat.h>
 #include "text-freetype2.h"
 #include "obs-convenience.h"
 
 float offsets[16] = {-2.0f, 0.0f, 0.0f, -2.0f, 2.0f,  0.0f, 2.0f,  0.0f,
 		     0.0f,  2.0f, 0.0f, 2.0f,  -2.0f, 0.0f, -2.0f, 0.0f};
 
-extern uint32_t texbuf_w, texbuf_h;
+void draw_glyph_pages(struct ft2_source *srcdata)
+{
+	uint32_t start = 0;
+
+	for (uint32_t page = 0; page < GLYPH_ATLAS_MAX_PAGES; page++) {
+		const uint32_t count = srcdata->page_glyphs[page];
+		if (!count)
+			continue;
+
+		draw_uv_vbuffer(srcdata->vbuf,
+				glyph_atlas_get_texture(srcdata->atlas, page),
+				srcdata->draw_effect, start * 6, count * 6);
+		start += count;
+	}
+}
 
 void draw_outlines(struct ft2_source *srcdata)
 {
@@ -45,9 +58,7 @@ void draw_outlines(struct ft2_source *srcdata)
 	for (int32_t i = 0; i < 8; i++) {
 		gs_matrix_translate3f(offsets[i * 2], offsets[(i * 2) + 1],
 				      0.0f);
-		draw_uv_vbuffer(srcdata->vbuf, srcdata->tex,
-				srcdata->draw_effect,
-				(uint32_t)wcslen(srcdata->text) * 6);
+		draw_glyph_pages(srcdata);
 	}
 	gs_matrix_identity();
 	gs_matrix_pop();
@@ -70,8 +81,7 @@ void draw_drop_shadow(struct ft2_source *srcdata)
 
 	gs_matrix_push();
 	gs_matrix_translate3f(4.0f, 4.0f, 0.0f);
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
-			(uint32_t)wcslen(srcdata->text) * 6);
+	draw_glyph_pages(srcdata);
 	gs_matrix_identity();
 	gs_matrix_pop();
 
@@ -81,6 +91,7 @@ void draw_drop_shadow(struct ft2_source *srcdata)
 void set_up_vertex_buffer(struct ft2_source *srcdata)
 {
 	FT_UInt glyph_index = 0;
+	struct glyph_info glyph;
 	uint32_t x = 0, space_pos = 0, word_width = 0;
 	size_t len;
 
@@ -140,7 +151,8 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 	next_char:;
 		glyph_index =
 			FT_Get_Char_Index(srcdata->font_face, srcdata->text[i]);
-		word_width += src_glyph->xadv;
+		if (glyph_atlas_get_glyph(srcdata->atlas, glyph_index, &glyph))
+			word_width += glyph.xadv;
 	eos_skip:;
 	}
 
@@ -159,11 +171,33 @@ void fill_vertex_buffer(struct ft2_source *srcdata)
 	uint32_t *col = (uint32_t *)vdata->colors;
 
 	FT_UInt glyph_index = 0;
+	struct glyph_info glyph;
 
 	uint32_t dx = 0, dy = srcdata->max_h, max_y = dy;
+	uint32_t next_glyph[GLYPH_ATLAS_MAX_PAGES];
+	uint32_t end_glyph[GLYPH_ATLAS_MAX_PAGES];
 	uint32_t cur_glyph = 0;
 	size_t len = wcslen(srcdata->text);
 
+	/* glyphs are grouped by atlas page so that each page can be drawn
+	 * with a single call */
+	memset(srcdata->page_glyphs, 0, sizeof(srcdata->page_glyphs));
+	for (size_t i = 0; i < len; i++) {
+		if (srcdata->text[i] == L'\n' || srcdata->text[i] == L'\r')
+			continue;
+
+		glyph_index =
+			FT_Get_Char_Index(srcdata->font_face, srcdata->text[i]);
+		if (glyph_atlas_get_glyph(srcdata->atlas, glyph_index, &glyph))
+			srcdata->page_glyphs[glyph.page]++;
+	}
+
+	for (uint32_t page = 0; page < GLYPH_ATLAS_MAX_PAGES; page++) {
+		next_glyph[page] = cur_glyph;
+		cur_glyph += srcdata->page_glyphs[page];
+		end_glyph[page] = cur_glyph;
+	}
+
 	if (srcdata->colorbuf != NULL) {
 		bfree(srcdata->colorbuf);
 		srcdata->colorbuf = NULL;
@@ -192,13 +226,18 @@ void fill_vertex_buffer(struct ft2_source *srcdata)
 
 		glyph_index =
 			FT_Get_Char_Index(srcdata->font_face, srcdata->text[i]);
-		if (src_glyph == NULL)
+		if (!glyph_atlas_get_glyph(srcdata->atlas, glyph_index, &glyph))
+			goto skip_glyph;
+
+		/* the atlas may have changed since the glyphs were counted */
+		if (next_glyph[glyph.page] == end_glyph[glyph.page])
 			goto skip_glyph;
+		cur_glyph = next_glyph[glyph.page]++;
 
 		if (srcdata->custom_width < 100)
 			goto skip_custom_width;
 
-		if (dx + src_glyph->xadv > srcdata->custom_width) {
+		if (dx + glyph.xadv > srcdata->custom_width) {
 			dx = 0;
 			dy += srcdata->max_h + 4;
 		}
@@ -206,17 +245,16 @@ void fill_vertex_buffer(struct ft2_source *srcdata)
 	skip_custom_width:;
 
 		set_v3_rect(vdata->points + (cur_glyph * 6),
-			    (float)dx + (float)src_glyph->xoff,
-			    (float)dy - (float)src_glyph->yoff,
-			    (float)src_glyph->w, (float)src_glyph->h);
-		set_v2_uv(tvarray + (cur_glyph * 6), src_glyph->u, src_glyph->v,
-			  src_glyph->u2, src_glyph->v2);
+			    (float)dx + (float)glyph.xoff,
+			    (float)dy - (float)glyph.yoff, (float)glyph.w,
+			    (float)glyph.h);
+		set_v2_uv(tvarray + (cur_glyph * 6), glyph.u, glyph.v, glyph.u2,
+			  glyph.v2);
 		set_rect_colors2(col + (cur_glyph * 6), srcdata->color[0],
 				 srcdata->color[1]);
-		dx += src_glyph->xadv;
-		if (dy - (float)src_glyph->yoff + src_glyph->h > max_y)
-			max_y = dy - src_glyph->yoff + src_glyph->h;
-		cur_glyph++;
+		dx += glyph.xadv;
+		if (dy - (float)glyph.yoff + glyph.h > max_y)
+			max_y = dy - glyph.yoff + glyph.h;
 	skip_glyph:;
 	}
 
@@ -225,16 +263,6 @@ void fill_vertex_buffer(struct ft2_source *srcdata)
 
 void cache_standard_glyphs(struct ft2_source *srcdata)
 {
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
-		}
-	}
-
-	srcdata->texbuf_x = 0;
-	srcdata->texbuf_y = 0;
-
 	cache_glyphs(srcdata, L"abcdefghijklmnopqrstuvwxyz"
 			      L"ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890"
 			      L"!@#$%^&*()-_=+,<.>/?\\|[]{}`~ \'\"\0");
@@ -255,150 +283,28 @@ void load_glyph(struct ft2_source *srcdata, const FT_UInt glyph_index,
 	FT_Load_Glyph(srcdata->font_face, glyph_index, load_mode);
 }
 
-struct glyph_info *init_glyph(FT_GlyphSlot slot, const uint32_t dx,
-			      const uint32_t dy, const uint32_t g_w,
-			      const uint32_t g_h)
-{
-	struct glyph_info *glyph = bzalloc(sizeof(struct glyph_info));
-	glyph->u = (float)dx / (float)texbuf_w;
-	glyph->u2 = (float)(dx + g_w) / (float)texbuf_w;
-	glyph->v = (float)dy / (float)texbuf_h;
-	glyph->v2 = (float)(dy + g_h) / (float)texbuf_h;
-	glyph->w = g_w;
-	glyph->h = g_h;
-	glyph->yoff = slot->bitmap_top;
-	glyph->xoff = slot->bitmap_left;
-	glyph->xadv = slot->advance.x >> 6;
-
-	return glyph;
-}
-
-uint8_t get_pixel_value(const unsigned char *buf_row,
-			FT_Render_Mode render_mode, const uint32_t x)
-{
-	if (render_mode == FT_RENDER_MODE_NORMAL) {
-		return buf_row[x];
-	}
-
-	const uint32_t byte_index = x / 8;
-	const uint8_t bit_index = x % 8;
-	const bool pixel_set = (buf_row[byte_index] >> (7 - bit_index)) & 1;
-	return pixel_set ? 255 : 0;
-}
-
-void rasterize(struct ft2_source *srcdata, FT_GlyphSlot slot,
-	       const FT_Render_Mode render_mode, const uint32_t dx,
-	       const uint32_t dy)
-{
-	/**
-	 * The pitch's absolute value is the number of bytes taken by one bitmap
-	 * row, including padding.
-	 *
-	 * Source: https://www.freetype.org/freetype2/docs/reference/ft2-basic_types.html
-	 */
-	const int pitch = abs(slot->bitmap.pitch);
-
-	for (uint32_t y = 0; y < slot->bitmap.rows; y++) {
-		const uint32_t row_start = y * pitch;
-		const uint32_t row = (dy + y) * texbuf_w;
-
-		for (uint32_t x = 0; x < slot->bitmap.width; x++) {
-			const uint32_t row_pixel_position = dx + x;
-			const uint8_t pixel_value =
-				get_pixel_value(&slot->bitmap.buffer[row_start],
-						render_mode, x);
-			srcdata->texbuf[row_pixel_position + row] = pixel_value;
-		}
-	}
-}
-
 void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs)
 {
+	struct glyph_info glyph;
+
 	if (!srcdata->font_face || !cache_glyphs)
 		return;
 
-	FT_GlyphSlot slot = srcdata->font_face->glyph;
-
-	uint32_t dx = srcdata->texbuf_x;
-	uint32_t dy = srcdata->texbuf_y;
+	/* read before caching, so that a page cleared by another source while
+	 * this one caches causes a rebuild on the next tick */
+	srcdata->atlas_generation = glyph_atlas_get_generation(srcdata->atlas);
+	glyph_atlas_cache(srcdata->atlas, srcdata->font_face, cache_glyphs);
 
-	int32_t cached_glyphs = 0;
 	const size_t len = wcslen(cache_glyphs);
-
-	const FT_Render_Mode render_mode = get_render_mode(srcdata);
-
 	for (size_t i = 0; i < len; i++) {
 		const FT_UInt glyph_index =
 			FT_Get_Char_Index(srcdata->font_face, cache_glyphs[i]);
 
-		if (src_glyph != NULL) {
-			continue;
-		}
-
-		load_glyph(srcdata, glyph_index, render_mode);
-		FT_Render_Glyph(slot, render_mode);
-
-		const uint32_t g_w = slot->bitmap.width;
-		const uint32_t g_h = slot->bitmap.rows;
-
-		if (srcdata->max_h < g_h) {
-			srcdata->max_h = g_h;
-		}
-
-		if (dx + g_w >= texbuf_w) {
-			dx = 0;
-			dy += srcdata->max_h + 1;
-		}
-
-		if (dy + g_h >= texbuf_h) {
-			blog(LOG_WARNING,
-			     "Out of space trying to render glyphs");
-			break;
-		}
-
-		src_glyph = init_glyph(slot, dx, dy, g_w, g_h);
-		rasterize(srcdata, slot, render_mode, dx, dy);
-
-		dx += (g_w + 1);
-		if (dx >= texbuf_w) {
-			dx = 0;
-			dy += srcdata->max_h;
-		}
-
-		cached_glyphs++;
+		if (glyph_atlas_get_glyph(srcdata->atlas, glyph_index,
+					  &glyph) &&
+		    srcdata->max_h < (uint32_t)glyph.h)
+			srcdata->max_h = glyph.h;
 	}
-
-	srcdata->texbuf_x = dx;
-	srcdata->texbuf_y = dy;
-
-	if (cached_glyphs > 0) {
-
-		obs_enter_graphics();
-
-		if (srcdata->tex != NULL) {
-			gs_texture_t *tmp_texture = srcdata->tex;
-			srcdata->tex = NULL;
-			gs_texture_destroy(tmp_texture);
-		}
-
-		srcdata->tex = gs_texture_create(
-			texbuf_w, texbuf_h, GS_A8, 1,
-			(const uint8_t **)&srcdata->texbuf, 0);
-
-		obs_leave_graphics();
-	}
-}
-
-time_t get_modified_timestamp(char *filename)
-{
-	struct stat stats;
-
-	// stat is apparently terrifying and horrible, but we only call it once
-	// every second at most.
-	if (os_stat(filename, &stats) != 0)
-		return -1;
-
-	return stats.st_mtime;
 }
 
 static void remove_cr(wchar_t *source)
@@ -0,0 +1,225 @@
+/*
+ * Compares resolving effect parameters and techniques by name on every draw
+ * against using the handles cached when the effect is created, both for the
+ * lookups alone and for a full sprite draw into a texture the way scene items
+ * and filters are drawn.
+ *
+ * usage: draw-bench [iterations] [graphics module]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <obs.h>
+#include <util/platform.h>
+
+#ifdef _WIN32
+#define DEFAULT_GRAPHICS_MODULE "libobs-d3d11"
+#else
+#define DEFAULT_GRAPHICS_MODULE "libobs-opengl"
+#endif
+
+#define CANVAS_CX 1920
+#define CANVAS_CY 1080
+#define SPRITE_CX 64
+#define SPRITE_CY 64
+#define DEFAULT_ITERATIONS 100000
+
+struct handles {
+	gs_technique_t *tech;
+	gs_eparam_t *image;
+	gs_eparam_t *bres;
+	gs_eparam_t *bres_i;
+};
+
+static void get_handles_by_name(gs_effect_t *effect, struct handles *h)
+{
+	h->tech = gs_effect_get_technique(effect, "Draw");
+	h->image = gs_effect_get_param_by_name(effect, "image");
+	h->bres = gs_effect_get_param_by_name(effect, "base_dimension");
+	h->bres_i = gs_effect_get_param_by_name(effect, "base_dimension_i");
+}
+
+static void get_cached_handles(gs_effect_t *effect, const struct handles *cache,
+			       struct handles *h)
+{
+	h->tech = gs_effect_get_draw_technique(effect);
+	h->image = gs_effect_get_image_param(effect);
+	h->bres = cache->bres;
+	h->bres_i = cache->bres_i;
+}
+
+static uint64_t run_lookups(gs_effect_t *effect, uint32_t iterations,
+			    bool cached)
+{
+	struct handles cache;
+	struct handles h;
+	uintptr_t sink = 0;
+	uint64_t start;
+
+	get_handles_by_name(effect, &cache);
+
+	start = os_gettime_ns();
+	for (uint32_t i = 0; i < iterations; i++) {
+		if (cached)
+			get_cached_handles(effect, &cache, &h);
+		else
+			get_handles_by_name(effect, &h);
+
+		sink ^= (uintptr_t)h.tech ^ (uintptr_t)h.image ^
+			(uintptr_t)h.bres ^ (uintptr_t)h.bres_i;
+	}
+
+	/* keeps the loop from being optimized away */
+	if (sink == 1)
+		printf("\n");
+
+	return os_gettime_ns() - start;
+}
+
+static uint64_t run_draws(gs_effect_t *effect, gs_texture_t *tex,
+			  gs_texrender_t *texrender, uint32_t iterations,
+			  bool cached)
+{
+	const struct vec2 base = {(float)SPRITE_CX, (float)SPRITE_CY};
+	const struct vec2 base_i = {1.0f / SPRITE_CX, 1.0f / SPRITE_CY};
+	struct handles cache;
+	uint64_t start;
+
+	get_handles_by_name(effect, &cache);
+	gs_texrender_reset(texrender);
+	if (!gs_texrender_begin(texrender, CANVAS_CX, CANVAS_CY))
+		return 0;
+
+	gs_ortho(0.0f, (float)CANVAS_CX, 0.0f, (float)CANVAS_CY, -100.0f,
+		 100.0f);
+
+	start = os_gettime_ns();
+	for (uint32_t i = 0; i < iterations; i++) {
+		struct handles h;
+		size_t passes;
+
+		if (cached)
+			get_cached_handles(effect, &cache, &h);
+		else
+			get_handles_by_name(effect, &h);
+
+		gs_effect_set_vec2(h.bres, &base);
+		gs_effect_set_vec2(h.bres_i, &base_i);
+		gs_effect_set_texture(h.image, tex);
+
+		passes = gs_technique_begin(h.tech);
+		for (size_t p = 0; p < passes; p++) {
+			gs_technique_begin_pass(h.tech, p);
+			gs_draw_sprite(tex, 0, SPRITE_CX, SPRITE_CY);
+			gs_technique_end_pass(h.tech);
+		}
+		gs_technique_end(h.tech);
+	}
+	gs_flush();
+
+	gs_texrender_end(texrender);
+	return os_gettime_ns() - start;
+}
+
+static void print_result(const char *name, uint64_t by_name, uint64_t cached,
+			 uint32_t iterations)
+{
+	printf("%s\n", name);
+	printf("  by name: %8.1f ns/draw\n",
+	       (double)by_name / (double)iterations);
+	printf("  cached:  %8.1f ns/draw\n",
+	       (double)cached / (double)iterations);
+
+	/* a coarse timer can measure nothing at all for the cached path */
+	if (cached)
+		printf("  speedup: %8.2fx\n",
+		       (double)by_name / (double)cached);
+	else
+		printf("  speedup:      n/a\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *module = DEFAULT_GRAPHICS_MODULE;
+	uint32_t iterations = DEFAULT_ITERATIONS;
+	struct obs_video_info ovi = {0};
+	gs_texrender_t *texrender = NULL;
+	gs_texture_t *tex = NULL;
+	gs_effect_t *effect;
+	uint32_t *pixels;
+	bool success = false;
+
+	if (argc > 1)
+		iterations = (uint32_t)strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		module = argv[2];
+	if (!iterations)
+		iterations = DEFAULT_ITERATIONS;
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "Couldn't start libobs\n");
+		return 1;
+	}
+
+	ovi.graphics_module = module;
+	ovi.fps_num = 60;
+	ovi.fps_den = 1;
+	ovi.base_width = CANVAS_CX;
+	ovi.base_height = CANVAS_CY;
+	ovi.output_width = CANVAS_CX;
+	ovi.output_height = CANVAS_CY;
+	ovi.output_format = VIDEO_FORMAT_NV12;
+	ovi.colorspace = VIDEO_CS_709;
+	ovi.range = VIDEO_RANGE_PARTIAL;
+	ovi.scale_type = OBS_SCALE_BICUBIC;
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		fprintf(stderr, "Couldn't initialize video with '%s'\n", module);
+		goto shutdown;
+	}
+
+	pixels = bzalloc(SPRITE_CX * SPRITE_CY * sizeof(uint32_t));
+	for (size_t i = 0; i < SPRITE_CX * SPRITE_CY; i++)
+		pixels[i] = 0xFF000000 | (uint32_t)(i * 2654435761u);
+
+	obs_enter_graphics();
+
+	effect = obs_get_base_effect(OBS_EFFECT_BICUBIC);
+	tex = gs_texture_create(SPRITE_CX, SPRITE_CY, GS_RGBA, 1,
+				(const uint8_t **)&pixels, 0);
+	texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+	if (effect && tex && texrender) {
+		uint64_t lookup_name, lookup_cached;
+		uint64_t draw_name, draw_cached;
+
+		lookup_name = run_lookups(effect, iterations, false);
+		lookup_cached = run_lookups(effect, iterations, true);
+		draw_name =
+			run_draws(effect, tex, texrender, iterations, false);
+		draw_cached =
+			run_draws(effect, tex, texrender, iterations, true);
+
+		if (draw_name && draw_cached) {
+			printf("bicubic effect, %u iterations\n", iterations);
+			print_result("lookups", lookup_name, lookup_cached,
+				     iterations);
+			print_result("draws", draw_name, draw_cached,
+				     iterations);
+			success = true;
+		}
+	} else {
+		fprintf(stderr, "Couldn't create the graphics resources\n");
+	}
+
+	gs_texrender_destroy(texrender);
+	gs_texture_destroy(tex);
+	obs_leave_graphics();
+
+	bfree(pixels);
+
+shutdown:
+	obs_shutdown();
+	return success ? 0 : 1;
+}
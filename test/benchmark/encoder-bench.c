@@ -0,0 +1,549 @@
+/*
+ * Headless encoder benchmark.
+ *
+ * Starts libobs without a graphics context, loads the encoder modules and
+ * feeds an encoder with deterministic synthetic video or audio through a
+ * private video_output/audio_output pair, using an output that does nothing
+ * but time the packets it receives.
+ *
+ * Video is fed as fast as the encoder consumes it, so the reported frame
+ * rate is the encoder's throughput.  Audio is paced by audio_output in real
+ * time, so for audio encoders the CPU usage and latency are what matter.
+ *
+ * usage: encoder-bench [options]
+ *   --encoder <id>         encoder to run (default: obs_x264)
+ *   --settings <json>      encoder settings
+ *   --width <cx>           video width (default: 1280)
+ *   --height <cy>          video height (default: 720)
+ *   --fps <fps>            video frame rate (default: 60)
+ *   --frames <count>       number of video frames (default: 600)
+ *   --seconds <secs>       audio duration (default: 10)
+ *   --module-bin <path>    additional module binary path
+ *   --module-data <path>   additional module data path
+ *   --list                 list the available encoders and exit
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <media-io/video-frame.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define VIDEO_CACHE_FRAMES 4
+#define AUDIO_SAMPLE_RATE 48000
+#define SINE_HZ 440.0
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+struct bench {
+	obs_output_t *output;
+
+	video_t *video;
+	audio_t *audio;
+
+	/* video */
+	uint32_t frames;
+	uint64_t *submit_ns;
+	volatile long processed;
+	os_sem_t *frame_done;
+
+	/* audio */
+	uint64_t sample_pos;
+
+	pthread_mutex_t mutex;
+	DARRAY(uint64_t) latencies;
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t last_packet_ns;
+	bool encode_error;
+};
+
+static struct bench bench;
+
+/* ------------------------------------------------------------------------- */
+/* output that just records when packets arrive                              */
+
+static const char *bench_output_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Encoder Benchmark Output";
+}
+
+static void *bench_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	UNUSED_PARAMETER(settings);
+	return output;
+}
+
+static void bench_output_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool bench_output_start(void *data)
+{
+	obs_output_t *output = data;
+
+	if (!obs_output_can_begin_data_capture(output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(output, 0))
+		return false;
+
+	return obs_output_begin_data_capture(output, 0);
+}
+
+static void bench_output_stop(void *data, uint64_t ts)
+{
+	UNUSED_PARAMETER(ts);
+	obs_output_end_data_capture(data);
+}
+
+static inline uint64_t packet_latency(const struct encoder_packet *packet,
+				      uint64_t now)
+{
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		int64_t idx = packet->pts / packet->timebase_num;
+
+		if (idx < 0 || (uint64_t)idx >= bench.frames)
+			return 0;
+		return now - bench.submit_ns[idx];
+	}
+
+	/* audio is real-time, so its system timestamps are usable */
+	uint64_t sys_ns = (uint64_t)packet->sys_dts_usec * 1000;
+	return now > sys_ns ? now - sys_ns : 0;
+}
+
+static void bench_output_packet(void *data, struct encoder_packet *packet)
+{
+	uint64_t now = os_gettime_ns();
+	UNUSED_PARAMETER(data);
+
+	pthread_mutex_lock(&bench.mutex);
+
+	if (!packet) {
+		bench.encode_error = true;
+	} else {
+		uint64_t latency = packet_latency(packet, now);
+		if (latency)
+			da_push_back(bench.latencies, &latency);
+
+		bench.packets++;
+		bench.bytes += packet->size;
+		bench.last_packet_ns = now;
+	}
+
+	pthread_mutex_unlock(&bench.mutex);
+}
+
+static struct obs_output_info bench_video_output = {
+	.id = "encoder_bench_video_output",
+	.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_ENCODED,
+	.get_name = bench_output_name,
+	.create = bench_output_create,
+	.destroy = bench_output_destroy,
+	.start = bench_output_start,
+	.stop = bench_output_stop,
+	.encoded_packet = bench_output_packet,
+};
+
+static struct obs_output_info bench_audio_output = {
+	.id = "encoder_bench_audio_output",
+	.flags = OBS_OUTPUT_AUDIO | OBS_OUTPUT_ENCODED,
+	.get_name = bench_output_name,
+	.create = bench_output_create,
+	.destroy = bench_output_destroy,
+	.start = bench_output_start,
+	.stop = bench_output_stop,
+	.encoded_packet = bench_output_packet,
+};
+
+/* ------------------------------------------------------------------------- */
+/* synthetic media                                                           */
+
+static void fill_video_frame(struct video_frame *frame, uint32_t cx,
+			     uint32_t cy, uint32_t idx)
+{
+	uint32_t seed = idx * 2654435761u;
+
+	/* moving gradient with a bit of deterministic noise so the encoder has
+	 * both motion and texture to deal with */
+	for (uint32_t y = 0; y < cy; y++) {
+		uint8_t *line = frame->data[0] + y * frame->linesize[0];
+
+		for (uint32_t x = 0; x < cx; x++) {
+			seed = seed * 1664525u + 1013904223u;
+			line[x] = (uint8_t)(((x + idx * 4) ^ (y + idx)) +
+					    (seed >> 28));
+		}
+	}
+
+	for (uint32_t y = 0; y < cy / 2; y++) {
+		uint8_t *line = frame->data[1] + y * frame->linesize[1];
+
+		for (uint32_t x = 0; x < cx; x += 2) {
+			line[x] = (uint8_t)(96 + ((x + idx) & 63));
+			line[x + 1] = (uint8_t)(160 - ((y + idx) & 63));
+		}
+	}
+}
+
+static void video_frame_processed(void *param, struct video_data *frame)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(frame);
+
+	os_atomic_inc_long(&bench.processed);
+	os_sem_post(bench.frame_done);
+}
+
+static bool audio_input(void *param, uint64_t start_ts, uint64_t end_ts,
+			uint64_t *new_ts, uint32_t active_mixers,
+			struct audio_output_data *mixes)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(end_ts);
+	UNUSED_PARAMETER(active_mixers);
+
+	for (size_t i = 0; i < AUDIO_OUTPUT_FRAMES; i++) {
+		double t = (double)(bench.sample_pos + i) / AUDIO_SAMPLE_RATE;
+		float val = (float)(sin(t * SINE_HZ * 2.0 * M_PI) * 0.5);
+
+		mixes[0].data[0][i] = val;
+		mixes[0].data[1][i] = val;
+	}
+
+	bench.sample_pos += AUDIO_OUTPUT_FRAMES;
+	*new_ts = start_ts;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t val_a = *(const uint64_t *)a;
+	uint64_t val_b = *(const uint64_t *)b;
+	return val_a < val_b ? -1 : (val_a > val_b ? 1 : 0);
+}
+
+static double percentile_ms(double pct)
+{
+	size_t idx;
+
+	if (!bench.latencies.num)
+		return 0.0;
+
+	idx = (size_t)(pct / 100.0 * (double)(bench.latencies.num - 1) + 0.5);
+	return (double)bench.latencies.array[idx] / 1000000.0;
+}
+
+static bool wait_for_output_stop(obs_output_t *output)
+{
+	for (int i = 0; i < 500; i++) {
+		if (!obs_output_active(output))
+			return true;
+		os_sleep_ms(10);
+	}
+
+	return false;
+}
+
+static bool run_video(obs_encoder_t *encoder, uint32_t cx, uint32_t cy,
+		      uint32_t fps, uint64_t *elapsed_ns, long *skipped)
+{
+	struct video_output_info voi = {
+		.name = "encoder-bench",
+		.format = VIDEO_FORMAT_NV12,
+		.fps_num = fps,
+		.fps_den = 1,
+		.width = cx,
+		.height = cy,
+		.cache_size = VIDEO_CACHE_FRAMES,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+	};
+	uint64_t frame_ns = 1000000000ULL / fps;
+	uint64_t start_ns;
+
+	if (video_output_open(&bench.video, &voi) != VIDEO_OUTPUT_SUCCESS) {
+		fprintf(stderr, "Failed to open video output\n");
+		return false;
+	}
+
+	obs_encoder_set_video(encoder, bench.video);
+
+	bench.output = obs_output_create(bench_video_output.id, "bench", NULL,
+					 NULL);
+	obs_output_set_media(bench.output, bench.video, NULL);
+	obs_output_set_video_encoder(bench.output, encoder);
+
+	if (!obs_output_start(bench.output)) {
+		fprintf(stderr, "Failed to start encoder: %s\n",
+			obs_output_get_last_error(bench.output));
+		return false;
+	}
+
+	/* connected after the encoder, so this runs once it has the frame */
+	video_output_connect(bench.video, NULL, video_frame_processed, NULL);
+
+	start_ns = os_gettime_ns();
+
+	for (uint32_t i = 0; i < bench.frames; i++) {
+		struct video_frame frame;
+
+		/* keep the video-io cache from running dry, which would make
+		 * it duplicate frames instead of waiting on the encoder */
+		if (i >= VIDEO_CACHE_FRAMES - 1)
+			os_sem_wait(bench.frame_done);
+
+		if (!video_output_lock_frame(bench.video, &frame, 1,
+					     i * frame_ns)) {
+			(*skipped)++;
+			continue;
+		}
+
+		fill_video_frame(&frame, cx, cy, i);
+		bench.submit_ns[i] = os_gettime_ns();
+		video_output_unlock_frame(bench.video);
+	}
+
+	while (os_atomic_load_long(&bench.processed) <
+		       (long)bench.frames - *skipped &&
+	       !bench.encode_error)
+		os_sem_wait(bench.frame_done);
+
+	obs_output_stop(bench.output);
+	wait_for_output_stop(bench.output);
+
+	*elapsed_ns = bench.last_packet_ns > start_ns
+			      ? bench.last_packet_ns - start_ns
+			      : os_gettime_ns() - start_ns;
+
+	video_output_disconnect(bench.video, video_frame_processed, NULL);
+	return true;
+}
+
+static bool run_audio(obs_encoder_t *encoder, uint32_t seconds,
+		      uint64_t *elapsed_ns)
+{
+	struct audio_output_info aoi = {
+		.name = "encoder-bench",
+		.samples_per_sec = AUDIO_SAMPLE_RATE,
+		.format = AUDIO_FORMAT_FLOAT_PLANAR,
+		.speakers = SPEAKERS_STEREO,
+		.input_callback = audio_input,
+	};
+	uint64_t start_ns;
+
+	if (audio_output_open(&bench.audio, &aoi) != AUDIO_OUTPUT_SUCCESS) {
+		fprintf(stderr, "Failed to open audio output\n");
+		return false;
+	}
+
+	obs_encoder_set_audio(encoder, bench.audio);
+
+	bench.output = obs_output_create(bench_audio_output.id, "bench", NULL,
+					 NULL);
+	obs_output_set_media(bench.output, NULL, bench.audio);
+	obs_output_set_audio_encoder(bench.output, encoder, 0);
+
+	if (!obs_output_start(bench.output)) {
+		fprintf(stderr, "Failed to start encoder: %s\n",
+			obs_output_get_last_error(bench.output));
+		return false;
+	}
+
+	start_ns = os_gettime_ns();
+	os_sleep_ms(seconds * 1000);
+
+	obs_output_stop(bench.output);
+	wait_for_output_stop(bench.output);
+
+	*elapsed_ns = os_gettime_ns() - start_ns;
+	return true;
+}
+
+static void list_encoders(void)
+{
+	const char *id;
+
+	for (size_t i = 0; obs_enum_encoder_types(i, &id); i++)
+		printf("%-24s %s\n", id,
+		       obs_get_encoder_type(id) == OBS_ENCODER_VIDEO ? "video"
+								    : "audio");
+}
+
+static void print_results(const char *id, bool is_video, uint64_t elapsed_ns,
+			  long skipped, double cpu)
+{
+	double secs = (double)elapsed_ns / 1000000000.0;
+
+	qsort(bench.latencies.array, bench.latencies.num, sizeof(uint64_t),
+	      compare_u64);
+
+	printf("encoder:    %s (%s)\n", id, is_video ? "video" : "audio");
+	if (is_video) {
+		printf("frames:     %u submitted, %ld skipped, %" PRIu64
+		       " packets\n",
+		       bench.frames, skipped, bench.packets);
+		printf("throughput: %.1f fps\n",
+		       secs > 0.0 ? (double)bench.frames / secs : 0.0);
+	} else {
+		printf("packets:    %" PRIu64 " in %.1f s\n", bench.packets,
+		       secs);
+	}
+	printf("bitrate:    %.0f kbps\n",
+	       secs > 0.0 ? (double)bench.bytes * 8.0 / secs / 1000.0 : 0.0);
+	printf("latency:    p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, "
+	       "max %.2f ms\n",
+	       percentile_ms(50.0), percentile_ms(90.0), percentile_ms(99.0),
+	       percentile_ms(100.0));
+	printf("cpu:        %.1f%%\n", cpu);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *id = "obs_x264";
+	const char *settings_json = NULL;
+	const char *module_bin = NULL;
+	const char *module_data = NULL;
+	uint32_t cx = 1280, cy = 720, fps = 60, seconds = 10;
+	bool list = false;
+	bool is_video;
+	bool success = false;
+	long skipped = 0;
+	uint64_t elapsed_ns = 0;
+	obs_data_t *settings = NULL;
+	obs_encoder_t *encoder = NULL;
+	os_cpu_usage_info_t *cpu_info = NULL;
+	double cpu = 0.0;
+
+	bench.frames = 600;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(arg, "--list") == 0) {
+			list = true;
+			continue;
+		}
+		if (!val) {
+			fprintf(stderr, "Missing value for '%s'\n", arg);
+			return 1;
+		}
+
+		if (strcmp(arg, "--encoder") == 0)
+			id = val;
+		else if (strcmp(arg, "--settings") == 0)
+			settings_json = val;
+		else if (strcmp(arg, "--width") == 0)
+			cx = (uint32_t)strtoul(val, NULL, 10);
+		else if (strcmp(arg, "--height") == 0)
+			cy = (uint32_t)strtoul(val, NULL, 10);
+		else if (strcmp(arg, "--fps") == 0)
+			fps = (uint32_t)strtoul(val, NULL, 10);
+		else if (strcmp(arg, "--frames") == 0)
+			bench.frames = (uint32_t)strtoul(val, NULL, 10);
+		else if (strcmp(arg, "--seconds") == 0)
+			seconds = (uint32_t)strtoul(val, NULL, 10);
+		else if (strcmp(arg, "--module-bin") == 0)
+			module_bin = val;
+		else if (strcmp(arg, "--module-data") == 0)
+			module_data = val;
+		else {
+			fprintf(stderr, "Unknown option '%s'\n", arg);
+			return 1;
+		}
+		i++;
+	}
+
+	if (!cx || !cy || !fps || !bench.frames || !seconds ||
+	    (cx & 1) != 0 || (cy & 1) != 0) {
+		fprintf(stderr, "Invalid video/audio parameters\n");
+		return 1;
+	}
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "Couldn't start libobs\n");
+		return 1;
+	}
+
+	if (module_bin && module_data)
+		obs_add_module_path(module_bin, module_data);
+	obs_load_all_modules();
+	obs_post_load_modules();
+
+	if (list) {
+		list_encoders();
+		success = true;
+		goto shutdown;
+	}
+
+	obs_register_output(&bench_video_output);
+	obs_register_output(&bench_audio_output);
+
+	pthread_mutex_init(&bench.mutex, NULL);
+	os_sem_init(&bench.frame_done, 0);
+	bench.submit_ns = bzalloc(sizeof(uint64_t) * bench.frames);
+
+	settings = settings_json ? obs_data_create_from_json(settings_json)
+				 : obs_data_create();
+	if (!settings) {
+		fprintf(stderr, "Invalid settings JSON\n");
+		goto cleanup;
+	}
+
+	is_video = obs_get_encoder_type(id) == OBS_ENCODER_VIDEO;
+	encoder = is_video ? obs_video_encoder_create(id, "bench", settings,
+						      NULL)
+			   : obs_audio_encoder_create(id, "bench", settings, 0,
+						      NULL);
+	if (!encoder) {
+		fprintf(stderr, "Couldn't create encoder '%s'\n", id);
+		goto cleanup;
+	}
+
+	cpu_info = os_cpu_usage_info_start();
+
+	success = is_video ? run_video(encoder, cx, cy, fps, &elapsed_ns,
+				       &skipped)
+			   : run_audio(encoder, seconds, &elapsed_ns);
+
+	cpu = os_cpu_usage_info_query(cpu_info);
+
+	if (success && bench.encode_error) {
+		fprintf(stderr, "Encoder reported an error\n");
+		success = false;
+	}
+
+	if (success)
+		print_results(id, is_video, elapsed_ns, skipped, cpu);
+
+cleanup:
+	obs_output_release(bench.output);
+	obs_encoder_release(encoder);
+	obs_data_release(settings);
+	os_cpu_usage_info_destroy(cpu_info);
+
+	video_output_close(bench.video);
+	audio_output_close(bench.audio);
+
+	da_free(bench.latencies);
+	bfree(bench.submit_ns);
+	os_sem_destroy(bench.frame_done);
+	pthread_mutex_destroy(&bench.mutex);
+
+shutdown:
+	obs_shutdown();
+	return success ? 0 : 1;
+}
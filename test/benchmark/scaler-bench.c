@@ -0,0 +1,162 @@
+/*
+ * Compares scaling an encoder ladder with one scaler per rung, each reading
+ * the full-size frame, against the cascade used by video-io, where each rung
+ * is scaled from the next larger one.
+ *
+ * usage: scaler-bench [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/platform.h>
+#include <media-io/video-frame.h>
+#include <media-io/video-scaler.h>
+
+#define CANVAS_CX 1920
+#define CANVAS_CY 1080
+#define DEFAULT_FRAMES 300
+
+static const struct {
+	uint32_t cx;
+	uint32_t cy;
+} ladder[] = {
+	{1280, 720},
+	{852, 480},
+	{640, 360},
+};
+
+#define NUM_RUNGS (sizeof(ladder) / sizeof(ladder[0]))
+
+struct rung {
+	struct video_scale_info info;
+	video_scaler_t *scaler;
+	struct video_frame frame;
+};
+
+static struct video_scale_info canvas_info(void)
+{
+	struct video_scale_info info = {
+		.format = VIDEO_FORMAT_NV12,
+		.width = CANVAS_CX,
+		.height = CANVAS_CY,
+		.range = VIDEO_RANGE_PARTIAL,
+		.colorspace = VIDEO_CS_709,
+	};
+	return info;
+}
+
+static void fill_frame(struct video_frame *frame, uint32_t frame_idx)
+{
+	for (uint32_t y = 0; y < CANVAS_CY; y++) {
+		uint8_t *line = frame->data[0] + y * frame->linesize[0];
+		for (uint32_t x = 0; x < CANVAS_CX; x++)
+			line[x] = (uint8_t)(x + y + frame_idx);
+	}
+
+	for (uint32_t y = 0; y < CANVAS_CY / 2; y++) {
+		uint8_t *line = frame->data[1] + y * frame->linesize[1];
+		for (uint32_t x = 0; x < CANVAS_CX; x++)
+			line[x] = (uint8_t)(128 + ((x ^ y) & 31));
+	}
+}
+
+static bool init_rungs(struct rung *rungs, bool cascade)
+{
+	const struct video_scale_info canvas = canvas_info();
+
+	for (size_t i = 0; i < NUM_RUNGS; i++) {
+		struct rung *rung = &rungs[i];
+		const struct video_scale_info *from =
+			(cascade && i > 0) ? &rungs[i - 1].info : &canvas;
+
+		rung->info = canvas;
+		rung->info.width = ladder[i].cx;
+		rung->info.height = ladder[i].cy;
+
+		if (video_scaler_create(&rung->scaler, &rung->info, from,
+					VIDEO_SCALE_FAST_BILINEAR) !=
+		    VIDEO_SCALER_SUCCESS) {
+			fprintf(stderr, "Failed to create %ux%u scaler\n",
+				ladder[i].cx, ladder[i].cy);
+			return false;
+		}
+
+		video_frame_init(&rung->frame, rung->info.format,
+				 rung->info.width, rung->info.height);
+	}
+
+	return true;
+}
+
+static void free_rungs(struct rung *rungs)
+{
+	for (size_t i = 0; i < NUM_RUNGS; i++) {
+		video_scaler_destroy(rungs[i].scaler);
+		video_frame_free(&rungs[i].frame);
+	}
+}
+
+static uint64_t run(struct video_frame *canvas, uint32_t frames, bool cascade)
+{
+	struct rung rungs[NUM_RUNGS] = {0};
+	uint64_t total = 0;
+
+	if (!init_rungs(rungs, cascade)) {
+		free_rungs(rungs);
+		return 0;
+	}
+
+	for (uint32_t f = 0; f < frames; f++) {
+		fill_frame(canvas, f);
+
+		uint64_t start = os_gettime_ns();
+
+		for (size_t i = 0; i < NUM_RUNGS; i++) {
+			struct video_frame *src = (i > 0 && cascade)
+							  ? &rungs[i - 1].frame
+							  : canvas;
+
+			video_scaler_scale(rungs[i].scaler, rungs[i].frame.data,
+					   rungs[i].frame.linesize,
+					   (const uint8_t *const *)src->data,
+					   src->linesize);
+		}
+
+		total += os_gettime_ns() - start;
+	}
+
+	free_rungs(rungs);
+	return total;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t frames = DEFAULT_FRAMES;
+	struct video_frame canvas;
+	uint64_t independent, cascade;
+
+	if (argc > 1)
+		frames = (uint32_t)strtoul(argv[1], NULL, 10);
+	if (!frames)
+		frames = DEFAULT_FRAMES;
+
+	video_frame_init(&canvas, VIDEO_FORMAT_NV12, CANVAS_CX, CANVAS_CY);
+
+	independent = run(&canvas, frames, false);
+	cascade = run(&canvas, frames, true);
+
+	video_frame_free(&canvas);
+
+	if (!independent || !cascade)
+		return 1;
+
+	printf("%ux%u NV12 -> %u rungs, %u frames\n", CANVAS_CX, CANVAS_CY,
+	       (unsigned)NUM_RUNGS, frames);
+	printf("independent: %8.3f ms/frame\n",
+	       (double)independent / (double)frames / 1000000.0);
+	printf("cascade:     %8.3f ms/frame\n",
+	       (double)cascade / (double)frames / 1000000.0);
+	printf("speedup:     %8.2fx\n", (double)independent / (double)cascade);
+	return 0;
+}
@@ -0,0 +1,65 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+
+static void media_small_test(void **state)
+{
+	long allocs = bnum_allocs();
+	long media_allocs = bnum_media_allocs();
+
+	uint8_t *ptr = bmalloc_media(16);
+	assert_non_null(ptr);
+	assert_int_equal((uintptr_t)ptr % base_get_alignment(), 0);
+	assert_int_equal(bnum_media_allocs(), media_allocs + 1);
+
+	memset(ptr, 0xff, 16);
+	bfree_media(ptr);
+
+	assert_int_equal(bnum_allocs(), allocs);
+	assert_int_equal(bnum_media_allocs(), media_allocs);
+}
+
+static void media_pool_test(void **state)
+{
+	const size_t size = 1024 * 1024;
+	struct base_media_stats before, stats;
+	long allocs = bnum_allocs();
+
+	base_trim_media_pool();
+	base_get_media_stats(&before);
+	assert_int_equal(before.bytes_cached, 0);
+
+	uint8_t *ptr = bmalloc_media(size);
+	assert_non_null(ptr);
+	assert_int_equal((uintptr_t)ptr % base_get_alignment(), 0);
+	memset(ptr, 0xff, size);
+
+	base_get_media_stats(&stats);
+	assert_true(stats.bytes_in_use >= before.bytes_in_use + size);
+	assert_int_equal(stats.pool_hits + stats.pool_misses,
+			 before.pool_hits + before.pool_misses + 1);
+
+	bfree_media(ptr);
+	assert_int_equal(bnum_allocs(), allocs);
+
+	base_get_media_stats(&stats);
+	assert_int_equal(stats.bytes_in_use, before.bytes_in_use);
+	assert_true(stats.bytes_cached >= size);
+
+	base_trim_media_pool();
+	base_get_media_stats(&stats);
+	assert_int_equal(stats.bytes_cached, 0);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(media_small_test),
+		cmocka_unit_test(media_pool_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,319 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ffmpeg-mux-shm.h"
+
+/* rounded up to the smallest ring the producer creates */
+#define RING_SIZE (64 * 1024)
+
+/* not a multiple of anything in the ring, so that reads and writes keep
+ * straddling its end */
+#define CHUNK_SIZE 1531
+
+struct ring {
+	struct ffm_shm producer;
+	struct ffm_shm consumer;
+};
+
+struct transfer {
+	struct ffm_shm *shm;
+	size_t size;
+	uint32_t delay_ms;
+	size_t result;
+};
+
+static void sleep_ms(uint32_t ms)
+{
+	struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000};
+	nanosleep(&ts, NULL);
+}
+
+static inline uint8_t pattern(size_t pos)
+{
+	return (uint8_t)(pos * 7 + (pos >> 8));
+}
+
+static void fill_pattern(uint8_t *data, size_t pos, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		data[i] = pattern(pos + i);
+}
+
+static bool check_pattern(const uint8_t *data, size_t pos, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (data[i] != pattern(pos + i))
+			return false;
+	}
+	return true;
+}
+
+static bool write_pattern(struct ffm_shm *shm, size_t size)
+{
+	uint8_t chunk[CHUNK_SIZE];
+
+	for (size_t pos = 0; pos < size; pos += CHUNK_SIZE) {
+		size_t count = size - pos < CHUNK_SIZE ? size - pos
+						       : CHUNK_SIZE;
+
+		fill_pattern(chunk, pos, count);
+		if (!ffm_shm_write(shm, chunk, count))
+			return false;
+	}
+
+	return true;
+}
+
+static size_t read_pattern(struct ffm_shm *shm, size_t size)
+{
+	uint8_t chunk[CHUNK_SIZE];
+	size_t pos = 0;
+
+	while (pos < size) {
+		size_t count = size - pos < CHUNK_SIZE ? size - pos
+						       : CHUNK_SIZE;
+
+		if (ffm_shm_read(shm, chunk, count) != count)
+			break;
+		if (!check_pattern(chunk, pos, count))
+			break;
+		pos += count;
+	}
+
+	return pos;
+}
+
+static void *writer_thread(void *param)
+{
+	struct transfer *t = param;
+
+	sleep_ms(t->delay_ms);
+	t->result = write_pattern(t->shm, t->size) ? t->size : 0;
+	return NULL;
+}
+
+static void *reader_thread(void *param)
+{
+	struct transfer *t = param;
+
+	sleep_ms(t->delay_ms);
+	t->result = read_pattern(t->shm, t->size);
+	return NULL;
+}
+
+static int setup(void **state)
+{
+	struct ring *ring = calloc(1, sizeof(*ring));
+
+	if (!ffm_shm_create(&ring->producer, RING_SIZE)) {
+		free(ring);
+		return -1;
+	}
+
+	*state = ring;
+	return 0;
+}
+
+static int setup_attached(void **state)
+{
+	struct ring *ring;
+
+	if (setup(state) != 0)
+		return -1;
+
+	ring = *state;
+	if (!ffm_shm_open(&ring->consumer, ring->producer.name) ||
+	    !ffm_shm_wait_attach(&ring->producer, 0))
+		return -1;
+
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	struct ring *ring = *state;
+
+	ffm_shm_free(&ring->consumer);
+	ffm_shm_free(&ring->producer);
+	free(ring);
+	return 0;
+}
+
+static void attach_test(void **state)
+{
+	struct ring *ring = *state;
+
+	assert_true(ffm_shm_valid(&ring->producer));
+	assert_int_equal(ring->producer.capacity, RING_SIZE);
+
+	assert_true(ffm_shm_open(&ring->consumer, ring->producer.name));
+	assert_int_equal(ring->consumer.capacity, RING_SIZE);
+	assert_true(ffm_shm_wait_attach(&ring->producer, 1000));
+}
+
+static void attach_timeout_test(void **state)
+{
+	struct ring *ring = *state;
+	char name[FFM_SHM_NAME_SIZE];
+
+	strcpy(name, ring->producer.name);
+
+	/* once the producer has given up, the consumer can't attach */
+	assert_false(ffm_shm_wait_attach(&ring->producer, 0));
+	assert_false(ffm_shm_open(&ring->consumer, name));
+	assert_false(ffm_shm_valid(&ring->consumer));
+}
+
+static void wrap_test(void **state)
+{
+	struct ring *ring = *state;
+	const size_t size = RING_SIZE * 5 / 2;
+	uint8_t data[RING_SIZE / 2 + 1];
+	size_t pos = 0;
+
+	/* more than half a ring at a time, so every other transfer wraps */
+	while (pos < size) {
+		size_t count = size - pos < sizeof(data) ? size - pos
+							 : sizeof(data);
+
+		fill_pattern(data, pos, count);
+		assert_true(ffm_shm_write(&ring->producer, data, count));
+
+		memset(data, 0, count);
+		assert_int_equal(ffm_shm_read(&ring->consumer, data, count),
+				 count);
+		assert_true(check_pattern(data, pos, count));
+		pos += count;
+	}
+}
+
+static void full_ring_test(void **state)
+{
+	struct ring *ring = *state;
+	struct transfer t = {&ring->producer, RING_SIZE * 4, 0, 0};
+	pthread_t thread;
+
+	/* the writer fills the ring and has to wait for the reader, which
+	 * only starts once the ring is full */
+	assert_int_equal(pthread_create(&thread, NULL, writer_thread, &t), 0);
+	sleep_ms(200);
+
+	assert_int_equal(read_pattern(&ring->consumer, t.size), t.size);
+	pthread_join(thread, NULL);
+	assert_int_equal(t.result, t.size);
+}
+
+static void empty_ring_test(void **state)
+{
+	struct ring *ring = *state;
+	struct transfer t = {&ring->consumer, RING_SIZE * 4, 0, 0};
+	pthread_t thread;
+
+	/* the reader waits on an empty ring until the writer starts */
+	assert_int_equal(pthread_create(&thread, NULL, reader_thread, &t), 0);
+	sleep_ms(200);
+
+	assert_true(write_pattern(&ring->producer, t.size));
+	pthread_join(thread, NULL);
+	assert_int_equal(t.result, t.size);
+}
+
+static void close_test(void **state)
+{
+	struct ring *ring = *state;
+	uint8_t data[16];
+
+	assert_true(write_pattern(&ring->producer, 100));
+	ffm_shm_close(&ring->producer);
+
+	/* the data written before closing can still be read, then it's the
+	 * end of the file */
+	assert_int_equal(read_pattern(&ring->consumer, 100), 100);
+	assert_int_equal(ffm_shm_read(&ring->consumer, data, sizeof(data)), 0);
+}
+
+static void reader_closed_test(void **state)
+{
+	struct ring *ring = *state;
+	struct transfer t = {&ring->producer, RING_SIZE * 4, 0, 0};
+	pthread_t thread;
+
+	/* a writer stalled on a full ring fails once the reader detaches */
+	assert_int_equal(pthread_create(&thread, NULL, writer_thread, &t), 0);
+	sleep_ms(200);
+
+	ffm_shm_free(&ring->consumer);
+	pthread_join(thread, NULL);
+	assert_int_equal(t.result, 0);
+
+	assert_false(ffm_shm_write(&ring->producer, "a", 1));
+}
+
+static void stats_test(void **state)
+{
+	struct ring *ring = *state;
+	const int64_t published[3] = {1, -2, 3000000000LL};
+	int64_t stats[FFM_SHM_MAX_STATS + 1] = {0};
+
+	assert_false(ffm_shm_read_stats(&ring->producer, stats, 3));
+
+	ffm_shm_publish_stats(&ring->consumer, published, 3);
+	assert_true(ffm_shm_read_stats(&ring->producer, stats, 3));
+	assert_int_equal(stats[0], published[0]);
+	assert_int_equal(stats[1], published[1]);
+	assert_true(stats[2] == published[2]);
+
+	/* asking for more than was published fills in what there is */
+	stats[1] = 0;
+	assert_false(ffm_shm_read_stats(&ring->producer, stats, 4));
+	assert_int_equal(stats[1], published[1]);
+
+	/* only FFM_SHM_MAX_STATS values are kept */
+	ffm_shm_publish_stats(&ring->consumer, stats, FFM_SHM_MAX_STATS + 1);
+	assert_true(ffm_shm_read_stats(&ring->producer, stats,
+				       FFM_SHM_MAX_STATS));
+
+	/* the last snapshot outlives the consumer */
+	ffm_shm_publish_stats(&ring->consumer, published, 3);
+	ffm_shm_free(&ring->consumer);
+	memset(stats, 0, sizeof(stats));
+	assert_true(ffm_shm_read_stats(&ring->producer, stats, 3));
+	assert_int_equal(stats[1], published[1]);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(attach_test, setup, teardown),
+		cmocka_unit_test_setup_teardown(attach_timeout_test, setup,
+						teardown),
+		cmocka_unit_test_setup_teardown(wrap_test, setup_attached,
+						teardown),
+		cmocka_unit_test_setup_teardown(full_ring_test, setup_attached,
+						teardown),
+		cmocka_unit_test_setup_teardown(empty_ring_test,
+						setup_attached, teardown),
+		cmocka_unit_test_setup_teardown(close_test, setup_attached,
+						teardown),
+		cmocka_unit_test_setup_teardown(reader_closed_test,
+						setup_attached, teardown),
+		cmocka_unit_test_setup_teardown(stats_test, setup_attached,
+						teardown),
+	};
+	int pipe_fds[2];
+
+	/* the consumer takes its stdin becoming readable to mean that the
+	 * producer is gone, so it gets a pipe that nothing is written to */
+	if (pipe(pipe_fds) != 0 || dup2(pipe_fds[0], STDIN_FILENO) == -1)
+		return 1;
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,149 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/file-watch.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define TEST_DIR "test_file_watch_dir"
+#define TEST_FILE TEST_DIR "/file.txt"
+#define OTHER_FILE TEST_DIR "/other.txt"
+
+/* long enough for the polling fallback, which can take two intervals to see
+ * a change */
+#define TIMEOUT_MS 5000
+
+struct watch_data {
+	os_event_t *event;
+	volatile long calls;
+};
+
+static void watch_cb(void *param, const char *path)
+{
+	struct watch_data *data = param;
+
+	os_atomic_inc_long(&data->calls);
+	os_event_signal(data->event);
+
+	UNUSED_PARAMETER(path);
+}
+
+static bool wait_for_call(struct watch_data *data, unsigned long ms)
+{
+	return os_event_timedwait(data->event, ms) == 0;
+}
+
+static int setup(void **state)
+{
+	struct watch_data *data = bzalloc(sizeof(*data));
+
+	if (os_event_init(&data->event, OS_EVENT_TYPE_AUTO) != 0) {
+		bfree(data);
+		return -1;
+	}
+
+	os_mkdir(TEST_DIR);
+	os_quick_write_utf8_file(TEST_FILE, "a", 1, false);
+
+	*state = data;
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	struct watch_data *data = *state;
+
+	os_unlink(TEST_FILE);
+	os_unlink(OTHER_FILE);
+	os_rmdir(TEST_DIR);
+
+	os_event_destroy(data->event);
+	bfree(data);
+	return 0;
+}
+
+static void invalid_args_test(void **state)
+{
+	assert_null(os_file_watch_add(NULL, watch_cb, *state));
+	assert_null(os_file_watch_add("", watch_cb, *state));
+	assert_null(os_file_watch_add(TEST_FILE, NULL, *state));
+
+	/* removing nothing is allowed */
+	os_file_watch_remove(NULL);
+}
+
+static void file_modified_test(void **state)
+{
+	struct watch_data *data = *state;
+	os_file_watch_t *watch = os_file_watch_add(TEST_FILE, watch_cb, data);
+
+	assert_non_null(watch);
+
+	/* a new size is seen even with a coarse mtime when polling */
+	os_quick_write_utf8_file(TEST_FILE, "abc", 3, false);
+	assert_true(wait_for_call(data, TIMEOUT_MS));
+
+	os_file_watch_remove(watch);
+}
+
+static void file_unrelated_test(void **state)
+{
+	struct watch_data *data = *state;
+	os_file_watch_t *watch = os_file_watch_add(TEST_FILE, watch_cb, data);
+
+	assert_non_null(watch);
+
+	/* files next to the watched file don't trigger it */
+	os_quick_write_utf8_file(OTHER_FILE, "b", 1, false);
+	assert_false(wait_for_call(data, 1500));
+	assert_int_equal(data->calls, 0);
+
+	os_file_watch_remove(watch);
+}
+
+static void directory_test(void **state)
+{
+	struct watch_data *data = *state;
+	os_file_watch_t *watch = os_file_watch_add(TEST_DIR, watch_cb, data);
+
+	assert_non_null(watch);
+
+	os_quick_write_utf8_file(OTHER_FILE, "b", 1, false);
+	assert_true(wait_for_call(data, TIMEOUT_MS));
+
+	os_file_watch_remove(watch);
+}
+
+static void removed_test(void **state)
+{
+	struct watch_data *data = *state;
+	os_file_watch_t *watch = os_file_watch_add(TEST_FILE, watch_cb, data);
+
+	assert_non_null(watch);
+	os_file_watch_remove(watch);
+
+	/* the callback isn't called once the watch has been removed */
+	os_quick_write_utf8_file(TEST_FILE, "abcd", 4, false);
+	assert_false(wait_for_call(data, 1500));
+	assert_int_equal(data->calls, 0);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(invalid_args_test, setup,
+						teardown),
+		cmocka_unit_test_setup_teardown(file_modified_test, setup,
+						teardown),
+		cmocka_unit_test_setup_teardown(file_unrelated_test, setup,
+						teardown),
+		cmocka_unit_test_setup_teardown(directory_test, setup,
+						teardown),
+		cmocka_unit_test_setup_teardown(removed_test, setup, teardown),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,171 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "obs-internal.h"
+
+#define FRAME_CX 640
+#define FRAME_CY 360
+#define POOL_LIMIT (64ULL * 1024 * 1024)
+
+static int setup(void **state)
+{
+	free_frame_pool();
+	obs_set_frame_pool_limit(POOL_LIMIT);
+
+	UNUSED_PARAMETER(state);
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	free_frame_pool();
+
+	UNUSED_PARAMETER(state);
+	return 0;
+}
+
+static void acquire_release_test(void **state)
+{
+	struct obs_frame_pool_stats stats;
+	struct obs_source_frame *frame;
+	struct obs_source_frame *reused;
+
+	frame = frame_pool_acquire(VIDEO_FORMAT_I420, FRAME_CX, FRAME_CY);
+	assert_non_null(frame);
+	assert_true(frame->pooled);
+	assert_int_equal(frame->width, FRAME_CX);
+	assert_int_equal(frame->height, FRAME_CY);
+	assert_non_null(frame->data[0]);
+
+	obs_get_frame_pool_stats(&stats);
+	assert_int_equal(stats.misses, 1);
+	assert_int_equal(stats.hits, 0);
+	assert_int_equal(stats.idle_frames, 0);
+
+	frame->refs = 3;
+	frame->prev_frame = true;
+	frame_pool_release(frame);
+
+	obs_get_frame_pool_stats(&stats);
+	assert_int_equal(stats.idle_frames, 1);
+	assert_true(stats.idle_bytes >= FRAME_CX * FRAME_CY * 3 / 2);
+	assert_int_equal(stats.peak_idle_bytes, stats.idle_bytes);
+
+	/* the same frame comes back, with its libobs state reset */
+	reused = frame_pool_acquire(VIDEO_FORMAT_I420, FRAME_CX, FRAME_CY);
+	assert_ptr_equal(reused, frame);
+	assert_int_equal(reused->refs, 0);
+	assert_false(reused->prev_frame);
+
+	obs_get_frame_pool_stats(&stats);
+	assert_int_equal(stats.hits, 1);
+	assert_int_equal(stats.misses, 1);
+	assert_int_equal(stats.idle_frames, 0);
+	assert_int_equal(stats.idle_bytes, 0);
+
+	frame_pool_release(reused);
+	UNUSED_PARAMETER(state);
+}
+
+static void bucket_test(void **state)
+{
+	struct obs_frame_pool_stats stats;
+	struct obs_source_frame *small;
+	struct obs_source_frame *large;
+	struct obs_source_frame *frame;
+
+	small = frame_pool_acquire(VIDEO_FORMAT_I420, FRAME_CX, FRAME_CY);
+	large = frame_pool_acquire(VIDEO_FORMAT_I420, FRAME_CX * 2,
+				   FRAME_CY * 2);
+	frame_pool_release(small);
+	frame_pool_release(large);
+
+	/* a different format or size doesn't get a pooled frame */
+	frame = frame_pool_acquire(VIDEO_FORMAT_NV12, FRAME_CX, FRAME_CY);
+	assert_ptr_not_equal(frame, small);
+	assert_ptr_not_equal(frame, large);
+	frame_pool_release(frame);
+
+	frame = frame_pool_acquire(VIDEO_FORMAT_I420, FRAME_CX * 2,
+				   FRAME_CY * 2);
+	assert_ptr_equal(frame, large);
+	frame_pool_release(frame);
+
+	obs_get_frame_pool_stats(&stats);
+	assert_int_equal(stats.hits, 1);
+	assert_int_equal(stats.misses, 3);
+	assert_int_equal(stats.idle_frames, 3);
+	UNUSED_PARAMETER(state);
+}
+
+static void limit_test(void **state)
+{
+	struct obs_source_frame *frames[3];
+	struct obs_frame_pool_stats stats;
+	uint64_t frame_size;
+
+	for (size_t i = 0; i < 3; i++)
+		frames[i] = frame_pool_acquire(VIDEO_FORMAT_I420, FRAME_CX,
+					       FRAME_CY);
+
+	frame_pool_release(frames[0]);
+	obs_get_frame_pool_stats(&stats);
+	frame_size = stats.idle_bytes;
+
+	/* frames past the limit are released right away */
+	obs_set_frame_pool_limit(frame_size);
+	frame_pool_release(frames[1]);
+	frame_pool_release(frames[2]);
+
+	obs_get_frame_pool_stats(&stats);
+	assert_int_equal(stats.limit, frame_size);
+	assert_int_equal(stats.idle_frames, 1);
+	assert_int_equal(stats.idle_bytes, frame_size);
+	assert_int_equal(stats.evictions, 2);
+
+	/* lowering the limit trims the pool immediately */
+	obs_set_frame_pool_limit(0);
+	obs_get_frame_pool_stats(&stats);
+	assert_int_equal(stats.idle_frames, 0);
+	assert_int_equal(stats.idle_bytes, 0);
+	assert_int_equal(stats.evictions, 3);
+	UNUSED_PARAMETER(state);
+}
+
+static void foreign_frame_test(void **state)
+{
+	struct obs_frame_pool_stats stats;
+	struct obs_source_frame *frame;
+
+	/* frames the pool didn't create are destroyed, not pooled */
+	frame = obs_source_frame_create(VIDEO_FORMAT_I420, FRAME_CX, FRAME_CY);
+	assert_false(frame->pooled);
+	frame_pool_release(frame);
+
+	obs_get_frame_pool_stats(&stats);
+	assert_int_equal(stats.idle_frames, 0);
+	assert_int_equal(stats.idle_bytes, 0);
+
+	frame = frame_pool_acquire(VIDEO_FORMAT_I420, FRAME_CX, FRAME_CY);
+	obs_get_frame_pool_stats(&stats);
+	assert_int_equal(stats.hits, 0);
+
+	frame_pool_release(frame);
+	UNUSED_PARAMETER(state);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(acquire_release_test, setup,
+						teardown),
+		cmocka_unit_test_setup_teardown(bucket_test, setup, teardown),
+		cmocka_unit_test_setup_teardown(limit_test, setup, teardown),
+		cmocka_unit_test_setup_teardown(foreign_frame_test, setup,
+						teardown),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,184 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+
+#include "net-bwe.h"
+
+#define MS_NS 1000000ULL
+#define PACKET_SIZE 1400
+#define SEND_BUFFER_SIZE (64 * 1024)
+
+/* a bottleneck link behind a local send buffer: the sender blocks while the
+ * buffer is full, and the buffer drains at the link capacity except while
+ * the link is stalled recovering from a loss */
+struct link_sim {
+	uint64_t now_ns;
+	double capacity_kbps;
+	double queue_bytes;
+	uint64_t stall_end_ns;
+	uint32_t base_rtt_ms;
+};
+
+static void link_advance(struct link_sim *link, uint64_t to_ns)
+{
+	if (link->now_ns < link->stall_end_ns) {
+		if (to_ns <= link->stall_end_ns) {
+			link->now_ns = to_ns;
+			return;
+		}
+		link->now_ns = link->stall_end_ns;
+	}
+
+	link->queue_bytes -= (double)(to_ns - link->now_ns) *
+			     link->capacity_kbps / 8000000.0;
+	if (link->queue_bytes < 0.0)
+		link->queue_bytes = 0.0;
+	link->now_ns = to_ns;
+}
+
+/* the RTT grows with the time a packet spends waiting in the buffer */
+static uint32_t link_rtt_ms(const struct link_sim *link)
+{
+	double queue_ms = link->queue_bytes * 8.0 / link->capacity_kbps;
+	return link->base_rtt_ms + (uint32_t)queue_ms;
+}
+
+static void link_send(struct link_sim *link, struct net_bwe *bwe,
+		      double offered_kbps, uint64_t duration_ns)
+{
+	const uint64_t packet_ns =
+		(uint64_t)(PACKET_SIZE * 8000000.0 / offered_kbps);
+	const uint64_t end_ns = link->now_ns + duration_ns;
+
+	while (link->now_ns < end_ns) {
+		uint64_t send_beg = link->now_ns;
+		int64_t outq;
+
+		while (link->queue_bytes + PACKET_SIZE > SEND_BUFFER_SIZE)
+			link_advance(link, link->now_ns + MS_NS);
+		link->queue_bytes += PACKET_SIZE;
+
+		outq = (int64_t)link->queue_bytes;
+		if (net_bwe_add_sample(bwe, PACKET_SIZE, send_beg,
+				       link->now_ns, outq))
+			net_bwe_add_rtt(bwe, link_rtt_ms(link));
+
+		if (link->now_ns < send_beg + packet_ns)
+			link_advance(link, send_beg + packet_ns);
+	}
+}
+
+static void init_sim(struct link_sim *link, struct net_bwe *bwe,
+		     double capacity_kbps)
+{
+	link->now_ns = 1000 * MS_NS;
+	link->capacity_kbps = capacity_kbps;
+	link->queue_bytes = 0.0;
+	link->stall_end_ns = 0;
+	link->base_rtt_ms = 40;
+	net_bwe_reset(bwe);
+}
+
+static void assert_within(long value, double expected, double tolerance)
+{
+	if (fabs((double)value - expected) > expected * tolerance)
+		fail_msg("estimate %ld kbps, expected %.0f kbps +/- %.0f%%",
+			 value, expected, tolerance * 100.0);
+}
+
+static void link_limited_test(void **state)
+{
+	struct link_sim link;
+	struct net_bwe bwe;
+
+	init_sim(&link, &bwe, 2000.0);
+	assert_int_equal(net_bwe_get_kbps(&bwe), 0);
+
+	link_send(&link, &bwe, 3000.0, 10000 * MS_NS);
+	assert_within(net_bwe_get_kbps(&bwe), 2000.0, 0.1);
+
+	/* the buffer stays full, so the path shows up as queueing */
+	assert_true(net_bwe_rtt_inflated(&bwe));
+}
+
+static void app_limited_test(void **state)
+{
+	struct link_sim link;
+	struct net_bwe bwe;
+
+	init_sim(&link, &bwe, 5000.0);
+
+	link_send(&link, &bwe, 1000.0, 10000 * MS_NS);
+	assert_within(net_bwe_get_kbps(&bwe), 1000.0, 0.1);
+	assert_false(net_bwe_rtt_inflated(&bwe));
+
+	/* idle periods can only raise the estimate, never lower it */
+	link_send(&link, &bwe, 500.0, 5000 * MS_NS);
+	assert_within(net_bwe_get_kbps(&bwe), 1000.0, 0.1);
+}
+
+static void capacity_drop_test(void **state)
+{
+	struct link_sim link;
+	struct net_bwe bwe;
+
+	init_sim(&link, &bwe, 4000.0);
+
+	link_send(&link, &bwe, 5000.0, 5000 * MS_NS);
+	assert_within(net_bwe_get_kbps(&bwe), 4000.0, 0.1);
+
+	link.capacity_kbps = 1500.0;
+	link_send(&link, &bwe, 5000.0, 5000 * MS_NS);
+	assert_within(net_bwe_get_kbps(&bwe), 1500.0, 0.1);
+}
+
+static void loss_test(void **state)
+{
+	struct link_sim link;
+	struct net_bwe bwe;
+
+	init_sim(&link, &bwe, 3000.0);
+
+	/* stall for 50ms out of every 500ms, as if recovering from a loss,
+	 * which leaves 90% of the capacity */
+	for (int i = 0; i < 40; i++) {
+		link.stall_end_ns = link.now_ns + 50 * MS_NS;
+		link_send(&link, &bwe, 4000.0, 500 * MS_NS);
+	}
+
+	assert_within(net_bwe_get_kbps(&bwe), 2700.0, 0.15);
+}
+
+static void rtt_trace_test(void **state)
+{
+	static const uint32_t trace[] = {40, 42, 38, 41, 39, 60, 90, 120, 45};
+	static const bool inflated[] = {false, false, false, false, false,
+					false, true,  true,  false};
+	struct net_bwe bwe;
+
+	net_bwe_reset(&bwe);
+	assert_false(net_bwe_rtt_inflated(&bwe));
+
+	for (size_t i = 0; i < sizeof(trace) / sizeof(trace[0]); i++) {
+		net_bwe_add_rtt(&bwe, trace[i]);
+		assert_int_equal(net_bwe_rtt_inflated(&bwe), inflated[i]);
+	}
+
+	assert_int_equal(bwe.min_rtt_ms, 38);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(link_limited_test),
+		cmocka_unit_test(app_limited_test),
+		cmocka_unit_test(capacity_drop_test),
+		cmocka_unit_test(loss_test),
+		cmocka_unit_test(rtt_trace_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,191 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <string.h>
+
+#include "pulseaudio-mix.h"
+
+#define CHANNELS 2
+#define TICK_FRAMES 256
+#define BUFFER_FRAMES 512
+
+struct test_mix {
+	float planes[CHANNELS][AUDIO_OUTPUT_FRAMES];
+	float *mix[CHANNELS];
+};
+
+static void clear_mix(struct test_mix *m)
+{
+	memset(m->planes, 0, sizeof(m->planes));
+	for (size_t ch = 0; ch < CHANNELS; ch++)
+		m->mix[ch] = m->planes[ch];
+}
+
+/* pushes 'frames' of a ramp starting at 'start', with the right channel
+ * negated */
+static void push_ramp(struct monitor_input *input, float start, size_t frames,
+		      float vol, bool muted)
+{
+	float left[BUFFER_FRAMES * 4];
+	float right[BUFFER_FRAMES * 4];
+	const uint8_t *data[CHANNELS] = {(uint8_t *)left, (uint8_t *)right};
+
+	for (size_t i = 0; i < frames; i++) {
+		left[i] = start + (float)i;
+		right[i] = -left[i];
+	}
+
+	monitor_input_push(input, data, frames, CHANNELS, vol, muted,
+			   BUFFER_FRAMES);
+}
+
+static void mix_tick(struct monitor_input *input, struct test_mix *m)
+{
+	monitor_input_mix(input, m->mix, TICK_FRAMES, CHANNELS, BUFFER_FRAMES);
+}
+
+static void assert_float_near(float value, float expected)
+{
+	assert_true(value > expected - 0.001f && value < expected + 0.001f);
+}
+
+static void buffering_test(void **state)
+{
+	struct monitor_input input = {0};
+	struct test_mix m;
+
+	monitor_input_reset(&input);
+	clear_mix(&m);
+
+	/* nothing is mixed until the jitter buffer is full */
+	push_ramp(&input, 1.0f, BUFFER_FRAMES - 1, 1.0f, false);
+	mix_tick(&input, &m);
+	assert_float_near(m.planes[0][0], 0.0f);
+
+	push_ramp(&input, (float)BUFFER_FRAMES, 1, 1.0f, false);
+	mix_tick(&input, &m);
+	assert_float_near(m.planes[0][0], 1.0f);
+	assert_float_near(m.planes[1][0], -1.0f);
+	assert_float_near(m.planes[0][TICK_FRAMES - 1], (float)TICK_FRAMES);
+
+	/* the rest is mixed in the next tick */
+	clear_mix(&m);
+	mix_tick(&input, &m);
+	assert_float_near(m.planes[0][0], (float)TICK_FRAMES + 1.0f);
+
+	monitor_input_reset(&input);
+	UNUSED_PARAMETER(state);
+}
+
+static void run_dry_test(void **state)
+{
+	struct monitor_input input = {0};
+	struct test_mix m;
+
+	monitor_input_reset(&input);
+	clear_mix(&m);
+
+	push_ramp(&input, 1.0f, BUFFER_FRAMES + TICK_FRAMES / 2, 1.0f, false);
+	mix_tick(&input, &m);
+	mix_tick(&input, &m);
+
+	/* what's left is mixed when the source runs dry, and the rest of the
+	 * tick stays silent */
+	clear_mix(&m);
+	mix_tick(&input, &m);
+	assert_float_near(m.planes[0][0], (float)BUFFER_FRAMES + 1.0f);
+	assert_float_near(m.planes[0][TICK_FRAMES / 2], 0.0f);
+
+	/* then it buffers again before being mixed */
+	clear_mix(&m);
+	push_ramp(&input, 1.0f, TICK_FRAMES, 1.0f, false);
+	mix_tick(&input, &m);
+	assert_float_near(m.planes[0][0], 0.0f);
+
+	push_ramp(&input, 1.0f, BUFFER_FRAMES - TICK_FRAMES, 1.0f, false);
+	mix_tick(&input, &m);
+	assert_float_near(m.planes[0][0], 1.0f);
+
+	monitor_input_reset(&input);
+	UNUSED_PARAMETER(state);
+}
+
+static void two_inputs_test(void **state)
+{
+	struct monitor_input a = {0};
+	struct monitor_input b = {0};
+	struct test_mix m;
+	float expected;
+
+	monitor_input_reset(&a);
+	monitor_input_reset(&b);
+	clear_mix(&m);
+
+	push_ramp(&a, 1.0f, BUFFER_FRAMES, 1.0f, false);
+	push_ramp(&b, 100.0f, BUFFER_FRAMES, 0.5f, false);
+
+	/* both sources are summed into the same submix, with their volume */
+	mix_tick(&a, &m);
+	mix_tick(&b, &m);
+	assert_float_near(m.planes[0][0], 1.0f + 50.0f);
+	assert_float_near(m.planes[1][0], -1.0f - 50.0f);
+	assert_float_near(m.planes[0][10], 11.0f + 55.0f);
+
+	/* a muted source queues silence behind what it already queued */
+	clear_mix(&m);
+	push_ramp(&b, 1.0f, BUFFER_FRAMES, 1.0f, true);
+	mix_tick(&a, &m);
+	mix_tick(&b, &m);
+	expected = (float)TICK_FRAMES + 1.0f +
+		   ((float)TICK_FRAMES + 100.0f) * 0.5f;
+	assert_float_near(m.planes[0][0], expected);
+
+	clear_mix(&m);
+	mix_tick(&a, &m);
+	mix_tick(&b, &m);
+	assert_float_near(m.planes[0][0], 0.0f);
+	assert_int_equal(b.buf[0].size, BUFFER_FRAMES / 2 * sizeof(float));
+
+	monitor_input_reset(&a);
+	monitor_input_reset(&b);
+	UNUSED_PARAMETER(state);
+}
+
+static void overflow_test(void **state)
+{
+	const size_t max_frames = BUFFER_FRAMES * 2 + AUDIO_OUTPUT_FRAMES;
+	struct monitor_input input = {0};
+	struct test_mix m;
+
+	monitor_input_reset(&input);
+	clear_mix(&m);
+
+	/* a source that delivers faster than it's mixed loses its oldest
+	 * audio instead of adding latency */
+	push_ramp(&input, 1.0f, BUFFER_FRAMES * 4, 1.0f, false);
+	push_ramp(&input, (float)BUFFER_FRAMES * 4 + 1.0f, BUFFER_FRAMES, 1.0f,
+		  false);
+	assert_int_equal(input.buf[0].size, max_frames * sizeof(float));
+	assert_int_equal(input.buf[1].size, max_frames * sizeof(float));
+
+	mix_tick(&input, &m);
+	assert_float_near(m.planes[0][0],
+			  (float)(BUFFER_FRAMES * 5 - max_frames) + 1.0f);
+
+	monitor_input_reset(&input);
+	UNUSED_PARAMETER(state);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(buffering_test),
+		cmocka_unit_test(run_dry_test),
+		cmocka_unit_test(two_inputs_test),
+		cmocka_unit_test(overflow_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}